@@ -6,63 +6,137 @@
  * - Автоматическое включение при потоке >0.5л/мин
  * - Плавный разгон за 2 секунды
  * - PID регулирование температуры 40-65°C
- * - Режим покоя для экономии ресурсов
- * - Защитные функции
+ * - Режим покоя: пониженная частота CPU и light sleep без потока
+ * - Защитные функции (отдельная задача супервизора и сторожевой таймер)
  */
 
 #include "system_controller.h"
 #include "web_server.h"
 #include "config_storage.h"
 #include "boot_button.h"
+#include "terminal_commands.h"
+#include "command_registry.h"
+#include "telemetry_recorder.h"
+#include "history_store.h"
 #include "sensors.h"
+#include "logger.h"
+#include "safety_supervisor.h"
+#include "power_manager.h"
+#include "cpu_frequency.h"
+#include "perf_profiler.h"
+#include "bench_suite.h"
+#include "memory_monitor.h"
+#include "mains_sensing.h"
 #include "config.h"
 
 SystemController systemController;
 WebServerManager webServer;
 SystemState systemState;
 BootButtonDetector bootButton;
+TerminalCommands terminal;
+TelemetryRecorder telemetry;
+HistoryStore history;
+PowerManager power;
 
 void setup() {
     // Инициализация последовательного порта
     Serial.begin(SERIAL_BAUD_RATE);
     delay(1000);
     
+    // Асинхронный вывод логов (вызовы LOG_* в цикле управления только ставят сообщение в очередь)
+    Logger::begin();
+    
+    // Частота CPU по блокировкам подсистем (в покое - базовая)
+    CpuFrequency::begin();
+    
     Serial.println("=== ПРОТОЧНЫЙ ВОДОНАГРЕВАТЕЛЬ ===");
     Serial.println("Инициализация системы...");
     
-    // Инициализация EEPROM для хранения конфигурации
+    // Инициализация хранилища конфигурации (журнал во flash)
     ConfigStorage::begin();
     
-    // Загрузка конфигурации из EEPROM
+    // Загрузка конфигурации
     if (!systemState.loadConfiguration()) {
         Serial.println("Используем настройки по умолчанию");
     }
     
+    // Измерение напряжения и тока через DMA (до датчиков: NTC на выходе
+    // опрашивается в том же шаблоне АЦП)
+    MainsSensing::begin();
+    
     // Инициализация системы управления
     systemController.begin();
     
-    // Настройка параметров системы из загруженной конфигурации
-    systemController.setMinFlowRate(MIN_FLOW_RATE_DEFAULT);        // Минимальный поток 0.5 л/мин
-    systemController.setTargetTemperature(systemState.targetTemp); // Целевая температура из конфигурации
-    systemController.setTemperatureRange(MIN_TEMP_DEFAULT, MAX_TEMP_DEFAULT); // Диапазон 40-65°C
-    systemController.setRampUpTime(RAMP_UP_TIME_MS);      // Разгон за 2 секунды
+    // Настройка параметров системы из загруженной конфигурации (ConfigRegistry)
+    systemController.applyConfig();
+    
+    // Команды терминала (Serial и веб используют одну таблицу)
+    terminal.begin(&systemController);
     
     // Инициализация веб-сервера
     webServer.begin();
     webServer.setSystemController(&systemController);
+    BenchSuite::setWebServer(&webServer);
+    webServer.setSessionTimeout(ConfigRegistry::getUInt(PARAM_WIFI_SESSION_TIMEOUT) * 1000UL);
+    
+    // Запись телеметрии высокой частоты
+    telemetry.begin();
+    webServer.setTelemetryRecorder(&telemetry);
+    
+    // История для графиков веб-интерфейса (1 с / 1 мин / 15 мин)
+    history.begin();
+    webServer.setHistoryStore(&history);
     
     // Инициализация детектора кнопки BOOT
     bootButton.begin();
     
+    // Энергосбережение в покое (light sleep с пробуждением по потоку/кнопке)
+    power.begin();
+    webServer.setPowerManager(&power);
+    
+    // Супервизор безопасности и сторожевой таймер запускаем последними:
+    // инициализация выше может занимать больше таймаута
+    SafetySupervisor::begin(&systemController);
+    
+    // Учет памяти: куча и запас стека задач
+    MemoryMonitor::registerTask(xTaskGetCurrentTaskHandle());
+    MemoryMonitor::registerTask(Logger::getTaskHandle());
+    MemoryMonitor::registerTask(SafetySupervisor::getTaskHandle());
+    MemoryMonitor::registerTask(MainsSensing::getTaskHandle());
+    MemoryMonitor::begin();
+    
     Serial.println("Система готова к работе!");
     Serial.println("Мониторинг данных в реальном времени...");
     Serial.println("=====================================");
 }
 
 void loop() {
+    // Время прохода без учета сна (PowerManager::update) - для /perf
+    PERF_BEGIN(loopStart);
+    
+    // Отметка для сторожевого таймера: зависание loop приводит к перезагрузке
+    SafetySupervisor::feedWatchdog();
+    
     // Обновляем систему управления
     systemController.update();
     
+    // Отложенная запись настроек во flash
+    ConfigStorage::update();
+    
+    // Записываем отсчет телеметрии (10-100 Гц)
+    telemetry.update(systemController);
+    
+    // Накапливаем историю для графиков
+    float historyValues[HISTORY_METRIC_COUNT];
+    historyValues[HISTORY_TEMPERATURE] = systemController.getCurrentTemperature();
+    historyValues[HISTORY_FLOW] = systemController.getCurrentFlowRate();
+    historyValues[HISTORY_POWER] = systemController.getCurrentPower();
+    historyValues[HISTORY_DELIVERED_POWER] = systemController.getEnergyMeter().getTotalDeliveredPower();
+    history.addSample(historyValues);
+    
+    // Команды Serial и шаги фоновых заданий терминала (не блокируют цикл)
+    terminal.update();
+    
     // Обновляем детектор кнопки BOOT
     bootButton.update();
     
@@ -79,67 +153,74 @@ void loop() {
     webServer.handleClient();
     
     // Простой тест детектора нуля каждые 10 секунд
-    static unsigned long lastTestTime = 0;
-    if (millis() - lastTestTime > 10000) {
-        Serial.println("=== ТЕСТ ДЕТЕКТОРА НУЛЯ ===");
-        Serial.print("Пин 15: ");
-        Serial.println(digitalRead(ZERO_CROSS_PIN) ? "HIGH" : "LOW");
-        Serial.print("Пин 21: ");
-        Serial.println(digitalRead(TRIAC_L1_PIN) ? "HIGH" : "LOW");
-        Serial.print("Пин 19: ");
-        Serial.println(digitalRead(TRIAC_L2_PIN) ? "HIGH" : "LOW");
-        Serial.print("Пин 18: ");
-        Serial.println(digitalRead(TRIAC_L3_PIN) ? "HIGH" : "LOW");
-        Serial.println("==========================");
-        
-        // Дополнительная диагностика датчика потока
-        Serial.println("=== ДАТЧИК ПОТОКА ===");
-        Serial.print("Пин 35: ");
-        Serial.println(digitalRead(FLOW_SENSOR_PIN) ? "HIGH" : "LOW");
-        Serial.print("Поток: ");
-        Serial.print(systemController.getCurrentFlowRate(), 2);
-        Serial.print(" л/мин, Обнаружен: ");
-        Serial.println(systemController.isWaterFlowing() ? "ДА" : "НЕТ");
-        Serial.println("=====================");
-        
-        // Расширенная диагностика датчика протока
-        Serial.println("--- ДАТЧИК ПОТОКА ---");
-        Serial.print("Импульсы: ");
-        Serial.print(systemController.getSensors().getFlowPulseCount());
-        Serial.print(", Последний импульс: ");
-        Serial.print(systemController.getSensors().getTimeSinceLastPulse());
-        Serial.println(" мс назад");
-        Serial.print("Сырое значение пина: ");
-        Serial.println(digitalRead(FLOW_SENSOR_PIN) ? "HIGH" : "LOW");
-        Serial.print("Скорость потока: ");
-        Serial.print(systemController.getCurrentFlowRate(), 2);
-        Serial.print(" л/мин, Обнаружен: ");
-        Serial.println(systemController.isWaterFlowing() ? "ДА" : "НЕТ");
-        Serial.println("--------------------");
-        
-        lastTestTime = millis();
+    if (LOG_ENABLED(MAIN, LOG_LEVEL_DEBUG)) {
+        static unsigned long lastTestTime = 0;
+        if (millis() - lastTestTime > 10000) {
+            LOG_D(MAIN, "Пины: ZC(%d)=%s, L1(%d)=%s, L2(%d)=%s, L3(%d)=%s",
+                  ZERO_CROSS_PIN, digitalRead(ZERO_CROSS_PIN) ? "HIGH" : "LOW",
+                  TRIAC_L1_PIN, digitalRead(TRIAC_L1_PIN) ? "HIGH" : "LOW",
+                  TRIAC_L2_PIN, digitalRead(TRIAC_L2_PIN) ? "HIGH" : "LOW",
+                  TRIAC_L3_PIN, digitalRead(TRIAC_L3_PIN) ? "HIGH" : "LOW");
+            
+            // Диагностика датчика потока
+            LOG_D(MAIN, "Датчик потока (пин %d=%s): импульсы: %lu, последний импульс: %lu мс назад, поток: %.2f л/мин, обнаружен: %s",
+                  FLOW_SENSOR_PIN, digitalRead(FLOW_SENSOR_PIN) ? "HIGH" : "LOW",
+                  systemController.getSensors().getFlowPulseCount(),
+                  systemController.getSensors().getTimeSinceLastPulse(),
+                  systemController.getCurrentFlowRate(),
+                  systemController.isWaterFlowing() ? "ДА" : "НЕТ");
+            
+            lastTestTime = millis();
+        }
     }
     
-    // Убираем задержку для максимальной скорости чтения детектора
-    // delay(10);
+    // Снимок кучи и стеков, предупреждение о фрагментации
+    MemoryMonitor::update();
+    
+    PERF_END(PERF_LOOP, loopStart);
+    
+    // Без потока и WiFi сессии засыпаем до следующего прохода loop
+    // (вместо задержки: пробуждение по импульсу потока, кнопке, UART или таймеру)
+    power.update(systemController,
+                 bootButton.getClickCount() > 0 || CommandRegistry::isJobActive(),
+                 webServer.isWiFiSessionActive());
 }
 
 void updateSystemState() {
     // Обновляем состояние системы для веб-интерфейса
     systemState.currentTemp = systemController.getCurrentTemperature();
+    systemState.inletTemp = systemController.getSensors().getInletTemperature();
+    systemState.isInletMeasured = systemController.getSensors().isInletMeasured();
     systemState.targetTemp = systemController.getTargetTemperature();
+    systemState.flowCalibrationFactor = ConfigRegistry::get(PARAM_FLOW_CALIBRATION);
     systemState.flowRate = systemController.getCurrentFlowRate();
     systemState.isHeating = systemController.isHeatingEnabled();
     systemState.isFlowDetected = systemController.isWaterFlowing();
     systemState.isSystemEnabled = !systemController.isEmergencyStop();
     systemState.currentTargetPower = systemController.getCurrentPower();
+    systemState.isPowerRamping = !systemController.getRampEngine().isSettled();
+    
+    // Учет энергии
+    const EnergyMeter& energy = systemController.getEnergyMeter();
+    for (int i = 0; i < 3; i++) {
+        systemState.heatingPower[i] = energy.getDeliveredPower(i) / energy.getElementPower() * 100.0;
+        systemState.targetPower[i] = systemController.getCurrentPower();
+        systemState.energyPhaseKWh[i] = energy.getPhaseEnergyKWh(i);
+    }
+    systemState.deliveredPowerW = energy.getTotalDeliveredPower();
+    systemState.energyTotalKWh = energy.getTotalEnergyKWh();
+    systemState.litresHeated = energy.getLitresHeated();
+    systemState.energyCost = energy.getCost();
     
     // Обновляем состояние WiFi сессии
     systemState.isWiFiEnabled = webServer.isWiFiSessionActive();
     systemState.wifiSessionStartTime = webServer.isWiFiSessionActive() ? 
         (millis() - webServer.getSessionTimeLeft()) : 0;
-    systemState.systemMode = webServer.isWiFiSessionActive() ? 
-        SYSTEM_MODE_WIFI_SESSION : SYSTEM_MODE_ACTIVE;
+    if (webServer.isWiFiSessionActive()) {
+        systemState.systemMode = SYSTEM_MODE_WIFI_SESSION;
+    } else {
+        systemState.systemMode = power.isIdle() ? SYSTEM_MODE_SLEEP : SYSTEM_MODE_ACTIVE;
+    }
     
     // Обновляем состояние в веб-сервере
     webServer.updateStatus(systemState);
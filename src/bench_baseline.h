@@ -0,0 +1,36 @@
+#ifndef BENCH_BASELINE_H
+#define BENCH_BASELINE_H
+
+#include <Arduino.h>
+
+// ========================================
+// БАЗОВЫЕ ЗНАЧЕНИЯ ТЕСТОВ ПРОИЗВОДИТЕЛЬНОСТИ
+// ========================================
+//
+// Такты и байты кучи на операцию, с которыми сравнивается "bench" и
+// GET /bench. Значения снимаются на плате командой "bench baseline"
+// (ESP32-WROOM-32, сборка по умолчанию) и заменяют строки ниже целиком.
+// 0 тактов - базового значения нет: тест измеряется, но прогон не
+// считается пройденным, пока значения не сняты.
+
+struct BenchBaseline {
+    const char* name;
+    uint32_t cycles;
+    uint32_t bytes;
+};
+
+static const BenchBaseline BENCH_BASELINE[] = {
+    { "pid_compute",    0, 0 },
+    { "fire_delay",     0, 0 },
+    { "ntc_convert",    0, 0 },
+    { "temp_filter",    0, 0 },
+    { "json_status",    0, 0 },
+    { "json_config",    0, 0 },
+    { "json_sensors",   0, 0 },
+    { "terminal_log",   0, 0 },
+    { "config_load",    0, 0 },
+    { "config_compare", 0, 0 },
+    { "config_save",    0, 0 },
+};
+
+#endif
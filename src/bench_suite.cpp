@@ -0,0 +1,298 @@
+#include "bench_suite.h"
+#include "bench_baseline.h"
+#include "pid_controller.h"
+#include "phase_controller.h"
+#include "sensors.h"
+#include "web_server.h"
+#include "terminal_manager.h"
+#include "config_storage.h"
+#include "cpu_frequency.h"
+#include "perf_profiler.h"
+#include "safety_supervisor.h"
+#include "request_arena.h"
+#include <new>
+
+WebServerManager* BenchSuite::webServer = nullptr;
+uint32_t BenchSuite::minFreeHeap = 0;
+
+namespace {
+
+// Объекты тестов: отдельные экземпляры, рабочие не затрагиваются
+struct BenchFixture {
+    PIDController pid;
+    PhaseController phase;
+    TemperatureSensor sensor;
+    String savedLog;
+    volatile float sink;
+};
+
+BenchFixture* fixture = nullptr;
+WebServerManager* web = nullptr;
+
+const TemperatureChannelConfig BENCH_CHANNEL = {
+    "bench", -1, NOMINAL_RESISTANCE, BETA_COEFFICIENT, SERIES_RESISTANCE
+};
+
+}
+
+// Доступ к закрытым методам тестируемых классов (friend struct BenchAccess)
+struct BenchAccess {
+    static float fireDelay(PhaseController& phase, float power) { return phase.calculateFireDelay(power); }
+    static float convert(const TemperatureSensor& sensor, int adc) { return sensor.convertToTemperature(adc); }
+    static float filter(TemperatureSensor& sensor, float value) { return sensor.applyFilter(value); }
+    static const char* statusJson(WebServerManager& web) { return web.getStatusJSON(); }
+    static const char* configJson(WebServerManager& web) { return web.getConfigJSON(); }
+    static const char* sensorsJson(WebServerManager& web) { return web.getSensorsInfoJSON(); }
+    static String& terminalLog() { return TerminalManager::logBuffer; }
+    static bool readConfig(float* values, int& count) { return ConfigStorage::readStoredValues(values, count); }
+    static bool writeConfig(bool force) { return ConfigStorage::writeConfig(force); }
+};
+
+// ========================================
+// ТЕСТЫ
+// ========================================
+
+namespace {
+
+struct BenchCase {
+    const char* name;
+    uint16_t iterations;
+    bool (*available)();        // nullptr - всегда
+    void (*setup)();
+    void (*op)(int i);
+    void (*teardown)();
+};
+
+void opPidCompute(int i) {
+    fixture->sink = fixture->pid.compute(55.0 + (i & 15) * 0.5, 60.0);
+}
+
+void opFireDelay(int i) {
+    fixture->sink = BenchAccess::fireDelay(fixture->phase, (i % 100) + 0.5);
+}
+
+void opNtcConvert(int i) {
+    fixture->sink = BenchAccess::convert(fixture->sensor, 600 + (i * 37) % 2800);
+}
+
+void opTempFilter(int i) {
+    fixture->sink = BenchAccess::filter(fixture->sensor, 40.0 + (i & 15) * 0.1);
+}
+
+void saveTerminalLog() {
+    fixture->savedLog = BenchAccess::terminalLog();
+}
+
+void opTerminalLog(int i) {
+    TerminalManager::addLog("bench: запись журнала терминала");
+    BenchSuite::sampleHeap();
+}
+
+void restoreTerminalLog() {
+    BenchAccess::terminalLog() = fixture->savedLog;
+    fixture->savedLog = String();
+}
+
+void opConfigLoad(int i) {
+    float values[PARAM_COUNT];
+    int count;
+    BenchAccess::readConfig(values, count);
+    fixture->sink = values[0];
+}
+
+// Сохранение без изменений: чтение, сравнение и отказ от записи во flash.
+// С отложенными изменениями (их нельзя записать раньше времени) или без
+// журнала (EEPROM) тесты настроек пропускаются
+bool canCompareConfig() {
+    return ConfigStorage::isUsingLog() && !ConfigStorage::hasPendingChanges();
+}
+
+void opConfigCompare(int i) {
+    BenchAccess::writeConfig(false);
+}
+
+// Сохранение с записью тех же значений в журнал flash (итераций мало:
+// каждая - запись сектора)
+void opConfigSave(int i) {
+    BenchAccess::writeConfig(true);
+}
+
+bool webAvailable() {
+    return web != nullptr;
+}
+
+void opJsonStatus(int i) {
+    // Документ и ответ - в RequestArena, место возвращается после операции
+    size_t mark = RequestArena::mark();
+    const char* json = BenchAccess::statusJson(*web);
+    BenchSuite::sampleHeap();
+    fixture->sink = strlen(json);
+    RequestArena::releaseText(json);
+    RequestArena::rewind(mark);
+}
+
+void opJsonConfig(int i) {
+    size_t mark = RequestArena::mark();
+    const char* json = BenchAccess::configJson(*web);
+    BenchSuite::sampleHeap();
+    fixture->sink = strlen(json);
+    RequestArena::releaseText(json);
+    RequestArena::rewind(mark);
+}
+
+void opJsonSensors(int i) {
+    size_t mark = RequestArena::mark();
+    const char* json = BenchAccess::sensorsJson(*web);
+    BenchSuite::sampleHeap();
+    fixture->sink = strlen(json);
+    RequestArena::releaseText(json);
+    RequestArena::rewind(mark);
+}
+
+const BenchCase CASES[] = {
+    { "pid_compute",    1000, nullptr,          nullptr,         opPidCompute,    nullptr },
+    { "fire_delay",     1000, nullptr,          nullptr,         opFireDelay,     nullptr },
+    { "ntc_convert",    1000, nullptr,          nullptr,         opNtcConvert,    nullptr },
+    { "temp_filter",    1000, nullptr,          nullptr,         opTempFilter,    nullptr },
+    { "json_status",      50, webAvailable,     nullptr,         opJsonStatus,    nullptr },
+    { "json_config",      20, webAvailable,     nullptr,         opJsonConfig,    nullptr },
+    { "json_sensors",     20, webAvailable,     nullptr,         opJsonSensors,   nullptr },
+    { "terminal_log",     16, nullptr,          saveTerminalLog, opTerminalLog,   restoreTerminalLog },
+    { "config_load",      20, nullptr,          nullptr,         opConfigLoad,    nullptr },
+    { "config_compare",   20, canCompareConfig, nullptr,         opConfigCompare, nullptr },
+    { "config_save",       4, canCompareConfig, nullptr,         opConfigSave,    nullptr },
+};
+
+static_assert(sizeof(CASES) / sizeof(CASES[0]) == BenchSuite::CASE_COUNT, "BenchSuite::CASE_COUNT");
+
+const BenchBaseline* findBaseline(const char* name) {
+    for (size_t i = 0; i < sizeof(BENCH_BASELINE) / sizeof(BENCH_BASELINE[0]); i++) {
+        if (strcmp(BENCH_BASELINE[i].name, name) == 0) return &BENCH_BASELINE[i];
+    }
+    return nullptr;
+}
+
+}
+
+// ========================================
+// ПРОГОН
+// ========================================
+
+void BenchSuite::sampleHeap() {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap < minFreeHeap) minFreeHeap = freeHeap;
+}
+
+void BenchSuite::run(Result* results, Summary& summary) {
+    CpuFrequencyLock lock(CpuFrequency::LOCK_HTTP);
+    unsigned long wallStart = millis();
+
+    summary.count = CASE_COUNT;
+    summary.regressions = 0;
+    summary.skipped = 0;
+    summary.missingBaselines = 0;
+    summary.heapPeakBytes = 0;
+
+    web = webServer;
+    fixture = new (std::nothrow) BenchFixture();
+    summary.heapFreeStart = ESP.getFreeHeap();
+
+    for (int c = 0; c < CASE_COUNT; c++) {
+        const BenchCase& bench = CASES[c];
+        Result& result = results[c];
+        const BenchBaseline* baseline = findBaseline(bench.name);
+
+        result.name = bench.name;
+        result.iterations = bench.iterations;
+        result.meanCycles = 0;
+        result.minCycles = 0;
+        result.bytesPerOp = 0;
+        result.baselineCycles = baseline ? baseline->cycles : 0;
+        result.baselineBytes = baseline ? baseline->bytes : 0;
+        result.regressed = false;
+        result.missingBaseline = false;
+        result.skipped = fixture == nullptr || (bench.available && !bench.available());
+        if (result.skipped) {
+            summary.skipped++;
+            continue;
+        }
+
+        fixture->pid.setComputeInterval(0);
+        fixture->pid.enable();
+        fixture->sensor.begin(BENCH_CHANNEL);
+        if (bench.setup) bench.setup();
+
+        uint64_t totalCycles = 0;
+        for (int i = 0; i < bench.iterations; i++) {
+            uint32_t freeBefore = ESP.getFreeHeap();
+            minFreeHeap = freeBefore;
+
+            uint32_t start = PerfProfiler::cycles();
+            bench.op(i);
+            uint32_t elapsed = PerfProfiler::cycles() - start;
+
+            sampleHeap();
+            totalCycles += elapsed;
+            if (i == 0 || elapsed < result.minCycles) result.minCycles = elapsed;
+            if (freeBefore - minFreeHeap > result.bytesPerOp) result.bytesPerOp = freeBefore - minFreeHeap;
+            if (summary.heapFreeStart > minFreeHeap && summary.heapFreeStart - minFreeHeap > summary.heapPeakBytes) {
+                summary.heapPeakBytes = summary.heapFreeStart - minFreeHeap;
+            }
+        }
+        if (bench.teardown) bench.teardown();
+        result.meanCycles = (uint32_t)(totalCycles / bench.iterations);
+
+        // Регрессия: больше базового значения на BENCH_REGRESSION_PERCENT
+        if (result.baselineCycles > 0) {
+            uint32_t cycleLimit = result.baselineCycles + result.baselineCycles * BENCH_REGRESSION_PERCENT / 100;
+            uint32_t byteLimit = result.baselineBytes + result.baselineBytes * BENCH_REGRESSION_PERCENT / 100 +
+                                 BENCH_HEAP_SLACK_BYTES;
+            result.regressed = result.meanCycles > cycleLimit || result.bytesPerOp > byteLimit;
+            if (result.regressed) summary.regressions++;
+        } else {
+            result.missingBaseline = true;
+            summary.missingBaselines++;
+        }
+
+        SafetySupervisor::feedWatchdog();
+    }
+
+    delete fixture;
+    fixture = nullptr;
+    web = nullptr;
+
+    summary.heapMinFreeEver = ESP.getMinFreeHeap();
+    summary.wallMs = millis() - wallStart;
+}
+
+// ========================================
+// ВЫВОД
+// ========================================
+
+void BenchSuite::printCsv(Print& out, const Result* results, const Summary& summary) {
+    out.println("name,iterations,cycles_per_op,min_cycles,bytes_per_op,baseline_cycles,baseline_bytes,status");
+    for (int c = 0; c < summary.count; c++) {
+        const Result& r = results[c];
+        const char* status = r.skipped ? "skip" : r.regressed ? "FAIL" : r.missingBaseline ? "NOBASE" : "ok";
+        out.printf("%s,%u,%lu,%lu,%lu,%lu,%lu,%s\n", r.name, r.iterations, (unsigned long)r.meanCycles,
+                   (unsigned long)r.minCycles, (unsigned long)r.bytesPerOp, (unsigned long)r.baselineCycles,
+                   (unsigned long)r.baselineBytes, status);
+    }
+    out.printf("# bench: %s, регрессий %d, без базы %d, пропущено %d, пик кучи %lu Б, мин. свободно %lu Б, "
+               "%lu МГц, %lu мс\n",
+               isPassed(summary) ? "PASS" : "FAIL", summary.regressions, summary.missingBaselines, summary.skipped,
+               (unsigned long)summary.heapPeakBytes, (unsigned long)summary.heapMinFreeEver,
+               (unsigned long)getCpuFrequencyMhz(), summary.wallMs);
+}
+
+void BenchSuite::printBaseline(Print& out, const Result* results, const Summary& summary) {
+    out.println("// bench_baseline.h:");
+    for (int c = 0; c < summary.count; c++) {
+        const Result& r = results[c];
+        if (r.skipped) {
+            out.printf("    { \"%s\", 0, 0 },  // пропущен\n", r.name);
+        } else {
+            out.printf("    { \"%s\", %lu, %lu },\n", r.name, (unsigned long)r.meanCycles, (unsigned long)r.bytesPerOp);
+        }
+    }
+}
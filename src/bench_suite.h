@@ -0,0 +1,85 @@
+#ifndef BENCH_SUITE_H
+#define BENCH_SUITE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+class WebServerManager;
+
+// ========================================
+// ТЕСТЫ ПРОИЗВОДИТЕЛЬНОСТИ
+// ========================================
+//
+// Набор замеров горячих участков: ПИД, расчет задержки включения,
+// преобразование NTC и фильтр температуры, JSON веб-сервера, журнал
+// терминала, чтение, сравнение и запись настроек во flash. Каждый тест выполняется
+// заданное число раз в loop; замер - такты CPU на операцию (mean/min) и
+// память кучи, занятая на пике операции (снимки ESP.getFreeHeap() после
+// операции и в точках внутри теста, где результат еще жив).
+//
+// Результаты сравниваются с базовыми значениями bench_baseline.h:
+// регрессия - больше на BENCH_REGRESSION_PERCENT процентов. Тест без
+// базового значения (0 тактов) измеряется, но прогон с ним не пройден:
+// отсутствие базы не должно выглядеть как отсутствие регрессий. Новые
+// базовые значения печатает команда "bench baseline" - их переносят в
+// bench_baseline.h.
+//
+// Прогон занимает loop на время всех тестов, поэтому вызывающие (bench,
+// GET /bench) запускают его только в IDLE.
+//
+// Замеры тактов зависят от частоты CPU только через ожидание flash,
+// поэтому на время прогона держится блокировка LOCK_HTTP (240 МГц).
+
+class BenchSuite {
+public:
+    struct Result {
+        const char* name;
+        uint16_t iterations;
+        uint32_t meanCycles;
+        uint32_t minCycles;
+        uint32_t bytesPerOp;        // Пик занятой кучи за операцию
+        uint32_t baselineCycles;    // 0 - базового значения нет
+        uint32_t baselineBytes;
+        bool skipped;               // Нет нужного компонента
+        bool regressed;
+        bool missingBaseline;       // Измерен, сравнить не с чем
+    };
+
+    struct Summary {
+        int count;
+        int regressions;
+        int skipped;
+        int missingBaselines;
+        uint32_t heapFreeStart;
+        uint32_t heapPeakBytes;     // Максимум занятой кучи за прогон
+        uint32_t heapMinFreeEver;   // Минимум свободной кучи с запуска
+        unsigned long wallMs;
+    };
+
+    // Веб-сервер для тестов JSON (без него тесты пропускаются)
+    static void setWebServer(WebServerManager* server) { webServer = server; }
+
+    static const int CASE_COUNT = 11;
+
+    static bool isPassed(const Summary& summary) {
+        return summary.regressions == 0 && summary.missingBaselines == 0;
+    }
+
+    // Прогон всех тестов, results - CASE_COUNT элементов
+    static void run(Result* results, Summary& summary);
+
+    // Снимок свободной кучи внутри операции (результат еще не освобожден)
+    static void sampleHeap();
+
+    // Таблица CSV: name,iterations,cycles_per_op,min_cycles,bytes_per_op,
+    // baseline_cycles,baseline_bytes,status и итоговая строка '#'
+    static void printCsv(Print& out, const Result* results, const Summary& summary);
+    // Строки для bench_baseline.h по текущим результатам
+    static void printBaseline(Print& out, const Result* results, const Summary& summary);
+
+private:
+    static WebServerManager* webServer;
+    static uint32_t minFreeHeap;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "boot_button.h"
+#include "perf_profiler.h"
 
 BootButtonDetector::BootButtonDetector() 
     : lastButtonState(HIGH)  // Кнопка BOOT подтянута к HIGH
@@ -24,6 +25,8 @@ void BootButtonDetector::begin() {
 }
 
 void BootButtonDetector::update() {
+    PERF_SCOPE(PERF_BUTTON_UPDATE);
+    
     // Читаем текущее состояние кнопки
     int reading = digitalRead(BOOT_BUTTON_PIN);
     
@@ -0,0 +1,178 @@
+#include "command_registry.h"
+
+// ========================================
+// РАЗБОР СТРОКИ
+// ========================================
+
+CommandArgs::CommandArgs() : wordCount(0) {
+}
+
+bool CommandArgs::parse(char* line) {
+    wordCount = 0;
+    char* p = line;
+    while (*p) {
+        while (*p == ' ' || *p == '\t') *p++ = '\0';
+        if (!*p) break;
+        if (wordCount >= CMD_MAX_ARGS) return false;
+        words[wordCount++] = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+    }
+
+    if (wordCount > 0) {
+        for (char* c = (char*)words[0]; *c; c++) {
+            *c = tolower(*c);
+        }
+    }
+    return true;
+}
+
+const char* CommandArgs::get(int index) const {
+    return index >= 0 && index < wordCount ? words[index] : "";
+}
+
+float CommandArgs::getFloat(int index) const {
+    return atof(get(index));
+}
+
+bool CommandArgs::is(int index, const char* word) const {
+    return strcasecmp(get(index), word) == 0;
+}
+
+// ========================================
+// РЕЕСТР
+// ========================================
+
+const CommandDescriptor* CommandRegistry::commands = nullptr;
+int CommandRegistry::commandCount = 0;
+CommandJob CommandRegistry::job;
+bool CommandRegistry::jobActive = false;
+
+void CommandRegistry::begin(const CommandDescriptor* table, int count) {
+    commands = table;
+    commandCount = count;
+}
+
+bool CommandRegistry::matchesAlias(const char* aliases, const char* name) {
+    if (aliases == nullptr) return false;
+
+    size_t length = strlen(name);
+    const char* p = aliases;
+    while (*p) {
+        const char* end = strchr(p, '|');
+        size_t aliasLength = end ? (size_t)(end - p) : strlen(p);
+        if (aliasLength == length && strncasecmp(p, name, length) == 0) return true;
+        if (!end) break;
+        p = end + 1;
+    }
+    return false;
+}
+
+const CommandDescriptor* CommandRegistry::find(const char* name) {
+    for (int i = 0; i < commandCount; i++) {
+        if (strcasecmp(commands[i].name, name) == 0 || matchesAlias(commands[i].aliases, name)) {
+            return &commands[i];
+        }
+    }
+    return nullptr;
+}
+
+int CommandRegistry::getCount() {
+    return commandCount;
+}
+
+const CommandDescriptor& CommandRegistry::getCommand(int index) {
+    return commands[index];
+}
+
+CommandRegistry::Result CommandRegistry::execute(char* line, CommandContext& context) {
+    CommandArgs args;
+    if (!args.parse(line)) {
+        context.out.println("Слишком много аргументов");
+        return CMD_BAD_ARGS;
+    }
+    if (args.count() == 0) return CMD_EMPTY;
+
+    const CommandDescriptor* command = find(args.get(0));
+    if (command == nullptr) {
+        context.out.printf("Неизвестная команда: %s\nВведите 'help' для справки\n", args.get(0));
+        return CMD_UNKNOWN;
+    }
+
+    int argCount = args.count() - 1;
+    if (argCount < command->minArgs || argCount > command->maxArgs) {
+        printUsage(*command, context.out);
+        return CMD_BAD_ARGS;
+    }
+
+    command->handler(args, context);
+    return CMD_OK;
+}
+
+void CommandRegistry::printUsage(const CommandDescriptor& command, Print& out) {
+    out.printf("Использование: %s %s\n", command.name, command.usage);
+}
+
+void CommandRegistry::printHelp(Print& out) {
+    out.println("Доступные команды:");
+    for (int i = 0; i < commandCount; i++) {
+        const CommandDescriptor& command = commands[i];
+        out.print(command.name);
+        if (command.aliases) {
+            out.printf(" (%s)", command.aliases);
+        }
+        if (command.usage[0]) {
+            out.printf(" %s", command.usage);
+        }
+        out.printf(" - %s\n", command.help);
+    }
+}
+
+// ========================================
+// ЗАДАНИЯ
+// ========================================
+
+bool CommandRegistry::startJob(const CommandJob& newJob) {
+    if (jobActive) return false;
+
+    job = newJob;
+    job.startTime = millis();
+    job.lastStepTime = job.startTime;
+    jobActive = true;
+    return true;
+}
+
+bool CommandRegistry::isJobActive() {
+    return jobActive;
+}
+
+const char* CommandRegistry::getJobName() {
+    return jobActive ? job.name : "";
+}
+
+void CommandRegistry::cancelJob() {
+    if (jobActive) {
+        finishJob("отменено");
+    }
+}
+
+void CommandRegistry::update() {
+    if (!jobActive) return;
+
+    // Один шаг за вызов: loop продолжает работать между шагами
+    unsigned long currentTime = millis();
+    if (currentTime - job.lastStepTime < job.intervalMs) return;
+    job.lastStepTime = currentTime;
+
+    if (!job.step(job)) {
+        finishJob("завершено");
+    } else if (job.durationMs > 0 && currentTime - job.startTime >= job.durationMs) {
+        finishJob("завершено по времени");
+    }
+}
+
+void CommandRegistry::finishJob(const char* reason) {
+    jobActive = false;
+    if (job.out) {
+        job.out->printf("Задание %s %s\n", job.name, reason);
+    }
+}
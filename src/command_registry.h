@@ -0,0 +1,118 @@
+#ifndef COMMAND_REGISTRY_H
+#define COMMAND_REGISTRY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+class SystemController;
+struct SystemState;
+
+// ========================================
+// РЕЕСТР КОМАНД ТЕРМИНАЛА
+// ========================================
+//
+// Одна таблица команд (terminal_commands.cpp) обслуживает Serial и веб
+// (/terminal). Строка разбирается на месте без выделения памяти, число
+// аргументов проверяется по описанию команды до вызова обработчика.
+// Вывод идет в Print: Serial напрямую, для веба - в строку ответа.
+//
+// Длительные команды (testflow) не блокируют loop: обработчик запускает
+// задание, шаги которого вызываются из CommandRegistry::update().
+
+// Слова командной строки
+class CommandArgs {
+public:
+    CommandArgs();
+
+    // Делит строку на слова, заменяя пробелы на '\0'. Имя команды
+    // приводится к нижнему регистру. false - слов больше CMD_MAX_ARGS
+    bool parse(char* line);
+
+    int count() const { return wordCount; }          // Вместе с именем команды
+    const char* get(int index) const;                // "" вне диапазона
+    float getFloat(int index) const;
+    bool is(int index, const char* word) const;      // Без учета регистра
+
+private:
+    const char* words[CMD_MAX_ARGS];
+    int wordCount;
+};
+
+struct CommandContext {
+    SystemController* controller;
+    SystemState* state;         // nullptr для Serial
+    Print& out;                 // Ответ на команду
+    Print* jobOut;              // Вывод заданий (живет дольше запроса)
+};
+
+typedef void (*CommandHandler)(const CommandArgs& args, CommandContext& context);
+
+struct CommandDescriptor {
+    const char* name;
+    const char* aliases;        // Через '|', nullptr - нет
+    uint8_t minArgs;            // Без имени команды
+    uint8_t maxArgs;
+    const char* usage;          // Аргументы для справки
+    const char* help;
+    CommandHandler handler;
+};
+
+// Задание длительной команды. step вызывается раз в intervalMs из loop
+// и возвращает false, когда задание завершено
+struct CommandJob;
+typedef bool (*CommandJobStep)(CommandJob& job);
+
+struct CommandJob {
+    const char* name;
+    CommandJobStep step;
+    unsigned long intervalMs;
+    unsigned long durationMs;   // 0 - до завершения или отмены
+    unsigned long startTime;
+    unsigned long lastStepTime;
+    float lastValue;            // Состояние шага
+    SystemController* controller;
+    Print* out;
+};
+
+class CommandRegistry {
+public:
+    enum Result {
+        CMD_OK,
+        CMD_EMPTY,
+        CMD_UNKNOWN,
+        CMD_BAD_ARGS
+    };
+
+    // Таблица команд (статическая, не копируется)
+    static void begin(const CommandDescriptor* table, int count);
+
+    // Выполнение строки (строка изменяется при разборе)
+    static Result execute(char* line, CommandContext& context);
+
+    // Поиск по имени или псевдониму
+    static const CommandDescriptor* find(const char* name);
+    static int getCount();
+    static const CommandDescriptor& getCommand(int index);
+
+    // Справка по всем командам
+    static void printHelp(Print& out);
+    static void printUsage(const CommandDescriptor& command, Print& out);
+
+    // Задания: одновременно выполняется одно
+    static bool startJob(const CommandJob& job);
+    static bool isJobActive();
+    static const char* getJobName();
+    static void cancelJob();
+    static void update();       // Вызывать в loop
+
+private:
+    static const CommandDescriptor* commands;
+    static int commandCount;
+    static CommandJob job;
+    static bool jobActive;
+
+    static bool matchesAlias(const char* aliases, const char* name);
+    static void finishJob(const char* reason);
+};
+
+#endif
@@ -12,7 +12,8 @@
 #define ZERO_CROSS_PIN 15  // Детектор пересечения нуля
 
 // Пины сенсоров
-#define NTC_PIN 34         // Датчик температуры NTC
+#define NTC_PIN 34         // Датчик температуры NTC (выход)
+#define INLET_NTC_PIN 36   // Датчик температуры на входе (необязательный, VP)
 #define FLOW_SENSOR_PIN 35 // Датчик потока воды
 #define STATUS_LED_PIN 2   // Светодиод статуса
 #define BOOT_BUTTON_PIN 0  // Кнопка BOOT (встроенная кнопка ESP32)
@@ -56,6 +57,11 @@
 #define FLOW_CALIBRATION_MIN 100.0  // Минимальный коэффициент калибровки
 #define FLOW_CALIBRATION_MAX 1000.0 // Максимальный коэффициент калибровки
 
+// Калибровка по известному объему
+#define FLOW_CURVE_MAX_POINTS 6     // Точек кривой коэффициента (зависимость от расхода)
+#define FLOW_CAL_MIN_PULSES 200     // Минимум импульсов за калибровочный пролив
+#define FLOW_CAL_MERGE_RATIO 0.15   // Точки с частотой ближе 15% заменяют друг друга
+
 // ========================================
 // НАСТРОЙКИ ФАЗОВОГО УПРАВЛЕНИЯ
 // ========================================
@@ -70,6 +76,47 @@
 // Фильтрация частоты
 #define FREQ_FILTER_SAMPLES 5       // Количество образцов для фильтрации частоты
 
+// Контроль фаз: смещения L2, L3 относительно L1, обрыв и порядок фаз.
+// Источник - детекторы нуля L2, L3 (если установлены), иначе конец
+// проводимости тока по MainsSensing
+#define PHASE_ZERO_CROSS_INPUTS 0   // 1 - детекторы нуля L2, L3 установлены
+#define ZERO_CROSS_L2_PIN 16        // Детектор нуля L2 (RX2)
+#define ZERO_CROSS_L3_PIN 17        // Детектор нуля L3 (TX2)
+#define PHASE_OFFSET_FILTER 0.05    // Сглаживание измеренного смещения (доля на измерение)
+#define PHASE_OFFSET_TOLERANCE_US 1000 // Допуск смещения от 120°/240° при определении порядка фаз
+#define PHASE_LOSS_TIMEOUT_MS 200   // Нет пересечений нуля (тока) дольше - фаза потеряна
+#define PHASE_LOSS_MIN_POWER 10.0   // Ток проверяется при мощности фазы не ниже (%)
+#define PHASE_LOSS_CURRENT_A 0.5    // Ток ниже при включенном триаке - фазы нет
+
+// ========================================
+// НАСТРОЙКИ СТУПЕНЕЙ НА РЕЛЕ
+// ========================================
+
+// Ступени нагрева на реле/контакторах поверх триаков (stage_controller.h)
+#define RELAY_STAGE_MAX 4                       // Предел relayStageCount
+#define RELAY_STAGE_PINS {25, 26, 27, 13}       // Выходы реле ступеней по порядку
+#define RELAY_ACTIVE_LEVEL HIGH                 // Уровень включения реле
+#define RELAY_STAGE_COUNT_DEFAULT 0             // 0 - только триаки
+#define RELAY_STAGE_POWER_W 6000.0              // Мощность ступени (не больше 3 * elementPowerW)
+#define RELAY_MIN_ON_SEC 60                     // Минимальное время включения реле
+#define RELAY_MIN_OFF_SEC 60                    // Минимальная пауза реле
+
+// Симуляция ступеней (команда stages sim)
+#define STAGE_SIM_STEP_MS 100
+#define STAGE_SIM_OUTPUT_S 60                   // Интервал строк CSV (наименьший)
+#define STAGE_SIM_MAX_ROWS 120                  // Строк CSV не больше (ответ веб-терминала)
+#define STAGE_SIM_ERROR_PERCENT 0.5             // Отклонение, считающееся потерей разрешения
+
+// ========================================
+// НАСТРОЙКИ УЧЕТА ЭНЕРГИИ
+// ========================================
+
+#define ELEMENT_POWER_W 3000.0      // Номинальная мощность нагревателя одной фазы (Вт)
+#define ENERGY_TARIFF_PER_KWH 6.0   // Стоимость 1 кВт*ч (в валюте счета)
+#define ENERGY_SAVE_INTERVAL_MS 900000   // Периодическое сохранение счетчиков (15 минут)
+#define ENERGY_SAVE_MIN_INTERVAL_MS 60000 // Минимальный интервал между записями (1 минута)
+#define ENERGY_SAVE_MIN_DELTA_KWH 0.05   // Минимальный прирост энергии для записи
+
 // ========================================
 // НАСТРОЙКИ ДАТЧИКОВ
 // ========================================
@@ -77,7 +124,9 @@
 // Датчик потока
 #define PULSES_PER_LITER 400.0     // Импульсов на литр по умолчанию
 #define FLOW_TIMEOUT_MS 1000       // Таймаут отсутствия потока
-#define MIN_PULSE_INTERVAL_MS 10   // Минимальный интервал между импульсами
+#define FLOW_PCNT_UNIT 0            // Аппаратный счетчик импульсов (PCNT)
+#define FLOW_PCNT_FILTER 1023       // Фильтр помех PCNT (такты APB, 1023 = 12.8 мкс)
+#define FLOW_PCNT_LIMIT 32767       // Предел 16-битного счетчика PCNT
 
 // NTC датчик температуры
 #define NOMINAL_TEMP 25.0           // Номинальная температура
@@ -85,20 +134,117 @@
 #define BETA_COEFFICIENT 3950.0    // Бета-коэффициент
 #define SERIES_RESISTANCE 10000.0   // Подтягивающий резистор
 
+// NTC на входе (необязательный)
+#define INLET_NTC_ENABLED 0         // 1 - датчик установлен; 0 - вход не опрашивается, только оценка
+#define INLET_NOMINAL_RESISTANCE 10000.0
+#define INLET_BETA_COEFFICIENT 3950.0
+
+// Опрос каналов температуры
+#define TEMP_ADC_OVERSAMPLE 4       // Выборок на канал за один проход АЦП
+#define TEMP_ADC_MIN_VALID 100      // Показания АЦП подключенного NTC
+#define TEMP_ADC_MAX_VALID 4000     // (вне диапазона - обрыв или замыкание)
+
+// Оценка температуры на входе (без датчика на входе)
+#define INLET_TEMP_DEFAULT 15.0     // Значение до первой оценки (°C)
+#define WATER_HEAT_CAPACITY 4186.0  // Удельная теплоемкость воды (Дж/(кг*К))
+#define INLET_ESTIMATE_SETTLE_MS 5000  // Длительность установившегося режима
+#define INLET_ESTIMATE_MAX_SLOPE 0.05  // Допустимая скорость изменения T выхода (°C/с)
+#define INLET_ESTIMATE_MAX_POWER_CHANGE 0.1 // Допустимое изменение мощности за секунду (доля)
+#define INLET_ESTIMATE_FILTER 0.2   // Коэффициент сглаживания оценки
+
 // Фильтрация датчиков
 #define FILTER_SAMPLES 5            // Количество образцов для фильтрации
 
+// ========================================
+// НАСТРОЙКИ ИЗМЕРЕНИЯ СЕТИ
+// ========================================
+
+// Трансформатор напряжения L1 и трансформаторы тока L1-L3 (mains_sensing.h).
+// Трансформаторы тока - на вводе фаз (через них идут и ступени на реле).
+// АЦП1 при этом работает через I2S DMA, NTC на выходе читается из того же
+// потока. Свободных входов АЦП1 на esp32dev три, поэтому ток L3 занимает
+// вход NTC на входе (GPIO36) - температура на входе только оценивается
+#define MAINS_SENSING_ENABLED 0                 // 1 - трансформаторы подключены
+#define MAINS_VOLTAGE_PIN 39                    // Напряжение L1 (ADC1_CH3, VN)
+#define MAINS_CURRENT_PINS {32, 33, 36}         // Ток L1, L2, L3 (ADC1_CH4, CH5, CH0)
+#define MAINS_SAMPLE_RATE_HZ 20000              // Частота I2S: каналы шаблона опрашиваются по очереди
+#define MAINS_DMA_BUFFER_COUNT 4
+#define MAINS_DMA_BUFFER_SAMPLES 256
+#define MAINS_VOLTAGE_SCALE 0.35                // В на отсчет АЦП (делитель трансформатора)
+#define MAINS_CURRENT_SCALE 0.0125              // А на отсчет АЦП (трансформатор тока и нагрузка)
+#define MAINS_OFFSET_FILTER 0.0005              // Слежение за средней точкой АЦП (доля на отсчет)
+#define MAINS_ZERO_HYSTERESIS 40                // Отсчетов АЦП вокруг нуля при поиске перехода
+#define MAINS_CONDUCTION_THRESHOLD 30           // Отсчетов АЦП: ток ниже - триак закрыт
+#define MAINS_HISTORY_SAMPLES 128               // История напряжения L1 (больше 2/3 периода) для L2, L3
+#define MAINS_STALE_MS 100                      // Дольше без полупериода - измерение недействительно
+#define MAINS_TASK_STACK_SIZE 3072
+#define MAINS_TASK_PRIORITY 4                   // Выше loop, ниже супервизора
+#define MAINS_TASK_CORE 0
+
+#if MAINS_SENSING_ENABLED && INLET_NTC_ENABLED
+#error "MAINS_SENSING_ENABLED: ток L3 на GPIO36 - установите INLET_NTC_ENABLED 0"
+#endif
+
+// Внутренний контур мощности: команда ПИД - доля номинальной мощности,
+// триаки подстраиваются под измеренную активную мощность (power_loop.h)
+#define POWER_LOOP_KP 0.2                       // % команды на % ошибки мощности
+#define POWER_LOOP_KI 4.0                       // То же в секунду
+#define POWER_LOOP_MAX_TRIM 30.0                // Наибольшая поправка к команде (%)
+
 // ========================================
 // НАСТРОЙКИ СИСТЕМЫ
 // ========================================
 
 // Режимы работы системы
-#define SYSTEM_MODE_SLEEP 0         // Режим глубокого сна
+#define SYSTEM_MODE_SLEEP 0         // Режим сна (light sleep без потока)
 #define SYSTEM_MODE_ACTIVE 1        // Активная работа
 #define SYSTEM_MODE_WIFI_SESSION 2 // WiFi сессия
 
 // Временные настройки
 #define RAMP_UP_TIME_MS 2000        // Время разгона до полной мощности
+#define FLOW_DEBOUNCE_MS 200        // Поток должен держаться столько, чтобы считаться изменившимся
+
+// Скорость изменения мощности (ramp_engine.h)
+#define RAMP_PROFILE_DEFAULT 0      // 0 - линейный, 1 - S-кривая, 2 - с ограничением тока
+#define RAMP_PROFILE_MAX (MAINS_SENSING_ENABLED ? 2 : 1) // Ограничение тока - только с измерением
+#define RAMP_DOWN_RATE_DEFAULT 20.0 // Скорость снижения (%/с)
+#define RAMP_INSTANT_RATE 100000.0  // rampUpTimeMs = 0: без ограничения роста (%/с)
+#define RAMP_S_CURVE_TIME_S 0.5     // S-кривая: время набора предельной скорости
+#define RAMP_CURRENT_LIMIT_A 16.0   // Предел тока фазы по умолчанию
+#define RAMP_CURRENT_BACKOFF 1.05   // Ток выше предела во столько раз - мощность снижается
+#define RAMP_MAX_STEP_S 0.1         // Наибольший шаг времени (пропуск loop не дает скачка)
+
+// Профили по времени (profile_engine.h)
+#define PROFILE_MAX_SEGMENTS 8      // Сегментов в профиле
+#define PROFILE_MAX_SEGMENT_S 86400 // Наибольшая длительность сегмента (с)
+#define PROFILE_SLOT_COUNT 3        // Режимов с профилем (SystemController::ProfileMode)
+#define PREHEAT_START_LIMIT 30.0    // Прогрев: предел мощности в начале (%)
+#define PREHEAT_TIME_S 300          // Прогрев: предел доходит до 100% за (с)
+#define DISINFECTION_MARGIN_C 5.0   // Термодезинфекция: уставка выше disinfectionTempC на (°C)
+#define DISINFECTION_HEATUP_S 600   // Термодезинфекция: длительность - удержание и это время на нагрев (с)
+#define BURN_IN_HOLD_S 600          // Обкатка: удержание 100% (с)
+#define BURN_IN_LOW_POWER 30.0      // Обкатка: мощность между циклами (%)
+#define BURN_IN_LOW_S 300           // Обкатка: работа на пониженной мощности (с)
+
+// Термодезинфекция по расписанию (disinfection_scheduler.h). Режим
+// завершается, как только набрано удержание
+#define DISINFECTION_INTERVAL_H_DEFAULT 0   // Интервал (ч), 0 - расписание выключено
+#define DISINFECTION_INTERVAL_H_MAX 2160    // 90 суток
+#define DISINFECTION_MIN_TEMP_DEFAULT 60.0  // Засчитываемая температура на выходе (°C)
+#define DISINFECTION_MIN_TEMP_MIN 50.0
+#define DISINFECTION_MIN_TEMP_MAX (TARGET_TEMP_MAX - DISINFECTION_MARGIN_C) // Уставке нужен запас
+#define DISINFECTION_HOLD_MIN_DEFAULT 5     // Требуемое удержание (мин)
+#define DISINFECTION_HOLD_MIN_MAX 30
+#define DISINFECTION_GAP_S 10               // Провал короче не прерывает удержание (с)
+#define DISINFECTION_GRACE_H 24             // Не выполнен за интервал + столько - пропуск (ч)
+#define DISINFECTION_RETRY_S 1800           // Повтор после прерванного цикла не раньше (с)
+#define DISINFECTION_MAX_ATTEMPTS 3         // Запусков по расписанию за интервал
+#define DISINFECTION_SAVE_INTERVAL_S 3600   // Сохранение счетчика времени работы (с)
+#define DISINFECTION_HISTORY_SIZE 8         // Результатов в журнале
+
+// Машина состояний контроллера
+#define EVENT_QUEUE_SIZE 16         // Очередь событий (обрабатывается за один цикл)
+#define CONTROLLER_TRACE_SIZE 32    // Последние переходы для /trace
 #define WIFI_SESSION_TIMEOUT_MS 900000 // Таймаут WiFi сессии (15 минут)
 
 // Настройки кнопки BOOT
@@ -111,6 +257,36 @@
 #define MIN_TEMP_DEFAULT 40.0       // Минимальная температура
 #define MAX_TEMP_DEFAULT 65.0       // Максимальная температура
 
+// ========================================
+// НАСТРОЙКИ ЭНЕРГОСБЕРЕЖЕНИЯ
+// ========================================
+
+// Без потока и WiFi сессии ESP32 уходит в light sleep и просыпается по
+// фронту датчика потока, кнопке BOOT, приему по UART или таймеру
+#define IDLE_SLEEP_ENABLED 1
+#define IDLE_SLEEP_ENTER_MS 3000        // Покой без активности до первого сна
+#define IDLE_SLEEP_INTERVAL_MS 250      // Пробуждение по таймеру (опрос температуры)
+#define IDLE_UART_WAKE_THRESHOLD 3      // Фронтов RX для пробуждения (символ теряется)
+
+// Оценка потребления для статистики (мА, по документации ESP32)
+#define POWER_CURRENT_ACTIVE_MA 30.0    // Работа, WiFi выключен
+#define POWER_CURRENT_IDLE_MA 20.0      // 80 МГц между снами
+#define POWER_CURRENT_SLEEP_MA 0.8      // Light sleep
+#define POWER_CURRENT_WIFI_MA 130.0     // Точка доступа WiFi
+
+// ========================================
+// НАСТРОЙКИ ЧАСТОТЫ CPU
+// ========================================
+
+// Частота задается блокировками: без блокировок - базовая, иначе
+// максимальная из частот удерживаемых блокировок. Допустимы 80/160/240 МГц
+// (при 80 МГц и выше шина APB не меняется - UART, PCNT и таймеры работают)
+#define CPU_FREQ_SCALING_ENABLED 1
+#define CPU_FREQ_BASE_MHZ 80            // Покой и мониторинг
+#define CPU_FREQ_CONTROL_MHZ 80         // Нагрев (фазовое управление)
+#define CPU_FREQ_WIFI_MHZ 160           // WiFi сессия
+#define CPU_FREQ_HTTP_MHZ 240           // Тяжелые HTTP ответы (телеметрия, история, страницы)
+
 // ========================================
 // НАСТРОЙКИ WiFi И ВЕБ-СЕРВЕРА
 // ========================================
@@ -123,7 +299,7 @@
 #define WIFI_TX_POWER_FULL 19.5     // Полная мощность передачи (dBm)
 
 // Веб-сервер
-#define CONFIG_JSON_SIZE 1024       // Размер JSON конфигурации
+#define CONFIG_JSON_SIZE 7680       // Размер JSON конфигурации (параметры, их описание и профили)
 #define DEBUG_SERIAL true           // Включить отладочный вывод
 
 // ========================================
@@ -132,4 +308,136 @@
 
 #define SERIAL_BAUD_RATE 115200     // Скорость последовательного порта
 
+// Команды терминала (Serial и /terminal)
+#define CMD_LINE_MAX 96             // Максимальная длина строки команды
+#define CMD_MAX_ARGS 6              // Максимальное количество слов в команде
+#define CMD_TESTFLOW_DURATION_S 30  // Длительность testflow по умолчанию
+
+// ========================================
+// НАСТРОЙКИ ТЕЛЕМЕТРИИ
+// ========================================
+
+#define TELEMETRY_BUFFER_BYTES 32768   // Размер кольцевого буфера записи (байт)
+#define TELEMETRY_SAMPLE_RATE_HZ 20    // Частота записи по умолчанию
+#define TELEMETRY_RATE_MIN_HZ 10       // Минимальная частота записи
+#define TELEMETRY_RATE_MAX_HZ 100      // Максимальная частота записи
+#define TELEMETRY_BLOCK_SAMPLES 64     // Количество отсчетов в одном сжатом блоке
+
+// ========================================
+// НАСТРОЙКИ ИСТОРИИ ДЛЯ ГРАФИКОВ
+// ========================================
+
+#define HISTORY_1S_BUCKETS 600         // 1 с x 600 = 10 минут
+#define HISTORY_1MIN_BUCKETS 1440      // 1 мин x 1440 = 24 часа
+#define HISTORY_15MIN_BUCKETS 672      // 15 мин x 672 = 7 дней
+#define HISTORY_MAX_CATCHUP_SEC 64     // Максимум закрываемых секунд за один вызов
+
+// ========================================
+// НАСТРОЙКИ ХРАНЕНИЯ КОНФИГУРАЦИИ
+// ========================================
+
+// Журнал записей в разделе flash (см. partitions.csv)
+#define CONFIG_LOG_PARTITION "cfglog"  // Метка раздела
+#define CONFIG_LOG_SUBTYPE 0x40        // Подтип раздела данных
+#define CONFIG_LOG_SECTOR_SIZE 4096    // Размер стираемого сектора flash
+#define CONFIG_LOG_MAX_RECORD 512      // Максимальный размер данных одной записи (профили - 316 байт)
+
+// Объединение записей
+#define CONFIG_WRITE_DELAY_MS 3000     // Запись через 3 с после последнего изменения
+#define CONFIG_WRITE_MAX_DELAY_MS 15000 // Но не позже 15 с после первого
+
+// ========================================
+// НАСТРОЙКИ ЛОГИРОВАНИЯ
+// ========================================
+
+// Уровни логирования
+#define LOG_LEVEL_NONE 0            // Логирование отключено
+#define LOG_LEVEL_ERROR 1           // Только ошибки
+#define LOG_LEVEL_WARN 2            // Ошибки и предупреждения
+#define LOG_LEVEL_INFO 3            // Основные события
+#define LOG_LEVEL_DEBUG 4           // Подробная периодическая диагностика
+
+// Уровни по модулям (вызовы ниже уровня вырезаются компилятором)
+#define LOG_FLOW_LEVEL LOG_LEVEL_INFO    // Датчик потока
+#define LOG_TEMP_LEVEL LOG_LEVEL_INFO    // Датчик температуры
+#define LOG_PHASE_LEVEL LOG_LEVEL_INFO   // Контроллер фаз
+#define LOG_SYSTEM_LEVEL LOG_LEVEL_INFO  // Системный контроллер
+#define LOG_MAIN_LEVEL LOG_LEVEL_INFO    // Главный цикл
+#define LOG_SAFETY_LEVEL LOG_LEVEL_INFO  // Супервизор безопасности
+#define LOG_MEMORY_LEVEL LOG_LEVEL_INFO  // Учет памяти
+#define LOG_MAINS_LEVEL LOG_LEVEL_INFO   // Измерение сети
+
+// Асинхронный вывод
+#define LOG_QUEUE_LENGTH 24         // Количество сообщений в очереди
+#define LOG_MESSAGE_MAX_LEN 200     // Максимальная длина одного сообщения (байт, UTF-8)
+#define LOG_TASK_STACK_SIZE 3072    // Размер стека задачи вывода
+#define LOG_TASK_PRIORITY 1         // Приоритет задачи вывода (ниже loop)
+#define LOG_TASK_CORE 0             // Ядро задачи вывода (loop работает на ядре 1)
+
+// ========================================
+// НАСТРОЙКИ ПРОФИЛИРОВАНИЯ
+// ========================================
+
+// Замеры в тактах CPU вокруг горячих участков loop (см. perf_profiler.h).
+// При 0 макросы PERF_* не генерируют код
+#define PERF_PROFILING_ENABLED 1
+#define PERF_HISTOGRAM_BUCKETS 24   // Корзины log2: [2^i, 2^(i+1)) тактов, последняя - все больше
+#define PHASE_TIMING_HISTOGRAM_BUCKETS 14 // Корзины log2 ошибки включения триака (до ~16 мс)
+
+// Тесты производительности (bench_suite.h): замер считается регрессией,
+// если такты или память на операцию больше базовых (bench_baseline.h)
+// на BENCH_REGRESSION_PERCENT процентов
+#define BENCH_REGRESSION_PERCENT 15
+#define BENCH_HEAP_SLACK_BYTES 64   // Допуск по памяти сверх процента (выравнивание блоков кучи)
+
+// ========================================
+// НАСТРОЙКИ УЧЕТА ПАМЯТИ
+// ========================================
+
+// Снимок кучи и стеков задач (memory_monitor.h, GET /memory)
+#define MEMORY_CHECK_INTERVAL_MS 5000
+#define MEMORY_FRAGMENTATION_ALERT_PERCENT 50   // 1 - самый большой блок / свободно
+#define MEMORY_FRAGMENTATION_CLEAR_PERCENT 40   // Снятие предупреждения (гистерезис)
+#define MEMORY_LOW_BLOCK_ALERT_BYTES 16384      // Самый большой блок меньше - предупреждение
+#define MEMORY_MAX_TASKS 4                      // Задач для контроля стека
+#define MEMORY_SCOPE_DEPTH 4                    // Вложенность MEMORY_SCOPE
+
+// Буфер обработки HTTP запроса (request_arena.h): JSON документы и ответы
+#define REQUEST_ARENA_SIZE 16384
+
+// Проверка выделений в loop (сборка env:esp32dev-allocwatch, ALLOC_WATCH)
+#define ALLOC_WATCH_MAX_SECONDS 3600
+#define ALLOC_WATCH_SAMPLES 8                   // Запоминаемых выделений: размер и адрес вызова
+
+// ========================================
+// НАСТРОЙКИ ЗАПИСИ И ВОСПРОИЗВЕДЕНИЯ ТРАСС
+// ========================================
+
+// Трасса входов контура (control_io.h): 8 байт на запись, буфер в RAM
+// выделяется при запуске записи. Детектор нуля дает ~100 записей/с
+#define REPLAY_TRACE_CAPACITY 3072      // Записей (24 КБ, ~30 с при нагреве)
+#define REPLAY_TRACE_MAGIC 0x54524857UL // "WHRT"
+#define REPLAY_TRACE_VERSION 1
+#define REPLAY_STEP_US 200              // Шаг виртуального времени между проходами контура
+#define REPLAY_OUTPUT_INTERVAL_MS 100   // Период строк решений (и при каждом переходе)
+#define REPLAY_START_TIME_US 1000000ULL // Виртуальное время начала воспроизведения
+
+// ========================================
+// НАСТРОЙКИ СУПЕРВИЗОРА БЕЗОПАСНОСТИ
+// ========================================
+
+// Задача супервизора не зависит от loop: при зависании главного цикла
+// выходы триаков принудительно выключаются не позже чем через
+// период + время обнаружения соответствующей неисправности
+#define SUPERVISOR_PERIOD_MS 10             // Период проверок
+#define SUPERVISOR_TASK_STACK_SIZE 3072     // Размер стека задачи (с выводом в лог)
+#define SUPERVISOR_TASK_PRIORITY 5          // Выше loop и задачи логов
+#define SUPERVISOR_TASK_CORE 0              // Ядро, отличное от loop
+#define SUPERVISOR_WDT_TIMEOUT_S 8          // Сторожевой таймер задач (перезагрузка)
+
+// Пороги неисправностей
+#define SUPERVISOR_SENSOR_STALE_MS 1000     // Датчики не обновлялись (loop завис)
+#define SUPERVISOR_DRY_FIRE_MS 3000         // Мощность без импульсов датчика потока
+#define SUPERVISOR_ZERO_CROSS_TIMEOUT_MS 100 // Нет пересечений нуля при включенной мощности
+
 #endif
\ No newline at end of file
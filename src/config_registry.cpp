@@ -0,0 +1,149 @@
+#include "config_registry.h"
+
+// Таблица дескрипторов: порядок строк совпадает с ParamId
+static const ParamDescriptor DESCRIPTORS[] = {
+    { "targetTemp",            PARAM_TYPE_FLOAT, TARGET_TEMP_MIN,    TARGET_TEMP_MAX,    TARGET_TEMP_DEFAULT,        true,  "°C" },
+    { "flowCalibrationFactor", PARAM_TYPE_FLOAT, FLOW_CALIBRATION_MIN, FLOW_CALIBRATION_MAX, FLOW_CALIBRATION_FACTOR, true, "имп/л" },
+    { "minFlowRate",           PARAM_TYPE_FLOAT, FLOW_THRESHOLD_MIN, FLOW_THRESHOLD_MAX, MIN_FLOW_RATE_DEFAULT,      true,  "л/мин" },
+    { "minTemp",               PARAM_TYPE_FLOAT, TARGET_TEMP_MIN,    TARGET_TEMP_MAX,    MIN_TEMP_DEFAULT,           true,  "°C" },
+    { "maxTemp",               PARAM_TYPE_FLOAT, TARGET_TEMP_MIN,    TARGET_TEMP_MAX,    MAX_TEMP_DEFAULT,           true,  "°C" },
+    { "rampUpTimeMs",          PARAM_TYPE_UINT,  0,                  30000,              RAMP_UP_TIME_MS,            true,  "мс" },
+    { "pidKp",                 PARAM_TYPE_FLOAT, 0.0,                20.0,               PID_KP,                     true,  "" },
+    { "pidKi",                 PARAM_TYPE_FLOAT, 0.0,                5.0,                PID_KI,                     true,  "" },
+    { "pidKd",                 PARAM_TYPE_FLOAT, 0.0,                20.0,               PID_KD,                     true,  "" },
+    { "pidIntegralLimit",      PARAM_TYPE_FLOAT, 0.0,                200.0,              PID_INTEGRAL_MAX,           true,  "" },
+    { "pidIntervalMs",         PARAM_TYPE_UINT,  10,                 1000,               PID_COMPUTE_INTERVAL_MS,    true,  "мс" },
+    { "minFireDelayUs",        PARAM_TYPE_UINT,  100,                5000,               MIN_FIRE_DELAY_US,          true,  "мкс" },
+    { "maxFireDelayUs",        PARAM_TYPE_UINT,  1000,               9500,               MAX_FIRE_DELAY_US,          true,  "мкс" },
+    { "triacPulseUs",          PARAM_TYPE_UINT,  100,                3000,               TRIAC_PULSE_US,             true,  "мкс" },
+    { "elementPowerW",         PARAM_TYPE_FLOAT, 100.0,              10000.0,            ELEMENT_POWER_W,            true,  "Вт" },
+    { "energyTariff",          PARAM_TYPE_FLOAT, 0.0,                1000.0,             ENERGY_TARIFF_PER_KWH,      true,  "/кВт*ч" },
+    { "wifiSessionTimeoutSec", PARAM_TYPE_UINT,  60,                 7200,               WIFI_SESSION_TIMEOUT_MS / 1000, false, "с" },
+    { "outletTempOffset",      PARAM_TYPE_FLOAT, -10.0,              10.0,               0.0,                        true,  "°C" },
+    { "inletTempOffset",       PARAM_TYPE_FLOAT, -10.0,              10.0,               0.0,                        true,  "°C" },
+    { "relayStageCount",       PARAM_TYPE_UINT,  0,                  RELAY_STAGE_MAX,    RELAY_STAGE_COUNT_DEFAULT,  false, "" },
+    { "relayStagePowerW",      PARAM_TYPE_FLOAT, 100.0,              30000.0,            RELAY_STAGE_POWER_W,        true,  "Вт" },
+    { "relayMinOnSec",         PARAM_TYPE_UINT,  1,                  3600,               RELAY_MIN_ON_SEC,           true,  "с" },
+    { "relayMinOffSec",        PARAM_TYPE_UINT,  1,                  3600,               RELAY_MIN_OFF_SEC,          true,  "с" },
+    { "rampProfile",           PARAM_TYPE_UINT,  0,                  RAMP_PROFILE_MAX,   RAMP_PROFILE_DEFAULT,       true,  "" },
+    { "rampDownRate",          PARAM_TYPE_FLOAT, 1.0,                1000.0,             RAMP_DOWN_RATE_DEFAULT,     true,  "%/с" },
+    { "rampCurrentLimitA",     PARAM_TYPE_FLOAT, 1.0,                100.0,              RAMP_CURRENT_LIMIT_A,       true,  "А" },
+    { "disinfectionIntervalH", PARAM_TYPE_UINT,  0,                  DISINFECTION_INTERVAL_H_MAX, DISINFECTION_INTERVAL_H_DEFAULT, true, "ч" },
+    { "disinfectionTempC",     PARAM_TYPE_FLOAT, DISINFECTION_MIN_TEMP_MIN, DISINFECTION_MIN_TEMP_MAX, DISINFECTION_MIN_TEMP_DEFAULT, true, "°C" },
+    { "disinfectionHoldMin",   PARAM_TYPE_UINT,  1,                  DISINFECTION_HOLD_MIN_MAX, DISINFECTION_HOLD_MIN_DEFAULT, true, "мин" },
+};
+
+static_assert(sizeof(DESCRIPTORS) / sizeof(DESCRIPTORS[0]) == PARAM_COUNT,
+              "Таблица дескрипторов не совпадает с ParamId");
+
+float ConfigRegistry::values[PARAM_COUNT];
+
+void ConfigRegistry::resetToDefaults() {
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        values[i] = DESCRIPTORS[i].defaultValue;
+    }
+}
+
+float ConfigRegistry::normalize(ParamId id, float value) {
+    if (DESCRIPTORS[id].type == PARAM_TYPE_UINT) {
+        return roundf(value);
+    }
+    return value;
+}
+
+bool ConfigRegistry::isInRange(ParamId id, float value) {
+    const ParamDescriptor& descriptor = DESCRIPTORS[id];
+    value = normalize(id, value);
+    return value >= descriptor.minValue && value <= descriptor.maxValue;
+}
+
+ConfigRegistry::SetResult ConfigRegistry::set(ParamId id, float value) {
+    if (id < 0 || id >= PARAM_COUNT) return SET_UNKNOWN;
+    if (!isInRange(id, value)) return SET_OUT_OF_RANGE;
+    value = normalize(id, value);
+    if (!isConsistent(id, value)) return SET_CONFLICT;
+
+    values[id] = value;
+    return DESCRIPTORS[id].live ? SET_OK : SET_OK_RESTART;
+}
+
+bool ConfigRegistry::isConsistent(ParamId id, float value) {
+    // Согласованность связанных параметров
+    float minTemp = id == PARAM_MIN_TEMP ? value : values[PARAM_MIN_TEMP];
+    float maxTemp = id == PARAM_MAX_TEMP ? value : values[PARAM_MAX_TEMP];
+    float targetTemp = id == PARAM_TARGET_TEMP ? value : values[PARAM_TARGET_TEMP];
+    if (minTemp > maxTemp || targetTemp < minTemp || targetTemp > maxTemp) return false;
+
+    float minDelay = id == PARAM_MIN_FIRE_DELAY ? value : values[PARAM_MIN_FIRE_DELAY];
+    float maxDelay = id == PARAM_MAX_FIRE_DELAY ? value : values[PARAM_MAX_FIRE_DELAY];
+    if (minDelay >= maxDelay) return false;
+
+    // Ступень на реле не мощнее всех триаков: иначе триаки не перекрывают
+    // шаг ступени и разрешение регулирования теряется (stage_controller.h)
+    float stageCount = id == PARAM_RELAY_STAGE_COUNT ? value : values[PARAM_RELAY_STAGE_COUNT];
+    float stagePower = id == PARAM_RELAY_STAGE_POWER ? value : values[PARAM_RELAY_STAGE_POWER];
+    float elementPower = id == PARAM_ELEMENT_POWER ? value : values[PARAM_ELEMENT_POWER];
+    return stageCount == 0 || stagePower <= 3 * elementPower;
+}
+
+void ConfigRegistry::loadValues(const float* stored, int count) {
+    resetToDefaults();
+    for (int i = 0; i < count && i < PARAM_COUNT; i++) {
+        if (isInRange((ParamId)i, stored[i])) {
+            values[i] = normalize((ParamId)i, stored[i]);
+        }
+    }
+
+    // Несогласованные группы возвращаем к значениям по умолчанию
+    // (ступени - первыми: isConsistent проверяет все группы сразу)
+    if (values[PARAM_RELAY_STAGE_COUNT] > 0 && values[PARAM_RELAY_STAGE_POWER] > 3 * values[PARAM_ELEMENT_POWER]) {
+        values[PARAM_RELAY_STAGE_POWER] = 3 * values[PARAM_ELEMENT_POWER];
+    }
+    if (!isConsistent(PARAM_TARGET_TEMP, values[PARAM_TARGET_TEMP])) {
+        values[PARAM_TARGET_TEMP] = DESCRIPTORS[PARAM_TARGET_TEMP].defaultValue;
+        values[PARAM_MIN_TEMP] = DESCRIPTORS[PARAM_MIN_TEMP].defaultValue;
+        values[PARAM_MAX_TEMP] = DESCRIPTORS[PARAM_MAX_TEMP].defaultValue;
+    }
+    if (!isConsistent(PARAM_MIN_FIRE_DELAY, values[PARAM_MIN_FIRE_DELAY])) {
+        values[PARAM_MIN_FIRE_DELAY] = DESCRIPTORS[PARAM_MIN_FIRE_DELAY].defaultValue;
+        values[PARAM_MAX_FIRE_DELAY] = DESCRIPTORS[PARAM_MAX_FIRE_DELAY].defaultValue;
+    }
+}
+
+const ParamDescriptor& ConfigRegistry::getDescriptor(ParamId id) {
+    return DESCRIPTORS[id];
+}
+
+int ConfigRegistry::findByName(const char* name) {
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        if (strcasecmp(DESCRIPTORS[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+void ConfigRegistry::formatValue(ParamId id, char* buffer, size_t size) {
+    if (DESCRIPTORS[id].type == PARAM_TYPE_UINT) {
+        snprintf(buffer, size, "%lu", (unsigned long)getUInt(id));
+    } else {
+        snprintf(buffer, size, "%g", values[id]);
+    }
+}
+
+void ConfigRegistry::formatEntry(ParamId id, char* buffer, size_t size) {
+    const ParamDescriptor& descriptor = DESCRIPTORS[id];
+    char value[24];
+    formatValue(id, value, sizeof(value));
+    snprintf(buffer, size, "%s = %s %s [%g..%g]%s", descriptor.name, value, descriptor.unit,
+             descriptor.minValue, descriptor.maxValue, descriptor.live ? "" : " *");
+}
+
+const char* ConfigRegistry::getResultText(SetResult result) {
+    switch (result) {
+        case SET_OK:           return "установлено";
+        case SET_OK_RESTART:   return "сохранено, применится после перезапуска";
+        case SET_UNKNOWN:      return "неизвестный параметр";
+        case SET_OUT_OF_RANGE: return "значение вне допустимого диапазона";
+        case SET_CONFLICT:     return "противоречит связанному параметру";
+        default:               return "ошибка";
+    }
+}
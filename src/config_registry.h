@@ -0,0 +1,108 @@
+#ifndef CONFIG_REGISTRY_H
+#define CONFIG_REGISTRY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// РЕЕСТР НАСТРАИВАЕМЫХ ПАРАМЕТРОВ
+// ========================================
+//
+// Каждый параметр описан в таблице дескрипторов (config_registry.cpp):
+// имя, тип, диапазон, значение по умолчанию и возможность изменения без
+// перезапуска. Доступ к значению - по индексу ParamId за O(1), поиск по
+// имени нужен только веб-интерфейсу и терминалу. Компоненты получают
+// значения через SystemController::applyConfig() и в цикле управления
+// используют свои копии.
+//
+// Порядок ParamId определяет формат записи во flash: новые параметры
+// добавляются только в конец перед PARAM_COUNT.
+
+enum ParamId {
+    PARAM_TARGET_TEMP,          // Целевая температура (°C)
+    PARAM_FLOW_CALIBRATION,     // Коэффициент калибровки потока (имп/л)
+    PARAM_MIN_FLOW_RATE,        // Минимальный поток для нагрева (л/мин)
+    PARAM_MIN_TEMP,             // Нижняя граница целевой температуры (°C)
+    PARAM_MAX_TEMP,             // Верхняя граница целевой температуры (°C)
+    PARAM_RAMP_UP_TIME,         // Время разгона (мс)
+    PARAM_PID_KP,
+    PARAM_PID_KI,
+    PARAM_PID_KD,
+    PARAM_PID_INTEGRAL_LIMIT,   // Ограничение интегральной составляющей
+    PARAM_PID_INTERVAL,         // Интервал вычисления ПИД (мс)
+    PARAM_MIN_FIRE_DELAY,       // Минимальная задержка включения (мкс)
+    PARAM_MAX_FIRE_DELAY,       // Максимальная задержка включения (мкс)
+    PARAM_TRIAC_PULSE,          // Длительность импульса триака (мкс)
+    PARAM_ELEMENT_POWER,        // Мощность нагревателя фазы (Вт)
+    PARAM_ENERGY_TARIFF,        // Стоимость 1 кВт*ч
+    PARAM_WIFI_SESSION_TIMEOUT, // Длительность WiFi сессии (с)
+    PARAM_OUTLET_TEMP_OFFSET,   // Поправка датчика на выходе (°C)
+    PARAM_INLET_TEMP_OFFSET,    // Поправка датчика на входе (°C)
+    PARAM_RELAY_STAGE_COUNT,    // Ступеней на реле поверх триаков
+    PARAM_RELAY_STAGE_POWER,    // Мощность ступени (Вт)
+    PARAM_RELAY_MIN_ON,         // Минимальное время включения реле (с)
+    PARAM_RELAY_MIN_OFF,        // Минимальная пауза реле (с)
+    PARAM_RAMP_PROFILE,         // Профиль изменения мощности (RampEngine::Profile)
+    PARAM_RAMP_DOWN_RATE,       // Скорость снижения мощности (%/с)
+    PARAM_RAMP_CURRENT_LIMIT,   // Предел тока фазы при разгоне (А)
+    PARAM_DISINFECTION_INTERVAL, // Интервал термодезинфекции (ч), 0 - выключена
+    PARAM_DISINFECTION_TEMP,    // Засчитываемая температура на выходе (°C)
+    PARAM_DISINFECTION_HOLD,    // Требуемое удержание (мин)
+    PARAM_COUNT
+};
+
+enum ParamType {
+    PARAM_TYPE_FLOAT,
+    PARAM_TYPE_UINT
+};
+
+struct ParamDescriptor {
+    const char* name;
+    ParamType type;
+    float minValue;
+    float maxValue;
+    float defaultValue;
+    bool live;                  // Применяется без перезапуска
+    const char* unit;
+};
+
+class ConfigRegistry {
+public:
+    enum SetResult {
+        SET_OK,
+        SET_OK_RESTART,         // Сохранено, вступит в силу после перезапуска
+        SET_UNKNOWN,
+        SET_OUT_OF_RANGE,
+        SET_CONFLICT            // Противоречит связанному параметру
+    };
+
+    // Значения по умолчанию для всех параметров
+    static void resetToDefaults();
+
+    // Доступ по индексу (O(1))
+    static float get(ParamId id) { return values[id]; }
+    static uint32_t getUInt(ParamId id) { return (uint32_t)values[id]; }
+    static SetResult set(ParamId id, float value);
+    static bool isInRange(ParamId id, float value);
+
+    // Описание параметров
+    static const ParamDescriptor& getDescriptor(ParamId id);
+    static int findByName(const char* name);      // -1, если не найден
+    static void formatValue(ParamId id, char* buffer, size_t size);
+    static void formatEntry(ParamId id, char* buffer, size_t size); // "имя = значение ед. [мин..макс]"
+    static const char* getResultText(SetResult result);
+
+    // Набор всех значений (для записи во flash)
+    static const float* getValues() { return values; }
+    // Загрузка сохраненного набора: значения вне диапазона и несогласованные
+    // группы параметров заменяются значениями по умолчанию
+    static void loadValues(const float* stored, int count);
+
+private:
+    static float values[PARAM_COUNT];
+
+    static float normalize(ParamId id, float value);
+    static bool isConsistent(ParamId id, float value);
+};
+
+#endif
@@ -1,89 +1,400 @@
 #include "config_storage.h"
+#include "rom/crc.h"
 
 // Определение статических констант
 const uint32_t ConfigStorage::MAGIC_NUMBER = 0x57415445; // "WATE" (Water Heater)
+const uint32_t ConfigStorage::ENERGY_MAGIC_NUMBER = 0x454E5247; // "ENRG"
+const uint32_t ConfigStorage::FLOW_CURVE_MAGIC_NUMBER = 0x464C4F57; // "FLOW"
+
+RecordLog ConfigStorage::recordLog;
+bool ConfigStorage::useLog = false;
+bool ConfigStorage::pending = false;
+unsigned long ConfigStorage::firstChangeTime = 0;
+unsigned long ConfigStorage::lastChangeTime = 0;
+unsigned long ConfigStorage::flashWriteCount = 0;
 
 void ConfigStorage::begin() {
+    ConfigRegistry::resetToDefaults();
     EEPROM.begin(EEPROM_SIZE);
+    
+    useLog = recordLog.begin(CONFIG_LOG_PARTITION, CONFIG_LOG_SUBTYPE);
+    if (useLog) {
+        migrateFromEEPROM();
+    } else if (DEBUG_SERIAL) {
+        Serial.println("Раздел журнала настроек не найден, используем EEPROM");
+    }
 }
 
-bool ConfigStorage::saveConfig(const SystemState& state) {
-    EEPROMConfig config;
-    config.targetTemp = state.targetTemp;
-    config.flowCalibrationFactor = state.flowCalibrationFactor;
-    config.magic = MAGIC_NUMBER;
+void ConfigStorage::migrateFromEEPROM() {
+    // Переносим данные прежнего формата, если в журнале их еще нет
+    float values[PARAM_COUNT];
+    int count;
+    if (!recordLog.contains(RECORD_CONFIG) && readLegacyConfig(values, count)) {
+        // Прежний формат совпадает с записью версии 1
+        bool result = recordLog.write(RECORD_CONFIG, 1, values, count * sizeof(float));
+        if (DEBUG_SERIAL) {
+            Serial.println("Конфигурация перенесена из EEPROM в журнал: " + String(result ? "УСПЕХ" : "ОШИБКА"));
+        }
+    }
     
-    // Записываем магическое число
-    EEPROM.put(MAGIC_NUMBER_ADDR, MAGIC_NUMBER);
+    EnergyTotals totals;
+    if (!recordLog.contains(RECORD_ENERGY) && readLegacyEnergy(totals)) {
+        bool result = recordLog.write(RECORD_ENERGY, ENERGY_SCHEMA_VERSION, &totals, sizeof(totals));
+        if (DEBUG_SERIAL) {
+            Serial.println("Счетчики энергии перенесены из EEPROM в журнал: " + String(result ? "УСПЕХ" : "ОШИБКА"));
+        }
+    }
+}
+
+bool ConfigStorage::saveConfig() {
+    // Откладываем запись: серия изменений подряд дает одну запись во flash
+    unsigned long currentTime = millis();
+    if (!pending) {
+        firstChangeTime = currentTime;
+    }
+    lastChangeTime = currentTime;
+    pending = true;
     
-    // Записываем конфигурацию
-    EEPROM.put(CONFIG_START_ADDR, config);
+    return true;
+}
+
+void ConfigStorage::update() {
+    if (!pending) return;
     
-    // Сохраняем изменения
-    bool result = EEPROM.commit();
+    unsigned long currentTime = millis();
+    if (currentTime - lastChangeTime >= CONFIG_WRITE_DELAY_MS ||
+        currentTime - firstChangeTime >= CONFIG_WRITE_MAX_DELAY_MS) {
+        flush();
+    }
+}
+
+bool ConfigStorage::flush() {
+    if (!pending) return true;
+    
+    pending = false;
+    bool result = writeConfig();
     
     if (DEBUG_SERIAL) {
-        Serial.println("Конфигурация сохранена в EEPROM: " + String(result ? "УСПЕХ" : "ОШИБКА"));
-        Serial.println("Целевая температура: " + String(config.targetTemp, 1) + "°C");
-        Serial.println("Коэффициент калибровки: " + String(config.flowCalibrationFactor, 2) + " имп/л");
+        Serial.println("Конфигурация сохранена: " + String(result ? "УСПЕХ" : "ОШИБКА"));
     }
     
     return result;
 }
 
-bool ConfigStorage::loadConfig(SystemState& state) {
-    uint32_t magic;
-    EEPROM.get(MAGIC_NUMBER_ADDR, magic);
+bool ConfigStorage::hasPendingChanges() {
+    return pending;
+}
+
+bool ConfigStorage::writeConfig(bool force) {
+    const float* values = ConfigRegistry::getValues();
     
-    if (magic != MAGIC_NUMBER) {
+    // Не пишем, если значения не изменились
+    float stored[PARAM_COUNT];
+    int count;
+    if (!force && readStoredValues(stored, count) && count == PARAM_COUNT &&
+        memcmp(stored, values, sizeof(stored)) == 0) {
+        return true;
+    }
+    
+    flashWriteCount++;
+    if (useLog) {
+        ConfigValuesRecord record;
+        record.count = PARAM_COUNT;
+        record.reserved = 0;
+        memcpy(record.values, values, sizeof(record.values));
+        return recordLog.write(RECORD_CONFIG, CONFIG_SCHEMA_VERSION, &record, sizeof(record));
+    }
+    
+    // Прежний формат вмещает только первые два параметра
+    EEPROMConfig legacy;
+    legacy.targetTemp = values[PARAM_TARGET_TEMP];
+    legacy.flowCalibrationFactor = values[PARAM_FLOW_CALIBRATION];
+    legacy.magic = MAGIC_NUMBER;
+    EEPROM.put(MAGIC_NUMBER_ADDR, MAGIC_NUMBER);
+    EEPROM.put(CONFIG_START_ADDR, legacy);
+    return EEPROM.commit();
+}
+
+bool ConfigStorage::loadConfig() {
+    float values[PARAM_COUNT];
+    int count;
+    if (!readStoredValues(values, count)) {
         if (DEBUG_SERIAL) {
-            Serial.println("EEPROM не содержит валидной конфигурации, используем настройки по умолчанию");
+            Serial.println("Хранилище не содержит валидной конфигурации, используем настройки по умолчанию");
         }
         return false;
     }
     
-    EEPROMConfig config;
-    EEPROM.get(CONFIG_START_ADDR, config);
+    // Отсутствующие в старой записи параметры получают значения по умолчанию
+    ConfigRegistry::loadValues(values, count);
     
-    // Проверяем валидность данных
-    if (config.targetTemp < TARGET_TEMP_MIN || config.targetTemp > TARGET_TEMP_MAX ||
-        config.flowCalibrationFactor < FLOW_CALIBRATION_MIN || config.flowCalibrationFactor > FLOW_CALIBRATION_MAX) {
+    if (DEBUG_SERIAL) {
+        Serial.printf("Конфигурация загружена: %d из %d параметров\n", count, PARAM_COUNT);
+        Serial.println("Целевая температура: " + String(ConfigRegistry::get(PARAM_TARGET_TEMP), 1) + "°C");
+        Serial.println("Коэффициент калибровки: " + String(ConfigRegistry::get(PARAM_FLOW_CALIBRATION), 2) + " имп/л");
+    }
+    
+    return true;
+}
+
+bool ConfigStorage::readStoredValues(float* values, int& count) {
+    if (!useLog) {
+        return readLegacyConfig(values, count);
+    }
+    
+    uint8_t data[CONFIG_LOG_MAX_RECORD];
+    uint8_t version;
+    size_t length;
+    if (!recordLog.read(RECORD_CONFIG, version, data, sizeof(data), length)) {
+        return false;
+    }
+    
+    if (!migrateConfig(version, data, length, values, count)) {
         if (DEBUG_SERIAL) {
-            Serial.println("Конфигурация в EEPROM содержит невалидные данные, используем настройки по умолчанию");
+            Serial.printf("Неизвестная версия схемы настроек: %d\n", version);
         }
         return false;
     }
     
-    // Загружаем валидные данные
-    state.targetTemp = config.targetTemp;
-    state.flowCalibrationFactor = config.flowCalibrationFactor;
+    return true;
+}
+
+bool ConfigStorage::migrateConfig(uint8_t version, const uint8_t* data, size_t length, float* values, int& count) {
+    // Преобразование записи версии version в значения в порядке ParamId.
+    // При изменении порядка или смысла параметров увеличиваем
+    // CONFIG_SCHEMA_VERSION и добавляем сюда ветку
+    switch (version) {
+        case 1: {
+            // targetTemp и flowCalibrationFactor - первые два параметра реестра
+            if (length < 2 * sizeof(float)) return false;
+            memcpy(values, data, 2 * sizeof(float));
+            count = 2;
+            return true;
+        }
+        case 2: {
+            // Новые параметры добавляются в конец, поэтому короткая запись
+            // той же версии тоже допустима
+            const size_t headerSize = offsetof(ConfigValuesRecord, values);
+            if (length < headerSize) return false;
+            uint16_t stored;
+            memcpy(&stored, data, sizeof(stored));
+            count = (length - headerSize) / sizeof(float);
+            if (stored < count) count = stored;
+            if (count > PARAM_COUNT) count = PARAM_COUNT;
+            memcpy(values, data + headerSize, count * sizeof(float));
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+void ConfigStorage::resetToDefaults() {
+    ConfigRegistry::resetToDefaults();
+    
+    // Одна запись значений по умолчанию (счетчики энергии сохраняются)
+    pending = false;
+    writeConfig();
     
     if (DEBUG_SERIAL) {
-        Serial.println("Конфигурация загружена из EEPROM:");
-        Serial.println("Целевая температура: " + String(state.targetTemp, 1) + "°C");
-        Serial.println("Коэффициент калибровки: " + String(state.flowCalibrationFactor, 2) + " имп/л");
+        Serial.println("Конфигурация сброшена к настройкам по умолчанию");
     }
+}
+
+bool ConfigStorage::isValidConfig() {
+    float values[PARAM_COUNT];
+    int count;
+    return readStoredValues(values, count);
+}
+
+bool ConfigStorage::saveEnergyTotals(const EnergyTotals& totals) {
+    flashWriteCount++;
+    if (useLog) {
+        return recordLog.write(RECORD_ENERGY, ENERGY_SCHEMA_VERSION, &totals, sizeof(totals));
+    }
+    
+    EEPROMEnergy record;
+    record.magic = ENERGY_MAGIC_NUMBER;
+    record.totals = totals;
+    record.crc = crc32_le(0, (const uint8_t*)&record.totals, sizeof(record.totals));
     
+    EEPROM.put(ENERGY_START_ADDR, record);
+    return EEPROM.commit();
+}
+
+bool ConfigStorage::loadEnergyTotals(EnergyTotals& totals) {
+    bool result;
+    if (useLog) {
+        uint8_t version;
+        size_t length;
+        result = recordLog.read(RECORD_ENERGY, version, &totals, sizeof(totals), length) &&
+                 version == ENERGY_SCHEMA_VERSION && length == sizeof(totals);
+    } else {
+        result = readLegacyEnergy(totals);
+    }
+    
+    if (!result) {
+        if (DEBUG_SERIAL) {
+            Serial.println("Счетчики энергии не найдены, начинаем с нуля");
+        }
+        return false;
+    }
+    
+    if (DEBUG_SERIAL) {
+        Serial.println("Счетчики энергии загружены: " +
+                       String(totals.phaseKWh[0] + totals.phaseKWh[1] + totals.phaseKWh[2], 3) + " кВт*ч, " +
+                       String(totals.litresHeated, 1) + " л");
+    }
     return true;
 }
 
-void ConfigStorage::resetToDefaults(SystemState& state) {
-    state.targetTemp = TARGET_TEMP_DEFAULT;
-    state.flowCalibrationFactor = FLOW_CALIBRATION_FACTOR;
+bool ConfigStorage::saveFlowCurve(const FlowCalibrationPoint* points, int count) {
+    FlowCurveRecord record;
+    memset(&record, 0, sizeof(record));
+    record.count = count < FLOW_CURVE_MAX_POINTS ? count : FLOW_CURVE_MAX_POINTS;
+    for (int i = 0; i < record.count; i++) {
+        record.points[i] = points[i];
+    }
+    
+    flashWriteCount++;
+    if (useLog) {
+        return recordLog.write(RECORD_FLOW_CURVE, FLOW_CURVE_SCHEMA_VERSION, &record, sizeof(record));
+    }
+    
+    EEPROMFlowCurve stored;
+    stored.magic = FLOW_CURVE_MAGIC_NUMBER;
+    stored.curve = record;
+    stored.crc = crc32_le(0, (const uint8_t*)&stored.curve, sizeof(stored.curve));
     
-    // Очищаем EEPROM
-    for (int i = 0; i < EEPROM_SIZE; i++) {
-        EEPROM.write(i, 0xFF);
+    EEPROM.put(FLOW_CURVE_START_ADDR, stored);
+    return EEPROM.commit();
+}
+
+bool ConfigStorage::loadFlowCurve(FlowCalibrationPoint* points, int& count) {
+    FlowCurveRecord record;
+    bool result;
+    if (useLog) {
+        uint8_t version;
+        size_t length;
+        result = recordLog.read(RECORD_FLOW_CURVE, version, &record, sizeof(record), length) &&
+                 version == FLOW_CURVE_SCHEMA_VERSION && length == sizeof(record);
+    } else {
+        EEPROMFlowCurve stored;
+        EEPROM.get(FLOW_CURVE_START_ADDR, stored);
+        result = stored.magic == FLOW_CURVE_MAGIC_NUMBER &&
+                 stored.crc == crc32_le(0, (const uint8_t*)&stored.curve, sizeof(stored.curve));
+        record = stored.curve;
     }
-    EEPROM.commit();
     
+    if (!result || record.count > FLOW_CURVE_MAX_POINTS) {
+        count = 0;
+        return false;
+    }
+    
+    count = record.count;
+    for (int i = 0; i < count; i++) {
+        points[i] = record.points[i];
+    }
+    return true;
+}
+
+bool ConfigStorage::saveProfiles(const PowerProfile* profiles, int count) {
+    if (!useLog) return false;
+    
+    ProfilesRecord record;
+    memset(&record, 0, sizeof(record));
+    record.count = count < PROFILE_SLOT_COUNT ? count : PROFILE_SLOT_COUNT;
+    for (int i = 0; i < record.count; i++) {
+        record.profiles[i] = profiles[i];
+    }
+    
+    flashWriteCount++;
+    return recordLog.write(RECORD_PROFILES, PROFILES_SCHEMA_VERSION, &record, sizeof(record));
+}
+
+bool ConfigStorage::loadProfiles(PowerProfile* profiles, int count) {
+    if (!useLog) return false;
+    
+    ProfilesRecord record;
+    uint8_t version;
+    size_t length;
+    if (!recordLog.read(RECORD_PROFILES, version, &record, sizeof(record), length) ||
+        version != PROFILES_SCHEMA_VERSION || length != sizeof(record)) {
+        return false;
+    }
+    
+    for (int i = 0; i < count && i < record.count && i < PROFILE_SLOT_COUNT; i++) {
+        if (ProfileEngine::isValid(record.profiles[i])) {
+            profiles[i] = record.profiles[i];
+        }
+    }
     if (DEBUG_SERIAL) {
-        Serial.println("Конфигурация сброшена к настройкам по умолчанию");
+        Serial.println("Профили режимов загружены: " + String(record.count));
     }
+    return true;
 }
 
-bool ConfigStorage::isValidConfig() {
+bool ConfigStorage::saveDisinfection(const DisinfectionHistory& history) {
+    if (!useLog) return false;
+    
+    flashWriteCount++;
+    return recordLog.write(RECORD_DISINFECTION, DISINFECTION_SCHEMA_VERSION, &history, sizeof(history));
+}
+
+bool ConfigStorage::loadDisinfection(DisinfectionHistory& history) {
+    if (!useLog) return false;
+    
+    DisinfectionHistory record;
+    uint8_t version;
+    size_t length;
+    if (!recordLog.read(RECORD_DISINFECTION, version, &record, sizeof(record), length) ||
+        version != DISINFECTION_SCHEMA_VERSION || length != sizeof(record) ||
+        record.count > DISINFECTION_HISTORY_SIZE || record.head >= DISINFECTION_HISTORY_SIZE) {
+        return false;
+    }
+    
+    history = record;
+    return true;
+}
+
+const RecordLog& ConfigStorage::getLog() {
+    return recordLog;
+}
+
+bool ConfigStorage::isUsingLog() {
+    return useLog;
+}
+
+unsigned long ConfigStorage::getFlashWriteCount() {
+    return flashWriteCount;
+}
+
+// ========================================
+// ПРЕЖНИЙ ФОРМАТ EEPROM
+// ========================================
+
+bool ConfigStorage::readLegacyConfig(float* values, int& count) {
     uint32_t magic;
     EEPROM.get(MAGIC_NUMBER_ADDR, magic);
-    return magic == MAGIC_NUMBER;
+    if (magic != MAGIC_NUMBER) return false;
+    
+    EEPROMConfig legacy;
+    EEPROM.get(CONFIG_START_ADDR, legacy);
+    values[PARAM_TARGET_TEMP] = legacy.targetTemp;
+    values[PARAM_FLOW_CALIBRATION] = legacy.flowCalibrationFactor;
+    count = 2;
+    return true;
+}
+
+bool ConfigStorage::readLegacyEnergy(EnergyTotals& totals) {
+    EEPROMEnergy record;
+    EEPROM.get(ENERGY_START_ADDR, record);
+    
+    if (record.magic != ENERGY_MAGIC_NUMBER ||
+        record.crc != crc32_le(0, (const uint8_t*)&record.totals, sizeof(record.totals))) {
+        return false;
+    }
+    
+    totals = record.totals;
+    return true;
 }
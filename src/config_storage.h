@@ -4,32 +4,99 @@
 #include <EEPROM.h>
 #include "config.h"
 #include "system_state.h"
+#include "energy_meter.h"
+#include "record_log.h"
+#include "config_registry.h"
+#include "sensors.h"
+#include "profile_engine.h"
+#include "disinfection_scheduler.h"
+
+// Настройки (все параметры ConfigRegistry) и счетчики энергии хранятся в
+// журнале записей (RecordLog) в отдельном разделе flash. Каждая запись
+// содержит версию схемы, при чтении старые версии преобразуются в текущую.
+// Данные старого формата из EEPROM переносятся в журнал при первом запуске.
+// Если раздела нет (старая таблица разделов), используется прежнее
+// хранение в EEPROM (только targetTemp и flowCalibrationFactor).
 
 class ConfigStorage {
 public:
-    // Инициализация EEPROM
+    // Инициализация хранилища и перенос данных из EEPROM
     static void begin();
     
-    // Сохранение конфигурации
-    static bool saveConfig(const SystemState& state);
+    // Сохранение значений реестра (запись во flash откладывается, см. update)
+    static bool saveConfig();
     
-    // Загрузка конфигурации
-    static bool loadConfig(SystemState& state);
+    // Загрузка сохраненных значений в реестр
+    static bool loadConfig();
     
-    // Сброс к настройкам по умолчанию
-    static void resetToDefaults(SystemState& state);
+    // Сброс реестра к настройкам по умолчанию
+    static void resetToDefaults();
     
-    // Проверка валидности данных в EEPROM
+    // Проверка валидности сохраненных данных
     static bool isValidConfig();
     
+    // Отложенная запись: вызывать в loop
+    static void update();
+    static bool flush();
+    static bool hasPendingChanges();
+    
+    // Счетчики энергии (отдельная запись, не затрагивается сбросом настроек)
+    static bool saveEnergyTotals(const EnergyTotals& totals);
+    static bool loadEnergyTotals(EnergyTotals& totals);
+    
+    // Кривая калибровки датчика потока (отдельная запись)
+    static bool saveFlowCurve(const FlowCalibrationPoint* points, int count);
+    static bool loadFlowCurve(FlowCalibrationPoint* points, int& count);
+    
+    // Профили режимов SystemController (только журнал: в EEPROM нет места,
+    // без раздела действуют встроенные профили). При загрузке заменяются
+    // только допустимые профили
+    static bool saveProfiles(const PowerProfile* profiles, int count);
+    static bool loadProfiles(PowerProfile* profiles, int count);
+    
+    // Журнал термодезинфекции (только журнал записей, как профили)
+    static bool saveDisinfection(const DisinfectionHistory& history);
+    static bool loadDisinfection(DisinfectionHistory& history);
+    
+    // Состояние журнала
+    static const RecordLog& getLog();
+    static bool isUsingLog();
+    static unsigned long getFlashWriteCount();
+
 private:
-    // Адреса в EEPROM
+    friend struct BenchAccess;   // Тесты производительности (bench_suite.cpp)
+    
+    // Типы записей журнала
+    static const uint8_t RECORD_CONFIG = 1;
+    static const uint8_t RECORD_ENERGY = 2;
+    static const uint8_t RECORD_FLOW_CURVE = 3;
+    static const uint8_t RECORD_PROFILES = 4;
+    static const uint8_t RECORD_DISINFECTION = 5;
+    
+    // Версии схем
+    // Настройки: 1 - targetTemp, flowCalibrationFactor
+    //            2 - ConfigValuesRecord (значения в порядке ParamId)
+    // Энергия: 1 - EnergyTotals
+    // Кривая потока: 1 - FlowCurveRecord
+    // Профили: 1 - ProfilesRecord
+    // Термодезинфекция: 1 - DisinfectionHistory
+    static const uint8_t CONFIG_SCHEMA_VERSION = 2;
+    static const uint8_t ENERGY_SCHEMA_VERSION = 1;
+    static const uint8_t FLOW_CURVE_SCHEMA_VERSION = 1;
+    static const uint8_t PROFILES_SCHEMA_VERSION = 1;
+    static const uint8_t DISINFECTION_SCHEMA_VERSION = 1;
+    
+    // Адреса в EEPROM (прежний формат)
     static const int EEPROM_SIZE = 512;
     static const int MAGIC_NUMBER_ADDR = 0;
     static const int CONFIG_START_ADDR = 4;
+    static const int ENERGY_START_ADDR = 64;    // Область счетчиков энергии
+    static const int FLOW_CURVE_START_ADDR = 128; // Область кривой калибровки
     
     // Магическое число для проверки валидности
     static const uint32_t MAGIC_NUMBER;
+    static const uint32_t ENERGY_MAGIC_NUMBER;
+    static const uint32_t FLOW_CURVE_MAGIC_NUMBER;
     
     // Структура конфигурации для EEPROM
     struct EEPROMConfig {
@@ -37,6 +104,59 @@ private:
         float flowCalibrationFactor;
         uint32_t magic;
     };
+    
+    // Запись настроек версии 2
+    struct ConfigValuesRecord {
+        uint16_t count;
+        uint16_t reserved;
+        float values[PARAM_COUNT];
+    };
+    
+    // Запись кривой калибровки версии 1
+    struct FlowCurveRecord {
+        uint16_t count;
+        uint16_t reserved;
+        FlowCalibrationPoint points[FLOW_CURVE_MAX_POINTS];
+    };
+    
+    // Запись профилей версии 1
+    struct ProfilesRecord {
+        uint16_t count;
+        uint16_t reserved;
+        PowerProfile profiles[PROFILE_SLOT_COUNT];
+    };
+    static_assert(sizeof(ProfilesRecord) <= CONFIG_LOG_MAX_RECORD, "Запись профилей больше CONFIG_LOG_MAX_RECORD");
+    static_assert(sizeof(DisinfectionHistory) <= CONFIG_LOG_MAX_RECORD, "Журнал термодезинфекции больше CONFIG_LOG_MAX_RECORD");
+    
+    // Кривая калибровки для EEPROM
+    struct EEPROMFlowCurve {
+        uint32_t magic;
+        FlowCurveRecord curve;
+        uint32_t crc;
+    };
+    
+    // Структура счетчиков энергии для EEPROM
+    struct EEPROMEnergy {
+        uint32_t magic;
+        EnergyTotals totals;
+        uint32_t crc;
+    };
+    
+    static RecordLog recordLog;
+    static bool useLog;
+    static bool pending;
+    static unsigned long firstChangeTime;
+    static unsigned long lastChangeTime;
+    static unsigned long flashWriteCount;
+    
+    static bool readStoredValues(float* values, int& count);
+    static bool writeConfig(bool force = false);    // force - писать и без изменений
+    static bool migrateConfig(uint8_t version, const uint8_t* data, size_t length, float* values, int& count);
+    
+    // Прежний формат EEPROM
+    static bool readLegacyConfig(float* values, int& count);
+    static bool readLegacyEnergy(EnergyTotals& totals);
+    static void migrateFromEEPROM();
 };
 
 #endif
@@ -0,0 +1,285 @@
+#include "control_io.h"
+#include "safety_supervisor.h"
+#include "logger.h"
+#include "memory_monitor.h"
+
+ControlIO::TraceRecord* ControlIO::records = nullptr;
+int ControlIO::recordCount = 0;
+bool ControlIO::recording = false;
+bool ControlIO::overflow = false;
+unsigned long ControlIO::startUs = 0;
+int ControlIO::lastZeroCross[3] = { LOW, LOW, LOW };
+int16_t ControlIO::lastFlowCounter = 0;
+
+uint8_t ControlIO::loadPartial[sizeof(TraceHeader)];
+size_t ControlIO::loadPartialLength = 0;
+bool ControlIO::loadHeaderDone = false;
+uint32_t ControlIO::loadExpectedCount = 0;
+bool ControlIO::loading = false;
+
+bool ControlIO::replaying = false;
+uint64_t ControlIO::virtualTimeUs = 0;
+int ControlIO::replayZeroCross[3] = { LOW, LOW, LOW };
+int16_t ControlIO::replayFlowCounter = 0;
+uint16_t ControlIO::replayAdc[TEMP_CHANNEL_COUNT] = {0};
+
+// ========================================
+// ВРЕМЯ, ВХОДЫ И ВЫХОДЫ
+// ========================================
+
+unsigned long ControlIO::nowMs() {
+    return replaying ? (unsigned long)(virtualTimeUs / 1000) : millis();
+}
+
+unsigned long ControlIO::nowUs() {
+    return replaying ? (unsigned long)virtualTimeUs : micros();
+}
+
+int ControlIO::readZeroCross(int pin, int phase) {
+    if (replaying) return replayZeroCross[phase];
+
+    int level = digitalRead(pin);
+    if (recording && level != lastZeroCross[phase]) {
+        append(TRACE_ZERO_CROSS, phase, level);
+    }
+    lastZeroCross[phase] = level;
+    return level;
+}
+
+int16_t ControlIO::readFlowCounter() {
+    if (replaying) return replayFlowCounter;
+
+    int16_t counter = 0;
+    pcnt_get_counter_value((pcnt_unit_t)FLOW_PCNT_UNIT, &counter);
+    if (recording && counter != lastFlowCounter) {
+        append(TRACE_FLOW_COUNTER, 0, counter);
+    }
+    lastFlowCounter = counter;
+    return counter;
+}
+
+uint16_t ControlIO::adcSample(int channel, uint16_t value) {
+    if (replaying) return replayAdc[channel];
+
+    if (recording) {
+        append(TRACE_ADC, channel, value);
+    }
+    return value;
+}
+
+void ControlIO::writeTriac(int pin, int level) {
+    if (!replaying) {
+        digitalWrite(pin, level);
+    }
+}
+
+void ControlIO::writeRelay(int pin, int level) {
+    if (!replaying) {
+        digitalWrite(pin, level);
+    }
+}
+
+bool ControlIO::isSafetyTripped() {
+    return !replaying && SafetySupervisor::isTripped();
+}
+
+void ControlIO::command(Command command, float value) {
+    if (recording && !replaying) {
+        append(TRACE_COMMAND, command, (int16_t)lroundf(value * 100.0));
+    }
+}
+
+const char* ControlIO::getCommandName(Command command) {
+    switch (command) {
+        case COMMAND_TARGET_TEMP:    return "target";
+        case COMMAND_MIN_FLOW:       return "minflow";
+        case COMMAND_ENABLE:         return "enable";
+        case COMMAND_DISABLE:        return "disable";
+        case COMMAND_EMERGENCY_STOP: return "stop";
+        case COMMAND_RESET:          return "reset";
+        case COMMAND_PROFILE:        return "profile";
+        default:                     return "unknown";
+    }
+}
+
+// ========================================
+// ЗАПИСЬ
+// ========================================
+
+bool ControlIO::allocate() {
+    if (records == nullptr) {
+        records = (TraceRecord*)MemoryMonitor::allocate(MEM_REPLAY, REPLAY_TRACE_CAPACITY * sizeof(TraceRecord));
+    }
+    return records != nullptr;
+}
+
+bool ControlIO::startRecording() {
+    if (recording || loading || !allocate()) return false;
+
+    recordCount = 0;
+    overflow = false;
+    startUs = micros();
+    recording = true;
+
+    // Начальное состояние входов (АЦП - на следующем опросе датчиков)
+    lastZeroCross[0] = digitalRead(ZERO_CROSS_PIN);
+    pcnt_get_counter_value((pcnt_unit_t)FLOW_PCNT_UNIT, &lastFlowCounter);
+    append(TRACE_ZERO_CROSS, 0, lastZeroCross[0]);
+#if PHASE_ZERO_CROSS_INPUTS
+    lastZeroCross[1] = digitalRead(ZERO_CROSS_L2_PIN);
+    lastZeroCross[2] = digitalRead(ZERO_CROSS_L3_PIN);
+    append(TRACE_ZERO_CROSS, 1, lastZeroCross[1]);
+    append(TRACE_ZERO_CROSS, 2, lastZeroCross[2]);
+#endif
+    append(TRACE_FLOW_COUNTER, 0, lastFlowCounter);
+
+    LOG_I(MAIN, "Запись трассы входов запущена (до %d записей)", REPLAY_TRACE_CAPACITY);
+    return true;
+}
+
+void ControlIO::stopRecording() {
+    if (!recording) return;
+    recording = false;
+    LOG_I(MAIN, "Запись трассы остановлена: %d записей, %.1f с%s", recordCount,
+          getDurationUs() / 1000000.0, overflow ? " (буфер заполнен)" : "");
+}
+
+void ControlIO::clear() {
+    recording = false;
+    loading = false;
+    recordCount = 0;
+    overflow = false;
+    MemoryMonitor::release(MEM_REPLAY, records);
+    records = nullptr;
+}
+
+bool ControlIO::isFull() {
+    return recordCount >= REPLAY_TRACE_CAPACITY;
+}
+
+uint32_t ControlIO::getDurationUs() {
+    if (recording) return micros() - startUs;
+    return recordCount > 0 ? records[recordCount - 1].timeUs : 0;
+}
+
+void ControlIO::append(uint8_t type, uint8_t channel, int16_t value) {
+    if (recordCount >= REPLAY_TRACE_CAPACITY) {
+        overflow = true;
+        stopRecording();
+        return;
+    }
+
+    TraceRecord& record = records[recordCount++];
+    record.timeUs = micros() - startUs;
+    record.type = type;
+    record.channel = channel;
+    record.value = value;
+}
+
+void ControlIO::fillHeader(TraceHeader& header) {
+    header.magic = REPLAY_TRACE_MAGIC;
+    header.version = REPLAY_TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.recordCount = recordCount;
+}
+
+// ========================================
+// ЗАГРУЗКА
+// ========================================
+
+bool ControlIO::beginLoad() {
+    if (recording || !allocate()) return false;
+
+    recordCount = 0;
+    overflow = false;
+    loadPartialLength = 0;
+    loadHeaderDone = false;
+    loadExpectedCount = 0;
+    loading = true;
+    return true;
+}
+
+bool ControlIO::loadBytes(const uint8_t* data, size_t length) {
+    if (!loading) return false;
+
+    while (length > 0) {
+        size_t need = loadHeaderDone ? sizeof(TraceRecord) : sizeof(TraceHeader);
+        size_t part = min(length, need - loadPartialLength);
+        memcpy(loadPartial + loadPartialLength, data, part);
+        loadPartialLength += part;
+        data += part;
+        length -= part;
+        if (loadPartialLength < need) break;
+        loadPartialLength = 0;
+
+        if (!loadHeaderDone) {
+            TraceHeader header;
+            memcpy(&header, loadPartial, sizeof(header));
+            if (header.magic != REPLAY_TRACE_MAGIC || header.version != REPLAY_TRACE_VERSION ||
+                header.recordSize != sizeof(TraceRecord) || header.recordCount > REPLAY_TRACE_CAPACITY) {
+                loading = false;
+                recordCount = 0;
+                return false;
+            }
+            loadExpectedCount = header.recordCount;
+            loadHeaderDone = true;
+        } else {
+            if (recordCount >= (int)loadExpectedCount) {
+                loading = false;
+                recordCount = 0;
+                return false;
+            }
+            memcpy(&records[recordCount++], loadPartial, sizeof(TraceRecord));
+        }
+    }
+    return true;
+}
+
+bool ControlIO::endLoad() {
+    bool complete = loading && loadHeaderDone && loadPartialLength == 0 && recordCount == (int)loadExpectedCount;
+    loading = false;
+    if (!complete) {
+        recordCount = 0;
+    }
+    return complete;
+}
+
+// ========================================
+// ВОСПРОИЗВЕДЕНИЕ
+// ========================================
+
+void ControlIO::beginReplay() {
+    replaying = true;
+    virtualTimeUs = REPLAY_START_TIME_US;
+    for (int phase = 0; phase < 3; phase++) {
+        replayZeroCross[phase] = LOW;
+    }
+    replayFlowCounter = 0;
+    for (int ch = 0; ch < TEMP_CHANNEL_COUNT; ch++) {
+        replayAdc[ch] = 0;
+    }
+}
+
+void ControlIO::endReplay() {
+    replaying = false;
+}
+
+void ControlIO::applyInput(const TraceRecord& record) {
+    switch (record.type) {
+        case TRACE_ZERO_CROSS:
+            if (record.channel < 3) {
+                replayZeroCross[record.channel] = record.value;
+            }
+            break;
+        case TRACE_FLOW_COUNTER:
+            replayFlowCounter = record.value;
+            break;
+        case TRACE_ADC:
+            if (record.channel < TEMP_CHANNEL_COUNT) {
+                replayAdc[record.channel] = (uint16_t)record.value;
+            }
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef CONTROL_IO_H
+#define CONTROL_IO_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensors.h"
+
+// ========================================
+// ВВОД-ВЫВОД КОНТУРА УПРАВЛЕНИЯ
+// ========================================
+//
+// SensorManager, SystemController, PhaseController, PIDController и
+// EnergyMeter берут время, входы (детектор нуля, счетчик потока, АЦП) и
+// выходы триаков только через ControlIO. В обычной работе это прямые
+// вызовы оборудования, а при включенной записи каждое изменение входа
+// и каждая команда пользователя дописываются в трассу в RAM.
+//
+// При воспроизведении (ReplayEngine) тот же код работает на отдельном
+// экземпляре SystemController: время виртуальное, входы берутся из трассы,
+// выходы и побочные действия (супервизор, частота CPU, запись во flash)
+// отключены. Воспроизведение выполняется в задаче loop, флаг действует
+// только на нее.
+
+class ControlIO {
+public:
+    enum RecordType {
+        TRACE_ZERO_CROSS,       // Уровень детектора нуля фазы channel (при изменении)
+        TRACE_FLOW_COUNTER,     // Значение PCNT датчика потока (при изменении)
+        TRACE_ADC,              // Усредненный отсчет АЦП канала температуры
+        TRACE_COMMAND           // Команда пользователя
+    };
+
+    enum Command {
+        COMMAND_TARGET_TEMP,    // value = °C * 100
+        COMMAND_MIN_FLOW,       // value = л/мин * 100
+        COMMAND_ENABLE,
+        COMMAND_DISABLE,
+        COMMAND_EMERGENCY_STOP,
+        COMMAND_RESET,
+        COMMAND_PROFILE,        // value = режим профиля * 100, -100 - остановка
+        COMMAND_COUNT
+    };
+
+    // Запись трассы (8 байт, little-endian)
+    struct TraceRecord {
+        uint32_t timeUs;        // От начала записи
+        uint8_t type;           // RecordType
+        uint8_t channel;        // Канал АЦП или Command
+        int16_t value;
+    };
+
+    // Файл трассы: заголовок, затем recordCount записей
+    struct TraceHeader {
+        uint32_t magic;         // REPLAY_TRACE_MAGIC
+        uint16_t version;
+        uint16_t recordSize;    // sizeof(TraceRecord)
+        uint32_t recordCount;
+    };
+
+    static void fillHeader(TraceHeader& header);
+
+    // Время контура
+    static unsigned long nowMs();
+    static unsigned long nowUs();
+
+    // Входы
+    static int readZeroCross(int pin, int phase = 0);     // phase - детектор L1-L3
+    static int16_t readFlowCounter();
+    static uint16_t adcSample(int channel, uint16_t value);  // value - измеренный отсчет
+
+    // Выходы и состояние системы вне контура
+    static void writeTriac(int pin, int level);
+    static void writeRelay(int pin, int level);
+    static bool isSafetyTripped();
+    static bool isReplaying() { return replaying; }
+
+    // Команда пользователя (для записи)
+    static void command(Command command, float value = 0.0);
+
+    // Запись трассы
+    static bool startRecording();       // false - нет памяти
+    static void stopRecording();
+    static void clear();
+    static bool isRecording() { return recording; }
+    static bool isFull();
+    static int getRecordCount() { return recordCount; }
+    static int getCapacity() { return REPLAY_TRACE_CAPACITY; }
+    static const TraceRecord& getRecord(int index) { return records[index]; }
+    static uint32_t getDurationUs();
+    static const char* getCommandName(Command command);
+
+    // Загрузка трассы (остановленная запись заменяется)
+    static bool beginLoad();
+    static bool loadBytes(const uint8_t* data, size_t length);
+    static bool endLoad();
+
+    // Воспроизведение (ReplayEngine)
+    static void beginReplay();
+    static void endReplay();
+    static void setVirtualTimeUs(uint64_t timeUs) { virtualTimeUs = timeUs; }
+    static uint64_t getVirtualTimeUs() { return virtualTimeUs; }
+    static void applyInput(const TraceRecord& record);
+
+private:
+    static TraceRecord* records;
+    static int recordCount;
+    static bool recording;
+    static bool overflow;
+    static unsigned long startUs;
+    static int lastZeroCross[3];
+    static int16_t lastFlowCounter;
+
+    // Загрузка: заголовок и неполная запись между частями
+    static uint8_t loadPartial[sizeof(TraceHeader)];
+    static size_t loadPartialLength;
+    static bool loadHeaderDone;
+    static uint32_t loadExpectedCount;
+    static bool loading;
+
+    // Воспроизведение
+    static bool replaying;
+    static uint64_t virtualTimeUs;
+    static int replayZeroCross[3];
+    static int16_t replayFlowCounter;
+    static uint16_t replayAdc[TEMP_CHANNEL_COUNT];
+
+    static bool allocate();
+    static void append(uint8_t type, uint8_t channel, int16_t value);
+};
+
+#endif
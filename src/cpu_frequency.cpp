@@ -0,0 +1,142 @@
+#include "cpu_frequency.h"
+#include "logger.h"
+#include "esp_timer.h"
+
+static const uint32_t LEVEL_MHZ[CpuFrequency::LEVEL_COUNT] = {80, 160, 240};
+static const uint32_t LOCK_MHZ[CpuFrequency::LOCK_COUNT] = {
+    CPU_FREQ_CONTROL_MHZ, CPU_FREQ_WIFI_MHZ, CPU_FREQ_HTTP_MHZ
+};
+
+uint8_t CpuFrequency::lockCounts[LOCK_COUNT] = {0};
+int CpuFrequency::currentLevel = LEVEL_COUNT - 1;
+int64_t CpuFrequency::levelStartUs = 0;
+uint64_t CpuFrequency::levelTimeUs[LEVEL_COUNT] = {0};
+unsigned long CpuFrequency::switchCount = 0;
+unsigned long CpuFrequency::fireCounts[LEVEL_COUNT] = {0};
+uint64_t CpuFrequency::fireLatencySumUs[LEVEL_COUNT] = {0};
+unsigned long CpuFrequency::fireLatencyMaxUs[LEVEL_COUNT] = {0};
+
+void CpuFrequency::begin() {
+    currentLevel = findLevel(getCpuFrequencyMhz());
+    levelStartUs = esp_timer_get_time();
+    apply();
+
+    if (DEBUG_SERIAL) {
+        Serial.printf("Частота CPU: %s, база %d МГц, нагрев %d, WiFi %d, HTTP %d МГц\n",
+                      CPU_FREQ_SCALING_ENABLED ? "по блокировкам" : "постоянная",
+                      CPU_FREQ_BASE_MHZ, CPU_FREQ_CONTROL_MHZ, CPU_FREQ_WIFI_MHZ, CPU_FREQ_HTTP_MHZ);
+    }
+}
+
+void CpuFrequency::acquire(Lock lock) {
+    if (lockCounts[lock] < 255) lockCounts[lock]++;
+    if (lockCounts[lock] == 1) apply();
+}
+
+void CpuFrequency::release(Lock lock) {
+    if (lockCounts[lock] == 0) return;
+    lockCounts[lock]--;
+    if (lockCounts[lock] == 0) apply();
+}
+
+void CpuFrequency::setHeld(Lock lock, bool held) {
+    if (held == (lockCounts[lock] > 0)) return;
+    lockCounts[lock] = held ? 1 : 0;
+    apply();
+}
+
+bool CpuFrequency::isHeld(Lock lock) {
+    return lockCounts[lock] > 0;
+}
+
+uint32_t CpuFrequency::getCurrentMhz() {
+    return LEVEL_MHZ[currentLevel];
+}
+
+uint32_t CpuFrequency::getLockMhz(Lock lock) {
+    return LOCK_MHZ[lock];
+}
+
+const char* CpuFrequency::getLockName(Lock lock) {
+    switch (lock) {
+        case LOCK_CONTROL: return "control";
+        case LOCK_WIFI:    return "wifi";
+        case LOCK_HTTP:    return "http";
+        default:           return "unknown";
+    }
+}
+
+int CpuFrequency::findLevel(uint32_t mhz) {
+    for (int i = 0; i < LEVEL_COUNT; i++) {
+        if (mhz <= LEVEL_MHZ[i]) return i;
+    }
+    return LEVEL_COUNT - 1;
+}
+
+void CpuFrequency::apply() {
+    uint32_t targetMhz = CPU_FREQ_SCALING_ENABLED ? CPU_FREQ_BASE_MHZ : LEVEL_MHZ[LEVEL_COUNT - 1];
+    for (int i = 0; i < LOCK_COUNT; i++) {
+        if (lockCounts[i] > 0 && LOCK_MHZ[i] > targetMhz) {
+            targetMhz = LOCK_MHZ[i];
+        }
+    }
+
+    int level = findLevel(targetMhz);
+    if (level == currentLevel) return;
+
+    int64_t now = esp_timer_get_time();
+    levelTimeUs[currentLevel] += now - levelStartUs;
+    levelStartUs = now;
+
+    setCpuFrequencyMhz(LEVEL_MHZ[level]);
+    LOG_D(MAIN, "Частота CPU: %lu -> %lu МГц", (unsigned long)LEVEL_MHZ[currentLevel], (unsigned long)LEVEL_MHZ[level]);
+    currentLevel = level;
+    switchCount++;
+}
+
+void CpuFrequency::recordFireLatency(unsigned long latencyUs) {
+    fireCounts[currentLevel]++;
+    fireLatencySumUs[currentLevel] += latencyUs;
+    if (latencyUs > fireLatencyMaxUs[currentLevel]) {
+        fireLatencyMaxUs[currentLevel] = latencyUs;
+    }
+}
+
+uint32_t CpuFrequency::getLevelMhz(int level) {
+    return LEVEL_MHZ[level];
+}
+
+uint64_t CpuFrequency::getTimeAtLevelUs(int level) {
+    uint64_t time = levelTimeUs[level];
+    if (level == currentLevel) {
+        time += esp_timer_get_time() - levelStartUs;
+    }
+    return time;
+}
+
+unsigned long CpuFrequency::getSwitchCount() {
+    return switchCount;
+}
+
+unsigned long CpuFrequency::getFireCount(int level) {
+    return fireCounts[level];
+}
+
+float CpuFrequency::getAverageFireLatencyUs(int level) {
+    return fireCounts[level] > 0 ? (float)fireLatencySumUs[level] / fireCounts[level] : 0.0;
+}
+
+unsigned long CpuFrequency::getMaxFireLatencyUs(int level) {
+    return fireLatencyMaxUs[level];
+}
+
+void CpuFrequency::resetStats() {
+    levelStartUs = esp_timer_get_time();
+    switchCount = 0;
+    for (int i = 0; i < LEVEL_COUNT; i++) {
+        levelTimeUs[i] = 0;
+        fireCounts[i] = 0;
+        fireLatencySumUs[i] = 0;
+        fireLatencyMaxUs[i] = 0;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef CPU_FREQUENCY_H
+#define CPU_FREQUENCY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// УПРАВЛЕНИЕ ЧАСТОТОЙ CPU
+// ========================================
+//
+// Подсистемы удерживают блокировки частоты на время своей работы: нагрев,
+// WiFi сессия, формирование тяжелого HTTP ответа. Частота CPU - максимум из
+// частот удерживаемых блокировок, без блокировок - CPU_FREQ_BASE_MHZ.
+// Переключение - setCpuFrequencyMhz (автоматическое управление питанием
+// esp_pm в сборке Arduino не включено).
+//
+// Блокировки берутся только из задачи loop, поэтому без синхронизации.
+//
+// Статистика: время на каждой частоте и запаздывание включения триаков
+// относительно расчетного момента по частоте, на которой оно произошло -
+// фазовое управление опрашивается из loop, и его точность зависит от частоты.
+
+class CpuFrequency {
+public:
+    enum Lock {
+        LOCK_CONTROL,       // Нагрев
+        LOCK_WIFI,          // WiFi сессия
+        LOCK_HTTP,          // Тяжелый HTTP ответ
+        LOCK_COUNT
+    };
+
+    static const int LEVEL_COUNT = 3;  // 80, 160, 240 МГц
+
+    static void begin();
+
+    // Блокировки со счетчиком (вложенные HTTP ответы)
+    static void acquire(Lock lock);
+    static void release(Lock lock);
+
+    // Блокировка одного владельца (состояние): повторный вызов не меняет счетчик
+    static void setHeld(Lock lock, bool held);
+
+    static bool isHeld(Lock lock);
+    static uint32_t getCurrentMhz();
+    static uint32_t getLockMhz(Lock lock);
+    static const char* getLockName(Lock lock);
+
+    // Запаздывание включения триака (мкс) при текущей частоте
+    static void recordFireLatency(unsigned long latencyUs);
+
+    // Статистика по уровням частоты
+    static uint32_t getLevelMhz(int level);
+    static uint64_t getTimeAtLevelUs(int level);      // С учетом текущего интервала
+    static unsigned long getSwitchCount();
+    static unsigned long getFireCount(int level);
+    static float getAverageFireLatencyUs(int level);
+    static unsigned long getMaxFireLatencyUs(int level);
+    static void resetStats();
+
+private:
+    static uint8_t lockCounts[LOCK_COUNT];
+    static int currentLevel;
+    static int64_t levelStartUs;
+    static uint64_t levelTimeUs[LEVEL_COUNT];
+    static unsigned long switchCount;
+
+    static unsigned long fireCounts[LEVEL_COUNT];
+    static uint64_t fireLatencySumUs[LEVEL_COUNT];
+    static unsigned long fireLatencyMaxUs[LEVEL_COUNT];
+
+    static int findLevel(uint32_t mhz);
+    static void apply();
+};
+
+// Блокировка на время области видимости (обработчик HTTP запроса)
+class CpuFrequencyLock {
+public:
+    explicit CpuFrequencyLock(CpuFrequency::Lock lock) : lock(lock) { CpuFrequency::acquire(lock); }
+    ~CpuFrequencyLock() { CpuFrequency::release(lock); }
+
+private:
+    CpuFrequency::Lock lock;
+
+    CpuFrequencyLock(const CpuFrequencyLock&);
+    CpuFrequencyLock& operator=(const CpuFrequencyLock&);
+};
+
+#endif
@@ -0,0 +1,273 @@
+#include "disinfection_scheduler.h"
+#include "config_storage.h"
+#include "control_io.h"
+#include "logger.h"
+
+DisinfectionScheduler::DisinfectionScheduler() :
+    intervalS(DISINFECTION_INTERVAL_H_DEFAULT * 3600UL),
+    minTemp(DISINFECTION_MIN_TEMP_DEFAULT),
+    holdMs(DISINFECTION_HOLD_MIN_DEFAULT * 60000UL),
+    state(STATE_OFF),
+    requested(false),
+    cancelRequested(false),
+    scheduledCycle(false),
+    cycleStartKWh(0.0),
+    retryAtS(0),
+    lastSaveS(0),
+    persistent(false),
+    attemptPeriod(UINT32_MAX),
+    lastUpdateMs(0),
+    pendingMs(0),
+    started(false),
+    exposureMs(0),
+    gapMs(0),
+    exposureMin(0.0),
+    exposureSum(0.0),
+    exposureCredited(false),
+    cycleSawFlow(false),
+    cycleNoFlowMs(0) {
+    memset(&history, 0, sizeof(history));
+}
+
+void DisinfectionScheduler::begin() {
+    persistent = ConfigStorage::isUsingLog();
+    if (ConfigStorage::loadDisinfection(history)) {
+        LOG_I(SYSTEM, "Термодезинфекция: с последнего выполнения %lu ч работы, записей %d",
+              (unsigned long)(history.sinceLastS / 3600), history.count);
+    }
+    lastSaveS = history.operatingS;
+}
+
+void DisinfectionScheduler::configure(unsigned long intervalH, float temp, unsigned long holdMin) {
+    intervalS = intervalH * 3600UL;
+    minTemp = temp;
+    holdMs = holdMin * 60000UL;
+}
+
+DisinfectionScheduler::Action DisinfectionScheduler::update(unsigned long nowMs, bool flowing, bool canHeat,
+                                                            float outletTemp, bool cycleActive, double energyKWh) {
+    unsigned long dtMs = started ? nowMs - lastUpdateMs : 0;
+    lastUpdateMs = nowMs;
+    started = true;
+
+    advanceClock(dtMs);
+    trackExposure(dtMs, flowing, outletTemp);
+
+    Action action = ACTION_NONE;
+
+    // Режим запущен вручную - засчитываем как цикл; остановлен без
+    // результата (пользователь, ошибка, истекла длительность) - прерван
+    if (cycleActive && state != STATE_RUNNING) {
+        beginCycle(false, energyKWh);
+    } else if (!cycleActive && state == STATE_RUNNING) {
+        finishCycle(RESULT_ABORTED, energyKWh);
+    }
+
+    // При выключенном расписании обычная работа не записывается
+    if (exposureMs >= holdMs && !exposureCredited && state != STATE_OFF) {
+        exposureCredited = true;
+        if (state == STATE_RUNNING) {
+            finishCycle(RESULT_PASSED, energyKWh);
+            action = ACTION_STOP;
+        } else {
+            record(RESULT_IN_USE, false, 0.0);
+        }
+        history.sinceLastS = 0;
+        history.missedMarked = 0;
+        history.attempts = 0;
+        requested = false;
+        save();
+    }
+
+    if (cancelRequested) {
+        cancelRequested = false;
+        requested = false;
+        if (state == STATE_RUNNING) {
+            finishCycle(RESULT_ABORTED, energyKWh);
+            action = ACTION_STOP;
+        }
+    }
+
+    // Водоразбор, с которым шел цикл, кончился - повышенную уставку не
+    // оставляем до следующих водоразборов
+    if (state == STATE_RUNNING && action == ACTION_NONE) {
+        if (flowing) {
+            cycleSawFlow = true;
+            cycleNoFlowMs = 0;
+        } else if (cycleSawFlow) {
+            cycleNoFlowMs += dtMs;
+            if (cycleNoFlowMs > DISINFECTION_GAP_S * 1000UL) {
+                finishCycle(RESULT_ABORTED, energyKWh);
+                action = ACTION_STOP;
+            }
+        }
+    }
+
+    // Попытки считаются заново с каждым интервалом
+    uint32_t period = intervalS > 0 ? history.sinceLastS / intervalS : 0;
+    if (period != attemptPeriod) {
+        if (attemptPeriod != UINT32_MAX) history.attempts = 0;
+        attemptPeriod = period;
+    }
+
+    // Пропуск: интервал и запас прошли без выполнения
+    if (intervalS > 0 && !history.missedMarked &&
+        history.sinceLastS >= intervalS + DISINFECTION_GRACE_H * 3600UL) {
+        history.missedMarked = 1;
+        record(RESULT_MISSED, true, 0.0);
+        save();
+    }
+
+    if (state != STATE_RUNNING) {
+        bool due = requested || (intervalS > 0 && history.sinceLastS >= intervalS);
+        state = due ? STATE_DUE : (intervalS > 0 ? STATE_WAITING : STATE_OFF);
+    }
+
+    if (state == STATE_DUE && action == ACTION_NONE && flowing && canHeat && history.operatingS >= retryAtS &&
+        history.attempts < DISINFECTION_MAX_ATTEMPTS) {
+        beginCycle(true, energyKWh);
+        action = ACTION_START;
+    }
+
+    // Счетчик времени работы переживает перезапуск с точностью до интервала
+    if (intervalS > 0 && history.operatingS - lastSaveS >= DISINFECTION_SAVE_INTERVAL_S) {
+        save();
+    }
+    return action;
+}
+
+void DisinfectionScheduler::advanceClock(unsigned long dtMs) {
+    pendingMs += dtMs;
+    uint32_t seconds = pendingMs / 1000;
+    pendingMs %= 1000;
+    history.operatingS += seconds;
+    history.sinceLastS += seconds;
+}
+
+void DisinfectionScheduler::trackExposure(unsigned long dtMs, bool flowing, float outletTemp) {
+    if (flowing && outletTemp >= minTemp) {
+        if (exposureMs == 0) exposureMin = outletTemp;
+        exposureMs += dtMs;
+        exposureSum += outletTemp * (dtMs / 1000.0);
+        exposureMin = min(exposureMin, outletTemp);
+        gapMs = 0;
+        return;
+    }
+
+    if (exposureMs == 0 && !exposureCredited) return;
+    gapMs += dtMs;
+    if (gapMs > DISINFECTION_GAP_S * 1000UL) {
+        exposureMs = 0;
+        exposureSum = 0.0;
+        exposureCredited = false;
+        gapMs = 0;
+    }
+}
+
+void DisinfectionScheduler::beginCycle(bool scheduled, double energyKWh) {
+    state = STATE_RUNNING;
+    scheduledCycle = scheduled;
+    cycleStartKWh = energyKWh;
+    cycleSawFlow = false;
+    cycleNoFlowMs = 0;
+    if (scheduled) history.attempts++;
+
+    // Удержание, набранное до начала, засчитывается циклу
+    exposureCredited = false;
+    LOG_I(SYSTEM, "Термодезинфекция: цикл начат (%s)", scheduled ? "по расписанию" : "вручную");
+}
+
+void DisinfectionScheduler::finishCycle(Result result, double energyKWh) {
+    record(result, scheduledCycle, getCycleEnergyWh(energyKWh));
+    state = STATE_WAITING;
+    if (result == RESULT_ABORTED) {
+        retryAtS = history.operatingS + DISINFECTION_RETRY_S;
+        if (scheduledCycle && history.attempts >= DISINFECTION_MAX_ATTEMPTS) {
+            LOG_W(SYSTEM, "Термодезинфекция: %d попыток за интервал, следующая - в новом интервале или по запросу",
+                  history.attempts);
+        }
+        save();
+    }
+}
+
+void DisinfectionScheduler::record(Result result, bool scheduled, float energyWh) {
+    DisinfectionResult& entry = history.results[history.head];
+    memset(&entry, 0, sizeof(entry));
+    entry.operatingS = history.operatingS;
+    entry.result = result;
+    entry.scheduled = scheduled ? 1 : 0;
+    entry.energyWh = energyWh;
+    if (exposureMs > 0) {
+        entry.holdS = min(exposureMs / 1000, 65535UL);
+        entry.minTemp = exposureMin;
+        entry.avgTemp = exposureSum / (exposureMs / 1000.0);
+    }
+    history.head = (history.head + 1) % DISINFECTION_HISTORY_SIZE;
+    if (history.count < DISINFECTION_HISTORY_SIZE) history.count++;
+
+    switch (result) {
+        case RESULT_PASSED:  history.passed++;  break;
+        case RESULT_IN_USE:  history.inUse++;   break;
+        case RESULT_ABORTED: history.aborted++; break;
+        case RESULT_MISSED:  history.missed++;  break;
+        default:             break;
+    }
+
+    if (result == RESULT_PASSED || result == RESULT_IN_USE) {
+        LOG_I(SYSTEM, "Термодезинфекция выполнена (%s): %u с, мин %.1f°C, ср %.1f°C, %.0f Вт*ч",
+              getResultName(result), entry.holdS, entry.minTemp, entry.avgTemp, entry.energyWh);
+    } else {
+        LOG_W(SYSTEM, "Термодезинфекция: %s, удержание %u с из %lu", getResultName(result), entry.holdS,
+              holdMs / 1000);
+    }
+}
+
+void DisinfectionScheduler::save() {
+    lastSaveS = history.operatingS;
+    if (ControlIO::isReplaying()) return;
+    persistent = ConfigStorage::saveDisinfection(history);
+}
+
+void DisinfectionScheduler::requestCycle() {
+    requested = true;
+    retryAtS = 0;
+    history.attempts = 0;
+}
+
+void DisinfectionScheduler::cancel() {
+    cancelRequested = true;
+}
+
+unsigned long DisinfectionScheduler::getDueInS() const {
+    if (requested) return 0;
+    return history.sinceLastS < intervalS ? intervalS - history.sinceLastS : 0;
+}
+
+float DisinfectionScheduler::getCycleEnergyWh(double energyKWh) const {
+    return state == STATE_RUNNING ? (energyKWh - cycleStartKWh) * 1000.0 : 0.0;
+}
+
+const DisinfectionResult& DisinfectionScheduler::getResult(int index) const {
+    int oldest = (history.head - history.count + DISINFECTION_HISTORY_SIZE) % DISINFECTION_HISTORY_SIZE;
+    return history.results[(oldest + index) % DISINFECTION_HISTORY_SIZE];
+}
+
+const char* DisinfectionScheduler::getStateName(State state) {
+    switch (state) {
+        case STATE_OFF:     return "off";
+        case STATE_WAITING: return "waiting";
+        case STATE_DUE:     return "due";
+        case STATE_RUNNING: return "running";
+        default:            return "?";
+    }
+}
+
+const char* DisinfectionScheduler::getResultName(Result result) {
+    switch (result) {
+        case RESULT_PASSED:  return "passed";
+        case RESULT_IN_USE:  return "in_use";
+        case RESULT_ABORTED: return "aborted";
+        case RESULT_MISSED:  return "missed";
+        default:             return "none";
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef DISINFECTION_SCHEDULER_H
+#define DISINFECTION_SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// ТЕРМОДЕЗИНФЕКЦИЯ ПО РАСПИСАНИЮ
+// ========================================
+//
+// Требование: раз в интервал вода на выходе не ниже minTemp не меньше
+// hold минут подряд при реальном водоразборе (провал короче
+// DISINFECTION_GAP_S удержание не прерывает). Удержание считается всегда,
+// поэтому выполнение в обычной работе (горячий долгий водоразбор)
+// засчитывается и переносит следующий цикл - лишний нагрев не нужен.
+//
+// Когда срок подошел, цикл (режим PROFILE_MODE_DISINFECTION
+// SystemController) запускается в начале ближайшего водоразбора: греется
+// вода, которая и так уходит из установки, а не стоящий контур. Цикл
+// завершается, как только набрано удержание; затраченная энергия
+// записывается вместе с результатом. Водоразбор кончился (нет потока
+// дольше DISINFECTION_GAP_S) раньше - цикл прерван: повышенная уставка не
+// переходит на следующие водоразборы. Прерванный цикл повторяется не раньше
+// DISINFECTION_RETRY_S, не больше DISINFECTION_MAX_ATTEMPTS запусков за
+// интервал; невыполненный за интервал + DISINFECTION_GRACE_H отмечается
+// пропуском.
+//
+// Часов реального времени нет: интервал считается по времени работы
+// устройства, которое вместе с результатами хранится во flash
+// (ConfigStorage::saveDisinfection). Время без питания не учитывается.
+
+// Результат в журнале (хранится во flash как есть)
+struct DisinfectionResult {
+    uint32_t operatingS;        // Время работы устройства на момент результата (с)
+    uint16_t holdS;             // Удержание не ниже minTemp (с)
+    uint8_t result;             // DisinfectionScheduler::Result
+    uint8_t scheduled;          // 1 - цикл по расписанию или по запросу
+    float minTemp;              // Наименьшая температура за удержание (°C)
+    float avgTemp;              // Средняя температура за удержание (°C)
+    float energyWh;             // Энергия за цикл (Вт*ч), 0 - обычная работа
+};
+
+struct DisinfectionHistory {
+    uint32_t operatingS;        // Суммарное время работы (с)
+    uint32_t sinceLastS;        // Время работы с последнего выполнения (с)
+    uint32_t passed;            // Выполнено циклов
+    uint32_t inUse;             // Засчитано в обычной работе
+    uint32_t aborted;
+    uint32_t missed;
+    uint8_t missedMarked;       // Пропуск за текущий интервал уже записан
+    uint8_t count;
+    uint8_t head;
+    uint8_t attempts;           // Запусков по расписанию за текущий интервал
+    DisinfectionResult results[DISINFECTION_HISTORY_SIZE];
+};
+
+class DisinfectionScheduler {
+public:
+    enum State {
+        STATE_OFF,              // Расписание выключено, запроса нет
+        STATE_WAITING,
+        STATE_DUE,              // Ждет водоразбора
+        STATE_RUNNING
+    };
+
+    enum Result {
+        RESULT_NONE,
+        RESULT_PASSED,          // Цикл набрал удержание
+        RESULT_IN_USE,          // Требование выполнено в обычной работе
+        RESULT_ABORTED,         // Режим остановлен раньше
+        RESULT_MISSED,          // Не выполнено за интервал + DISINFECTION_GRACE_H
+        RESULT_COUNT
+    };
+
+    // Что сделать SystemController после update
+    enum Action {
+        ACTION_NONE,
+        ACTION_START,
+        ACTION_STOP
+    };
+
+    DisinfectionScheduler();
+
+    void begin();               // Загрузка журнала из flash
+    void configure(unsigned long intervalH, float minTemp, unsigned long holdMin);
+
+    // Раз за такт. flowing - есть водоразбор, canHeat - нагрев разрешен,
+    // cycleActive - идет режим термодезинфекции (в том числе запущенный
+    // вручную - он тоже засчитывается)
+    Action update(unsigned long nowMs, bool flowing, bool canHeat, float outletTemp,
+                  bool cycleActive, double energyKWh);
+
+    void requestCycle();        // Выполнить при ближайшем водоразборе
+    void cancel();              // Снять запрос, идущий цикл остановить
+
+    State getState() const { return state; }
+    bool isRequested() const { return requested; }
+    unsigned long getIntervalS() const { return intervalS; }
+    float getMinTemp() const { return minTemp; }
+    unsigned long getHoldS() const { return holdMs / 1000; }
+    unsigned long getExposureS() const { return exposureMs / 1000; }  // Текущее удержание
+    unsigned long getDueInS() const;                                   // 0 - срок подошел
+    uint8_t getAttempts() const { return history.attempts; }
+    float getCycleEnergyWh(double energyKWh) const;
+    const DisinfectionHistory& getHistory() const { return history; }
+    const DisinfectionResult& getResult(int index) const;             // 0 - самый старый
+    bool isPersistent() const { return persistent; }                  // Журнал сохраняется во flash
+
+    static const char* getStateName(State state);
+    static const char* getResultName(Result result);
+
+private:
+    unsigned long intervalS;
+    float minTemp;
+    unsigned long holdMs;
+
+    DisinfectionHistory history;
+    State state;
+    bool requested;
+    bool cancelRequested;
+    bool scheduledCycle;
+    double cycleStartKWh;
+    uint32_t retryAtS;
+    uint32_t lastSaveS;
+    bool persistent;
+    uint32_t attemptPeriod;     // Номер интервала, к которому относятся attempts
+
+    // Время работы: доли секунды между тактами
+    unsigned long lastUpdateMs;
+    unsigned long pendingMs;
+    bool started;
+
+    // Текущее удержание
+    unsigned long exposureMs;
+    unsigned long gapMs;
+    float exposureMin;
+    double exposureSum;         // °C*с (float теряет точность за десятки минут)
+    bool exposureCredited;      // Уже засчитано, ждем окончания
+
+    // Водоразбор идущего цикла
+    bool cycleSawFlow;
+    unsigned long cycleNoFlowMs;
+
+    void advanceClock(unsigned long dtMs);
+    void trackExposure(unsigned long dtMs, bool flowing, float outletTemp);
+    void beginCycle(bool scheduled, double energyKWh);
+    void finishCycle(Result result, double energyKWh);
+    void record(Result result, bool scheduled, float energyWh);
+    void save();
+};
+
+#endif
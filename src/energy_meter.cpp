@@ -0,0 +1,145 @@
+#include "energy_meter.h"
+#include "phase_controller.h"
+#include "config_storage.h"
+#include "logger.h"
+#include "control_io.h"
+#include "mains_sensing.h"
+
+EnergyMeter::EnergyMeter() : savedTotalKWh(0.0), elementPowerW(ELEMENT_POWER_W), stagePowerW(0.0),
+                             tariffPerKWh(ENERGY_TARIFF_PER_KWH), lastUpdateUs(0),
+                             lastSaveTime(0), wasHeating(false) {
+    for (int i = 0; i < 3; i++) {
+        totals.phaseKWh[i] = 0.0;
+        deliveredPower[i] = 0.0;
+    }
+    totals.litresHeated = 0.0;
+}
+
+void EnergyMeter::begin() {
+    if (!ConfigStorage::loadEnergyTotals(totals)) {
+        for (int i = 0; i < 3; i++) {
+            totals.phaseKWh[i] = 0.0;
+        }
+        totals.litresHeated = 0.0;
+    }
+    
+    savedTotalKWh = getTotalEnergyKWh();
+    lastUpdateUs = ControlIO::nowUs();
+    lastSaveTime = ControlIO::nowMs();
+}
+
+void EnergyMeter::update(const PhaseController& phaseController, float flowRate) {
+    unsigned long currentTime = ControlIO::nowUs();
+    float dt = (currentTime - lastUpdateUs) / 1000000.0; // секунды
+    lastUpdateUs = currentTime;
+    
+    // Мощность по фазам: измеренная MainsSensing (трансформаторы тока на
+    // вводе фаз - в ней уже и ступени на реле), без измерения - из
+    // фактического угла включения триаков и номинала ступеней
+    MainsSensing::Measurement measurement;
+    bool measured = !ControlIO::isReplaying() && MainsSensing::isValid();
+    if (measured) {
+        MainsSensing::getMeasurement(measurement);
+    }
+    
+    bool heating = false;
+    for (int phase = 0; phase < 3; phase++) {
+        // Без нагрузки (триак закрыт, ступеней нет) - ноль, а не шум трансформатора тока
+        float fraction = phaseController.getDeliveredPowerFraction(phase);
+        if (measured) {
+            bool loaded = fraction > 0.0 || stagePowerW > 0.0;
+            deliveredPower[phase] = loaded ? max(measurement.realPowerW[phase], 0.0f) : 0.0f;
+        } else {
+            deliveredPower[phase] = fraction * elementPowerW + stagePowerW / 3;
+        }
+        totals.phaseKWh[phase] += deliveredPower[phase] * dt / 3600000.0;
+        if (deliveredPower[phase] > 0) heating = true;
+    }
+    
+    // Учитываем только воду, прошедшую через нагреватель под нагрузкой
+    if (heating) {
+        totals.litresHeated += flowRate * dt / 60.0;
+    }
+    
+    checkSave(heating);
+}
+
+void EnergyMeter::checkSave(bool heating) {
+    // Воспроизведение трассы не пишет счетчики во flash
+    if (ControlIO::isReplaying()) return;
+    
+    unsigned long currentTime = ControlIO::nowMs();
+    unsigned long sinceSave = currentTime - lastSaveTime;
+    bool enoughDelta = (getTotalEnergyKWh() - savedTotalKWh) >= ENERGY_SAVE_MIN_DELTA_KWH;
+    
+    // Пишем редко: по окончании водоразбора или раз в интервал, и только при заметном приросте
+    bool drawFinished = wasHeating && !heating;
+    wasHeating = heating;
+    
+    if (!enoughDelta || sinceSave < ENERGY_SAVE_MIN_INTERVAL_MS) return;
+    if (drawFinished || sinceSave >= ENERGY_SAVE_INTERVAL_MS) {
+        save();
+    }
+}
+
+bool EnergyMeter::save() {
+    bool result = ConfigStorage::saveEnergyTotals(totals);
+    if (result) {
+        savedTotalKWh = getTotalEnergyKWh();
+    }
+    lastSaveTime = ControlIO::nowMs();
+    
+    LOG_I(SYSTEM, "Счетчики энергии сохранены: %.3f кВт*ч, %.1f л (%s)",
+          getTotalEnergyKWh(), totals.litresHeated, result ? "УСПЕХ" : "ОШИБКА");
+    return result;
+}
+
+void EnergyMeter::reset() {
+    for (int i = 0; i < 3; i++) {
+        totals.phaseKWh[i] = 0.0;
+    }
+    totals.litresHeated = 0.0;
+    save();
+}
+
+void EnergyMeter::setElementPower(float watts) {
+    elementPowerW = watts;
+}
+
+void EnergyMeter::setTariff(float perKWh) {
+    tariffPerKWh = perKWh;
+}
+
+void EnergyMeter::setStagePower(float watts) {
+    stagePowerW = watts;
+}
+
+float EnergyMeter::getElementPower() const {
+    return elementPowerW;
+}
+
+float EnergyMeter::getDeliveredPower(int phase) const {
+    if (phase < 0 || phase >= 3) return 0.0;
+    return deliveredPower[phase];
+}
+
+float EnergyMeter::getTotalDeliveredPower() const {
+    return deliveredPower[0] + deliveredPower[1] + deliveredPower[2];
+}
+
+double EnergyMeter::getPhaseEnergyKWh(int phase) const {
+    if (phase < 0 || phase >= 3) return 0.0;
+    return totals.phaseKWh[phase];
+}
+
+double EnergyMeter::getTotalEnergyKWh() const {
+    return totals.phaseKWh[0] + totals.phaseKWh[1] + totals.phaseKWh[2];
+}
+
+double EnergyMeter::getLitresHeated() const {
+    return totals.litresHeated;
+}
+
+double EnergyMeter::getCost() const {
+    return getTotalEnergyKWh() * tariffPerKWh;
+}
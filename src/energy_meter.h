@@ -0,0 +1,60 @@
+#ifndef ENERGY_METER_H
+#define ENERGY_METER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Предварительное объявление
+class PhaseController;
+
+// Накопленные счетчики (сохраняются в EEPROM)
+struct EnergyTotals {
+    double phaseKWh[3];       // Энергия по фазам (кВт*ч)
+    double litresHeated;      // Объем нагретой воды (л)
+};
+
+class EnergyMeter {
+private:
+    EnergyTotals totals;
+    double savedTotalKWh;     // Энергия на момент последней записи
+    float deliveredPower[3];  // Мгновенная отдаваемая мощность по фазам (Вт)
+    
+    float elementPowerW;      // Номинальная мощность нагревателя фазы (Вт)
+    float stagePowerW;        // Включенные ступени на реле (Вт, поровну на три фазы)
+    float tariffPerKWh;       // Стоимость 1 кВт*ч
+    
+    unsigned long lastUpdateUs;
+    unsigned long lastSaveTime;
+    bool wasHeating;
+    
+    void checkSave(bool heating);
+
+public:
+    EnergyMeter();
+    
+    // Загрузка счетчиков из EEPROM
+    void begin();
+    
+    // Интегрирование (вызывать в каждом цикле управления)
+    void update(const PhaseController& phaseController, float flowRate);
+    
+    // Управление
+    bool save();
+    void reset();
+    
+    // Настройки
+    void setElementPower(float watts);
+    void setTariff(float perKWh);
+    void setStagePower(float watts);
+    float getElementPower() const;
+    
+    // Получение данных
+    float getDeliveredPower(int phase) const;     // Вт
+    float getTotalDeliveredPower() const;         // Вт
+    double getPhaseEnergyKWh(int phase) const;
+    double getTotalEnergyKWh() const;
+    double getLitresHeated() const;
+    double getCost() const;
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "history_store.h"
+#include "memory_monitor.h"
+
+static const unsigned long TIER_RESOLUTION_SEC[HISTORY_TIER_COUNT] = { 1, 60, 900 };
+static const int TIER_CAPACITY[HISTORY_TIER_COUNT] = {
+    HISTORY_1S_BUCKETS, HISTORY_1MIN_BUCKETS, HISTORY_15MIN_BUCKETS
+};
+
+// Масштабы метрик: значение = int16 * масштаб
+static const float METRIC_SCALES[HISTORY_METRIC_COUNT] = { 0.1, 0.01, 0.1, 10.0 };
+static const char* const METRIC_NAMES[HISTORY_METRIC_COUNT] = { "temperature", "flow", "power", "deliveredW" };
+
+HistoryStore::HistoryStore() : nextSecondBoundary(0), currentSecond(0), initialized(false) {
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+        tiers[t].buckets = nullptr;
+        tiers[t].capacity = 0;
+        tiers[t].head = 0;
+        tiers[t].count = 0;
+        tiers[t].newestEndTime = 0;
+        resetAccumulator(tiers[t].acc);
+    }
+}
+
+bool HistoryStore::begin() {
+    if (initialized) return true;
+
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+        size_t size = TIER_CAPACITY[t] * sizeof(Bucket);
+        Bucket* buckets = (Bucket*)MemoryMonitor::allocate(MEM_HISTORY, size, true);
+        if (buckets == nullptr) {
+            if (DEBUG_SERIAL) {
+                Serial.println("История: не удалось выделить память");
+            }
+            return false;
+        }
+        tiers[t].buckets = buckets;
+        tiers[t].capacity = TIER_CAPACITY[t];
+    }
+
+    currentSecond = millis() / 1000;
+    nextSecondBoundary = (currentSecond + 1) * 1000;
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+        tiers[t].newestEndTime = currentSecond;
+    }
+    initialized = true;
+
+    if (DEBUG_SERIAL) {
+        Serial.printf("История: %u байт (%d/%d/%d ячеек)\n",
+                      (unsigned)((HISTORY_1S_BUCKETS + HISTORY_1MIN_BUCKETS + HISTORY_15MIN_BUCKETS) * sizeof(Bucket)),
+                      HISTORY_1S_BUCKETS, HISTORY_1MIN_BUCKETS, HISTORY_15MIN_BUCKETS);
+    }
+    return true;
+}
+
+void HistoryStore::addSample(const float* values) {
+    if (!initialized) return;
+
+    // Закрываем прошедшие секунды (после долгой паузы догоняем по частям)
+    unsigned long now = millis();
+    int closed = 0;
+    while ((long)(now - nextSecondBoundary) >= 0 && closed < HISTORY_MAX_CATCHUP_SEC) {
+        closeSecond();
+        nextSecondBoundary += 1000;
+        currentSecond++;
+        closed++;
+    }
+
+    // Еще догоняем - значение не относится к закрываемым интервалам
+    if ((long)(now - nextSecondBoundary) >= 0) return;
+
+    Accumulator& acc = tiers[HISTORY_TIER_1S].acc;
+    for (int m = 0; m < HISTORY_METRIC_COUNT; m++) {
+        float value = values[m];
+        acc.sum[m] += value;
+        if (value < acc.minValue[m]) acc.minValue[m] = value;
+        if (value > acc.maxValue[m]) acc.maxValue[m] = value;
+    }
+    acc.count++;
+}
+
+void HistoryStore::closeSecond() {
+    // Секунда -> минута -> 15 минут
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+        Tier& tier = tiers[t];
+        pushBucket(t, tier.acc);
+        tier.newestEndTime = currentSecond + 1;
+        resetAccumulator(tier.acc);
+
+        if (t + 1 >= HISTORY_TIER_COUNT) break;
+
+        Tier& upper = tiers[t + 1];
+        foldInto(upper.acc, tier.buckets[(tier.head + tier.count - 1) % tier.capacity]);
+        unsigned long spansPerBucket = TIER_RESOLUTION_SEC[t + 1] / TIER_RESOLUTION_SEC[t];
+        if (upper.acc.spans < spansPerBucket) break;
+    }
+}
+
+void HistoryStore::pushBucket(int t, const Accumulator& acc) {
+    Tier& tier = tiers[t];
+    Bucket* bucket;
+
+    if (tier.count < tier.capacity) {
+        bucket = &tier.buckets[(tier.head + tier.count) % tier.capacity];
+        tier.count++;
+    } else {
+        // Буфер заполнен - перезаписываем самую старую ячейку
+        bucket = &tier.buckets[tier.head];
+        tier.head = (tier.head + 1) % tier.capacity;
+    }
+
+    for (int m = 0; m < HISTORY_METRIC_COUNT; m++) {
+        if (acc.count == 0) {
+            bucket->minValue[m] = EMPTY_VALUE;
+            bucket->maxValue[m] = EMPTY_VALUE;
+            bucket->avgValue[m] = EMPTY_VALUE;
+        } else {
+            bucket->minValue[m] = quantize(acc.minValue[m], m);
+            bucket->maxValue[m] = quantize(acc.maxValue[m], m);
+            bucket->avgValue[m] = quantize(acc.sum[m] / acc.count, m);
+        }
+    }
+}
+
+void HistoryStore::foldInto(Accumulator& target, const Bucket& bucket) {
+    target.spans++;
+    if (isEmpty(bucket)) return;
+
+    // Среднее верхнего уровня - среднее непустых ячеек нижнего
+    for (int m = 0; m < HISTORY_METRIC_COUNT; m++) {
+        float scale = METRIC_SCALES[m];
+        float minValue = bucket.minValue[m] * scale;
+        float maxValue = bucket.maxValue[m] * scale;
+        target.sum[m] += bucket.avgValue[m] * scale;
+        if (minValue < target.minValue[m]) target.minValue[m] = minValue;
+        if (maxValue > target.maxValue[m]) target.maxValue[m] = maxValue;
+    }
+    target.count++;
+}
+
+void HistoryStore::resetAccumulator(Accumulator& acc) {
+    for (int m = 0; m < HISTORY_METRIC_COUNT; m++) {
+        acc.sum[m] = 0.0;
+        acc.minValue[m] = INFINITY;
+        acc.maxValue[m] = -INFINITY;
+    }
+    acc.count = 0;
+    acc.spans = 0;
+}
+
+int16_t HistoryStore::quantize(float value, int metric) {
+    long q = lroundf(value / METRIC_SCALES[metric]);
+    if (q > INT16_MAX) q = INT16_MAX;
+    if (q <= EMPTY_VALUE) q = EMPTY_VALUE + 1;
+    return (int16_t)q;
+}
+
+// ========================================
+// ДОСТУП К ДАННЫМ
+// ========================================
+
+int HistoryStore::findTier(unsigned long resolutionSec) {
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+        if (TIER_RESOLUTION_SEC[t] == resolutionSec) return t;
+    }
+    return -1;
+}
+
+unsigned long HistoryStore::getResolution(int tier) {
+    return TIER_RESOLUTION_SEC[tier];
+}
+
+float HistoryStore::getMetricScale(int metric) {
+    return METRIC_SCALES[metric];
+}
+
+const char* HistoryStore::getMetricName(int metric) {
+    return METRIC_NAMES[metric];
+}
+
+int HistoryStore::getBucketCount(int tier) const {
+    return tiers[tier].count;
+}
+
+const HistoryStore::Bucket& HistoryStore::getBucket(int tier, int index) const {
+    const Tier& t = tiers[tier];
+    return t.buckets[(t.head + index) % t.capacity];
+}
+
+unsigned long HistoryStore::getBucketStartTime(int tier, int index) const {
+    const Tier& t = tiers[tier];
+    return t.newestEndTime - (unsigned long)(t.count - index) * TIER_RESOLUTION_SEC[tier];
+}
+
+bool HistoryStore::isEmpty(const Bucket& bucket) {
+    return bucket.avgValue[0] == EMPTY_VALUE;
+}
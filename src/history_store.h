@@ -0,0 +1,90 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// МНОГОУРОВНЕВАЯ ИСТОРИЯ ДЛЯ ГРАФИКОВ
+// ========================================
+//
+// Каждое значение из цикла управления попадает в накопитель секундного
+// уровня. Закрытая секунда сворачивается в минутный накопитель, закрытая
+// минута - в 15-минутный. Каждая ячейка хранит min/max/avg по каждой
+// метрике в виде int16 с фиксированным масштабом.
+
+enum HistoryMetric {
+    HISTORY_TEMPERATURE,    // Температура, 0.1°C
+    HISTORY_FLOW,           // Поток, 0.01 л/мин
+    HISTORY_POWER,          // Мощность, 0.1%
+    HISTORY_DELIVERED_POWER, // Отдаваемая мощность, 10 Вт
+    HISTORY_METRIC_COUNT
+};
+
+enum HistoryTier {
+    HISTORY_TIER_1S,        // 1 с, последние 10 минут
+    HISTORY_TIER_1MIN,      // 1 мин, последние 24 часа
+    HISTORY_TIER_15MIN,     // 15 мин, последняя неделя
+    HISTORY_TIER_COUNT
+};
+
+class HistoryStore {
+public:
+    struct Bucket {
+        int16_t minValue[HISTORY_METRIC_COUNT];
+        int16_t maxValue[HISTORY_METRIC_COUNT];
+        int16_t avgValue[HISTORY_METRIC_COUNT];
+    };
+
+    // Значение пустой ячейки (нет данных за интервал)
+    static const int16_t EMPTY_VALUE = INT16_MIN;
+
+    HistoryStore();
+
+    // Выделение памяти под все уровни
+    bool begin();
+
+    // Добавление значений (вызывать в каждом цикле управления)
+    void addSample(const float* values);
+
+    // Доступ к данным уровня (индекс 0 - самая старая ячейка)
+    static int findTier(unsigned long resolutionSec);
+    static unsigned long getResolution(int tier);
+    static float getMetricScale(int metric);
+    static const char* getMetricName(int metric);
+    int getBucketCount(int tier) const;
+    const Bucket& getBucket(int tier, int index) const;
+    unsigned long getBucketStartTime(int tier, int index) const; // секунды от запуска
+    static bool isEmpty(const Bucket& bucket);
+
+private:
+    struct Accumulator {
+        float sum[HISTORY_METRIC_COUNT];
+        float minValue[HISTORY_METRIC_COUNT];
+        float maxValue[HISTORY_METRIC_COUNT];
+        uint32_t count;         // Количество значений (для секунд) или непустых ячеек
+        uint32_t spans;         // Количество свернутых ячеек нижнего уровня
+    };
+
+    struct Tier {
+        Bucket* buckets;
+        int capacity;
+        int head;               // Индекс самой старой ячейки
+        int count;
+        unsigned long newestEndTime; // Конец последней закрытой ячейки (с)
+        Accumulator acc;
+    };
+
+    Tier tiers[HISTORY_TIER_COUNT];
+    unsigned long nextSecondBoundary;  // millis() конца текущей секунды
+    unsigned long currentSecond;       // Номер текущей секунды от запуска
+    bool initialized;
+
+    void closeSecond();
+    void pushBucket(int tier, const Accumulator& acc);
+    void foldInto(Accumulator& target, const Bucket& bucket);
+    static void resetAccumulator(Accumulator& acc);
+    static int16_t quantize(float value, int metric);
+};
+
+#endif
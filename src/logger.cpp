@@ -0,0 +1,95 @@
+#include "logger.h"
+
+QueueHandle_t Logger::queue = nullptr;
+TaskHandle_t Logger::taskHandle = nullptr;
+volatile TaskHandle_t Logger::mutedTask = nullptr;
+volatile unsigned long Logger::droppedCount = 0;
+volatile unsigned long Logger::writtenCount = 0;
+
+void Logger::begin() {
+    if (queue != nullptr) return;
+
+    queue = xQueueCreate(LOG_QUEUE_LENGTH, sizeof(LogMessage));
+    if (queue == nullptr) {
+        Serial.println("Logger: не удалось создать очередь, вывод будет синхронным");
+        return;
+    }
+
+    // Задача вывода работает на другом ядре с низким приоритетом,
+    // поэтому ожидание UART не влияет на главный цикл
+    xTaskCreatePinnedToCore(outputTask, "logger", LOG_TASK_STACK_SIZE, nullptr,
+                            LOG_TASK_PRIORITY, &taskHandle, LOG_TASK_CORE);
+}
+
+void Logger::write(int level, const char* tag, const char* fmt, ...) {
+    if (mutedTask != nullptr && xTaskGetCurrentTaskHandle() == mutedTask) return;
+
+    LogMessage message;
+    message.timestamp = millis();
+    message.level = level;
+    strncpy(message.tag, tag, sizeof(message.tag) - 1);
+    message.tag[sizeof(message.tag) - 1] = '\0';
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message.text, sizeof(message.text), fmt, args);
+    va_end(args);
+
+    // До запуска задачи выводим напрямую (этап setup)
+    if (queue == nullptr) {
+        printMessage(message);
+        return;
+    }
+
+    // Не ждем освобождения места: при переполнении сообщение теряется
+    if (xQueueSend(queue, &message, 0) != pdTRUE) {
+        droppedCount++;
+        return;
+    }
+    writtenCount++;
+}
+
+unsigned long Logger::getDroppedCount() {
+    return droppedCount;
+}
+
+unsigned long Logger::getWrittenCount() {
+    return writtenCount;
+}
+
+int Logger::getQueueDepth() {
+    return queue ? uxQueueMessagesWaiting(queue) : 0;
+}
+
+void Logger::outputTask(void* parameter) {
+    LogMessage message;
+    unsigned long reportedDropped = 0;
+
+    while (true) {
+        if (xQueueReceive(queue, &message, portMAX_DELAY) == pdTRUE) {
+            printMessage(message);
+
+            // Сообщаем о потерянных сообщениях
+            unsigned long dropped = droppedCount;
+            if (dropped != reportedDropped) {
+                Serial.printf("[%lu] W LOG: потеряно сообщений: %lu\n", millis(), dropped - reportedDropped);
+                reportedDropped = dropped;
+            }
+        }
+    }
+}
+
+void Logger::printMessage(const LogMessage& message) {
+    Serial.printf("[%lu] %c %s: %s\n", message.timestamp, levelChar(message.level),
+                  message.tag, message.text);
+}
+
+char Logger::levelChar(int level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR: return 'E';
+        case LOG_LEVEL_WARN:  return 'W';
+        case LOG_LEVEL_INFO:  return 'I';
+        case LOG_LEVEL_DEBUG: return 'D';
+        default:              return '?';
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "config.h"
+
+// ========================================
+// МАКРОСЫ ЛОГИРОВАНИЯ
+// ========================================
+//
+// Использование: LOG_I(FLOW, "Импульсы: %lu", count);
+// Уровень модуля задается в config.h (LOG_<МОДУЛЬ>_LEVEL). Условие
+// вычисляется на этапе компиляции, поэтому отключенные вызовы вместе
+// с аргументами полностью удаляются из прошивки.
+
+#define LOG_ENABLED(module, level) (LOG_##module##_LEVEL >= (level))
+
+#define LOG_AT(module, level, fmt, ...) \
+    do { \
+        if (LOG_ENABLED(module, level)) { \
+            Logger::write((level), #module, fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_E(module, fmt, ...) LOG_AT(module, LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_W(module, fmt, ...) LOG_AT(module, LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_I(module, fmt, ...) LOG_AT(module, LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_D(module, fmt, ...) LOG_AT(module, LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+class Logger {
+public:
+    // Создание очереди и фоновой задачи вывода в Serial
+    static void begin();
+
+    // Форматирование и постановка сообщения в очередь (не блокирует)
+    static void write(int level, const char* tag, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+    // Статистика
+    static unsigned long getDroppedCount();
+    static unsigned long getWrittenCount();
+    static int getQueueDepth();
+    static TaskHandle_t getTaskHandle() { return taskHandle; }
+
+    // Подавление сообщений одной задачи (воспроизведение трассы в loop),
+    // nullptr - выключено. Подавленные сообщения не считаются потерянными
+    static void setMutedTask(TaskHandle_t task) { mutedTask = task; }
+
+private:
+    struct LogMessage {
+        unsigned long timestamp;   // Время постановки в очередь (мс)
+        uint8_t level;
+        char tag[8];
+        char text[LOG_MESSAGE_MAX_LEN];
+    };
+
+    static QueueHandle_t queue;
+    static TaskHandle_t taskHandle;
+    static volatile TaskHandle_t mutedTask;
+    static volatile unsigned long droppedCount;
+    static volatile unsigned long writtenCount;
+
+    static void outputTask(void* parameter);
+    static void printMessage(const LogMessage& message);
+    static char levelChar(int level);
+};
+
+#endif
@@ -0,0 +1,281 @@
+#include "mains_sensing.h"
+#include "logger.h"
+
+#if MAINS_SENSING_ENABLED
+#include "driver/i2s.h"
+#include "driver/adc.h"
+#include "soc/syscon_struct.h"
+#endif
+
+TaskHandle_t MainsSensing::taskHandle = nullptr;
+portMUX_TYPE MainsSensing::mux = portMUX_INITIALIZER_UNLOCKED;
+MainsSensing::Measurement MainsSensing::latest = {};
+uint16_t MainsSensing::auxAdc = 0;
+unsigned long MainsSensing::rejectedHalfCycles = 0;
+volatile bool MainsSensing::sequenceReversed = false;
+
+namespace {
+
+// Порядок каналов в шаблоне АЦП
+const int SLOT_VOLTAGE = 0;
+const int SLOT_CURRENT = 1;         // L1-L3: 1, 2, 3
+const int SLOT_AUX = 4;             // NTC на выходе
+const int SLOT_COUNT = 5;
+
+// Полупериодов для оценки длины окна до начала измерения
+const int SETTLE_HALF_CYCLES = 4;
+const int MAX_REJECTED_IN_ROW = 8;
+
+// Длительность кадра (все каналы шаблона по разу)
+const float FRAME_US = SLOT_COUNT * 1000000.0 / MAINS_SAMPLE_RATE_HZ;
+
+// Состояние задачи измерения (доступно только ей)
+#if MAINS_SENSING_ENABLED
+int8_t slotForChannel[16];
+#endif
+float offsets[SLOT_COUNT];
+float history[MAINS_HISTORY_SAMPLES];
+int historyHead = 0;
+
+float sumV2 = 0;
+float sumI2[3] = { 0 };
+float sumP[3] = { 0 };
+uint32_t sumAux = 0;
+uint32_t sampleCount = 0;
+bool conducting[3] = { false };
+int32_t conductionEnd[3] = { -1, -1, -1 };  // Кадр спада тока в текущем окне
+
+bool positiveHalf = false;
+float samplesPerHalf = 0;
+int settledHalfCycles = 0;
+int rejectedInRow = 0;
+uint32_t sequence = 0;
+
+#if MAINS_SENSING_ENABLED
+int adc1Channel(int pin) {
+    switch (pin) {
+        case 36: return 0;
+        case 37: return 1;
+        case 38: return 2;
+        case 39: return 3;
+        case 32: return 4;
+        case 33: return 5;
+        case 34: return 6;
+        case 35: return 7;
+        default: return -1;
+    }
+}
+#endif
+
+}
+
+void MainsSensing::begin() {
+#if MAINS_SENSING_ENABLED
+    if (!startDma()) {
+        LOG_E(MAINS, "Не удалось запустить АЦП через I2S DMA, измерение сети отключено");
+        return;
+    }
+    xTaskCreatePinnedToCore(samplerTask, "mains", MAINS_TASK_STACK_SIZE, nullptr,
+                            MAINS_TASK_PRIORITY, &taskHandle, MAINS_TASK_CORE);
+    LOG_I(MAINS, "Измерение сети: %d каналов, I2S %d Гц", SLOT_COUNT, MAINS_SAMPLE_RATE_HZ);
+#endif
+}
+
+bool MainsSensing::isValid() {
+    portENTER_CRITICAL(&mux);
+    bool valid = latest.sequence > 0 && millis() - latest.timeMs < MAINS_STALE_MS;
+    portEXIT_CRITICAL(&mux);
+    return valid;
+}
+
+void MainsSensing::getMeasurement(Measurement& measurement) {
+    portENTER_CRITICAL(&mux);
+    measurement = latest;
+    portEXIT_CRITICAL(&mux);
+}
+
+float MainsSensing::getTotalPower() {
+    if (!isValid()) return 0.0;
+
+    Measurement measurement;
+    getMeasurement(measurement);
+    return measurement.realPowerW[0] + measurement.realPowerW[1] + measurement.realPowerW[2];
+}
+
+uint16_t MainsSensing::getAuxAdc() {
+    return auxAdc;
+}
+
+// ========================================
+// АЦП И DMA
+// ========================================
+
+bool MainsSensing::startDma() {
+#if MAINS_SENSING_ENABLED
+    static const int currentPins[3] = MAINS_CURRENT_PINS;
+    const int pins[SLOT_COUNT] = { MAINS_VOLTAGE_PIN, currentPins[0], currentPins[1], currentPins[2], NTC_PIN };
+
+    // Элемент шаблона: канал [7:4], разрядность 12 бит [3:2], ослабление 11 дБ [1:0]
+    uint8_t pattern[SLOT_COUNT];
+    memset(slotForChannel, -1, sizeof(slotForChannel));
+    for (int slot = 0; slot < SLOT_COUNT; slot++) {
+        int channel = adc1Channel(pins[slot]);
+        if (channel < 0 || slotForChannel[channel] >= 0) return false;
+        slotForChannel[channel] = slot;
+        adc1_config_channel_atten((adc1_channel_t)channel, ADC_ATTEN_DB_11);
+        pattern[slot] = (channel << 4) | (3 << 2) | 3;
+        offsets[slot] = 2048;
+    }
+
+    i2s_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+    config.sample_rate = MAINS_SAMPLE_RATE_HZ;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_RIGHT;
+    config.communication_format = I2S_COMM_FORMAT_I2S_MSB;
+    config.dma_buf_count = MAINS_DMA_BUFFER_COUNT;
+    config.dma_buf_len = MAINS_DMA_BUFFER_SAMPLES;
+    if (i2s_driver_install(I2S_NUM_0, &config, 0, nullptr) != ESP_OK) return false;
+
+    i2s_set_adc_mode(ADC_UNIT_1, (adc1_channel_t)adc1Channel(MAINS_VOLTAGE_PIN));
+    i2s_adc_enable(I2S_NUM_0);
+
+    // i2s_adc_enable оставляет в шаблоне один канал: полный шаблон - после него
+    SYSCON.saradc_ctrl.sar1_patt_len = SLOT_COUNT - 1;
+    for (int word = 0; word < (SLOT_COUNT + 3) / 4; word++) {
+        uint32_t value = 0;
+        for (int byte = 0; byte < 4; byte++) {
+            int slot = word * 4 + byte;
+            if (slot < SLOT_COUNT) value |= (uint32_t)pattern[slot] << (24 - 8 * byte);
+        }
+        SYSCON.saradc_sar1_patt_tab[word] = value;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MainsSensing::samplerTask(void* parameter) {
+#if MAINS_SENSING_ENABLED
+    static uint16_t buffer[MAINS_DMA_BUFFER_SAMPLES];
+    uint16_t frame[SLOT_COUNT];
+    uint8_t seen = 0;
+
+    for (;;) {
+        size_t bytesRead = 0;
+        i2s_read(I2S_NUM_0, buffer, sizeof(buffer), &bytesRead, portMAX_DELAY);
+
+        // Слово DMA: номер канала [15:12], отсчет [11:0]. Кадр - по одному
+        // отсчету каждого канала шаблона
+        for (size_t i = 0; i < bytesRead / sizeof(uint16_t); i++) {
+            int slot = slotForChannel[buffer[i] >> 12];
+            if (slot < 0) continue;
+            frame[slot] = buffer[i] & 0x0FFF;
+            seen |= 1 << slot;
+            if (seen == (1 << SLOT_COUNT) - 1) {
+                processFrame(frame);
+                seen = 0;
+            }
+        }
+    }
+#endif
+}
+
+// ========================================
+// ПОЛУПЕРИОДЫ
+// ========================================
+
+void MainsSensing::processFrame(const uint16_t* raw) {
+    for (int slot = 0; slot < SLOT_COUNT; slot++) {
+        offsets[slot] += (raw[slot] - offsets[slot]) * MAINS_OFFSET_FILTER;
+    }
+
+    float v = raw[SLOT_VOLTAGE] - offsets[SLOT_VOLTAGE];
+    history[historyHead] = v;
+
+    // Напряжение L2, L3: L1 на T/3 и 2T/3 раньше (обратный порядок - наоборот)
+    int shift = min((int)(samplesPerHalf * 2.0 / 3.0 + 0.5), (MAINS_HISTORY_SAMPLES - 1) / 2);
+    int shiftL2 = sequenceReversed ? 2 * shift : shift;
+    int shiftL3 = sequenceReversed ? shift : 2 * shift;
+    float phaseVoltage[3] = {
+        v,
+        history[(historyHead - shiftL2 + MAINS_HISTORY_SAMPLES) % MAINS_HISTORY_SAMPLES],
+        history[(historyHead - shiftL3 + MAINS_HISTORY_SAMPLES) % MAINS_HISTORY_SAMPLES]
+    };
+    historyHead = (historyHead + 1) % MAINS_HISTORY_SAMPLES;
+
+    sumV2 += v * v;
+    for (int phase = 0; phase < 3; phase++) {
+        float i = raw[SLOT_CURRENT + phase] - offsets[SLOT_CURRENT + phase];
+        sumI2[phase] += i * i;
+        sumP[phase] += phaseVoltage[phase] * i;
+
+        bool flowing = fabsf(i) > MAINS_CONDUCTION_THRESHOLD;
+        if (conducting[phase] && !flowing) {
+            conductionEnd[phase] = sampleCount;
+        }
+        conducting[phase] = flowing;
+    }
+    sumAux += raw[SLOT_AUX];
+    sampleCount++;
+
+    // Переход через ноль с гистерезисом: оба края сдвинуты одинаково,
+    // окно остается равным полупериоду
+    if (!positiveHalf && v > MAINS_ZERO_HYSTERESIS) {
+        positiveHalf = true;
+        finishHalfCycle();
+    } else if (positiveHalf && v < -MAINS_ZERO_HYSTERESIS) {
+        positiveHalf = false;
+        finishHalfCycle();
+    }
+}
+
+void MainsSensing::finishHalfCycle() {
+    uint32_t n = sampleCount;
+    bool settled = settledHalfCycles >= SETTLE_HALF_CYCLES;
+    bool plausible = n > 0 && (!settled || (n > samplesPerHalf * 0.75 && n < samplesPerHalf * 1.25));
+
+    if (plausible) {
+        samplesPerHalf = settledHalfCycles == 0 ? n : samplesPerHalf * 0.9 + n * 0.1;
+        if (!settled) settledHalfCycles++;
+        rejectedInRow = 0;
+    } else if (++rejectedInRow >= MAX_REJECTED_IN_ROW) {
+        // Окно потеряно (пропуски DMA, другая частота) - оцениваем заново
+        settledHalfCycles = 0;
+        rejectedInRow = 0;
+    }
+
+    if (settled && plausible) {
+        Measurement measurement;
+        measurement.voltageRms = sqrtf(sumV2 / n) * MAINS_VOLTAGE_SCALE;
+        for (int phase = 0; phase < 3; phase++) {
+            measurement.currentRms[phase] = sqrtf(sumI2[phase] / n) * MAINS_CURRENT_SCALE;
+            measurement.realPowerW[phase] = sumP[phase] / n * MAINS_VOLTAGE_SCALE * MAINS_CURRENT_SCALE;
+        }
+        measurement.samplesPerHalfCycle = samplesPerHalf;
+        measurement.halfCycleUs = samplesPerHalf * FRAME_US;
+        for (int phase = 0; phase < 3; phase++) {
+            measurement.conductionEndUs[phase] = conductionEnd[phase] >= 0 ? conductionEnd[phase] * FRAME_US : -1.0;
+        }
+        measurement.sequence = ++sequence;
+        measurement.timeMs = millis();
+        auxAdc = sumAux / n;
+
+        portENTER_CRITICAL(&mux);
+        latest = measurement;
+        portEXIT_CRITICAL(&mux);
+    } else if (settled) {
+        rejectedHalfCycles++;
+    }
+
+    sumV2 = 0;
+    sumAux = 0;
+    sampleCount = 0;
+    for (int phase = 0; phase < 3; phase++) {
+        sumI2[phase] = 0;
+        sumP[phase] = 0;
+        conductionEnd[phase] = -1;
+    }
+}
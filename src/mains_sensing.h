@@ -0,0 +1,69 @@
+#ifndef MAINS_SENSING_H
+#define MAINS_SENSING_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config.h"
+
+// ========================================
+// ИЗМЕРЕНИЕ НАПРЯЖЕНИЯ, ТОКА И МОЩНОСТИ
+// ========================================
+//
+// АЦП1 в режиме I2S DMA обходит по шаблону напряжение L1, токи L1-L3 и
+// NTC на выходе с общей частотой MAINS_SAMPLE_RATE_HZ (несколько кГц на
+// канал). Отдельная задача забирает буферы DMA, вычитает среднюю точку АЦП
+// и накапливает суммы v^2, i^2 и v*i за полупериод. Границы полупериодов -
+// переходы напряжения L1 через ноль, поэтому окно всегда ровно T/2.
+//
+// Трансформатор напряжения один: напряжение L2 и L3 берется из истории L1
+// со сдвигом на T/3 и 2T/3 (симметричная сеть; при обратном порядке фаз,
+// обнаруженном PhaseMonitor, сдвиги меняются местами).
+// Активная мощность фазы = среднее v*i за полупериод; для тока триака с
+// одинаковым углом в обоих полупериодах это точное среднее за период.
+//
+// Триак закрывается при нуле тока, а на активной нагрузке это ноль
+// напряжения своей фазы: момент спада тока ниже MAINS_CONDUCTION_THRESHOLD
+// дает фактическое смещение фазы относительно L1 (PhaseMonitor).
+//
+// Без MAINS_SENSING_ENABLED модуль пустой, isValid() всегда false.
+
+class MainsSensing {
+public:
+    struct Measurement {
+        float voltageRms;               // В (L1)
+        float currentRms[3];            // А
+        float realPowerW[3];            // Вт
+        float samplesPerHalfCycle;      // Отсчетов каждого канала за полупериод
+        float halfCycleUs;
+        float conductionEndUs[3];       // Конец тока фазы от начала полупериода L1 (мкс), -1 - тока не было
+        uint32_t sequence;              // Номер полупериода
+        unsigned long timeMs;           // Время окончания полупериода
+    };
+
+    static void begin();
+
+    static bool isEnabled() { return MAINS_SENSING_ENABLED != 0; }
+    static bool isValid();                          // Есть свежий полупериод
+    static void getMeasurement(Measurement& measurement);
+    static float getTotalPower();                   // Вт, 0 если нет измерения
+    static uint16_t getAuxAdc();                    // Средний отсчет NTC на выходе
+    static unsigned long getRejectedCount() { return rejectedHalfCycles; }
+    static TaskHandle_t getTaskHandle() { return taskHandle; }
+    static void setSequenceReversed(bool reversed) { sequenceReversed = reversed; }
+
+private:
+    static TaskHandle_t taskHandle;
+    static portMUX_TYPE mux;
+    static Measurement latest;
+    static uint16_t auxAdc;
+    static unsigned long rejectedHalfCycles;
+    static volatile bool sequenceReversed;
+
+    static void samplerTask(void* parameter);
+    static bool startDma();
+    static void processFrame(const uint16_t* raw);
+    static void finishHalfCycle();
+};
+
+#endif
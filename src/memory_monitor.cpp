@@ -0,0 +1,290 @@
+#include "memory_monitor.h"
+#include "terminal_manager.h"
+#include "logger.h"
+#include "request_arena.h"
+#include "esp_heap_caps.h"
+
+MemoryMonitor::TagStats MemoryMonitor::tags[MEM_TAG_COUNT];
+MemoryMonitor::HeapInfo MemoryMonitor::heap;
+unsigned long MemoryMonitor::lastCheckTime = 0;
+
+TaskHandle_t MemoryMonitor::tasks[MEMORY_MAX_TASKS] = {nullptr};
+uint32_t MemoryMonitor::taskStackFree[MEMORY_MAX_TASKS] = {0};
+int MemoryMonitor::taskCount = 0;
+
+uint32_t MemoryMonitor::scopeFreeStart[MEMORY_SCOPE_DEPTH];
+int32_t MemoryMonitor::scopeChildBytes[MEMORY_SCOPE_DEPTH];
+int MemoryMonitor::scopeDepth = 0;
+
+bool MemoryMonitor::fragmentationAlert = false;
+bool MemoryMonitor::lowHeapAlert = false;
+unsigned long MemoryMonitor::alertCount = 0;
+
+MemoryMonitor::AllocationWatch MemoryMonitor::watch;
+volatile bool MemoryMonitor::watchRecording = false;
+bool MemoryMonitor::watchPending = false;
+TaskHandle_t MemoryMonitor::watchTask = nullptr;
+unsigned long MemoryMonitor::watchStartTime = 0;
+
+// Заголовок явного выделения: размер для учета при освобождении
+// (8 байт, чтобы сохранить выравнивание данных)
+struct AllocationHeader {
+    uint32_t size;
+    uint32_t reserved;
+};
+
+void MemoryMonitor::begin() {
+    sample();
+    lastCheckTime = millis();
+}
+
+void MemoryMonitor::update() {
+    updateAllocationWatch();
+
+    unsigned long now = millis();
+    if (now - lastCheckTime < MEMORY_CHECK_INTERVAL_MS) return;
+    lastCheckTime = now;
+
+    sample();
+    checkAlerts();
+}
+
+void MemoryMonitor::registerTask(TaskHandle_t task) {
+    if (task == nullptr || taskCount >= MEMORY_MAX_TASKS) return;
+    tasks[taskCount] = task;
+    taskStackFree[taskCount] = uxTaskGetStackHighWaterMark(task);
+    taskCount++;
+}
+
+const char* MemoryMonitor::getTaskName(int index) {
+    return pcTaskGetTaskName(tasks[index]);
+}
+
+// ========================================
+// ВЫДЕЛЕНИЕ С МЕТКОЙ
+// ========================================
+
+void* MemoryMonitor::allocate(MemoryTag tag, size_t size, bool preferPsram) {
+    size_t total = size + sizeof(AllocationHeader);
+    AllocationHeader* header = nullptr;
+    if (preferPsram && psramFound()) {
+        header = (AllocationHeader*)ps_malloc(total);
+    }
+    if (header == nullptr) {
+        header = (AllocationHeader*)malloc(total);
+    }
+    if (header == nullptr) return nullptr;
+
+    header->size = size;
+    tags[tag].allocations++;
+    account(tag, size);
+    return header + 1;
+}
+
+void MemoryMonitor::release(MemoryTag tag, void* ptr) {
+    if (ptr == nullptr) return;
+
+    AllocationHeader* header = (AllocationHeader*)ptr - 1;
+    tags[tag].frees++;
+    account(tag, -(int32_t)header->size);
+    free(header);
+}
+
+// ========================================
+// УЧАСТКИ
+// ========================================
+
+void MemoryMonitor::enterScope() {
+    if (scopeDepth < MEMORY_SCOPE_DEPTH) {
+        scopeFreeStart[scopeDepth] = ESP.getFreeHeap();
+        scopeChildBytes[scopeDepth] = 0;
+    }
+    scopeDepth++;
+}
+
+void MemoryMonitor::exitScope(MemoryTag tag) {
+    scopeDepth--;
+    if (scopeDepth >= MEMORY_SCOPE_DEPTH) return;
+
+    int32_t total = (int32_t)scopeFreeStart[scopeDepth] - (int32_t)ESP.getFreeHeap();
+    int32_t own = total - scopeChildBytes[scopeDepth];
+    if (scopeDepth > 0) {
+        scopeChildBytes[scopeDepth - 1] += total;
+    }
+
+    if (own > 0) {
+        tags[tag].allocations++;
+    } else if (own < 0) {
+        tags[tag].frees++;
+    }
+    account(tag, own);
+}
+
+void MemoryMonitor::account(MemoryTag tag, int32_t bytes) {
+    TagStats& s = tags[tag];
+    s.currentBytes += bytes;
+    if (s.currentBytes > s.peakBytes) s.peakBytes = s.currentBytes;
+}
+
+const char* MemoryMonitor::getTagName(MemoryTag tag) {
+    switch (tag) {
+        case MEM_TERMINAL:  return "terminal";
+        case MEM_WEB:       return "web";
+        case MEM_SPIFFS:    return "spiffs";
+        case MEM_TELEMETRY: return "telemetry";
+        case MEM_HISTORY:   return "history";
+        case MEM_REPLAY:    return "replay";
+        default:            return "unknown";
+    }
+}
+
+// ========================================
+// СОСТОЯНИЕ КУЧИ И ПРЕДУПРЕЖДЕНИЯ
+// ========================================
+
+void MemoryMonitor::sample() {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+
+    heap.freeBytes = info.total_free_bytes;
+    heap.largestFreeBlock = info.largest_free_block;
+    heap.minFreeEver = info.minimum_free_bytes;
+    heap.allocatedBlocks = info.allocated_blocks;
+    heap.freeBlocks = info.free_blocks;
+    heap.fragmentationPercent = info.total_free_bytes > 0
+        ? 100 - (uint8_t)((uint64_t)info.largest_free_block * 100 / info.total_free_bytes)
+        : 0;
+
+    for (int i = 0; i < taskCount; i++) {
+        taskStackFree[i] = uxTaskGetStackHighWaterMark(tasks[i]);
+    }
+}
+
+void MemoryMonitor::checkAlerts() {
+    // Гистерезис: предупреждение снимается ниже MEMORY_FRAGMENTATION_CLEAR_PERCENT
+    if (!fragmentationAlert && heap.fragmentationPercent >= MEMORY_FRAGMENTATION_ALERT_PERCENT) {
+        fragmentationAlert = true;
+        alertCount++;
+        LOG_W(MEMORY, "Фрагментация кучи %d%%: самый большой блок %lu из %lu Б свободных",
+              heap.fragmentationPercent, (unsigned long)heap.largestFreeBlock, (unsigned long)heap.freeBytes);
+        TerminalManager::addLog("⚠ Фрагментация кучи " + String(heap.fragmentationPercent) +
+                                "%, самый большой блок " + String(heap.largestFreeBlock) + " Б");
+    } else if (fragmentationAlert && heap.fragmentationPercent < MEMORY_FRAGMENTATION_CLEAR_PERCENT) {
+        fragmentationAlert = false;
+        LOG_I(MEMORY, "Фрагментация кучи снизилась до %d%%", heap.fragmentationPercent);
+    }
+
+    if (!lowHeapAlert && heap.largestFreeBlock < MEMORY_LOW_BLOCK_ALERT_BYTES) {
+        lowHeapAlert = true;
+        alertCount++;
+        LOG_W(MEMORY, "Мало памяти: самый большой блок %lu Б", (unsigned long)heap.largestFreeBlock);
+        TerminalManager::addLog("⚠ Мало памяти: самый большой блок " + String(heap.largestFreeBlock) + " Б");
+    } else if (lowHeapAlert && heap.largestFreeBlock >= MEMORY_LOW_BLOCK_ALERT_BYTES * 2) {
+        lowHeapAlert = false;
+    }
+}
+
+// ========================================
+// ПРОВЕРКА ВЫДЕЛЕНИЙ
+// ========================================
+
+bool MemoryMonitor::isAllocationWatchSupported() {
+#ifdef ALLOC_WATCH
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool MemoryMonitor::startAllocationWatch(unsigned long seconds) {
+    if (!isAllocationWatchSupported() || watch.active) return false;
+    if (seconds == 0 || seconds > ALLOC_WATCH_MAX_SECONDS) return false;
+
+    memset(&watch, 0, sizeof(watch));
+    watch.active = true;
+    watch.durationMs = seconds * 1000;
+    watchPending = true;
+    return true;
+}
+
+void MemoryMonitor::updateAllocationWatch() {
+    if (watchPending) {
+        // Окно открывается в конце прохода loop: ответ команды или запроса,
+        // запустивших проверку, в него не попадает
+        watchPending = false;
+        watchTask = xTaskGetCurrentTaskHandle();
+        watchStartTime = millis();
+        LOG_I(MEMORY, "Проверка выделений: окно %lu с", watch.durationMs / 1000);
+        watchRecording = true;
+        return;
+    }
+    if (!watchRecording || millis() - watchStartTime < watch.durationMs) return;
+
+    watchRecording = false;
+    watch.active = false;
+    watch.finished = true;
+
+    if (watch.controlAllocations == 0) {
+        LOG_I(MEMORY, "Проверка выделений пройдена: управление 0, HTTP %lu (%lu Б), другие задачи %lu",
+              (unsigned long)watch.httpAllocations, (unsigned long)watch.httpBytes,
+              (unsigned long)watch.otherAllocations);
+        TerminalManager::addLog("✓ Проверка выделений пройдена, HTTP: " + String(watch.httpAllocations));
+    } else {
+        LOG_W(MEMORY, "Проверка выделений: управление выделило %lu блоков (%lu Б)",
+              (unsigned long)watch.controlAllocations, (unsigned long)watch.controlBytes);
+        TerminalManager::addLog("⚠ Проверка выделений: в управлении " + String(watch.controlAllocations) +
+                                " выделений");
+    }
+}
+
+void MemoryMonitor::recordAllocation(size_t size, void* caller) {
+    if (!watchRecording) return;
+
+    if (xTaskGetCurrentTaskHandle() != watchTask) {
+        watch.otherAllocations++;
+        return;
+    }
+
+    bool http = RequestArena::isInRequest();
+    if (http) {
+        watch.httpAllocations++;
+        watch.httpBytes += size;
+    } else {
+        watch.controlAllocations++;
+        watch.controlBytes += size;
+    }
+
+    if (watch.sampleCount < ALLOC_WATCH_SAMPLES) {
+        watch.sampleSize[watch.sampleCount] = size;
+        watch.sampleCaller[watch.sampleCount] = (uint32_t)(uintptr_t)caller;
+        watch.sampleHttp[watch.sampleCount] = http;
+        watch.sampleCount++;
+    }
+}
+
+#ifdef ALLOC_WATCH
+// Обертки компоновщика (-Wl,--wrap=malloc и т.д.): адрес вызова для
+// xtensa-esp32-elf-addr2line
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    MemoryMonitor::recordAllocation(size, __builtin_return_address(0));
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    MemoryMonitor::recordAllocation(count * size, __builtin_return_address(0));
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    MemoryMonitor::recordAllocation(size, __builtin_return_address(0));
+    return __real_realloc(ptr, size);
+}
+
+}
+#endif
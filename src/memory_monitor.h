@@ -0,0 +1,155 @@
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config.h"
+
+// ========================================
+// УЧЕТ ПАМЯТИ
+// ========================================
+//
+// Куча по подсистемам (MemoryTag) учитывается двумя способами:
+//  - буферы, выделяемые явно (телеметрия, история, трасса), берутся
+//    через MemoryMonitor::allocate/release с меткой: точное число
+//    выделений, освобождений, текущий и пиковый объем;
+//  - участки со String (журнал терминала, обработчики веба, чтение
+//    SPIFFS) оборачиваются в MEMORY_SCOPE(tag): подсистеме приписывается
+//    чистое изменение свободной кучи за участок (рост - выделение,
+//    уменьшение - освобождение). Вложенные участки вычитаются из внешнего.
+//    Выделения других задач (WiFi, lwIP) в это время попадают в участок.
+//
+// update() раз в MEMORY_CHECK_INTERVAL_MS снимает состояние кучи (самый
+// большой свободный блок, минимум свободной с запуска, фрагментация) и
+// запас стека зарегистрированных задач. Фрагментация = 1 - самый большой
+// блок / свободная память; при превышении MEMORY_FRAGMENTATION_ALERT_PERCENT
+// или нехватке памяти выдается предупреждение в журнал и терминал.
+//
+// Проверка выделений (startAllocationWatch) - тестовый режим сборки
+// env:esp32dev-allocwatch: malloc/calloc/realloc обернуты компоновщиком
+// (-Wl,--wrap), и за окно наблюдения считаются выделения задачи loop -
+// отдельно в обработке HTTP (RequestArena::isInRequest) и в управлении.
+// Проверка пройдена, если управление не выделило ни одного блока.
+// Выделения внутри библиотеки WebServer (заголовки, аргументы запроса) и
+// других задач только учитываются: их нельзя убрать без замены библиотеки.
+
+enum MemoryTag {
+    MEM_TERMINAL,       // Журнал и команды терминала (String)
+    MEM_WEB,            // Обработчики веб-сервера (JSON, String)
+    MEM_SPIFFS,         // Чтение страниц из SPIFFS
+    MEM_TELEMETRY,      // Буфер телеметрии
+    MEM_HISTORY,        // Ячейки истории
+    MEM_REPLAY,         // Трасса входов и контроллер воспроизведения
+    MEM_TAG_COUNT
+};
+
+class MemoryMonitor {
+public:
+    struct TagStats {
+        uint32_t allocations;
+        uint32_t frees;
+        int32_t currentBytes;       // Может быть < 0 для участков: освобождено больше, чем выделено в них
+        int32_t peakBytes;
+    };
+
+    struct HeapInfo {
+        uint32_t freeBytes;
+        uint32_t largestFreeBlock;
+        uint32_t minFreeEver;
+        uint32_t allocatedBlocks;
+        uint32_t freeBlocks;
+        uint8_t fragmentationPercent;
+    };
+
+    struct AllocationWatch {
+        bool active;
+        bool finished;
+        unsigned long durationMs;
+        uint32_t controlAllocations;
+        uint32_t controlBytes;
+        uint32_t httpAllocations;
+        uint32_t httpBytes;
+        uint32_t otherAllocations;  // Другие задачи (WiFi, lwIP, журнал)
+        uint8_t sampleCount;        // Первые выделения loop: размер и адрес вызова
+        uint32_t sampleSize[ALLOC_WATCH_SAMPLES];
+        uint32_t sampleCaller[ALLOC_WATCH_SAMPLES];
+        bool sampleHttp[ALLOC_WATCH_SAMPLES];
+    };
+
+    static void begin();
+    static void update();               // Вызывать в loop
+
+    // Задачи для контроля стека (loop, logger, safety)
+    static void registerTask(TaskHandle_t task);
+
+    // Выделение с меткой (preferPsram - сначала PSRAM, если есть)
+    static void* allocate(MemoryTag tag, size_t size, bool preferPsram = false);
+    static void release(MemoryTag tag, void* ptr);
+
+    // Участки с неявным выделением (MEMORY_SCOPE)
+    static void enterScope();
+    static void exitScope(MemoryTag tag);
+
+    static const TagStats& getTagStats(MemoryTag tag) { return tags[tag]; }
+    static const char* getTagName(MemoryTag tag);
+    static const HeapInfo& getHeapInfo() { return heap; }
+    static int getTaskCount() { return taskCount; }
+    static const char* getTaskName(int index);
+    static uint32_t getTaskStackFree(int index) { return taskStackFree[index]; }
+
+    // Проверка выделений: окно начинается со следующего update() в loop
+    static bool isAllocationWatchSupported();
+    static bool startAllocationWatch(unsigned long seconds);
+    static const AllocationWatch& getAllocationWatch() { return watch; }
+    static bool isAllocationWatchPassed() { return watch.finished && watch.controlAllocations == 0; }
+    static void recordAllocation(size_t size, void* caller);     // Из оберток malloc
+
+    static bool isFragmentationAlert() { return fragmentationAlert; }
+    static bool isLowHeapAlert() { return lowHeapAlert; }
+    static unsigned long getAlertCount() { return alertCount; }
+
+private:
+    static TagStats tags[MEM_TAG_COUNT];
+    static HeapInfo heap;
+    static unsigned long lastCheckTime;
+
+    static TaskHandle_t tasks[MEMORY_MAX_TASKS];
+    static uint32_t taskStackFree[MEMORY_MAX_TASKS];
+    static int taskCount;
+
+    // Стек участков: свободная память на входе и изменение во вложенных
+    static uint32_t scopeFreeStart[MEMORY_SCOPE_DEPTH];
+    static int32_t scopeChildBytes[MEMORY_SCOPE_DEPTH];
+    static int scopeDepth;
+
+    static bool fragmentationAlert;
+    static bool lowHeapAlert;
+    static unsigned long alertCount;
+
+    static AllocationWatch watch;
+    static volatile bool watchRecording;
+    static bool watchPending;
+    static TaskHandle_t watchTask;
+    static unsigned long watchStartTime;
+
+    static void account(MemoryTag tag, int32_t bytes);
+    static void updateAllocationWatch();
+    static void sample();
+    static void checkAlerts();
+};
+
+class MemoryScope {
+public:
+    explicit MemoryScope(MemoryTag tag) : tag(tag) { MemoryMonitor::enterScope(); }
+    ~MemoryScope() { MemoryMonitor::exitScope(tag); }
+
+private:
+    MemoryTag tag;
+};
+
+#define MEMORY_CONCAT_(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_(a, b)
+#define MEMORY_SCOPE(tag) MemoryScope MEMORY_CONCAT(memoryScope, __LINE__)(tag)
+
+#endif
@@ -0,0 +1,68 @@
+#include "perf_profiler.h"
+
+PerfProfiler::Stats PerfProfiler::stats[PERF_PROBE_COUNT];
+
+uint32_t PerfProfiler::getMeanCycles(PerfProbe probe) {
+    const Stats& s = stats[probe];
+    return s.count > 0 ? (uint32_t)(s.totalCycles / s.count) : 0;
+}
+
+uint32_t PerfProfiler::getP99Cycles(PerfProbe probe) {
+    const Stats& s = stats[probe];
+    if (s.count == 0) return 0;
+
+    // Номер замера 99-го перцентиля (с округлением вверх)
+    uint32_t target = s.count - s.count / 100;
+    uint32_t cumulative = 0;
+    for (int i = 0; i < PERF_HISTOGRAM_BUCKETS; i++) {
+        cumulative += s.histogram[i];
+        if (cumulative >= target) {
+            uint32_t upper = i < 31 ? (2UL << i) - 1 : 0xFFFFFFFFUL;
+            return upper < s.maxCycles ? upper : s.maxCycles;
+        }
+    }
+    return s.maxCycles;
+}
+
+const char* PerfProfiler::getProbeName(PerfProbe probe) {
+    switch (probe) {
+        case PERF_LOOP:           return "loop";
+        case PERF_SYSTEM_UPDATE:  return "system";
+        case PERF_SENSORS_UPDATE: return "sensors";
+        case PERF_PHASE_UPDATE:   return "phase";
+        case PERF_PID_COMPUTE:    return "pid";
+        case PERF_WEB_CLIENT:     return "web";
+        case PERF_BUTTON_UPDATE:  return "button";
+        default:                  return "unknown";
+    }
+}
+
+void PerfProfiler::reset() {
+    for (int p = 0; p < PERF_PROBE_COUNT; p++) {
+        Stats& s = stats[p];
+        s.count = 0;
+        s.minCycles = 0;
+        s.maxCycles = 0;
+        s.totalCycles = 0;
+        for (int i = 0; i < PERF_HISTOGRAM_BUCKETS; i++) {
+            s.histogram[i] = 0;
+        }
+    }
+}
+
+void PerfProfiler::printReport(Print& out) {
+    if (!PERF_PROFILING_ENABLED) {
+        out.println("Профилирование отключено (PERF_PROFILING_ENABLED 0)");
+        return;
+    }
+
+    out.printf("Такты CPU (частота сейчас %lu МГц)\n", (unsigned long)getCpuFrequencyMhz());
+    out.println("участок        вызовов        min       mean        p99        max");
+    for (int p = 0; p < PERF_PROBE_COUNT; p++) {
+        PerfProbe probe = (PerfProbe)p;
+        const Stats& s = stats[p];
+        out.printf("%-10s %11lu %10lu %10lu %10lu %10lu\n", getProbeName(probe), (unsigned long)s.count,
+                   (unsigned long)s.minCycles, (unsigned long)getMeanCycles(probe),
+                   (unsigned long)getP99Cycles(probe), (unsigned long)s.maxCycles);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef PERF_PROFILER_H
+#define PERF_PROFILER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// ПРОФИЛИРОВАНИЕ ГОРЯЧИХ УЧАСТКОВ
+// ========================================
+//
+// Использование: PERF_SCOPE(PERF_PID_COMPUTE); в начале функции - замер
+// до выхода из области видимости. Для участка без своей области:
+//   PERF_BEGIN(start); ... PERF_END(PERF_LOOP, start);
+//
+// Замер - два чтения счетчика тактов CPU (ccount) и запись в статистику:
+// min/max/сумма и гистограмма log2. Все точки - в задаче loop (ядро 1),
+// поэтому без синхронизации. Вложенные участки считаются включительно
+// (SystemController::update содержит SensorManager::update и т.д.).
+// Такты не зависят от частоты CPU (cpu_frequency.h), время - зависит.
+//
+// При PERF_PROFILING_ENABLED 0 макросы пустые и не генерируют код.
+
+enum PerfProbe {
+    PERF_LOOP,              // Проход loop без сна
+    PERF_SYSTEM_UPDATE,     // SystemController::update
+    PERF_SENSORS_UPDATE,    // SensorManager::update
+    PERF_PHASE_UPDATE,      // PhaseController::update
+    PERF_PID_COMPUTE,       // PIDController::compute
+    PERF_WEB_CLIENT,        // WebServerManager::handleClient
+    PERF_BUTTON_UPDATE,     // BootButtonDetector::update
+    PERF_PROBE_COUNT
+};
+
+class PerfProfiler {
+public:
+    struct Stats {
+        uint32_t count;
+        uint32_t minCycles;
+        uint32_t maxCycles;
+        uint64_t totalCycles;
+        uint32_t histogram[PERF_HISTOGRAM_BUCKETS];
+    };
+
+    static inline uint32_t cycles() { return ESP.getCycleCount(); }
+
+    static inline void record(PerfProbe probe, uint32_t elapsed) {
+        Stats& s = stats[probe];
+        s.count++;
+        s.totalCycles += elapsed;
+        if (elapsed < s.minCycles || s.count == 1) s.minCycles = elapsed;
+        if (elapsed > s.maxCycles) s.maxCycles = elapsed;
+        int bucket = elapsed > 0 ? 31 - __builtin_clz(elapsed) : 0;
+        if (bucket >= PERF_HISTOGRAM_BUCKETS) bucket = PERF_HISTOGRAM_BUCKETS - 1;
+        s.histogram[bucket]++;
+    }
+
+    static const Stats& getStats(PerfProbe probe) { return stats[probe]; }
+    static uint32_t getMeanCycles(PerfProbe probe);
+    // Верхняя граница корзины, в которую попадает 99-й перцентиль (не больше max)
+    static uint32_t getP99Cycles(PerfProbe probe);
+    static const char* getProbeName(PerfProbe probe);
+    static void reset();
+
+    // Таблица по всем точкам (терминал)
+    static void printReport(Print& out);
+
+private:
+    static Stats stats[PERF_PROBE_COUNT];
+};
+
+#if PERF_PROFILING_ENABLED
+
+class PerfScope {
+public:
+    explicit PerfScope(PerfProbe probe) : probe(probe), start(PerfProfiler::cycles()) {}
+    ~PerfScope() { PerfProfiler::record(probe, PerfProfiler::cycles() - start); }
+
+private:
+    PerfProbe probe;
+    uint32_t start;
+};
+
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#define PERF_SCOPE(probe) PerfScope PERF_CONCAT(perfScope, __LINE__)(probe)
+#define PERF_BEGIN(var) uint32_t var = PerfProfiler::cycles()
+#define PERF_END(probe, var) PerfProfiler::record((probe), PerfProfiler::cycles() - (var))
+
+#else
+
+#define PERF_SCOPE(probe) do {} while (0)
+#define PERF_BEGIN(var) do {} while (0)
+#define PERF_END(probe, var) do {} while (0)
+
+#endif
+
+#endif
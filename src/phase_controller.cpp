@@ -1,5 +1,11 @@
 #include "phase_controller.h"
 #include "config.h"
+#include "logger.h"
+#include "safety_supervisor.h"
+#include "cpu_frequency.h"
+#include "perf_profiler.h"
+#include "phase_timing.h"
+#include "control_io.h"
 
 PhaseController::PhaseController() 
     : zeroCrossPin(0)
@@ -11,9 +17,16 @@ PhaseController::PhaseController()
     , currentState(PHASE_IDLE)
     , targetPower(0.0)
     , currentPower(0.0)
+    , minFireDelayUs(MIN_FIRE_DELAY_US)
+    , maxFireDelayUs(MAX_FIRE_DELAY_US)
+    , triacPulseUs(TRIAC_PULSE_US)
     , freqHistoryIndex(0)
     , currentFrequency(50.0)
-    , freqHistoryFilled(false) {
+    , freqHistoryFilled(false)
+    , lastFreqUpdate(0)
+    , lastFreqPulseCount(0)
+    , lastDebugTime(0)
+    , debugFireCount(0) {
     
     // Инициализация пинов
     for (int i = 0; i < 3; i++) {
@@ -22,6 +35,11 @@ PhaseController::PhaseController()
         lastFireTimes[i] = 0;
         triacFireStartTimes[i] = 0;
         triacFiring[i] = false;
+        lastFireAngleUs[i] = 0;
+        phaseZeroCrossPins[i] = -1;
+        lastPhaseZeroState[i] = false;
+        lastPhaseZeroCrossTime[i] = 0;
+        phasePower[i] = 0.0;
     }
     
     // Инициализация фильтра частоты
@@ -40,16 +58,32 @@ void PhaseController::begin(int zeroCrossPin, int triacPin1, int triacPin2, int
     triacPins[0] = triacPin1;
     triacPins[1] = triacPin2;
     triacPins[2] = triacPin3;
+#if PHASE_ZERO_CROSS_INPUTS
+    phaseZeroCrossPins[1] = ZERO_CROSS_L2_PIN;
+    phaseZeroCrossPins[2] = ZERO_CROSS_L3_PIN;
+#endif
     
-    // Настройка пина детектора нуля
-    pinMode(zeroCrossPin, INPUT_PULLUP);
-    lastZeroState = digitalRead(zeroCrossPin);
+    // Настройка пинов (при воспроизведении трассы оборудование не трогаем)
+    if (!ControlIO::isReplaying()) {
+        pinMode(zeroCrossPin, INPUT_PULLUP);
+        for (int i = 0; i < 3; i++) {
+            pinMode(triacPins[i], OUTPUT);
+            if (phaseZeroCrossPins[i] >= 0) {
+                pinMode(phaseZeroCrossPins[i], INPUT_PULLUP);
+            }
+        }
+    }
+    lastZeroState = ControlIO::readZeroCross(zeroCrossPin);
     currentZeroState = lastZeroState;
+    for (int i = 1; i < 3; i++) {
+        if (phaseZeroCrossPins[i] >= 0) {
+            lastPhaseZeroState[i] = ControlIO::readZeroCross(phaseZeroCrossPins[i], i);
+        }
+    }
+    phaseMonitor.reset();
     
-    // Настройка пинов триаков
     for (int i = 0; i < 3; i++) {
-        pinMode(triacPins[i], OUTPUT);
-        digitalWrite(triacPins[i], LOW);
+        ControlIO::writeTriac(triacPins[i], LOW);
     }
     
     isInitialized = true;
@@ -57,164 +91,198 @@ void PhaseController::begin(int zeroCrossPin, int triacPin1, int triacPin2, int
 }
 
 void PhaseController::update() {
+    PERF_SCOPE(PERF_PHASE_UPDATE);
+    
     if (!isInitialized) return;
     
+    // Режим измерения точности: фронты, захваченные прерываниями, и пропуски
+    if (!ControlIO::isReplaying()) {
+        PhaseTiming::update(currentState == PHASE_RUNNING && targetPower >= 1.0 && !SafetySupervisor::isTripped());
+    }
+    
     updateZeroCrossDetection();
+    phaseMonitor.update(ControlIO::nowUs(), getHalfPeriodUs(), phasePower);
     updatePhaseControl();
 }
 
 void PhaseController::updateZeroCrossDetection() {
-    currentZeroState = digitalRead(zeroCrossPin);
+    currentZeroState = ControlIO::readZeroCross(zeroCrossPin);
     
     // Детектируем пересечение нуля (любое изменение состояния)
     if (currentZeroState != lastZeroState) {
-        unsigned long currentTime = micros();
+        unsigned long currentTime = ControlIO::nowUs();
         
         // Проверка на дребезг (минимум 100 мкс)
         if (currentTime - lastZeroCrossTime > 100) {
             lastZeroCrossTime = currentTime;
             pulseCount++;
             updateFrequency();
+            phaseMonitor.onZeroCross(0, currentTime, currentTime, getHalfPeriodUs());
             
             // Отладочная информация о пересечении нуля (каждый 500-й импульс)
-            if (pulseCount % 500 == 0) {
-                Serial.print("ПЕРЕСЕЧЕНИЕ НУЛЯ #");
-                Serial.print(pulseCount);
-                Serial.print(" - ");
-                Serial.println(currentZeroState ? "HIGH" : "LOW");
+            if (LOG_ENABLED(PHASE, LOG_LEVEL_DEBUG) && pulseCount % 500 == 0) {
+                LOG_D(PHASE, "Пересечение нуля #%lu - %s", (unsigned long)pulseCount,
+                      currentZeroState ? "HIGH" : "LOW");
             }
         }
     }
     
     // Отладочная информация каждые 5 секунд
-    static unsigned long lastDebugTime = 0;
-    if (millis() - lastDebugTime > 5000) {
-        Serial.println("--- КОНТРОЛЛЕР ФАЗ ---");
-        Serial.print("Пин ");
-        Serial.print(zeroCrossPin);
-        Serial.print(": ");
-        Serial.println(currentZeroState ? "HIGH" : "LOW");
-        Serial.print("Всего пересечений: ");
-        Serial.println(pulseCount);
-        Serial.print("Частота: ");
-        Serial.print(currentFrequency, 1);
-        Serial.println(" Гц");
-        Serial.println("---------------------");
-        lastDebugTime = millis();
+    if (LOG_ENABLED(PHASE, LOG_LEVEL_DEBUG)) {
+        if (ControlIO::nowMs() - lastDebugTime > 5000) {
+            LOG_D(PHASE, "Пин %d: %s, всего пересечений: %lu, частота: %.1f Гц", zeroCrossPin,
+                  currentZeroState ? "HIGH" : "LOW", (unsigned long)pulseCount, currentFrequency);
+            lastDebugTime = ControlIO::nowMs();
+        }
     }
     
     lastZeroState = currentZeroState;
+    
+    // Детекторы нуля L2, L3: смещение их перехода после перехода L1
+    for (int phase = 1; phase < 3; phase++) {
+        if (phaseZeroCrossPins[phase] < 0) continue;
+        
+        bool state = ControlIO::readZeroCross(phaseZeroCrossPins[phase], phase);
+        if (state != lastPhaseZeroState[phase]) {
+            unsigned long currentTime = ControlIO::nowUs();
+            if (currentTime - lastPhaseZeroCrossTime[phase] > 100) {
+                lastPhaseZeroCrossTime[phase] = currentTime;
+                phaseMonitor.onZeroCross(phase, currentTime, lastZeroCrossTime, getHalfPeriodUs());
+            }
+            lastPhaseZeroState[phase] = state;
+        }
+    }
 }
 
 void PhaseController::updatePhaseControl() {
-    unsigned long currentTime = micros();
+    unsigned long currentTime = ControlIO::nowUs();
     
     // Проверяем завершение импульсов триаков
     for (int phase = 0; phase < 3; phase++) {
-        if (triacFiring[phase] && (currentTime - triacFireStartTimes[phase] >= TRIAC_PULSE_US)) {
+        if (triacFiring[phase] && (currentTime - triacFireStartTimes[phase] >= triacPulseUs)) {
             // Завершаем импульс
-            digitalWrite(triacPins[phase], LOW);
+            ControlIO::writeTriac(triacPins[phase], LOW);
             triacFiring[phase] = false;
         }
     }
     
-    if (currentState != PHASE_RUNNING || targetPower < 1.0) {
+    // Сработавший супервизор безопасности запрещает включение независимо
+    // от состояния контроллера (выходы он выключает сам)
+    if (currentState != PHASE_RUNNING || targetPower < 1.0 || ControlIO::isSafetyTripped()) {
         // Выключаем все триаки
         for (int i = 0; i < 3; i++) {
-            digitalWrite(triacPins[i], LOW);
+            ControlIO::writeTriac(triacPins[i], LOW);
             triacStates[i] = false;
             triacFiring[i] = false;
+            phasePower[i] = 0.0;
         }
         currentPower = 0.0;
         return;
     }
     
-    // Плавное изменение текущей мощности с разными скоростями для включения/выключения
-    float diff = targetPower - currentPower;
-    if (abs(diff) > 0.05) {
-        // Разные скорости для включения и выключения
-        float rampSpeed = (targetPower > currentPower) ? 0.01 : 0.005; // Медленнее выключаем
-        currentPower += diff * rampSpeed;
-    } else {
-        currentPower = targetPower;
-    }
+    // Скорость изменения ограничивает RampEngine (SystemController) по
+    // реальному времени, а не по числу проходов loop: запрос применяется сразу
+    currentPower = targetPower;
     
     // Ограничиваем мощность
     if (currentPower < 0) currentPower = 0;
     if (currentPower > 100) currentPower = 100;
     
-    // Рассчитываем задержку включения
-    unsigned long baseDelay = calculateFireDelay(currentPower);
+    updatePhasePower();
     
-    // Управляем каждой фазой с учетом смещения
+    // Каждая фаза отсчитывается от своего перехода через ноль: L1 - по
+    // детектору, L2 и L3 - со смещением PhaseMonitor (по модулю полупериода).
+    // Задержка включения L3 больше не складывается с 240° и не выходит за
+    // полупериод L1
+    float halfPeriodUs = getHalfPeriodUs();
+    unsigned long timeSinceZeroCross = currentTime - lastZeroCrossTime;
     for (int phase = 0; phase < 3; phase++) {
-        // Рассчитываем смещение для каждой фазы
-        unsigned long phaseDelay = baseDelay + (phase * PHASE_SHIFT_US);
+        unsigned long offsetUs = phaseMonitor.getOffsetUs(phase, halfPeriodUs);
         
-        // Проверяем, прошло ли время для включения этой фазы
-        unsigned long timeSinceZeroCross = currentTime - lastZeroCrossTime;
+        // Последний переход фазы: в текущем полупериоде L1 или в предыдущем
+        unsigned long phaseZeroUs = lastZeroCrossTime + offsetUs;
+        if (timeSinceZeroCross < offsetUs) {
+            phaseZeroUs -= (unsigned long)halfPeriodUs;
+        }
+        unsigned long sincePhaseZero = currentTime - phaseZeroUs;
+        unsigned long delayUs = calculateFireDelay(phasePower[phase]);
         
-        // Если задержка прошла и мы в пределах полупериода
-        if (timeSinceZeroCross >= phaseDelay && timeSinceZeroCross < HALF_PERIOD_US) {
-            // Проверяем, не включали ли уже в этом полупериоде
-            if (lastFireTimes[phase] < lastZeroCrossTime || lastFireTimes[phase] == 0) {
-                fireTriac(phase, phaseDelay);
-            }
+        // Задержка прошла, полупериод фазы не закончился, в нем еще не включали
+        if (sincePhaseZero >= delayUs && sincePhaseZero < halfPeriodUs &&
+            (lastFireTimes[phase] == 0 || (long)(lastFireTimes[phase] - phaseZeroUs) < 0)) {
+            fireTriac(phase, phaseZeroUs, delayUs);
         }
     }
 }
 
-void PhaseController::fireTriac(int phase, unsigned long delayUs) {
+void PhaseController::updatePhasePower() {
+    // Потерянная фаза мощность не отдает: ее долю берут остальные (до 100%).
+    // Управляющий импульс на нее продолжает идти с общей мощностью - без
+    // напряжения ток не течет, а возвращение фазы видно по току
+    int live = phaseMonitor.getLiveCount();
+    float boost = (live > 0 && live < 3) ? 3.0 / live : 1.0;
+    for (int phase = 0; phase < 3; phase++) {
+        phasePower[phase] = phaseMonitor.isLost(phase) ? currentPower : min(currentPower * boost, 100.0f);
+    }
+}
+
+void PhaseController::fireTriac(int phase, unsigned long phaseZeroUs, unsigned long delayUs) {
     if (phase < 0 || phase >= 3) return;
     
     // Проверяем, что триак еще не включен
-    if (triacFiring[phase]) return;
-    
-    // Отладочная информация о срабатывании триака (только первые 3 включения)
-    static int triacFireCount = 0;
-    if (triacFireCount < 3) {
-        Serial.print("ТРИАК ");
-        Serial.print(phase + 1);
-        Serial.print(" (пин ");
-        Serial.print(triacPins[phase]);
-        Serial.print(") ВКЛЮЧЕН, задержка: ");
-        Serial.print(delayUs);
-        Serial.println(" мкс");
-        triacFireCount++;
-    }
+    if (triacFiring[phase] || ControlIO::isSafetyTripped()) return;
     
     // Начинаем импульс включения триака
-    digitalWrite(triacPins[phase], HIGH);
+    ControlIO::writeTriac(triacPins[phase], HIGH);
     triacStates[phase] = true;
     triacFiring[phase] = true;
-    triacFireStartTimes[phase] = micros();
+    triacFireStartTimes[phase] = ControlIO::nowUs();
     
     // Отмечаем время включения
-    lastFireTimes[phase] = micros();
+    lastFireTimes[phase] = ControlIO::nowUs();
+    
+    // Угол включения относительно нуля своей фазы (для учета энергии)
+    lastFireAngleUs[phase] = lastFireTimes[phase] - phaseZeroUs;
+    
+    // Запаздывание относительно расчетного момента (опрос из loop);
+    // PhaseTiming отсчитывает от перехода L1 перед фронтом
+    if (!ControlIO::isReplaying()) {
+        unsigned long intendedUs = phaseZeroUs + delayUs;
+        CpuFrequency::recordFireLatency(lastFireTimes[phase] - intendedUs);
+        if (PhaseTiming::isActive()) {
+            PhaseTiming::onFire(phase, intendedUs - lastZeroCrossTime);
+        }
+    }
+    
+    // Отладочная информация о срабатывании триака (только первые 3 включения),
+    // выводится после фронта импульса, чтобы не задерживать его
+    if (LOG_ENABLED(PHASE, LOG_LEVEL_DEBUG)) {
+        if (debugFireCount < 3) {
+            LOG_D(PHASE, "Триак %d (пин %d) включен, задержка: %lu мкс", phase + 1, triacPins[phase], delayUs);
+            debugFireCount++;
+        }
+    }
 }
 
 float PhaseController::calculateFireDelay(float power) {
-    if (power < 1.0) return MAX_FIRE_DELAY_US;
-    if (power >= 100.0) return MIN_FIRE_DELAY_US;
+    if (power < 1.0) return maxFireDelayUs;
+    if (power >= 100.0) return minFireDelayUs;
     
     // Используем квадратичную зависимость для более плавной работы
     float normalizedPower = power / 100.0;
     float smoothPower = normalizedPower * normalizedPower; // Квадратичная зависимость
     
-    // Более безопасный диапазон: 1000мкс - 8500мкс
-    return MIN_FIRE_DELAY_US + (MAX_FIRE_DELAY_US - MIN_FIRE_DELAY_US) * (1.0 - smoothPower);
+    // Безопасный диапазон задается minFireDelayUs - maxFireDelayUs
+    return minFireDelayUs + (maxFireDelayUs - minFireDelayUs) * (1.0 - smoothPower);
 }
 
 void PhaseController::updateFrequency() {
     // Простой расчет частоты на основе количества импульсов за время
-    static unsigned long lastFreqUpdate = 0;
-    static unsigned long lastPulseCount = 0;
-    
-    unsigned long currentTime = millis();
+    unsigned long currentTime = ControlIO::nowMs();
     
     // Обновляем частоту каждые 100мс
     if (currentTime - lastFreqUpdate >= 100) {
-        unsigned long pulseDiff = pulseCount - lastPulseCount;
+        unsigned long pulseDiff = pulseCount - lastFreqPulseCount;
         unsigned long timeDiff = currentTime - lastFreqUpdate;
         
         if (timeDiff > 0 && pulseDiff > 0) {
@@ -235,7 +303,7 @@ void PhaseController::updateFrequency() {
         }
         
         lastFreqUpdate = currentTime;
-        lastPulseCount = pulseCount;
+        lastFreqPulseCount = pulseCount;
     }
 }
 
@@ -269,6 +337,38 @@ PhaseController::PhaseState PhaseController::getState() const {
     return currentState;
 }
 
+void PhaseController::setFireDelayLimits(unsigned long minDelayUs, unsigned long maxDelayUs) {
+    if (minDelayUs >= maxDelayUs) return;
+    minFireDelayUs = minDelayUs;
+    maxFireDelayUs = maxDelayUs;
+}
+
+void PhaseController::setTriacPulse(unsigned long pulseUs) {
+    triacPulseUs = pulseUs;
+}
+
+float PhaseController::getDeliveredPowerFraction(int phase) const {
+    if (phase < 0 || phase >= 3 || currentState != PHASE_RUNNING || phaseMonitor.isLost(phase)) return 0.0;
+    
+    // Триак не включался в последних двух полупериодах - фаза не отдает мощность
+    float halfPeriodUs = getHalfPeriodUs();
+    if (lastFireTimes[phase] == 0 || ControlIO::nowUs() - lastFireTimes[phase] > 2 * halfPeriodUs) {
+        return 0.0;
+    }
+    
+    return powerFractionFromDelay(lastFireAngleUs[phase], halfPeriodUs);
+}
+
+float PhaseController::powerFractionFromDelay(float delayUs, float halfPeriodUs) {
+    // Доля мощности активной нагрузки при фазовом управлении с углом α:
+    // P/Pmax = 1 - α/π + sin(2α)/(2π)
+    if (delayUs <= 0) return 1.0;
+    if (delayUs >= halfPeriodUs) return 0.0;
+    
+    float alpha = PI * delayUs / halfPeriodUs;
+    return 1.0 - alpha / PI + sin(2.0 * alpha) / (2.0 * PI);
+}
+
 bool PhaseController::isReady() const {
     // Считаем готовым если инициализирован и частота в разумных пределах
     return isInitialized && currentFrequency > 40.0 && currentFrequency < 60.0;
@@ -278,6 +378,14 @@ float PhaseController::getFrequency() const {
     return currentFrequency;
 }
 
+unsigned long PhaseController::getLastZeroCrossTime() const {
+    return lastZeroCrossTime;
+}
+
+float PhaseController::getHalfPeriodUs() const {
+    return 500000.0 / currentFrequency;
+}
+
 void PhaseController::start() {
     if (!isInitialized) return;
     currentState = PHASE_RUNNING;
@@ -290,7 +398,7 @@ void PhaseController::stop() {
     
     // Выключаем все триаки
     for (int i = 0; i < 3; i++) {
-        digitalWrite(triacPins[i], LOW);
+        ControlIO::writeTriac(triacPins[i], LOW);
         triacStates[i] = false;
         triacFiring[i] = false;
     }
@@ -303,7 +411,7 @@ void PhaseController::emergencyStop() {
     
     // Немедленно выключаем все триаки
     for (int i = 0; i < 3; i++) {
-        digitalWrite(triacPins[i], LOW);
+        ControlIO::writeTriac(triacPins[i], LOW);
         triacStates[i] = false;
         triacFiring[i] = false;
     }
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "phase_monitor.h"
 
 class PhaseController {
 public:
@@ -13,6 +14,8 @@ public:
     };
 
 private:
+    friend struct BenchAccess;   // Тесты производительности (bench_suite.cpp)
+    
     // Пины управления
     int zeroCrossPin;
     int triacPins[3];
@@ -24,12 +27,21 @@ private:
     volatile unsigned long lastZeroCrossTime;
     volatile unsigned long pulseCount;
     
+    // Детекторы нуля L2, L3 (PHASE_ZERO_CROSS_INPUTS)
+    int phaseZeroCrossPins[3];
+    bool lastPhaseZeroState[3];
+    unsigned long lastPhaseZeroCrossTime[3];
+    
+    // Смещения, обрыв и порядок фаз
+    PhaseMonitor phaseMonitor;
+    
     // Фазовое управление
     PhaseState currentState;
     float targetPower;           // Целевая мощность 0-100%
     float currentPower;          // Текущая мощность 0-100%
+    float phasePower[3];         // Мощность фаз с перераспределением 0-100%
     
-    // Фазовые смещения (120° = 6667 мкс для 50Гц)
+    // Номинальное смещение фаз (120° = 6667 мкс для 50Гц); фактическое - PhaseMonitor
     static const unsigned long PHASE_SHIFT_US_DEFAULT = PHASE_SHIFT_US;
     static const unsigned long HALF_PERIOD_US_DEFAULT = HALF_PERIOD_US;
     static const unsigned long MIN_FIRE_DELAY_US_DEFAULT = MIN_FIRE_DELAY_US;  // Увеличили для безопасности
@@ -41,6 +53,12 @@ private:
     unsigned long lastFireTimes[3];
     unsigned long triacFireStartTimes[3]; // Время начала импульса для каждого триака
     bool triacFiring[3];                 // Флаг активного импульса
+    unsigned long lastFireAngleUs[3];    // Фактическая задержка включения от нуля своей фазы
+    
+    // Настраиваемые параметры (ConfigRegistry)
+    unsigned long minFireDelayUs;
+    unsigned long maxFireDelayUs;
+    unsigned long triacPulseUs;
     
     // Фильтрация частоты
     static const int FREQ_FILTER_SAMPLES_DEFAULT = FREQ_FILTER_SAMPLES;
@@ -48,11 +66,19 @@ private:
     int freqHistoryIndex;
     float currentFrequency;
     bool freqHistoryFilled;
+    unsigned long lastFreqUpdate;
+    unsigned long lastFreqPulseCount;
+    
+    // Отладочный вывод (в экземпляре: контроллер воспроизведения не делит
+    // состояние с рабочим)
+    unsigned long lastDebugTime;
+    int debugFireCount;
     
     // Методы
     void updateZeroCrossDetection();
     void updatePhaseControl();
-    void fireTriac(int phase, unsigned long delayUs);
+    void updatePhasePower();
+    void fireTriac(int phase, unsigned long phaseZeroUs, unsigned long delayUs);
     float calculateFireDelay(float power);
     void updateFrequency();
     float getFilteredFrequency();
@@ -72,10 +98,22 @@ public:
     float getCurrentPower() const;
     float getTargetPower() const;
     
+    // Настройка углов и импульса
+    void setFireDelayLimits(unsigned long minDelayUs, unsigned long maxDelayUs);
+    void setTriacPulse(unsigned long pulseUs);
+    
     // Состояние системы
     PhaseState getState() const;
     bool isReady() const;
     float getFrequency() const;
+    unsigned long getLastZeroCrossTime() const; // micros() последнего пересечения нуля
+    float getHalfPeriodUs() const;
+    const PhaseMonitor& getPhaseMonitor() const { return phaseMonitor; }
+    float getPhasePower(int phase) const { return phasePower[phase]; }
+    
+    // Фактически отдаваемая мощность фазы (доля от номинала 0.0-1.0)
+    float getDeliveredPowerFraction(int phase) const;
+    static float powerFractionFromDelay(float delayUs, float halfPeriodUs);
     
     // Управление
     void start();
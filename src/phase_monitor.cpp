@@ -0,0 +1,240 @@
+#include "phase_monitor.h"
+#include "mains_sensing.h"
+#include "control_io.h"
+#include "logger.h"
+
+// Измерений подряд за допуском, после которых смещение принимается сразу
+// (перекоммутация), а не считается помехой
+static const int OFFSET_JUMP_COUNT = 3;
+
+// Номинальное смещение перехода фазы через ноль после L1 при прямом
+// порядке: L2 отстает на 120°, L3 на 240° (по модулю полупериода)
+static float forwardOffsetUs(int phase, float halfPeriodUs) {
+    return fmodf((float)PHASE_SHIFT_US * phase * halfPeriodUs / HALF_PERIOD_US, halfPeriodUs);
+}
+
+static float reversedOffsetUs(int phase, float halfPeriodUs) {
+    return phase == 0 ? 0.0 : forwardOffsetUs(3 - phase, halfPeriodUs);
+}
+
+PhaseMonitor::PhaseMonitor() :
+    sequence(SEQUENCE_UNKNOWN),
+    lastMeasurement(0),
+    lastUpdateUs(0) {
+    for (int phase = 0; phase < 3; phase++) {
+        measuredOffsetUs[phase] = 0.0;
+        offsetValid[phase] = false;
+        outliers[phase] = 0;
+        lastEvidenceUs[phase] = 0;
+        health[phase] = HEALTH_UNKNOWN;
+        lossCount[phase] = 0;
+    }
+}
+
+void PhaseMonitor::reset() {
+    unsigned long now = ControlIO::nowUs();
+    Source source = getSource();
+    for (int phase = 0; phase < 3; phase++) {
+        offsetValid[phase] = false;
+        outliers[phase] = 0;
+        lastEvidenceUs[phase] = now;
+        health[phase] = (phase > 0 && source == SOURCE_NONE) ? HEALTH_UNKNOWN : HEALTH_OK;
+    }
+    sequence = SEQUENCE_UNKNOWN;
+    lastMeasurement = 0;
+    lastUpdateUs = now;
+}
+
+PhaseMonitor::Source PhaseMonitor::getSource() const {
+    if (PHASE_ZERO_CROSS_INPUTS) return SOURCE_ZERO_CROSS;
+    if (MainsSensing::isEnabled()) return SOURCE_CURRENT;
+    return SOURCE_NONE;
+}
+
+// ========================================
+// ИЗМЕРЕНИЕ
+// ========================================
+
+void PhaseMonitor::onZeroCross(int phase, unsigned long timeUs, unsigned long l1ZeroCrossUs, float halfPeriodUs) {
+    lastEvidenceUs[phase] = timeUs;
+    if (phase == 0 || getSource() != SOURCE_ZERO_CROSS) return;
+
+    applyOffset(phase, fmodf((float)(timeUs - l1ZeroCrossUs), halfPeriodUs));
+}
+
+void PhaseMonitor::applyOffset(int phase, float offsetUs) {
+    if (offsetValid[phase] && fabsf(offsetUs - measuredOffsetUs[phase]) > PHASE_OFFSET_TOLERANCE_US) {
+        // Одиночный выброс пропускаем, устойчивое новое смещение принимаем сразу
+        if (++outliers[phase] < OFFSET_JUMP_COUNT) return;
+        offsetValid[phase] = false;
+    }
+    outliers[phase] = 0;
+
+    if (!offsetValid[phase]) {
+        measuredOffsetUs[phase] = offsetUs;
+        offsetValid[phase] = true;
+    } else {
+        measuredOffsetUs[phase] += (offsetUs - measuredOffsetUs[phase]) * PHASE_OFFSET_FILTER;
+    }
+}
+
+void PhaseMonitor::updateFromCurrent(unsigned long nowUs, const float* phasePower) {
+    // Нет свежего измерения (в том числе при воспроизведении трассы) -
+    // нет и оснований менять состояние фаз
+    if (ControlIO::isReplaying() || !MainsSensing::isValid()) {
+        for (int phase = 1; phase < 3; phase++) {
+            if (!isLost(phase)) lastEvidenceUs[phase] = nowUs;
+        }
+        return;
+    }
+
+    MainsSensing::Measurement measurement;
+    MainsSensing::getMeasurement(measurement);
+    if (measurement.sequence == lastMeasurement) return;
+    lastMeasurement = measurement.sequence;
+
+    for (int phase = 1; phase < 3; phase++) {
+        // Триак почти закрыт: малый ток ничего не доказывает
+        if (phasePower[phase] < PHASE_LOSS_MIN_POWER) {
+            if (!isLost(phase)) lastEvidenceUs[phase] = nowUs;
+            continue;
+        }
+        if (measurement.currentRms[phase] >= PHASE_LOSS_CURRENT_A) {
+            lastEvidenceUs[phase] = nowUs;
+        }
+
+        // Спад тока L1 - та же задержка порога, что и у остальных фаз
+        float end = measurement.conductionEndUs[phase];
+        if (end < 0.0 || measurement.halfCycleUs <= 0.0) continue;
+        if (measurement.conductionEndUs[0] >= 0.0) {
+            end -= measurement.conductionEndUs[0];
+        }
+        applyOffset(phase, fmodf(end + measurement.halfCycleUs, measurement.halfCycleUs));
+    }
+}
+
+void PhaseMonitor::update(unsigned long nowUs, float halfPeriodUs, const float* phasePower) {
+    Source source = getSource();
+
+    // Пропуск опроса (сон, долгая команда) - не обрыв: переходы просто
+    // никто не видел
+    if (nowUs - lastUpdateUs > PHASE_LOSS_TIMEOUT_MS * 500UL) {
+        for (int phase = 0; phase < 3; phase++) {
+            if (!isLost(phase)) lastEvidenceUs[phase] = nowUs;
+        }
+    }
+    lastUpdateUs = nowUs;
+
+    if (source == SOURCE_CURRENT) {
+        updateFromCurrent(nowUs, phasePower);
+    }
+
+    for (int phase = 0; phase < 3; phase++) {
+        if (phase > 0 && source == SOURCE_NONE) continue;
+        bool recent = nowUs - lastEvidenceUs[phase] <= PHASE_LOSS_TIMEOUT_MS * 1000UL;
+        setHealth(phase, recent ? HEALTH_OK : HEALTH_LOST);
+    }
+
+    updateSequence(halfPeriodUs);
+}
+
+void PhaseMonitor::setHealth(int phase, Health newHealth) {
+    if (health[phase] == newHealth) return;
+
+    if (newHealth == HEALTH_LOST) {
+        lossCount[phase]++;
+        offsetValid[phase] = false;
+        LOG_W(PHASE, "Фаза L%d потеряна (%s), мощность перераспределена на остальные",
+              phase + 1, getSourceName(phase == 0 ? SOURCE_ZERO_CROSS : getSource()));
+    } else if (health[phase] == HEALTH_LOST) {
+        LOG_I(PHASE, "Фаза L%d восстановлена", phase + 1);
+    }
+    health[phase] = newHealth;
+}
+
+void PhaseMonitor::updateSequence(float halfPeriodUs) {
+    int forward = 0, reversed = 0, other = 0;
+    for (int phase = 1; phase < 3; phase++) {
+        if (!offsetValid[phase] || isLost(phase)) continue;
+        float offset = measuredOffsetUs[phase];
+        if (fabsf(offset - forwardOffsetUs(phase, halfPeriodUs)) < PHASE_OFFSET_TOLERANCE_US) {
+            forward++;
+        } else if (fabsf(offset - reversedOffsetUs(phase, halfPeriodUs)) < PHASE_OFFSET_TOLERANCE_US) {
+            reversed++;
+        } else {
+            other++;
+        }
+    }
+
+    // Нет измерений (триаки закрыты) - последний определенный порядок остается
+    if (forward + reversed + other == 0) return;
+
+    Sequence detected = SEQUENCE_UNKNOWN;
+    if (other == 0 && reversed == 0) detected = SEQUENCE_FORWARD;
+    if (other == 0 && forward == 0) detected = SEQUENCE_REVERSED;
+
+    if (detected != sequence) {
+        if (detected == SEQUENCE_REVERSED) {
+            LOG_W(PHASE, "Обратный порядок фаз (L1-L3-L2), моменты включения L2 и L3 пересчитаны");
+        } else if (detected == SEQUENCE_UNKNOWN) {
+            LOG_W(PHASE, "Смещения фаз не соответствуют 120°: L2 %.0f мкс, L3 %.0f мкс",
+                  measuredOffsetUs[1], measuredOffsetUs[2]);
+        } else {
+            LOG_I(PHASE, "Прямой порядок фаз (L1-L2-L3)");
+        }
+        sequence = detected;
+
+        // Напряжения L2, L3 для мощности MainsSensing восстанавливаются из L1
+        if (!ControlIO::isReplaying()) {
+            MainsSensing::setSequenceReversed(detected == SEQUENCE_REVERSED);
+        }
+    }
+}
+
+// ========================================
+// РАСПИСАНИЕ И СОСТОЯНИЕ
+// ========================================
+
+float PhaseMonitor::getNominalOffsetUs(int phase, float halfPeriodUs) const {
+    return sequence == SEQUENCE_REVERSED ? reversedOffsetUs(phase, halfPeriodUs) : forwardOffsetUs(phase, halfPeriodUs);
+}
+
+float PhaseMonitor::getOffsetUs(int phase, float halfPeriodUs) const {
+    if (phase == 0) return 0.0;
+    if (offsetValid[phase] && !isLost(phase) && measuredOffsetUs[phase] < halfPeriodUs) {
+        return measuredOffsetUs[phase];
+    }
+    return getNominalOffsetUs(phase, halfPeriodUs);
+}
+
+int PhaseMonitor::getLiveCount() const {
+    int live = 0;
+    for (int phase = 0; phase < 3; phase++) {
+        if (!isLost(phase)) live++;
+    }
+    return live;
+}
+
+const char* PhaseMonitor::getHealthName(Health health) {
+    switch (health) {
+        case HEALTH_OK:   return "ok";
+        case HEALTH_LOST: return "lost";
+        default:          return "unknown";
+    }
+}
+
+const char* PhaseMonitor::getSequenceName(Sequence sequence) {
+    switch (sequence) {
+        case SEQUENCE_FORWARD:  return "L1-L2-L3";
+        case SEQUENCE_REVERSED: return "L1-L3-L2";
+        default:                return "unknown";
+    }
+}
+
+const char* PhaseMonitor::getSourceName(Source source) {
+    switch (source) {
+        case SOURCE_ZERO_CROSS: return "zerocross";
+        case SOURCE_CURRENT:    return "current";
+        default:                return "none";
+    }
+}
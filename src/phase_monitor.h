@@ -0,0 +1,96 @@
+#ifndef PHASE_MONITOR_H
+#define PHASE_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// КОНТРОЛЬ ФАЗ ПИТАНИЯ
+// ========================================
+//
+// Детектор нуля один - на L1, моменты включения L2 и L3 отсчитываются от
+// него со смещением их собственного перехода через ноль. PhaseMonitor
+// измеряет эти смещения (по модулю полупериода), обнаруживает пропавшую
+// фазу и обратный порядок фаз.
+//
+// Источник измерения:
+// - детекторы нуля L2, L3 (PHASE_ZERO_CROSS_INPUTS): смещение - время от
+//   перехода L1 до перехода фазы, фаза потеряна без переходов дольше
+//   PHASE_LOSS_TIMEOUT_MS;
+// - иначе MainsSensing: ток активной нагрузки спадает до нуля вместе с
+//   напряжением фазы, смещение - разность моментов спада тока фазы и L1.
+//   Фаза потеряна, если при мощности не ниже PHASE_LOSS_MIN_POWER ток
+//   меньше PHASE_LOSS_CURRENT_A дольше PHASE_LOSS_TIMEOUT_MS (обрыв фазы
+//   и обрыв нагревателя неразличимы, реакция одна);
+// - без обоих источников смещения номинальные, состояние L2, L3 неизвестно.
+//
+// Без измерения смещение берется номинальное для определенного порядка фаз
+// (прямой: L2 через 2/3, L3 через 1/3 полупериода после L1).
+// L1 контролируется по основному детектору нуля: без L1 переходов нет, и
+// выходы выключает супервизор (FAULT_ZERO_CROSS).
+
+class PhaseMonitor {
+public:
+    enum Health {
+        HEALTH_UNKNOWN,         // Нет источника измерения
+        HEALTH_OK,
+        HEALTH_LOST
+    };
+
+    enum Sequence {
+        SEQUENCE_UNKNOWN,       // Не измерено или смещения не похожи на 120°
+        SEQUENCE_FORWARD,       // L1-L2-L3
+        SEQUENCE_REVERSED       // L1-L3-L2
+    };
+
+    enum Source {
+        SOURCE_NONE,
+        SOURCE_ZERO_CROSS,      // Детекторы нуля L2, L3
+        SOURCE_CURRENT          // Спад тока по MainsSensing
+    };
+
+    PhaseMonitor();
+
+    void reset();
+
+    // Из PhaseController: переход через ноль фазы (детектор L1 или L2, L3)
+    void onZeroCross(int phase, unsigned long timeUs, unsigned long l1ZeroCrossUs, float halfPeriodUs);
+
+    // Раз за проход loop; phasePower - мощность каждой фазы (%)
+    void update(unsigned long nowUs, float halfPeriodUs, const float* phasePower);
+
+    // Смещение перехода фазы через ноль после перехода L1, [0, полупериод)
+    float getOffsetUs(int phase, float halfPeriodUs) const;
+    float getNominalOffsetUs(int phase, float halfPeriodUs) const;
+    bool hasMeasuredOffset(int phase) const { return offsetValid[phase]; }
+    float getMeasuredOffsetUs(int phase) const { return measuredOffsetUs[phase]; }
+
+    Health getHealth(int phase) const { return health[phase]; }
+    bool isLost(int phase) const { return health[phase] == HEALTH_LOST; }
+    int getLiveCount() const;                   // Фаз, не признанных потерянными
+    unsigned long getLossCount(int phase) const { return lossCount[phase]; }
+    Sequence getSequence() const { return sequence; }
+    Source getSource() const;
+
+    static const char* getHealthName(Health health);
+    static const char* getSequenceName(Sequence sequence);
+    static const char* getSourceName(Source source);
+
+private:
+    float measuredOffsetUs[3];
+    bool offsetValid[3];
+    int outliers[3];                    // Измерений подряд за допуском
+    unsigned long lastEvidenceUs[3];    // Последнее подтверждение наличия фазы
+    Health health[3];
+    unsigned long lossCount[3];
+    Sequence sequence;
+    uint32_t lastMeasurement;           // Номер полупериода MainsSensing
+    unsigned long lastUpdateUs;
+
+    void applyOffset(int phase, float offsetUs);
+    void updateFromCurrent(unsigned long nowUs, const float* phasePower);
+    void setHealth(int phase, Health newHealth);
+    void updateSequence(float halfPeriodUs);
+};
+
+#endif
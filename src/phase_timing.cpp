@@ -0,0 +1,194 @@
+#include "phase_timing.h"
+#include "logger.h"
+#include "driver/gpio.h"
+
+static const int TRIAC_PINS[3] = {TRIAC_L1_PIN, TRIAC_L2_PIN, TRIAC_L3_PIN};
+
+bool PhaseTiming::active = false;
+
+volatile unsigned long PhaseTiming::zeroCrossTimeUs = 0;
+volatile unsigned long PhaseTiming::zeroCrossCount = 0;
+volatile unsigned long PhaseTiming::edgeTimeUs[3] = {0};
+volatile unsigned long PhaseTiming::edgeZeroCrossTimeUs[3] = {0};
+volatile unsigned long PhaseTiming::edgeZeroCross[3] = {0};
+volatile unsigned long PhaseTiming::prevEdgeZeroCross[3] = {0};
+volatile unsigned long PhaseTiming::edgeCount[3] = {0};
+
+unsigned long PhaseTiming::intendedDelayUs[3] = {0};
+bool PhaseTiming::firePending[3] = {false};
+unsigned long PhaseTiming::processedEdges[3] = {0};
+unsigned long PhaseTiming::lastCheckedZeroCross = 0;
+bool PhaseTiming::powerInHalfPeriod = false;
+unsigned long PhaseTiming::checkedHalfPeriods = 0;
+PhaseTiming::PhaseStats PhaseTiming::stats[3];
+
+// ========================================
+// ПРЕРЫВАНИЯ
+// ========================================
+
+void IRAM_ATTR PhaseTiming::onZeroCross() {
+    unsigned long now = micros();
+
+    // Тот же фильтр дребезга, что и в опросе PhaseController
+    if (now - zeroCrossTimeUs > 100) {
+        zeroCrossTimeUs = now;
+        zeroCrossCount++;
+    }
+}
+
+void IRAM_ATTR PhaseTiming::captureEdge(int phase) {
+    edgeTimeUs[phase] = micros();
+    edgeZeroCrossTimeUs[phase] = zeroCrossTimeUs;
+    prevEdgeZeroCross[phase] = edgeZeroCross[phase];
+    edgeZeroCross[phase] = zeroCrossCount;
+    edgeCount[phase]++;
+}
+
+void IRAM_ATTR PhaseTiming::onEdgeL1() { captureEdge(0); }
+void IRAM_ATTR PhaseTiming::onEdgeL2() { captureEdge(1); }
+void IRAM_ATTR PhaseTiming::onEdgeL3() { captureEdge(2); }
+
+// ========================================
+// УПРАВЛЕНИЕ
+// ========================================
+
+void PhaseTiming::start() {
+    if (active) return;
+
+    reset();
+    lastCheckedZeroCross = zeroCrossCount;
+    for (int phase = 0; phase < 3; phase++) {
+        processedEdges[phase] = edgeCount[phase];
+        firePending[phase] = false;
+
+        // Выход остается выходом, но GPIO видит и собственный фронт
+        gpio_set_direction((gpio_num_t)TRIAC_PINS[phase], GPIO_MODE_INPUT_OUTPUT);
+    }
+
+    attachInterrupt(digitalPinToInterrupt(ZERO_CROSS_PIN), onZeroCross, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(TRIAC_L1_PIN), onEdgeL1, RISING);
+    attachInterrupt(digitalPinToInterrupt(TRIAC_L2_PIN), onEdgeL2, RISING);
+    attachInterrupt(digitalPinToInterrupt(TRIAC_L3_PIN), onEdgeL3, RISING);
+    active = true;
+
+    LOG_I(PHASE, "Измерение точности включения триаков запущено");
+}
+
+void PhaseTiming::stop() {
+    if (!active) return;
+    active = false;
+
+    detachInterrupt(digitalPinToInterrupt(ZERO_CROSS_PIN));
+    for (int phase = 0; phase < 3; phase++) {
+        detachInterrupt(digitalPinToInterrupt(TRIAC_PINS[phase]));
+        gpio_set_direction((gpio_num_t)TRIAC_PINS[phase], GPIO_MODE_OUTPUT);
+    }
+
+    LOG_I(PHASE, "Измерение точности включения триаков остановлено: %lu полупериодов", checkedHalfPeriods);
+}
+
+void PhaseTiming::reset() {
+    checkedHalfPeriods = 0;
+    for (int phase = 0; phase < 3; phase++) {
+        PhaseStats& s = stats[phase];
+        s.fires = 0;
+        s.minErrorUs = 0;
+        s.maxErrorUs = 0;
+        s.sumErrorUs = 0;
+        s.sumSquaresUs = 0.0;
+        s.early = 0;
+        s.missed = 0;
+        for (int i = 0; i < PHASE_TIMING_HISTOGRAM_BUCKETS; i++) {
+            s.histogram[i] = 0;
+        }
+    }
+}
+
+// ========================================
+// ОБРАБОТКА В LOOP
+// ========================================
+
+void PhaseTiming::onFire(int phase, unsigned long delayUs) {
+    intendedDelayUs[phase] = delayUs;
+    firePending[phase] = true;
+}
+
+void PhaseTiming::update(bool powerCommanded) {
+    if (!active) return;
+
+    // Фронты включений: ошибка относительно пересечения нуля перед фронтом
+    for (int phase = 0; phase < 3; phase++) {
+        unsigned long count = edgeCount[phase];
+        if (count == processedEdges[phase]) continue;
+
+        // Повторное чтение, если прерывание обновило данные во время чтения
+        unsigned long edgeTime, zeroCrossTime;
+        do {
+            count = edgeCount[phase];
+            edgeTime = edgeTimeUs[phase];
+            zeroCrossTime = edgeZeroCrossTimeUs[phase];
+        } while (count != edgeCount[phase]);
+        processedEdges[phase] = count;
+
+        if (firePending[phase]) {
+            firePending[phase] = false;
+            recordError(phase, (long)(edgeTime - zeroCrossTime) - (long)intendedDelayUs[phase]);
+        }
+    }
+
+    // Пропуски в последнем завершившемся полупериоде
+    unsigned long currentZeroCross = zeroCrossCount;
+    if (currentZeroCross != lastCheckedZeroCross) {
+        unsigned long completed = currentZeroCross - 1;
+        if (powerInHalfPeriod) {
+            checkedHalfPeriods++;
+            for (int phase = 0; phase < 3; phase++) {
+                if (edgeZeroCross[phase] != completed && prevEdgeZeroCross[phase] != completed) {
+                    stats[phase].missed++;
+                }
+            }
+        }
+        lastCheckedZeroCross = currentZeroCross;
+    }
+    powerInHalfPeriod = powerCommanded;
+}
+
+void PhaseTiming::recordError(int phase, long errorUs) {
+    PhaseStats& s = stats[phase];
+    if (s.fires == 0 || errorUs < s.minErrorUs) s.minErrorUs = errorUs;
+    if (s.fires == 0 || errorUs > s.maxErrorUs) s.maxErrorUs = errorUs;
+    s.fires++;
+    s.sumErrorUs += errorUs;
+    s.sumSquaresUs += (double)errorUs * errorUs;
+    if (errorUs < 0) s.early++;
+
+    // Корзина log2 от |ошибка| + 1: 0 мкс -> 0, 1-2 -> 1, 3-6 -> 2, ...
+    unsigned long magnitude = (unsigned long)(errorUs < 0 ? -errorUs : errorUs) + 1;
+    int bucket = 31 - __builtin_clz(magnitude);
+    if (bucket >= PHASE_TIMING_HISTOGRAM_BUCKETS) bucket = PHASE_TIMING_HISTOGRAM_BUCKETS - 1;
+    s.histogram[bucket]++;
+}
+
+float PhaseTiming::getMeanErrorUs(int phase) {
+    const PhaseStats& s = stats[phase];
+    return s.fires > 0 ? (float)s.sumErrorUs / s.fires : 0.0;
+}
+
+float PhaseTiming::getJitterUs(int phase) {
+    const PhaseStats& s = stats[phase];
+    if (s.fires < 2) return 0.0;
+    double mean = (double)s.sumErrorUs / s.fires;
+    double variance = s.sumSquaresUs / s.fires - mean * mean;
+    return variance > 0.0 ? sqrt(variance) : 0.0;
+}
+
+void PhaseTiming::printReport(Print& out) {
+    out.printf("Измерение: %s, проверено полупериодов: %lu\n",
+               active ? "ИДЕТ" : "ОСТАНОВЛЕНО", checkedHalfPeriods);
+    for (int phase = 0; phase < 3; phase++) {
+        const PhaseStats& s = stats[phase];
+        out.printf("L%d: включений %lu, ошибка ср. %.1f мкс, джиттер %.1f мкс, [%ld..%ld] мкс, раньше %lu, пропусков %lu\n",
+                   phase + 1, s.fires, getMeanErrorUs(phase), getJitterUs(phase),
+                   s.minErrorUs, s.maxErrorUs, s.early, s.missed);
+    }
+}
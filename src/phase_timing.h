@@ -0,0 +1,81 @@
+#ifndef PHASE_TIMING_H
+#define PHASE_TIMING_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// ИЗМЕРЕНИЕ ТОЧНОСТИ ВКЛЮЧЕНИЯ ТРИАКОВ
+// ========================================
+//
+// Режим измерения (start/stop): фронт детектора нуля и фронты импульсов
+// триаков захватываются прерываниями - выходы триаков переводятся в режим
+// вход/выход, и GPIO читает собственный фронт. Ошибка включения - момент
+// фронта минус (пересечение нуля по прерыванию + задержка, рассчитанная
+// PhaseController). Она включает запаздывание опроса детектора нуля и
+// запаздывание опроса момента включения в loop.
+//
+// Пропуск: в завершившемся полупериоде мощность была задана, а фронта
+// фазы не было. Проверяется последний завершившийся полупериод на каждом
+// проходе loop (checked - число проверенных полупериодов).
+
+class PhaseTiming {
+public:
+    struct PhaseStats {
+        unsigned long fires;            // Измеренных включений
+        long minErrorUs;
+        long maxErrorUs;
+        int64_t sumErrorUs;
+        double sumSquaresUs;
+        unsigned long early;            // Фронт раньше расчетного момента
+        unsigned long missed;           // Полупериодов без включения
+        unsigned long histogram[PHASE_TIMING_HISTOGRAM_BUCKETS]; // |ошибка|: [2^i-1, 2^(i+1)-1) мкс
+    };
+
+    static void start();
+    static void stop();
+    static void reset();
+    static bool isActive() { return active; }
+
+    // Из PhaseController (задача loop)
+    static void onFire(int phase, unsigned long intendedDelayUs);
+    static void update(bool powerCommanded);
+
+    static const PhaseStats& getStats(int phase) { return stats[phase]; }
+    static unsigned long getCheckedHalfPeriods() { return checkedHalfPeriods; }
+    static unsigned long getZeroCrossCount() { return zeroCrossCount; }
+    static float getMeanErrorUs(int phase);
+    static float getJitterUs(int phase);             // Стандартное отклонение ошибки
+
+    static void printReport(Print& out);
+
+private:
+    static bool active;
+
+    // Данные прерываний
+    static volatile unsigned long zeroCrossTimeUs;
+    static volatile unsigned long zeroCrossCount;
+    static volatile unsigned long edgeTimeUs[3];
+    static volatile unsigned long edgeZeroCrossTimeUs[3];   // Пересечение нуля перед фронтом
+    static volatile unsigned long edgeZeroCross[3];         // Номер полупериода фронта
+    static volatile unsigned long prevEdgeZeroCross[3];     // ...и предыдущего фронта
+    static volatile unsigned long edgeCount[3];
+
+    // Обработка в loop
+    static unsigned long intendedDelayUs[3];
+    static bool firePending[3];
+    static unsigned long processedEdges[3];
+    static unsigned long lastCheckedZeroCross;
+    static bool powerInHalfPeriod;
+    static unsigned long checkedHalfPeriods;
+    static PhaseStats stats[3];
+
+    static void IRAM_ATTR onZeroCross();
+    static void IRAM_ATTR onEdgeL1();
+    static void IRAM_ATTR onEdgeL2();
+    static void IRAM_ATTR onEdgeL3();
+    static void IRAM_ATTR captureEdge(int phase);
+    static void recordError(int phase, long errorUs);
+};
+
+#endif
@@ -1,20 +1,26 @@
 #include "pid_controller.h"
+#include "perf_profiler.h"
+#include "control_io.h"
 
 PIDController::PIDController(float kp, float ki, float kd, float outputMin, float outputMax)
     : kp(kp), ki(ki), kd(kd)
     , outputMin(outputMin), outputMax(outputMax)
     , lastError(0.0), integral(0.0), lastTime(0), lastComputeTime(0), lastOutput(0.0)
+    , lastProportional(0.0), lastIntegralTerm(0.0), lastDerivativeTerm(0.0)
     , isEnabled(false), setpoint(TARGET_TEMP) // Используем константу из config.h
-    , integralMax(PID_INTEGRAL_MAX), integralMin(PID_INTEGRAL_MIN) {
+    , integralMax(PID_INTEGRAL_MAX), integralMin(PID_INTEGRAL_MIN)
+    , computeIntervalMs(PID_COMPUTE_INTERVAL_MS) {
 }
 
 float PIDController::compute(float input, float setpoint) {
+    PERF_SCOPE(PERF_PID_COMPUTE);
+    
     if (!isEnabled) return 0.0;
     
-    unsigned long currentTime = millis();
+    unsigned long currentTime = ControlIO::nowMs();
     
     // Проверяем интервал вычислений для стабильности
-    if (currentTime - lastComputeTime < PID_COMPUTE_INTERVAL_MS) {
+    if (currentTime - lastComputeTime < computeIntervalMs) {
         return lastOutput; // Возвращаем последнее значение
     }
     
@@ -52,6 +58,9 @@ float PIDController::compute(float input, float setpoint) {
     lastTime = currentTime;
     lastComputeTime = currentTime;
     lastOutput = output;
+    lastProportional = proportional;
+    lastIntegralTerm = integralTerm;
+    lastDerivativeTerm = derivativeTerm;
     
     return output;
 }
@@ -76,9 +85,13 @@ void PIDController::setIntegralLimits(float min, float max) {
     integralMax = max;
 }
 
+void PIDController::setComputeInterval(unsigned long intervalMs) {
+    computeIntervalMs = intervalMs;
+}
+
 void PIDController::enable() {
     isEnabled = true;
-    lastTime = millis();
+    lastTime = ControlIO::nowMs();
 }
 
 void PIDController::disable() {
@@ -100,5 +113,8 @@ float PIDController::getSetpoint() const {
 void PIDController::reset() {
     lastError = 0.0;
     integral = 0.0;
-    lastTime = millis();
+    lastProportional = 0.0;
+    lastIntegralTerm = 0.0;
+    lastDerivativeTerm = 0.0;
+    lastTime = ControlIO::nowMs();
 }
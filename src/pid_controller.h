@@ -17,6 +17,11 @@ private:
     unsigned long lastComputeTime;
     float lastOutput;
     
+    // Составляющие последнего вычисления (для телеметрии)
+    float lastProportional;
+    float lastIntegralTerm;
+    float lastDerivativeTerm;
+    
     // Настройки
     bool isEnabled;
     float setpoint;
@@ -24,6 +29,9 @@ private:
     // Ограничения интегральной составляющей
     float integralMax;
     float integralMin;
+    
+    // Интервал вычисления (мс)
+    unsigned long computeIntervalMs;
 
 public:
     PIDController(float kp = PID_KP, float ki = PID_KI, float kd = PID_KD, 
@@ -34,6 +42,7 @@ public:
     void setTunings(float kp, float ki, float kd);
     void setOutputLimits(float min, float max);
     void setIntegralLimits(float min, float max);
+    void setComputeInterval(unsigned long intervalMs);
     
     // Управление
     void enable();
@@ -56,6 +65,9 @@ public:
     float getLastError() const { return lastError; }
     float getIntegral() const { return integral; }
     float getLastOutput() const { return lastOutput; }
+    float getLastProportional() const { return lastProportional; }
+    float getLastIntegralTerm() const { return lastIntegralTerm; }
+    float getLastDerivativeTerm() const { return lastDerivativeTerm; }
 };
 
 #endif
@@ -0,0 +1,70 @@
+#include "power_loop.h"
+#include "mains_sensing.h"
+#include "control_io.h"
+
+PowerLoop::PowerLoop() :
+    nominalPowerW(3 * ELEMENT_POWER_W),
+    trim(0.0),
+    integral(0.0),
+    targetPowerW(0.0),
+    measuredPowerW(0.0),
+    stagePowerW(0.0),
+    lastSequence(0),
+    lastUpdateMs(0),
+    active(false) {
+}
+
+void PowerLoop::configure(float nominalW) {
+    nominalPowerW = nominalW;
+}
+
+void PowerLoop::setStagePower(float watts) {
+    stagePowerW = watts;
+}
+
+void PowerLoop::reset() {
+    trim = 0.0;
+    integral = 0.0;
+    active = false;
+}
+
+float PowerLoop::update(float commandPercent, unsigned long nowMs) {
+    targetPowerW = commandPercent / 100.0 * nominalPowerW;
+
+    if (commandPercent <= 0.0 || nominalPowerW <= 0.0 || ControlIO::isReplaying() || !MainsSensing::isValid()) {
+        measuredPowerW = 0.0;
+        reset();
+        return commandPercent;
+    }
+
+    MainsSensing::Measurement measurement;
+    MainsSensing::getMeasurement(measurement);
+    measuredPowerW = measurement.realPowerW[0] + measurement.realPowerW[1] + measurement.realPowerW[2] - stagePowerW;
+
+    if (!active) {
+        // Первое измерение после паузы: только запоминаем точку отсчета
+        active = true;
+        lastSequence = measurement.sequence;
+        lastUpdateMs = nowMs;
+        return commandPercent;
+    }
+
+    if (measurement.sequence != lastSequence) {
+        float dt = (nowMs - lastUpdateMs) / 1000.0;
+        lastSequence = measurement.sequence;
+        lastUpdateMs = nowMs;
+
+        float errorPercent = (targetPowerW - measuredPowerW) / nominalPowerW * 100.0;
+        float candidate = integral + POWER_LOOP_KI * errorPercent * dt;
+
+        // Интеграл не растет, пока команда или поправка в ограничении
+        float output = commandPercent + POWER_LOOP_KP * errorPercent + candidate;
+        bool saturated = (output >= 100.0 && errorPercent > 0) || (output <= 0.0 && errorPercent < 0);
+        if (!saturated) {
+            integral = constrain(candidate, -POWER_LOOP_MAX_TRIM, POWER_LOOP_MAX_TRIM);
+        }
+        trim = constrain(POWER_LOOP_KP * errorPercent + integral, -POWER_LOOP_MAX_TRIM, POWER_LOOP_MAX_TRIM);
+    }
+
+    return constrain(commandPercent + trim, 0.0f, 100.0f);
+}
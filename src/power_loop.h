@@ -0,0 +1,54 @@
+#ifndef POWER_LOOP_H
+#define POWER_LOOP_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// ВНУТРЕННИЙ КОНТУР МОЩНОСТИ
+// ========================================
+//
+// Команда триакам 0-100% - это доля номинальной мощности трех фаз
+// (3 * elementPowerW). Фактическая мощность отличается от нее из-за
+// напряжения сети и сопротивления нагревателей. При действующем измерении
+// MainsSensing ПИ-поправка доводит измеренную мощность до заданной, и
+// внешний ПИД по температуре фактически задает киловатты, а не угол.
+//
+// Поправка пересчитывается раз на новый полупериод измерения и ограничена
+// ±POWER_LOOP_MAX_TRIM. Без измерения (выключено, устарело) и при
+// воспроизведении трассы команда проходит без изменений, поправка
+// сбрасывается.
+//
+// Трансформаторы тока стоят на вводе фаз и видят и ступени на реле,
+// поэтому номинальная мощность включенных ступеней вычитается из
+// измеренной: контур регулирует только триаки.
+
+class PowerLoop {
+public:
+    PowerLoop();
+
+    void configure(float nominalPowerW);
+    void setStagePower(float watts);    // Включенные ступени (StageController)
+
+    // Команда триакам 0-100% -> скорректированная команда 0-100%
+    float update(float commandPercent, unsigned long nowMs);
+    void reset();
+
+    bool isActive() const { return active; }
+    float getTargetPowerW() const { return targetPowerW; }
+    float getMeasuredPowerW() const { return measuredPowerW; }
+    float getTrimPercent() const { return trim; }
+
+private:
+    float nominalPowerW;
+    float trim;                     // % команды
+    float integral;
+    float targetPowerW;
+    float measuredPowerW;           // Триаки: измеренная минус ступени
+    float stagePowerW;
+    uint32_t lastSequence;
+    unsigned long lastUpdateMs;
+    bool active;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include "power_manager.h"
+#include "system_controller.h"
+#include "logger.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+
+PowerManager::PowerManager()
+    : idle(false)
+    , lastActivityTime(0)
+    , lastFlowPulses(0)
+    , currentMode(POWER_ACTIVE)
+    , modeStartUs(0)
+    , sleepCount(0)
+    , lastWakeLatencyUs(0)
+    , maxWakeLatencyUs(0)
+    , totalWakeLatencyUs(0)
+    , timerWakeCount(0) {
+
+    for (int i = 0; i < POWER_MODE_COUNT; i++) {
+        modeTimeUs[i] = 0;
+    }
+    for (int i = 0; i < WAKE_SOURCE_COUNT; i++) {
+        wakeCounts[i] = 0;
+    }
+}
+
+void PowerManager::begin() {
+    lastActivityTime = millis();
+    modeStartUs = esp_timer_get_time();
+    currentMode = POWER_ACTIVE;
+
+    if (DEBUG_SERIAL) {
+        Serial.printf("Энергосбережение: %s, сон через %d мс покоя по %d мс\n",
+                      IDLE_SLEEP_ENABLED ? "ВКЛ" : "ВЫКЛ", IDLE_SLEEP_ENTER_MS, IDLE_SLEEP_INTERVAL_MS);
+    }
+}
+
+void PowerManager::update(const SystemController& controller, bool keepAwake, bool wifiActive) {
+    unsigned long currentTime = millis();
+    const SensorManager& sensors = controller.getSensors();
+
+    // Любой импульс датчика потока - активность
+    unsigned long flowPulses = sensors.getFlowTotalPulses();
+    bool flowActivity = flowPulses != lastFlowPulses;
+    lastFlowPulses = flowPulses;
+
+    bool canSleep = IDLE_SLEEP_ENABLED && !keepAwake && !wifiActive && !flowActivity &&
+                    controller.getState() == SystemController::STATE_IDLE &&
+                    !controller.isWaterFlowing() && controller.getCurrentFlowRate() <= 0.0 &&
+                    !sensors.isFlowCalibrationActive() &&
+                    digitalRead(BOOT_BUTTON_PIN) == HIGH;
+
+    if (!canSleep) {
+        lastActivityTime = currentTime;
+        setIdle(false);
+        switchMode(wifiActive ? POWER_WIFI : POWER_ACTIVE);
+        return;
+    }
+
+    if (currentTime - lastActivityTime < IDLE_SLEEP_ENTER_MS) return;
+
+    setIdle(true);
+    sleep();
+}
+
+void PowerManager::setIdle(bool enable) {
+    if (enable == idle) return;
+    idle = enable;
+
+    // Частота CPU в покое - базовая (блокировок нет, см. cpu_frequency.h)
+    switchMode(enable ? POWER_IDLE : POWER_ACTIVE);
+
+    LOG_I(MAIN, "%s: CPU %lu МГц, снов: %lu, во сне %.1f%% времени, оценка тока %.1f мА",
+          enable ? "Режим покоя" : "Выход из покоя", (unsigned long)getCpuFrequencyMhz(),
+          sleepCount, getSleepShare() * 100.0, getEstimatedCurrentMa());
+}
+
+void PowerManager::switchMode(PowerMode mode) {
+    int64_t now = esp_timer_get_time();
+    modeTimeUs[currentMode] += now - modeStartUs;
+    modeStartUs = now;
+    currentMode = mode;
+}
+
+void PowerManager::sleep() {
+    // Пробуждение по смене уровня: ждем уровень, противоположный текущему
+    gpio_int_type_t flowLevel = digitalRead(FLOW_SENSOR_PIN) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+    gpio_wakeup_enable((gpio_num_t)FLOW_SENSOR_PIN, flowLevel);
+    gpio_wakeup_enable((gpio_num_t)BOOT_BUTTON_PIN, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    uart_set_wakeup_threshold(UART_NUM_0, IDLE_UART_WAKE_THRESHOLD);
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
+    esp_sleep_enable_timer_wakeup((uint64_t)IDLE_SLEEP_INTERVAL_MS * 1000ULL);
+
+    // Дописываем вывод, иначе символы в FIFO UART теряются
+    Serial.flush();
+
+    switchMode(POWER_SLEEP);
+    int64_t sleepStart = esp_timer_get_time();
+    esp_light_sleep_start();
+    int64_t sleepEnd = esp_timer_get_time();
+    switchMode(POWER_IDLE);
+
+    gpio_wakeup_disable((gpio_num_t)FLOW_SENSOR_PIN);
+    gpio_wakeup_disable((gpio_num_t)BOOT_BUTTON_PIN);
+    sleepCount++;
+
+    WakeSource source;
+    switch (esp_sleep_get_wakeup_cause()) {
+        case ESP_SLEEP_WAKEUP_TIMER:
+            source = WAKE_TIMER;
+            break;
+        case ESP_SLEEP_WAKEUP_GPIO:
+            source = digitalRead(BOOT_BUTTON_PIN) == LOW ? WAKE_BUTTON : WAKE_FLOW;
+            break;
+        case ESP_SLEEP_WAKEUP_UART:
+            source = WAKE_UART;
+            break;
+        default:
+            source = WAKE_OTHER;
+            break;
+    }
+    wakeCounts[source]++;
+
+    if (source == WAKE_TIMER) {
+        long latency = (long)(sleepEnd - sleepStart - (int64_t)IDLE_SLEEP_INTERVAL_MS * 1000);
+        if (latency < 0) latency = 0;
+        lastWakeLatencyUs = latency;
+        if (latency > maxWakeLatencyUs) maxWakeLatencyUs = latency;
+        totalWakeLatencyUs += latency;
+        timerWakeCount++;
+    } else {
+        // Внешнее событие: не спим, пока идут импульсы или команды
+        lastActivityTime = millis();
+    }
+}
+
+float PowerManager::getSleepShare() const {
+    uint64_t total = 0;
+    for (int i = 0; i < POWER_MODE_COUNT; i++) {
+        total += modeTimeUs[i];
+    }
+    return total > 0 ? (float)modeTimeUs[POWER_SLEEP] / total : 0.0;
+}
+
+float PowerManager::getEstimatedCurrentMa() const {
+    static const float CURRENT_MA[POWER_MODE_COUNT] = {
+        POWER_CURRENT_ACTIVE_MA, POWER_CURRENT_IDLE_MA, POWER_CURRENT_SLEEP_MA, POWER_CURRENT_WIFI_MA
+    };
+
+    double charge = 0.0;
+    uint64_t total = 0;
+    for (int i = 0; i < POWER_MODE_COUNT; i++) {
+        charge += (double)modeTimeUs[i] * CURRENT_MA[i];
+        total += modeTimeUs[i];
+    }
+    return total > 0 ? charge / total : CURRENT_MA[POWER_ACTIVE];
+}
+
+float PowerManager::getAverageWakeLatencyUs() const {
+    return timerWakeCount > 0 ? (float)totalWakeLatencyUs / timerWakeCount : 0.0;
+}
+
+const char* PowerManager::getModeName(PowerMode mode) {
+    switch (mode) {
+        case POWER_ACTIVE: return "active";
+        case POWER_IDLE:   return "idle";
+        case POWER_SLEEP:  return "sleep";
+        case POWER_WIFI:   return "wifi";
+        default:           return "unknown";
+    }
+}
+
+const char* PowerManager::getWakeSourceName(WakeSource source) {
+    switch (source) {
+        case WAKE_TIMER:  return "timer";
+        case WAKE_FLOW:   return "flow";
+        case WAKE_BUTTON: return "button";
+        case WAKE_UART:   return "uart";
+        default:          return "other";
+    }
+}
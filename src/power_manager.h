@@ -0,0 +1,91 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Предварительное объявление
+class SystemController;
+
+// ========================================
+// РЕЖИМ ПОКОЯ И LIGHT SLEEP
+// ========================================
+//
+// Когда нет потока, контроллер в покое и WiFi сессия не запущена,
+// через IDLE_SLEEP_ENTER_MS loop между проходами засыпает (light sleep)
+// на IDLE_SLEEP_INTERVAL_MS.
+// Пробуждение - по смене уровня на пине датчика потока, кнопке BOOT,
+// приему по UART или таймеру (опрос температуры и сторожевой таймер).
+// Пробуждение не по таймеру считается активностью: следующие
+// IDLE_SLEEP_ENTER_MS устройство не спит, PCNT считает импульсы.
+//
+// Потребление не измеряется, а оценивается по времени в каждом режиме
+// и токам POWER_CURRENT_*_MA.
+
+class PowerManager {
+public:
+    enum PowerMode {
+        POWER_ACTIVE,           // Работа
+        POWER_IDLE,             // Между снами
+        POWER_SLEEP,            // Light sleep
+        POWER_WIFI,             // WiFi сессия
+        POWER_MODE_COUNT
+    };
+
+    enum WakeSource {
+        WAKE_TIMER,
+        WAKE_FLOW,
+        WAKE_BUTTON,
+        WAKE_UART,
+        WAKE_OTHER,
+        WAKE_SOURCE_COUNT
+    };
+
+    PowerManager();
+
+    void begin();
+
+    // Решение о сне (вызывать в конце loop). keepAwake - внешняя причина
+    // не спать (WiFi сессия, кнопка, фоновое задание терминала)
+    void update(const SystemController& controller, bool keepAwake, bool wifiActive);
+
+    bool isIdle() const { return idle; }
+
+    // Статистика
+    unsigned long getSleepCount() const { return sleepCount; }
+    unsigned long getWakeCount(WakeSource source) const { return wakeCounts[source]; }
+    uint64_t getModeTimeUs(PowerMode mode) const { return modeTimeUs[mode]; }
+    float getSleepShare() const;                    // Доля времени во сне (0-1)
+    float getEstimatedCurrentMa() const;            // Средний ток за время работы
+    long getLastWakeLatencyUs() const { return lastWakeLatencyUs; }
+    long getMaxWakeLatencyUs() const { return maxWakeLatencyUs; }
+    float getAverageWakeLatencyUs() const;
+    static const char* getModeName(PowerMode mode);
+    static const char* getWakeSourceName(WakeSource source);
+
+private:
+    bool idle;
+    unsigned long lastActivityTime;
+    unsigned long lastFlowPulses;
+
+    // Учет времени по режимам
+    PowerMode currentMode;
+    int64_t modeStartUs;
+    uint64_t modeTimeUs[POWER_MODE_COUNT];
+
+    unsigned long sleepCount;
+    unsigned long wakeCounts[WAKE_SOURCE_COUNT];
+
+    // Задержка пробуждения: превышение заданной длительности сна при
+    // пробуждении по таймеру (вход в сон + выход из сна)
+    long lastWakeLatencyUs;
+    long maxWakeLatencyUs;
+    int64_t totalWakeLatencyUs;
+    unsigned long timerWakeCount;
+
+    void setIdle(bool enable);
+    void switchMode(PowerMode mode);
+    void sleep();
+};
+
+#endif
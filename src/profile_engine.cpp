@@ -0,0 +1,147 @@
+#include "profile_engine.h"
+
+ProfileEngine::ProfileEngine() :
+    segmentCount(0),
+    totalMs(0),
+    target(TARGET_POWER),
+    looping(false),
+    active(false),
+    finished(false),
+    elapsedMs(0),
+    lastUpdateMs(0),
+    cursor(0),
+    value(0.0) {
+}
+
+bool ProfileEngine::isValid(const PowerProfile& profile) {
+    if (profile.target >= TARGET_COUNT) return false;
+    if (profile.segmentCount < 1 || profile.segmentCount > PROFILE_MAX_SEGMENTS) return false;
+
+    Target target = (Target)profile.target;
+    float minValue = getMinValue(target);
+    float maxValue = getMaxValue(target);
+    if (profile.startValue < minValue || profile.startValue > maxValue) return false;
+
+    uint32_t total = 0;
+    for (int i = 0; i < profile.segmentCount; i++) {
+        const ProfileSegment& segment = profile.segments[i];
+        if (segment.shape >= SHAPE_COUNT) return false;
+        if (segment.durationMs == 0 || segment.durationMs > PROFILE_MAX_SEGMENT_S * 1000UL) return false;
+        if (segment.value < minValue || segment.value > maxValue) return false;
+        total += segment.durationMs;
+    }
+    return total > 0;
+}
+
+bool ProfileEngine::load(const PowerProfile& profile) {
+    if (!isValid(profile)) return false;
+
+    uint32_t start = 0;
+    float from = profile.startValue;
+    for (int i = 0; i < profile.segmentCount; i++) {
+        const ProfileSegment& segment = profile.segments[i];
+        segmentStartMs[i] = start;
+        segmentEndMs[i] = start + segment.durationMs;
+        segmentFrom[i] = from;
+        segmentDelta[i] = segment.value - from;
+        segmentInvMs[i] = 1.0 / segment.durationMs;
+        segmentShape[i] = segment.shape;
+        start = segmentEndMs[i];
+        from = segment.value;
+    }
+    segmentCount = profile.segmentCount;
+    totalMs = start;
+    target = (Target)profile.target;
+    looping = profile.looping != 0;
+
+    cursor = 0;
+    value = profile.startValue;
+    return true;
+}
+
+void ProfileEngine::start(unsigned long nowMs) {
+    active = segmentCount > 0;
+    finished = false;
+    elapsedMs = 0;
+    lastUpdateMs = nowMs;
+    cursor = 0;
+    value = segmentCount > 0 ? segmentFrom[0] : 0.0;
+}
+
+void ProfileEngine::stop() {
+    active = false;
+}
+
+float ProfileEngine::update(unsigned long nowMs, bool running) {
+    if (!active) return value;
+
+    if (running) elapsedMs += nowMs - lastUpdateMs;
+    lastUpdateMs = nowMs;
+
+    if (elapsedMs >= totalMs && !looping) {
+        // Однократный профиль: последнее значение, профиль завершен
+        cursor = segmentCount - 1;
+        value = segmentFrom[cursor] + segmentDelta[cursor];
+        active = false;
+        finished = true;
+        return value;
+    }
+    uint32_t t = looping ? (uint32_t)(elapsedMs % totalMs) : (uint32_t)elapsedMs;
+
+    // Новый проход циклического профиля
+    if (t < segmentStartMs[cursor]) cursor = 0;
+    while (t >= segmentEndMs[cursor]) cursor++;
+
+    float x = (t - segmentStartMs[cursor]) * segmentInvMs[cursor];
+    switch (segmentShape[cursor]) {
+        case SHAPE_STEP:   x = 1.0; break;
+        case SHAPE_SMOOTH: x = x * x * (3.0 - 2.0 * x); break;
+        default:           break;
+    }
+    value = segmentFrom[cursor] + segmentDelta[cursor] * x;
+    return value;
+}
+
+uint32_t ProfileEngine::getCycles() const {
+    return totalMs > 0 ? (uint32_t)(elapsedMs / totalMs) : 0;
+}
+
+float ProfileEngine::getMinValue(Target target) {
+    return target == TARGET_SETPOINT ? TARGET_TEMP_MIN : 0.0;
+}
+
+float ProfileEngine::getMaxValue(Target target) {
+    return target == TARGET_SETPOINT ? TARGET_TEMP_MAX : 100.0;
+}
+
+const char* ProfileEngine::getShapeName(Shape shape) {
+    switch (shape) {
+        case SHAPE_STEP:   return "step";
+        case SHAPE_LINEAR: return "linear";
+        case SHAPE_SMOOTH: return "smooth";
+        default:           return "?";
+    }
+}
+
+const char* ProfileEngine::getTargetName(Target target) {
+    switch (target) {
+        case TARGET_POWER:       return "power";
+        case TARGET_POWER_LIMIT: return "limit";
+        case TARGET_SETPOINT:    return "setpoint";
+        default:                 return "?";
+    }
+}
+
+int ProfileEngine::findShape(const char* name) {
+    for (int i = 0; i < SHAPE_COUNT; i++) {
+        if (strcasecmp(getShapeName((Shape)i), name) == 0) return i;
+    }
+    return -1;
+}
+
+int ProfileEngine::findTarget(const char* name) {
+    for (int i = 0; i < TARGET_COUNT; i++) {
+        if (strcasecmp(getTargetName((Target)i), name) == 0) return i;
+    }
+    return -1;
+}
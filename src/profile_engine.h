@@ -0,0 +1,110 @@
+#ifndef PROFILE_ENGINE_H
+#define PROFILE_ENGINE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// ПРОФИЛИ ПО ВРЕМЕНИ
+// ========================================
+//
+// Профиль - список сегментов: за durationMs значение переходит от конца
+// предыдущего сегмента (у первого - от startValue) к value по форме
+// сегмента. Однократный профиль после последнего сегмента завершается,
+// циклический начинается сначала. Смотря по target, значение задает
+// мощность, ограничение мощности или целевую температуру (режимы
+// SystemController).
+//
+// load() заранее считает таблицу сегментов (начало, исходное значение,
+// приращение, 1/длительность), поэтому update() - O(1): курсор сегмента
+// движется только вперед (за такт обычно не больше одного шага), значение
+// - одна формула формы. Время профиля накапливается по монотонным часам
+// ControlIO только пока профиль идет (running), пауза его не продвигает.
+
+// Сегмент и профиль хранятся во flash как есть (ConfigStorage::saveProfiles)
+struct ProfileSegment {
+    uint32_t durationMs;
+    float value;                // Значение в конце сегмента
+    uint8_t shape;              // ProfileEngine::Shape
+    uint8_t reserved[3];
+};
+
+struct PowerProfile {
+    uint8_t target;             // ProfileEngine::Target
+    uint8_t looping;            // 1 - повторять с начала
+    uint8_t segmentCount;
+    uint8_t reserved;
+    float startValue;
+    ProfileSegment segments[PROFILE_MAX_SEGMENTS];
+};
+
+class ProfileEngine {
+public:
+    enum Shape {
+        SHAPE_STEP,             // Сразу новое значение на весь сегмент
+        SHAPE_LINEAR,
+        SHAPE_SMOOTH,           // S-кривая 3x^2 - 2x^3 (без скачка скорости на краях)
+        SHAPE_COUNT
+    };
+
+    enum Target {
+        TARGET_POWER,           // Мощность вместо ПИД (%)
+        TARGET_POWER_LIMIT,     // Предел мощности ПИД (%)
+        TARGET_SETPOINT,        // Целевая температура (°C)
+        TARGET_COUNT
+    };
+
+    ProfileEngine();
+
+    // Проверка профиля и расчет таблицы сегментов; false - профиль
+    // недопустим, загруженный ранее остается
+    bool load(const PowerProfile& profile);
+    static bool isValid(const PowerProfile& profile);
+
+    void start(unsigned long nowMs);
+    void stop();
+
+    // Раз за такт; running - продвигается ли время профиля
+    float update(unsigned long nowMs, bool running);
+
+    bool isActive() const { return active; }
+    bool isFinished() const { return finished; }     // Однократный дошел до конца
+    float getValue() const { return value; }
+    Target getTarget() const { return target; }
+    bool isLooping() const { return looping; }
+    int getSegment() const { return cursor; }
+    int getSegmentCount() const { return segmentCount; }
+    uint64_t getElapsedMs() const { return elapsedMs; }
+    uint32_t getCycleMs() const { return totalMs; }  // Длительность прохода
+    uint32_t getCycles() const;                      // Завершенных проходов
+
+    static const char* getShapeName(Shape shape);
+    static const char* getTargetName(Target target);
+    static int findShape(const char* name);          // -1, если не найдена
+    static int findTarget(const char* name);
+    static float getMinValue(Target target);
+    static float getMaxValue(Target target);
+
+private:
+    // Таблица сегментов (load)
+    uint32_t segmentStartMs[PROFILE_MAX_SEGMENTS];
+    uint32_t segmentEndMs[PROFILE_MAX_SEGMENTS];
+    float segmentFrom[PROFILE_MAX_SEGMENTS];
+    float segmentDelta[PROFILE_MAX_SEGMENTS];
+    float segmentInvMs[PROFILE_MAX_SEGMENTS];
+    uint8_t segmentShape[PROFILE_MAX_SEGMENTS];
+    int segmentCount;
+    uint32_t totalMs;
+    Target target;
+    bool looping;
+
+    // Ход профиля
+    bool active;
+    bool finished;
+    uint64_t elapsedMs;
+    unsigned long lastUpdateMs;
+    int cursor;
+    float value;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "ramp_engine.h"
+#include "mains_sensing.h"
+#include "control_io.h"
+
+RampEngine::RampEngine() :
+    profile(PROFILE_LINEAR),
+    upRate(100000.0 / RAMP_UP_TIME_MS),
+    downRate(RAMP_DOWN_RATE_DEFAULT),
+    currentLimitA(RAMP_CURRENT_LIMIT_A),
+    output(0.0),
+    velocity(0.0),
+    lastTarget(0.0),
+    lastUpdateUs(0),
+    started(false),
+    currentLimited(false) {
+}
+
+void RampEngine::configure(Profile newProfile, float upRatePerSec, float downRatePerSec, float limitA) {
+    profile = newProfile < PROFILE_COUNT ? newProfile : PROFILE_LINEAR;
+    upRate = upRatePerSec;
+    downRate = downRatePerSec;
+    currentLimitA = limitA;
+}
+
+void RampEngine::reset(float value) {
+    output = value;
+    velocity = 0.0;
+    lastTarget = value;
+    currentLimited = false;
+}
+
+float RampEngine::update(float target, unsigned long nowUs) {
+    // Шаг по реальному времени; пропуск loop (сон, блокирующая команда)
+    // не превращается в скачок
+    float dt = started ? (nowUs - lastUpdateUs) / 1000000.0 : 0.0;
+    dt = min(dt, (float)RAMP_MAX_STEP_S);
+    lastUpdateUs = nowUs;
+    started = true;
+
+    target = constrain(target, 0.0f, 100.0f);
+    if (target <= 0.0) {
+        reset(0.0);
+        return output;
+    }
+    lastTarget = target;
+
+    if (profile == PROFILE_CURRENT_LIMITED) {
+        target = limitByCurrent(target, dt);
+    } else {
+        currentLimited = false;
+    }
+
+    if (profile == PROFILE_S_CURVE) {
+        stepSCurve(target, dt);
+    } else {
+        stepLinear(target, dt);
+    }
+
+    output = constrain(output, 0.0f, 100.0f);
+    return output;
+}
+
+float RampEngine::limitByCurrent(float target, float dt) {
+    currentLimited = false;
+    if (ControlIO::isReplaying() || !MainsSensing::isValid()) return target;
+
+    MainsSensing::Measurement measurement;
+    MainsSensing::getMeasurement(measurement);
+    float peak = max(measurement.currentRms[0], max(measurement.currentRms[1], measurement.currentRms[2]));
+    if (peak <= currentLimitA) return target;
+
+    // Выше предела не растем, заметно выше - снижаемся со скоростью спада
+    currentLimited = true;
+    if (peak > currentLimitA * RAMP_CURRENT_BACKOFF) {
+        return min(target, output - downRate * dt);
+    }
+    return min(target, output);
+}
+
+void RampEngine::stepLinear(float target, float dt) {
+    float step = constrain(target - output, -downRate * dt, upRate * dt);
+    velocity = dt > 0.0 ? step / dt : 0.0;
+    output += step;
+}
+
+void RampEngine::stepSCurve(float target, float dt) {
+    float error = target - output;
+    if (fabsf(error) < 0.01) {
+        output = target;
+        velocity = 0.0;
+        return;
+    }
+
+    // Наибольшая скорость, с которой еще можно затормозить точно на цели
+    float rate = error > 0 ? upRate : downRate;
+    float accel = rate / RAMP_S_CURVE_TIME_S;
+    float brake = sqrtf(2.0 * accel * fabsf(error));
+    float desired = error > 0 ? min(rate, brake) : -min(rate, brake);
+
+    velocity += constrain(desired - velocity, -accel * dt, accel * dt);
+    output += velocity * dt;
+
+    // Перелет (цель сместилась навстречу) - встаем на цель
+    if ((error > 0) != (target - output > 0)) {
+        output = target;
+        velocity = 0.0;
+    }
+}
+
+const char* RampEngine::getProfileName(Profile profile) {
+    switch (profile) {
+        case PROFILE_LINEAR:          return "linear";
+        case PROFILE_S_CURVE:         return "scurve";
+        case PROFILE_CURRENT_LIMITED: return "current";
+        default:                      return "?";
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef RAMP_ENGINE_H
+#define RAMP_ENGINE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// ОГРАНИЧЕНИЕ СКОРОСТИ ИЗМЕНЕНИЯ МОЩНОСТИ
+// ========================================
+//
+// Единственное место, где сглаживается запрос мощности: разгон при запуске,
+// скачки ПИД и снижение проходят через одну и ту же скорость в %/с по
+// времени ControlIO, поэтому поведение не зависит от частоты loop (и
+// одинаково при воспроизведении трассы). Профили:
+// - линейный: не быстрее upRate вверх и downRate вниз;
+// - S-кривая: те же предельные скорости, ускорение ограничено (предельная
+//   скорость набирается за RAMP_S_CURVE_TIME_S), торможение к цели без
+//   перелета;
+// - с ограничением тока: линейный, но при токе любой фазы выше
+//   currentLimitA (MainsSensing) рост останавливается, а выше
+//   limit * RAMP_CURRENT_BACKOFF мощность снижается. Холодные ТЭНы
+//   потребляют больший ток, ограничение снимает бросок при запуске. Без
+//   измерения профиль работает как линейный.
+//
+// Нулевой запрос выключает сразу, без спада.
+
+class RampEngine {
+public:
+    enum Profile {
+        PROFILE_LINEAR,
+        PROFILE_S_CURVE,
+        PROFILE_CURRENT_LIMITED,
+        PROFILE_COUNT
+    };
+
+    RampEngine();
+
+    void configure(Profile profile, float upRatePerSec, float downRatePerSec, float currentLimitA);
+
+    // Запрос 0-100% -> ограниченный по скорости выход 0-100%
+    float update(float target, unsigned long nowUs);
+    void reset(float output = 0.0);
+
+    float getOutput() const { return output; }
+    float getVelocity() const { return velocity; }         // %/с
+    bool isSettled() const { return output == lastTarget; }
+    bool isCurrentLimited() const { return currentLimited; }
+    Profile getProfile() const { return profile; }
+    float getUpRate() const { return upRate; }
+    float getDownRate() const { return downRate; }
+
+    static const char* getProfileName(Profile profile);
+
+private:
+    Profile profile;
+    float upRate;
+    float downRate;
+    float currentLimitA;
+
+    float output;
+    float velocity;
+    float lastTarget;
+    unsigned long lastUpdateUs;
+    bool started;
+    bool currentLimited;
+
+    float limitByCurrent(float target, float dt);
+    void stepLinear(float target, float dt);
+    void stepSCurve(float target, float dt);
+};
+
+#endif
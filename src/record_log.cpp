@@ -0,0 +1,251 @@
+#include "record_log.h"
+#include "rom/crc.h"
+
+RecordLog::RecordLog() : partition(nullptr), sectorCount(0), currentSector(0),
+                         currentSequence(0), writeOffset(0) {
+    for (int i = 0; i < MAX_TYPES; i++) {
+        index[i].valid = false;
+    }
+}
+
+bool RecordLog::begin(const char* label, uint8_t subtype) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)subtype, label);
+    if (partition == nullptr) {
+        if (DEBUG_SERIAL) {
+            Serial.printf("Журнал записей: раздел '%s' не найден\n", label);
+        }
+        return false;
+    }
+
+    sectorCount = partition->size / CONFIG_LOG_SECTOR_SIZE;
+    if (sectorCount < 2) {
+        partition = nullptr;
+        return false;
+    }
+
+    // Читаем активные секторы по возрастанию номера, более новые записи
+    // заменяют в индексе более старые
+    bool found = false;
+    uint32_t lastSequence = 0;
+    while (true) {
+        int next = -1;
+        uint32_t nextSequence = 0;
+        for (int s = 0; s < sectorCount; s++) {
+            SectorHeader header;
+            if (!readSectorHeader(s, header) || header.state != SECTOR_ACTIVE) continue;
+            if (found && header.sequence <= lastSequence) continue;
+            if (next < 0 || header.sequence < nextSequence) {
+                next = s;
+                nextSequence = header.sequence;
+            }
+        }
+        if (next < 0) break;
+
+        currentSector = next;
+        currentSequence = nextSequence;
+        writeOffset = 0;
+        scanSector(next);
+        lastSequence = nextSequence;
+        found = true;
+    }
+
+    // Пустой раздел - размечаем первый сектор
+    if (!found) {
+        if (!startSector(0, 1)) {
+            partition = nullptr;
+            return false;
+        }
+        uint32_t state = SECTOR_ACTIVE;
+        esp_partition_write(partition, offsetof(SectorHeader, state), &state, sizeof(state));
+        currentSector = 0;
+        currentSequence = 1;
+        writeOffset = sizeof(SectorHeader);
+    }
+
+    if (DEBUG_SERIAL) {
+        Serial.printf("Журнал записей: %d секторов, текущий %d (№%u), свободно %u байт\n",
+                      sectorCount, currentSector, currentSequence, (unsigned)getFreeBytes());
+    }
+    return true;
+}
+
+bool RecordLog::readSectorHeader(int sector, SectorHeader& header) const {
+    if (esp_partition_read(partition, sector * CONFIG_LOG_SECTOR_SIZE, &header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    return header.magic == SECTOR_MAGIC &&
+           header.crc == crc32_le(0, (const uint8_t*)&header, offsetof(SectorHeader, crc));
+}
+
+void RecordLog::scanSector(int sector) {
+    uint32_t base = sector * CONFIG_LOG_SECTOR_SIZE;
+    uint32_t offset = sizeof(SectorHeader);
+    uint8_t data[CONFIG_LOG_MAX_RECORD];
+
+    while (offset + sizeof(RecordHeader) <= CONFIG_LOG_SECTOR_SIZE) {
+        RecordHeader header;
+        if (esp_partition_read(partition, base + offset, &header, sizeof(header)) != ESP_OK) break;
+
+        // Полностью стертый заголовок - конец журнала в секторе
+        const uint8_t* raw = (const uint8_t*)&header;
+        bool erased = true;
+        for (size_t i = 0; i < sizeof(header); i++) {
+            if (raw[i] != 0xFF) {
+                erased = false;
+                break;
+            }
+        }
+        if (erased) break;
+
+        // Испорченный заголовок - остаток сектора не используем
+        if (header.length > CONFIG_LOG_MAX_RECORD ||
+            offset + sizeof(RecordHeader) + header.length > CONFIG_LOG_SECTOR_SIZE) {
+            offset = CONFIG_LOG_SECTOR_SIZE;
+            break;
+        }
+
+        if (header.commit == RECORD_COMMITTED && header.type < MAX_TYPES &&
+            esp_partition_read(partition, base + offset + sizeof(header), data, header.length) == ESP_OK &&
+            header.crc == recordCrc(header, data)) {
+            IndexEntry& entry = index[header.type];
+            entry.offset = base + offset + sizeof(header);
+            entry.length = header.length;
+            entry.version = header.version;
+            entry.valid = true;
+        }
+
+        offset += align(sizeof(RecordHeader) + header.length);
+    }
+
+    if (sector == currentSector) {
+        writeOffset = offset;
+    }
+}
+
+bool RecordLog::read(uint8_t type, uint8_t& version, void* data, size_t maxLength, size_t& length) const {
+    if (partition == nullptr || type >= MAX_TYPES || !index[type].valid) return false;
+
+    const IndexEntry& entry = index[type];
+    length = entry.length < maxLength ? entry.length : maxLength;
+    version = entry.version;
+    return esp_partition_read(partition, entry.offset, data, length) == ESP_OK;
+}
+
+bool RecordLog::contains(uint8_t type) const {
+    return partition != nullptr && type < MAX_TYPES && index[type].valid;
+}
+
+bool RecordLog::write(uint8_t type, uint8_t version, const void* data, size_t length) {
+    if (partition == nullptr || type >= MAX_TYPES || length > CONFIG_LOG_MAX_RECORD) return false;
+
+    if (append(type, version, data, length)) return true;
+
+    // Сектор заполнен - переходим на следующий
+    if (!rotate()) return false;
+    return append(type, version, data, length);
+}
+
+bool RecordLog::append(uint8_t type, uint8_t version, const void* data, size_t length) {
+    size_t size = align(sizeof(RecordHeader) + length);
+    if (writeOffset + size > CONFIG_LOG_SECTOR_SIZE) return false;
+
+    RecordHeader header;
+    header.commit = 0xFFFFFFFF;
+    header.type = type;
+    header.version = version;
+    header.length = length;
+    header.crc = recordCrc(header, data);
+
+    uint32_t offset = currentSector * CONFIG_LOG_SECTOR_SIZE + writeOffset;
+    writeOffset += size;
+
+    // Заголовок, данные, затем слово подтверждения
+    uint32_t commit = RECORD_COMMITTED;
+    if (esp_partition_write(partition, offset, &header, sizeof(header)) != ESP_OK ||
+        (length > 0 && esp_partition_write(partition, offset + sizeof(header), data, length) != ESP_OK) ||
+        esp_partition_write(partition, offset, &commit, sizeof(commit)) != ESP_OK) {
+        return false;
+    }
+
+    IndexEntry& entry = index[type];
+    entry.offset = offset + sizeof(header);
+    entry.length = length;
+    entry.version = version;
+    entry.valid = true;
+    return true;
+}
+
+bool RecordLog::startSector(int sector, uint32_t sequence) {
+    uint32_t base = sector * CONFIG_LOG_SECTOR_SIZE;
+    if (esp_partition_erase_range(partition, base, CONFIG_LOG_SECTOR_SIZE) != ESP_OK) return false;
+
+    SectorHeader header;
+    header.magic = SECTOR_MAGIC;
+    header.sequence = sequence;
+    header.crc = crc32_le(0, (const uint8_t*)&header, offsetof(SectorHeader, crc));
+    header.state = 0xFFFFFFFF;
+    return esp_partition_write(partition, base, &header, sizeof(header)) == ESP_OK;
+}
+
+bool RecordLog::rotate() {
+    int previousSector = currentSector;
+    int target = (currentSector + 1) % sectorCount;
+    uint32_t sequence = currentSequence + 1;
+
+    // Стираем самый старый сектор (или оставшийся незавершенным)
+    if (!startSector(target, sequence)) return false;
+
+    // Копируем последние версии всех записей. Источники лежат в других
+    // секторах, поэтому сбой на этом шаге ничего не теряет
+    IndexEntry sources[MAX_TYPES];
+    memcpy(sources, index, sizeof(sources));
+    currentSector = target;
+    writeOffset = sizeof(SectorHeader);
+
+    uint8_t data[CONFIG_LOG_MAX_RECORD];
+    for (int type = 0; type < MAX_TYPES; type++) {
+        const IndexEntry& source = sources[type];
+        if (!source.valid) continue;
+        if (esp_partition_read(partition, source.offset, data, source.length) != ESP_OK ||
+            !append(type, source.version, data, source.length)) {
+            memcpy(index, sources, sizeof(index));
+            currentSector = previousSector;
+            writeOffset = CONFIG_LOG_SECTOR_SIZE;
+            return false;
+        }
+    }
+
+    uint32_t state = SECTOR_ACTIVE;
+    if (esp_partition_write(partition, target * CONFIG_LOG_SECTOR_SIZE + offsetof(SectorHeader, state),
+                            &state, sizeof(state)) != ESP_OK) {
+        memcpy(index, sources, sizeof(index));
+        currentSector = previousSector;
+        writeOffset = CONFIG_LOG_SECTOR_SIZE;
+        return false;
+    }
+
+    currentSequence = sequence;
+    return true;
+}
+
+uint32_t RecordLog::recordCrc(const RecordHeader& header, const void* data) {
+    uint32_t crc = crc32_le(0, &header.type, offsetof(RecordHeader, crc) - offsetof(RecordHeader, type));
+    return crc32_le(crc, (const uint8_t*)data, header.length);
+}
+
+size_t RecordLog::align(size_t size) {
+    return (size + 3) & ~(size_t)3;
+}
+
+uint32_t RecordLog::getSequence() const {
+    return currentSequence;
+}
+
+int RecordLog::getSectorCount() const {
+    return sectorCount;
+}
+
+size_t RecordLog::getFreeBytes() const {
+    if (partition == nullptr || writeOffset >= CONFIG_LOG_SECTOR_SIZE) return 0;
+    return CONFIG_LOG_SECTOR_SIZE - writeOffset;
+}
@@ -0,0 +1,87 @@
+#ifndef RECORD_LOG_H
+#define RECORD_LOG_H
+
+#include <Arduino.h>
+#include "esp_partition.h"
+#include "config.h"
+
+// ========================================
+// ЖУРНАЛ ЗАПИСЕЙ ВО FLASH
+// ========================================
+//
+// Раздел делится на секторы, запись идет только дописыванием в текущий
+// сектор. Когда место кончается, стирается следующий сектор по кругу,
+// в него копируются последние версии всех записей, и запись продолжается
+// в нем. Так стирания равномерно распределяются по всем секторам.
+//
+// Сектор: SectorHeader, затем записи RecordHeader + данные (выравнивание 4).
+// Запись считается действительной, только если слово commit записано
+// последним и CRC совпадает - оборванная запись при чтении пропускается.
+// Сектор становится текущим только после отметки state о завершении
+// копирования, незавершенный сектор при чтении игнорируется.
+
+class RecordLog {
+public:
+    static const int MAX_TYPES = 8;
+
+    RecordLog();
+
+    // Поиск раздела и восстановление индекса последних записей
+    bool begin(const char* label, uint8_t subtype);
+
+    // Последняя версия записи типа type
+    bool read(uint8_t type, uint8_t& version, void* data, size_t maxLength, size_t& length) const;
+    bool contains(uint8_t type) const;
+
+    // Дописывание новой версии записи
+    bool write(uint8_t type, uint8_t version, const void* data, size_t length);
+
+    // Статистика
+    uint32_t getSequence() const;       // Количество переходов на новый сектор
+    int getSectorCount() const;
+    size_t getFreeBytes() const;        // Свободно в текущем секторе
+
+private:
+    struct SectorHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t crc;                   // CRC magic и sequence
+        uint32_t state;                 // SECTOR_ACTIVE после копирования записей
+    };
+
+    struct RecordHeader {
+        uint32_t commit;                // RECORD_COMMITTED после записи данных
+        uint8_t type;
+        uint8_t version;
+        uint16_t length;
+        uint32_t crc;                   // CRC type, version, length и данных
+    };
+
+    struct IndexEntry {
+        uint32_t offset;                // Смещение данных в разделе
+        uint16_t length;
+        uint8_t version;
+        bool valid;
+    };
+
+    static const uint32_t SECTOR_MAGIC = 0x474C4857;     // "WHLG"
+    static const uint32_t SECTOR_ACTIVE = 0x56495441;    // "ATIV"
+    static const uint32_t RECORD_COMMITTED = 0x4B4F4352; // "RCOK"
+
+    const esp_partition_t* partition;
+    int sectorCount;
+    int currentSector;
+    uint32_t currentSequence;
+    uint32_t writeOffset;               // Смещение в текущем секторе
+    IndexEntry index[MAX_TYPES];
+
+    bool readSectorHeader(int sector, SectorHeader& header) const;
+    void scanSector(int sector);
+    bool startSector(int sector, uint32_t sequence);
+    bool rotate();
+    bool append(uint8_t type, uint8_t version, const void* data, size_t length);
+    static uint32_t recordCrc(const RecordHeader& header, const void* data);
+    static size_t align(size_t size);
+};
+
+#endif
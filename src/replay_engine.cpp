@@ -0,0 +1,168 @@
+#include "replay_engine.h"
+#include "system_controller.h"
+#include "control_io.h"
+#include "safety_supervisor.h"
+#include "logger.h"
+#include "memory_monitor.h"
+#include <new>
+
+// ========================================
+// ЗАПИСЬ
+// ========================================
+
+bool ReplayEngine::startRecording(const SystemController& live) {
+    if (!ControlIO::startRecording()) return false;
+
+    // Уставки на момент начала записи: при воспроизведении они заменят
+    // текущие параметры ConfigRegistry
+    ControlIO::command(ControlIO::COMMAND_TARGET_TEMP, live.getTargetTemperature());
+    ControlIO::command(ControlIO::COMMAND_MIN_FLOW, live.getMinFlowRate());
+    if (live.isHeatingEnabled()) {
+        ControlIO::command(ControlIO::COMMAND_ENABLE);
+    }
+    return true;
+}
+
+// ========================================
+// ВОСПРОИЗВЕДЕНИЕ
+// ========================================
+
+const char* ReplayEngine::checkReady(const SystemController& live) {
+    if (ControlIO::isRecording()) return "идет запись трассы";
+    if (ControlIO::getRecordCount() == 0) return "трасса пуста";
+    if (live.getState() != SystemController::STATE_IDLE) return "система не в покое";
+    return nullptr;
+}
+
+bool ReplayEngine::run(const SystemController& live, Print& out, bool fullOutput, Summary& summary) {
+    summary.records = 0;
+    summary.steps = 0;
+    summary.transitions = 0;
+    summary.durationMs = 0;
+    summary.wallMs = 0;
+
+    if (checkReady(live) != nullptr) return false;
+
+    MEMORY_SCOPE(MEM_REPLAY);
+
+    unsigned long wallStart = millis();
+    int count = ControlIO::getRecordCount();
+    LOG_I(MAIN, "Воспроизведение трассы: %d записей, %.1f с", count, ControlIO::getDurationUs() / 1000000.0);
+
+    Logger::setMutedTask(xTaskGetCurrentTaskHandle());
+    ControlIO::beginReplay();
+
+    // Начальное состояние входов - до инициализации контроллера
+    int index = 0;
+    while (index < count && ControlIO::getRecord(index).timeUs == 0 &&
+           ControlIO::getRecord(index).type != ControlIO::TRACE_COMMAND) {
+        ControlIO::applyInput(ControlIO::getRecord(index++));
+    }
+
+    SystemController* controller = new (std::nothrow) SystemController();
+    if (controller == nullptr) {
+        ControlIO::endReplay();
+        Logger::setMutedTask(nullptr);
+        LOG_E(MAIN, "Воспроизведение: недостаточно памяти");
+        return false;
+    }
+    controller->begin();
+    controller->applyConfig();
+
+    out.println("time_ms,state,temp_c,flow_lpm,target_power,l1_pct,l2_pct,l3_pct");
+
+    uint64_t endUs = REPLAY_START_TIME_US + ControlIO::getDurationUs();
+    uint64_t nextOutputUs = REPLAY_START_TIME_US;
+    SystemController::SystemState lastState = controller->getState();
+
+    for (uint64_t now = REPLAY_START_TIME_US; now <= endUs; now += REPLAY_STEP_US) {
+        ControlIO::setVirtualTimeUs(now);
+
+        // Записи, наступившие к текущему моменту
+        while (index < count && REPLAY_START_TIME_US + ControlIO::getRecord(index).timeUs <= now) {
+            const ControlIO::TraceRecord& record = ControlIO::getRecord(index++);
+            if (record.type == ControlIO::TRACE_COMMAND) {
+                applyCommand(*controller, record.channel, record.value);
+            } else {
+                ControlIO::applyInput(record);
+            }
+            summary.records++;
+        }
+
+        controller->update();
+        summary.steps++;
+
+        bool changed = controller->getState() != lastState;
+        if (changed) {
+            lastState = controller->getState();
+            summary.transitions++;
+        }
+        if (changed || (fullOutput && now >= nextOutputUs)) {
+            printRow(out, *controller);
+        }
+        if (now >= nextOutputUs) {
+            nextOutputUs += REPLAY_OUTPUT_INTERVAL_MS * 1000ULL;
+        }
+
+        // Длинная трасса не должна сработать сторожевым таймером loop
+        if ((summary.steps & 0x3FF) == 0) {
+            SafetySupervisor::feedWatchdog();
+        }
+    }
+
+    delete controller;
+    ControlIO::endReplay();
+    Logger::setMutedTask(nullptr);
+
+    summary.durationMs = (unsigned long)((endUs - REPLAY_START_TIME_US) / 1000);
+    summary.wallMs = millis() - wallStart;
+    out.printf("# replay: записей %lu, шагов %lu, переходов %lu, %lu мс за %lu мс (x%.1f)\n",
+               summary.records, summary.steps, summary.transitions, summary.durationMs, summary.wallMs,
+               summary.wallMs > 0 ? (float)summary.durationMs / summary.wallMs : 0.0);
+
+    LOG_I(MAIN, "Воспроизведение завершено: %lu переходов, %lu мс за %lu мс",
+          summary.transitions, summary.durationMs, summary.wallMs);
+    return true;
+}
+
+void ReplayEngine::printRow(Print& out, const SystemController& controller) {
+    const PhaseController& phase = controller.getPhaseController();
+    out.printf("%lu,%s,%.2f,%.2f,%.1f,%.1f,%.1f,%.1f\n",
+               (unsigned long)((ControlIO::getVirtualTimeUs() - REPLAY_START_TIME_US) / 1000),
+               SystemController::getStateName(controller.getState()),
+               controller.getCurrentTemperature(), controller.getCurrentFlowRate(), controller.getCurrentPower(),
+               phase.getDeliveredPowerFraction(0) * 100.0, phase.getDeliveredPowerFraction(1) * 100.0,
+               phase.getDeliveredPowerFraction(2) * 100.0);
+}
+
+void ReplayEngine::applyCommand(SystemController& controller, uint8_t command, int16_t value) {
+    switch (command) {
+        case ControlIO::COMMAND_TARGET_TEMP:
+            controller.setTargetTemperature(value / 100.0);
+            break;
+        case ControlIO::COMMAND_MIN_FLOW:
+            controller.setMinFlowRate(value / 100.0);
+            break;
+        case ControlIO::COMMAND_ENABLE:
+            controller.enableHeating();
+            break;
+        case ControlIO::COMMAND_DISABLE:
+            controller.disableHeating();
+            break;
+        case ControlIO::COMMAND_EMERGENCY_STOP:
+            controller.emergencyStop();
+            break;
+        case ControlIO::COMMAND_RESET:
+            controller.reset();
+            break;
+        case ControlIO::COMMAND_PROFILE:
+            if (value < 0) {
+                controller.stopProfile();
+            } else {
+                controller.startProfile((SystemController::ProfileMode)(value / 100));
+            }
+            break;
+        default:
+            break;
+    }
+}
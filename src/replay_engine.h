@@ -0,0 +1,49 @@
+#ifndef REPLAY_ENGINE_H
+#define REPLAY_ENGINE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+class SystemController;
+
+// ========================================
+// ВОСПРОИЗВЕДЕНИЕ ТРАССЫ ВХОДОВ
+// ========================================
+//
+// Трасса (control_io.h) прогоняется через отдельный экземпляр
+// SystemController с теми же параметрами ConfigRegistry: виртуальное
+// время идет шагами REPLAY_STEP_US, записи применяются в свои моменты,
+// команды вызывают те же методы контроллера. Результат - CSV решений
+// контура, который можно сравнить между версиями прошивки на одной и
+// той же трассе.
+//
+// Воспроизведение выполняется в loop и блокирует его, поэтому разрешено
+// только в покое (нагрев выключен, триаки не включаются). Сообщения
+// журнала задачи loop на это время подавляются.
+
+class ReplayEngine {
+public:
+    struct Summary {
+        unsigned long records;          // Примененных записей
+        unsigned long steps;            // Проходов контура
+        unsigned long transitions;      // Переходов машины состояний
+        unsigned long durationMs;       // Виртуальное время
+        unsigned long wallMs;           // Реальное время прогона
+    };
+
+    // Запуск записи с текущими уставками (команды в начале трассы)
+    static bool startRecording(const SystemController& live);
+
+    // Проверка условий: nullptr - можно запускать, иначе причина отказа
+    static const char* checkReady(const SystemController& live);
+
+    // Прогон трассы. fullOutput - строка каждые REPLAY_OUTPUT_INTERVAL_MS,
+    // иначе только переходы. Последняя строка - итог, начинается с '#'
+    static bool run(const SystemController& live, Print& out, bool fullOutput, Summary& summary);
+
+private:
+    static void printRow(Print& out, const SystemController& controller);
+    static void applyCommand(SystemController& controller, uint8_t command, int16_t value);
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "request_arena.h"
+
+// Заголовок блока: размер для reallocate (8 байт - выравнивание данных)
+struct ArenaHeader {
+    uint32_t size;
+    uint32_t reserved;
+};
+
+uint8_t RequestArena::buffer[REQUEST_ARENA_SIZE] __attribute__((aligned(8)));
+size_t RequestArena::used = 0;
+size_t RequestArena::highWater = 0;
+unsigned long RequestArena::fallbackCount = 0;
+unsigned long RequestArena::resetCount = 0;
+bool RequestArena::inRequest = false;
+const char RequestArena::OUT_OF_MEMORY_JSON[] = "{\"error\":\"Out of memory\"}";
+
+void* RequestArena::allocate(size_t size) {
+    size_t total = (sizeof(ArenaHeader) + size + 7) & ~(size_t)7;
+
+    ArenaHeader* header;
+    if (used + total <= REQUEST_ARENA_SIZE) {
+        header = (ArenaHeader*)(buffer + used);
+        used += total;
+        if (used > highWater) highWater = used;
+    } else {
+        header = (ArenaHeader*)malloc(sizeof(ArenaHeader) + size);
+        if (header == nullptr) return nullptr;
+        fallbackCount++;
+    }
+
+    header->size = size;
+    return header + 1;
+}
+
+void* RequestArena::reallocate(void* ptr, size_t size) {
+    if (ptr == nullptr) return allocate(size);
+
+    ArenaHeader* header = (ArenaHeader*)ptr - 1;
+    if (size <= header->size) {
+        header->size = size;
+        return ptr;
+    }
+
+    void* moved = allocate(size);
+    if (moved != nullptr) {
+        memcpy(moved, ptr, header->size);
+        release(ptr);
+    }
+    return moved;
+}
+
+void RequestArena::release(void* ptr) {
+    if (ptr == nullptr || contains(ptr)) return;
+    free((ArenaHeader*)ptr - 1);
+}
+
+void RequestArena::releaseText(const char* text) {
+    if (text == OUT_OF_MEMORY_JSON) return;
+    release((void*)text);
+}
+
+void RequestArena::reset() {
+    if (used > 0) resetCount++;
+    used = 0;
+}
+
+bool RequestArena::contains(const void* ptr) {
+    return ptr >= buffer && ptr < buffer + REQUEST_ARENA_SIZE;
+}
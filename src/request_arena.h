@@ -0,0 +1,78 @@
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ========================================
+// ПАМЯТЬ ОБРАБОТКИ HTTP ЗАПРОСА
+// ========================================
+//
+// Статический буфер REQUEST_ARENA_SIZE с выделением сдвигом указателя:
+// JSON документы обработчиков (ArenaJsonDocument) и тела ответов
+// (serialize) берутся из него и не освобождаются по одному - буфер
+// целиком сбрасывается после каждого прохода WebServerManager::handleClient.
+// Куча при этом не дробится блоками по несколько КБ на каждый опрос
+// /status. Если буфер заполнен, выделение идет из кучи (счетчик fallback):
+// документы освобождает ArduinoJson, тело ответа - releaseText после
+// отправки.
+//
+// Только задача loop. Данные из буфера действительны до reset/rewind.
+
+class RequestArena {
+public:
+    static void* allocate(size_t size);
+    static void* reallocate(void* ptr, size_t size);
+    static void release(void* ptr);     // Освобождает только выделенное из кучи
+    static void releaseText(const char* text);  // Тело ответа serialize
+
+    // Конец запроса: весь буфер снова свободен
+    static void reset();
+    // Вложенное использование вне запроса (тесты производительности)
+    static size_t mark() { return used; }
+    static void rewind(size_t position) { if (position <= used) used = position; }
+
+    // Признак обработки запроса (для учета выделений в MemoryMonitor)
+    static void setInRequest(bool active) { inRequest = active; }
+    static bool isInRequest() { return inRequest; }
+
+    // JSON документа в строку из буфера ("{\"error\":...}" при нехватке)
+    template <typename TDocument>
+    static const char* serialize(const TDocument& document) {
+        size_t length = measureJson(document);
+        char* text = (char*)allocate(length + 1);
+        if (text == nullptr) return OUT_OF_MEMORY_JSON;
+        serializeJson(document, text, length + 1);
+        return text;
+    }
+
+    static size_t getUsed() { return used; }
+    static size_t getCapacity() { return REQUEST_ARENA_SIZE; }
+    static size_t getHighWater() { return highWater; }
+    static unsigned long getFallbackCount() { return fallbackCount; }
+    static unsigned long getResetCount() { return resetCount; }
+
+    static const char OUT_OF_MEMORY_JSON[];
+
+private:
+    static uint8_t buffer[REQUEST_ARENA_SIZE];
+    static size_t used;
+    static size_t highWater;
+    static unsigned long fallbackCount;
+    static unsigned long resetCount;
+    static bool inRequest;
+
+    static bool contains(const void* ptr);
+};
+
+// Распределитель ArduinoJson поверх RequestArena
+struct ArenaAllocator {
+    void* allocate(size_t size) { return RequestArena::allocate(size); }
+    void deallocate(void* ptr) { RequestArena::release(ptr); }
+    void* reallocate(void* ptr, size_t size) { return RequestArena::reallocate(ptr, size); }
+};
+
+typedef BasicJsonDocument<ArenaAllocator> ArenaJsonDocument;
+
+#endif
@@ -0,0 +1,239 @@
+#include "safety_supervisor.h"
+#include "system_controller.h"
+#include "logger.h"
+#include <driver/pcnt.h>
+#include "esp_task_wdt.h"
+#include "esp_timer.h"
+
+const SystemController* SafetySupervisor::controller = nullptr;
+TaskHandle_t SafetySupervisor::taskHandle = nullptr;
+
+volatile bool SafetySupervisor::tripped = false;
+volatile SafetySupervisor::Fault SafetySupervisor::tripFault = FAULT_NONE;
+volatile unsigned long SafetySupervisor::tripTime = 0;
+volatile unsigned long SafetySupervisor::tripCount = 0;
+
+int16_t SafetySupervisor::lastFlowCounter = 0;
+unsigned long SafetySupervisor::lastFlowPulseTime = 0;
+
+volatile SafetySupervisor::Fault SafetySupervisor::injectedFault = FAULT_NONE;
+volatile int64_t SafetySupervisor::injectTimeUs = 0;
+volatile unsigned long SafetySupervisor::injectTimeMs = 0;
+volatile SafetySupervisor::Fault SafetySupervisor::lastTestFault = FAULT_NONE;
+volatile long SafetySupervisor::lastTestLatencyUs = -1;
+
+void SafetySupervisor::begin(const SystemController* systemController) {
+    if (taskHandle != nullptr) return;
+    controller = systemController;
+
+    // Сторожевой таймер задач. Ядро Arduino может уже запустить его со
+    // своими настройками - тогда подписываемся на существующий
+    esp_err_t result = esp_task_wdt_init(SUPERVISOR_WDT_TIMEOUT_S, true);
+    if (DEBUG_SERIAL && result != ESP_OK) {
+        Serial.println("Сторожевой таймер задач уже запущен, используем его настройки");
+    }
+
+    // setup выполняется в задаче loop - подписываем ее
+    esp_task_wdt_add(xTaskGetCurrentTaskHandle());
+
+    lastFlowPulseTime = millis();
+    pcnt_get_counter_value((pcnt_unit_t)FLOW_PCNT_UNIT, &lastFlowCounter);
+
+    xTaskCreatePinnedToCore(supervisorTask, "safety", SUPERVISOR_TASK_STACK_SIZE, nullptr,
+                            SUPERVISOR_TASK_PRIORITY, &taskHandle, SUPERVISOR_TASK_CORE);
+
+    if (DEBUG_SERIAL) {
+        Serial.printf("Супервизор безопасности: период %d мс, сторожевой таймер %d с\n",
+                      SUPERVISOR_PERIOD_MS, SUPERVISOR_WDT_TIMEOUT_S);
+    }
+}
+
+void SafetySupervisor::feedWatchdog() {
+    esp_task_wdt_reset();
+}
+
+void SafetySupervisor::supervisorTask(void* parameter) {
+    esp_task_wdt_add(nullptr);
+
+    TickType_t lastWake = xTaskGetTickCount();
+    while (true) {
+        if (tripped) {
+            // Повторно выключаем выходы: loop мог включить триак
+            // в момент срабатывания
+            forceSafeOutputs();
+        } else {
+            Fault fault = checkFaults();
+            if (fault != FAULT_NONE) {
+                trip(fault);
+            }
+        }
+
+        esp_task_wdt_reset();
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SUPERVISOR_PERIOD_MS));
+    }
+}
+
+SafetySupervisor::Fault SafetySupervisor::checkFaults() {
+    if (controller == nullptr) return FAULT_NONE;
+
+    const PhaseController& phase = controller->getPhaseController();
+    const SensorManager& sensors = controller->getSensors();
+    Fault injected = injectedFault;
+
+    // Отметки времени читаем до текущего времени: loop на другом ядре
+    // может обновить их между чтениями
+    unsigned long zeroCrossUs = phase.getLastZeroCrossTime();
+    unsigned long sampleMs = sensors.getLastUpdateTime();
+    int16_t flowCounter = 0;
+    pcnt_get_counter_value((pcnt_unit_t)FLOW_PCNT_UNIT, &flowCounter);
+    unsigned long currentMs = millis();
+    unsigned long currentUs = micros();
+
+    if (flowCounter != lastFlowCounter) {
+        lastFlowCounter = flowCounter;
+        lastFlowPulseTime = currentMs;
+    }
+
+    // Имитируемая неисправность начинается в момент вызова injectFault
+    if (injected == FAULT_DRY_FIRE) lastFlowPulseTime = injectTimeMs;
+    if (injected == FAULT_SENSOR_STALE) sampleMs = injectTimeMs;
+    if (injected == FAULT_ZERO_CROSS) zeroCrossUs = (unsigned long)injectTimeUs;
+
+    if (controller->getCurrentTemperature() > MAX_TEMP_SAFETY || injected == FAULT_OVER_TEMP) {
+        return FAULT_OVER_TEMP;
+    }
+
+    // Остальные проверки - только когда нагрев включен: триаки или ступени
+    // на реле. Ступень держится минимальное время включения и при триаках
+    // на 0%, поэтому без потока она тоже дает FAULT_DRY_FIRE
+    bool stagesOn = controller->getStageController().getActiveCount() > 0;
+    bool powerCommanded = (phase.getState() == PhaseController::PHASE_RUNNING &&
+                           phase.getTargetPower() >= 1.0) || stagesOn || injected != FAULT_NONE;
+    if (!powerCommanded) {
+        lastFlowPulseTime = currentMs;
+        return FAULT_NONE;
+    }
+
+    if (currentMs - sampleMs > SUPERVISOR_SENSOR_STALE_MS) {
+        return FAULT_SENSOR_STALE;
+    }
+    if (currentUs - zeroCrossUs > SUPERVISOR_ZERO_CROSS_TIMEOUT_MS * 1000UL) {
+        return FAULT_ZERO_CROSS;
+    }
+    if (currentMs - lastFlowPulseTime > SUPERVISOR_DRY_FIRE_MS) {
+        return FAULT_DRY_FIRE;
+    }
+
+    return FAULT_NONE;
+}
+
+void SafetySupervisor::trip(Fault fault) {
+    // Сначала выходы, затем учет
+    forceSafeOutputs();
+    int64_t safeTimeUs = esp_timer_get_time();
+
+    tripFault = fault;
+    tripTime = millis();
+    tripCount++;
+    tripped = true;
+
+    if (injectedFault != FAULT_NONE) {
+        lastTestFault = injectedFault;
+        lastTestLatencyUs = (long)(safeTimeUs - injectTimeUs);
+        injectedFault = FAULT_NONE;
+        LOG_W(SAFETY, "Проверка %s: выходы выключены через %ld мкс (граница %lu мс)",
+              getFaultName(lastTestFault), (long)lastTestLatencyUs, getLatencyBoundMs(lastTestFault));
+    } else {
+        LOG_E(SAFETY, "Срабатывание защиты: %s, выходы триаков выключены", getFaultName(fault));
+    }
+}
+
+void SafetySupervisor::forceSafeOutputs() {
+    digitalWrite(TRIAC_L1_PIN, LOW);
+    digitalWrite(TRIAC_L2_PIN, LOW);
+    digitalWrite(TRIAC_L3_PIN, LOW);
+
+    // Ступени на реле (stage_controller.h) - все выходы, закрепленные за ними
+    static const int relayPins[RELAY_STAGE_MAX] = RELAY_STAGE_PINS;
+    int relayCount = StageController::getOutputCount();
+    for (int i = 0; i < relayCount && i < RELAY_STAGE_MAX; i++) {
+        digitalWrite(relayPins[i], !RELAY_ACTIVE_LEVEL);
+    }
+}
+
+bool SafetySupervisor::isTripped() {
+    return tripped;
+}
+
+SafetySupervisor::Fault SafetySupervisor::getTripFault() {
+    return tripFault;
+}
+
+unsigned long SafetySupervisor::getTripTime() {
+    return tripTime;
+}
+
+unsigned long SafetySupervisor::getTripCount() {
+    return tripCount;
+}
+
+void SafetySupervisor::clearTrip() {
+    if (!tripped) return;
+    injectedFault = FAULT_NONE;
+    lastFlowPulseTime = millis();
+    tripFault = FAULT_NONE;
+    tripped = false;
+    LOG_I(SAFETY, "Защита сброшена");
+}
+
+bool SafetySupervisor::injectFault(Fault fault) {
+    if (fault <= FAULT_NONE || fault >= FAULT_COUNT || tripped || taskHandle == nullptr) return false;
+
+    injectTimeMs = millis();
+    injectTimeUs = esp_timer_get_time();
+    injectedFault = fault;
+    LOG_I(SAFETY, "Имитация неисправности: %s", getFaultName(fault));
+    return true;
+}
+
+bool SafetySupervisor::isTestPending() {
+    return injectedFault != FAULT_NONE;
+}
+
+SafetySupervisor::Fault SafetySupervisor::getLastTestFault() {
+    return lastTestFault;
+}
+
+long SafetySupervisor::getLastTestLatencyUs() {
+    return lastTestLatencyUs;
+}
+
+unsigned long SafetySupervisor::getLatencyBoundMs(Fault fault) {
+    // Время обнаружения + один период задачи (+ тик планировщика)
+    unsigned long detectMs = 0;
+    switch (fault) {
+        case FAULT_DRY_FIRE:     detectMs = SUPERVISOR_DRY_FIRE_MS; break;
+        case FAULT_SENSOR_STALE: detectMs = SUPERVISOR_SENSOR_STALE_MS; break;
+        case FAULT_ZERO_CROSS:   detectMs = SUPERVISOR_ZERO_CROSS_TIMEOUT_MS; break;
+        default:                 break;
+    }
+    return detectMs + SUPERVISOR_PERIOD_MS + portTICK_PERIOD_MS;
+}
+
+const char* SafetySupervisor::getFaultName(Fault fault) {
+    switch (fault) {
+        case FAULT_NONE:         return "none";
+        case FAULT_OVER_TEMP:    return "overtemp";
+        case FAULT_DRY_FIRE:     return "dryfire";
+        case FAULT_SENSOR_STALE: return "stale";
+        case FAULT_ZERO_CROSS:   return "zerocross";
+        default:                 return "unknown";
+    }
+}
+
+SafetySupervisor::Fault SafetySupervisor::findFault(const char* name) {
+    for (int i = FAULT_NONE + 1; i < FAULT_COUNT; i++) {
+        if (strcasecmp(getFaultName((Fault)i), name) == 0) return (Fault)i;
+    }
+    return FAULT_NONE;
+}
@@ -0,0 +1,84 @@
+#ifndef SAFETY_SUPERVISOR_H
+#define SAFETY_SUPERVISOR_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config.h"
+
+class SystemController;
+
+// Супервизор безопасности: отдельная высокоприоритетная задача на ядре 0.
+// Каждые SUPERVISOR_PERIOD_MS проверяет перегрев, нагрев без потока
+// (по аппаратному счетчику импульсов), устаревшие показания датчиков и
+// отсутствие пересечений нуля. При неисправности выходы триаков
+// принудительно выключаются и остаются выключенными до сброса ошибки
+// контроллера (состояние ERROR -> Reset).
+//
+// Главный цикл и супервизор подписаны на сторожевой таймер задач:
+// если один из них не отметился за SUPERVISOR_WDT_TIMEOUT_S, ESP32
+// перезагружается (при сбросе GPIO триаков переходят в высокоимпедансное
+// состояние).
+class SafetySupervisor {
+public:
+    enum Fault {
+        FAULT_NONE,
+        FAULT_OVER_TEMP,        // Температура выше MAX_TEMP_SAFETY
+        FAULT_DRY_FIRE,         // Мощность без потока
+        FAULT_SENSOR_STALE,     // Датчики не обновляются (loop завис)
+        FAULT_ZERO_CROSS,       // Нет сигнала детектора нуля
+        FAULT_COUNT
+    };
+
+    // Запуск задачи и сторожевого таймера (вызывать из setup)
+    static void begin(const SystemController* controller);
+
+    // Отметка главного цикла для сторожевого таймера
+    static void feedWatchdog();
+    static TaskHandle_t getTaskHandle() { return taskHandle; }
+
+    // Состояние защиты
+    static bool isTripped();
+    static Fault getTripFault();
+    static unsigned long getTripTime();       // millis() срабатывания
+    static unsigned long getTripCount();
+    static void clearTrip();
+
+    // Проверка: имитация неисправности и измерение времени до выключения
+    // выходов. Условие неисправности считается начавшимся в момент вызова
+    static bool injectFault(Fault fault);
+    static bool isTestPending();
+    static Fault getLastTestFault();
+    static long getLastTestLatencyUs();       // -1 - проверок не было
+    static unsigned long getLatencyBoundMs(Fault fault);
+
+    static const char* getFaultName(Fault fault);
+    static Fault findFault(const char* name);  // FAULT_NONE, если не найдена
+
+private:
+    static const SystemController* controller;
+    static TaskHandle_t taskHandle;
+
+    static volatile bool tripped;
+    static volatile Fault tripFault;
+    static volatile unsigned long tripTime;
+    static volatile unsigned long tripCount;
+
+    // Собственный учет импульсов потока (независимо от loop)
+    static int16_t lastFlowCounter;
+    static unsigned long lastFlowPulseTime;
+
+    // Режим проверки
+    static volatile Fault injectedFault;
+    static volatile int64_t injectTimeUs;
+    static volatile unsigned long injectTimeMs;
+    static volatile Fault lastTestFault;
+    static volatile long lastTestLatencyUs;
+
+    static void supervisorTask(void* parameter);
+    static Fault checkFaults();
+    static void trip(Fault fault);
+    static void forceSafeOutputs();
+};
+
+#endif
@@ -1,60 +1,115 @@
 #include "sensors.h"
 #include "config.h"
-
-// Статический указатель для обработчика прерывания
-FlowSensor* FlowSensor::instance = nullptr;
+#include "logger.h"
+#include "config_storage.h"
+#include "config_registry.h"
+#include "perf_profiler.h"
+#include "control_io.h"
+#include "mains_sensing.h"
 
 // ========================================
 // FLOW SENSOR IMPLEMENTATION
 // ========================================
 
-FlowSensor::FlowSensor() : pin(-1), pulseCount(0), lastPulseTime(0), 
-                           lastFlowTime(0), flowRate(0.0), isFlowDetected(false) {
+FlowSensor::FlowSensor() : pin(-1), pulseCount(0), totalPulses(0), lastCounterValue(0),
+                           lastPulseTime(0), lastFlowTime(0), lastUpdateTime(0), lastDebugTime(0),
+                           flowRate(0.0), pulseFrequency(0.0), isFlowDetected(false),
+                           pulsesPerLiter(PULSES_PER_LITER), curvePointCount(0),
+                           calibrating(false), calibrationPulses(0), calibrationStartMs(0), calibrationEndMs(0) {
 }
 
 void FlowSensor::begin(int sensorPin) {
     pin = sensorPin;
-    pinMode(pin, INPUT_PULLUP);
-    
-    // Сохраняем указатель на экземпляр для ISR
-    instance = this;
     
-    // Настраиваем прерывание на изменение состояния пина
-    attachInterrupt(digitalPinToInterrupt(pin), pulseISR, FALLING);
+    // При воспроизведении трассы оборудование не настраивается
+    if (!ControlIO::isReplaying()) {
+        pinMode(pin, INPUT_PULLUP);
+        
+        // Импульсы считает аппаратный счетчик PCNT: ни один импульс не теряется
+        // и не требует прерывания на каждый фронт
+        pcnt_config_t pcntConfig = {};
+        pcntConfig.pulse_gpio_num = pin;
+        pcntConfig.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+        pcntConfig.lctrl_mode = PCNT_MODE_KEEP;
+        pcntConfig.hctrl_mode = PCNT_MODE_KEEP;
+        pcntConfig.pos_mode = PCNT_COUNT_DIS;
+        pcntConfig.neg_mode = PCNT_COUNT_INC;     // Счет по спаду, как прежде в прерывании
+        pcntConfig.counter_h_lim = FLOW_PCNT_LIMIT;
+        pcntConfig.counter_l_lim = 0;
+        pcntConfig.unit = (pcnt_unit_t)FLOW_PCNT_UNIT;
+        pcntConfig.channel = PCNT_CHANNEL_0;
+        pcnt_unit_config(&pcntConfig);
+        
+        // Аппаратный фильтр помех вместо программной защиты от дребезга
+        pcnt_set_filter_value((pcnt_unit_t)FLOW_PCNT_UNIT, FLOW_PCNT_FILTER);
+        pcnt_filter_enable((pcnt_unit_t)FLOW_PCNT_UNIT);
+        
+        pcnt_counter_pause((pcnt_unit_t)FLOW_PCNT_UNIT);
+        pcnt_counter_clear((pcnt_unit_t)FLOW_PCNT_UNIT);
+        pcnt_counter_resume((pcnt_unit_t)FLOW_PCNT_UNIT);
+    }
     
     pulseCount = 0;
-    lastPulseTime = millis();
-    lastFlowTime = millis();
+    totalPulses = 0;
+    lastCounterValue = ControlIO::readFlowCounter();
+    lastPulseTime = ControlIO::nowMs();
+    lastFlowTime = ControlIO::nowMs();
+    lastUpdateTime = ControlIO::nowMs();
     flowRate = 0.0;
+    pulseFrequency = 0.0;
     isFlowDetected = false;
 }
 
+unsigned long FlowSensor::readPulses() {
+    // Счетчик не сбрасываем (сброс между чтениями терял бы импульсы):
+    // берем разность по модулю предела, при котором PCNT обнуляется
+    int16_t counter = ControlIO::readFlowCounter();
+    long delta = ((long)counter - lastCounterValue + FLOW_PCNT_LIMIT) % FLOW_PCNT_LIMIT;
+    lastCounterValue = counter;
+    return (unsigned long)delta;
+}
+
 void FlowSensor::update() {
-    unsigned long currentTime = millis();
+    unsigned long currentTime = ControlIO::nowMs();
+    
+    unsigned long newPulses = readPulses();
+    if (newPulses > 0) {
+        // Первые импульсы после паузы - окно измерения начинается с прошлого опроса
+        if (pulseCount == 0) {
+            lastFlowTime = lastUpdateTime;
+        }
+        pulseCount += newPulses;
+        totalPulses += newPulses;
+        lastPulseTime = currentTime;
+        
+        // Прогон калибровки - от первого до последнего импульса, включая
+        // опросы без импульсов (как окно измерения потока): иначе на малом
+        // потоке частота завышается в разы
+        if (calibrating) {
+            if (calibrationPulses == 0) {
+                calibrationStartMs = lastUpdateTime;
+            }
+            calibrationPulses += newPulses;
+            calibrationEndMs = currentTime;
+        }
+    }
+    lastUpdateTime = currentTime;
     
     // Отладочная информация каждые 3 секунды
-    static unsigned long lastDebugTime = 0;
-    if (currentTime - lastDebugTime > 3000) {
-        Serial.println("--- ДАТЧИК ПОТОКА ---");
-        Serial.print("Импульсы: ");
-        Serial.print(pulseCount);
-        Serial.print(", Последний импульс: ");
-        Serial.print(currentTime - lastPulseTime);
-        Serial.println(" мс назад");
-        Serial.print("Сырое значение пина: ");
-        Serial.println(digitalRead(pin) ? "HIGH" : "LOW");
-        Serial.print("Скорость потока: ");
-        Serial.print(flowRate, 2);
-        Serial.print(" л/мин, Обнаружен: ");
-        Serial.println(isFlowDetected ? "ДА" : "НЕТ");
-        Serial.println("--------------------");
-        lastDebugTime = currentTime;
+    if (LOG_ENABLED(FLOW, LOG_LEVEL_DEBUG)) {
+        if (currentTime - lastDebugTime > 3000) {
+            LOG_D(FLOW, "Импульсы: %lu, последний импульс: %lu мс назад, пин: %s, поток: %.2f л/мин, обнаружен: %s",
+                  (unsigned long)pulseCount, currentTime - lastPulseTime,
+                  digitalRead(pin) ? "HIGH" : "LOW", flowRate, isFlowDetected ? "ДА" : "НЕТ");
+            lastDebugTime = currentTime;
+        }
     }
     
     // Проверяем таймаут потока
     if (currentTime - lastPulseTime > FLOW_TIMEOUT_MS_DEFAULT) {
         // Если прошло слишком много времени без импульсов - сбрасываем поток
         flowRate = 0.0;
+        pulseFrequency = 0.0;
         isFlowDetected = false;
         
         // Сбрасываем счетчик импульсов для следующего измерения
@@ -67,9 +122,9 @@ void FlowSensor::update() {
         if (pulseCount > 0) {
             unsigned long timeDiff = currentTime - lastFlowTime;
             if (timeDiff > 1000) { // Минимум 1 секунда для расчета
-                // Конвертируем импульсы в литры в минуту
-                float pulsesPerMinute = (pulseCount * 60000.0) / timeDiff;
-                flowRate = pulsesPerMinute / PULSES_PER_LITER_DEFAULT;
+                // Коэффициент зависит от частоты импульсов (кривая калибровки)
+                pulseFrequency = (pulseCount * 1000.0) / timeDiff;
+                flowRate = pulseFrequency * 60.0 / getPulsesPerLiter(pulseFrequency);
                 
                 // Проверяем минимальный порог потока
                 isFlowDetected = (flowRate > FLOW_THRESHOLD_MIN);
@@ -94,41 +149,150 @@ unsigned long FlowSensor::getPulseCount() const {
     return pulseCount;
 }
 
+unsigned long FlowSensor::getTotalPulses() const {
+    return totalPulses;
+}
+
+float FlowSensor::getPulseFrequency() const {
+    return pulseFrequency;
+}
+
+void FlowSensor::setPulsesPerLiter(float factor) {
+    if (factor > 0) {
+        pulsesPerLiter = factor;
+    }
+}
+
+float FlowSensor::getPulsesPerLiter(float frequencyHz) const {
+    if (curvePointCount < 2) return pulsesPerLiter;
+    
+    // За пределами измеренного диапазона - коэффициент крайней точки
+    if (frequencyHz <= curve[0].frequencyHz) return curve[0].pulsesPerLiter;
+    const FlowCalibrationPoint& last = curve[curvePointCount - 1];
+    if (frequencyHz >= last.frequencyHz) return last.pulsesPerLiter;
+    
+    // Линейная интерполяция между соседними точками
+    int i = 1;
+    while (curve[i].frequencyHz < frequencyHz) i++;
+    const FlowCalibrationPoint& a = curve[i - 1];
+    const FlowCalibrationPoint& b = curve[i];
+    float t = (frequencyHz - a.frequencyHz) / (b.frequencyHz - a.frequencyHz);
+    return a.pulsesPerLiter + t * (b.pulsesPerLiter - a.pulsesPerLiter);
+}
+
+void FlowSensor::setCurve(const FlowCalibrationPoint* points, int count) {
+    clearCurve();
+    for (int i = 0; i < count && i < FLOW_CURVE_MAX_POINTS; i++) {
+        addCurvePoint(points[i]);
+    }
+}
+
+int FlowSensor::getCurve(FlowCalibrationPoint* points) const {
+    for (int i = 0; i < curvePointCount; i++) {
+        points[i] = curve[i];
+    }
+    return curvePointCount;
+}
+
+void FlowSensor::addCurvePoint(const FlowCalibrationPoint& point) {
+    if (point.frequencyHz <= 0 || point.pulsesPerLiter <= 0) return;
+    
+    // Повторный пролив при близком расходе заменяет прежнюю точку
+    int nearest = -1;
+    float nearestDistance = 0;
+    for (int i = 0; i < curvePointCount; i++) {
+        float distance = fabs(curve[i].frequencyHz - point.frequencyHz);
+        if (nearest < 0 || distance < nearestDistance) {
+            nearest = i;
+            nearestDistance = distance;
+        }
+    }
+    bool replace = nearest >= 0 &&
+                   (nearestDistance <= point.frequencyHz * FLOW_CAL_MERGE_RATIO ||
+                    curvePointCount >= FLOW_CURVE_MAX_POINTS);
+    if (replace) {
+        // Удаляем заменяемую точку
+        for (int i = nearest; i < curvePointCount - 1; i++) {
+            curve[i] = curve[i + 1];
+        }
+        curvePointCount--;
+    }
+    
+    // Вставка с сохранением порядка по частоте
+    int position = curvePointCount;
+    while (position > 0 && curve[position - 1].frequencyHz > point.frequencyHz) {
+        curve[position] = curve[position - 1];
+        position--;
+    }
+    curve[position] = point;
+    curvePointCount++;
+}
+
+void FlowSensor::clearCurve() {
+    curvePointCount = 0;
+}
+
+void FlowSensor::startCalibration() {
+    calibrating = true;
+    calibrationPulses = 0;
+    calibrationStartMs = 0;
+    calibrationEndMs = 0;
+}
+
+void FlowSensor::cancelCalibration() {
+    calibrating = false;
+}
+
+bool FlowSensor::finishCalibration(float volumeLiters, FlowCalibrationPoint& point) {
+    if (!calibrating || volumeLiters <= 0) return false;
+    
+    // Досчитываем импульсы, пришедшие после последнего опроса
+    update();
+    calibrating = false;
+    unsigned long flowMs = calibrationEndMs - calibrationStartMs;
+    if (calibrationPulses == 0 || flowMs == 0) return false;
+    
+    point.pulsesPerLiter = calibrationPulses / volumeLiters;
+    point.frequencyHz = calibrationPulses * 1000.0 / flowMs;
+    return true;
+}
+
+bool FlowSensor::isCalibrating() const {
+    return calibrating;
+}
+
+unsigned long FlowSensor::getCalibrationPulses() const {
+    return calibrationPulses;
+}
+
 unsigned long FlowSensor::getLastPulseTime() const {
     return lastPulseTime;
 }
 
 unsigned long FlowSensor::getTimeSinceLastPulse() const {
-    return millis() - lastPulseTime;
+    return ControlIO::nowMs() - lastPulseTime;
 }
 
 bool FlowSensor::isPinActive() const {
     return digitalRead(pin) == LOW; // Датчик активен при LOW (подключен к GND через резистор)
 }
 
-void IRAM_ATTR FlowSensor::pulseISR() {
-    if (instance != nullptr) {
-        unsigned long currentTime = millis();
-        
-        // Проверяем минимальный интервал между импульсами (защита от дребезга)
-        if (currentTime - instance->lastPulseTime > MIN_PULSE_INTERVAL_MS_DEFAULT) {
-            instance->pulseCount++;
-            instance->lastPulseTime = currentTime;
-            
-            // Если это первый импульс после таймаута - обновляем время начала измерения
-            if (instance->pulseCount == 1) {
-                instance->lastFlowTime = currentTime;
-            }
-        }
-    }
-}
-
 // ========================================
 // TEMPERATURE SENSOR IMPLEMENTATION
 // ========================================
 
-TemperatureSensor::TemperatureSensor() : pin(-1), temperature(25.0), 
-                                        lastReadTime(0), historyIndex(0), 
+// Параметры каналов: порядок совпадает с TemperatureChannel
+static const TemperatureChannelConfig TEMP_CHANNELS[TEMP_CHANNEL_COUNT] = {
+    { "outlet", NTC_PIN, NOMINAL_RESISTANCE, BETA_COEFFICIENT, SERIES_RESISTANCE },
+#if INLET_NTC_ENABLED
+    { "inlet", INLET_NTC_PIN, INLET_NOMINAL_RESISTANCE, INLET_BETA_COEFFICIENT, SERIES_RESISTANCE },
+#else
+    { "inlet", -1, INLET_NOMINAL_RESISTANCE, INLET_BETA_COEFFICIENT, SERIES_RESISTANCE },
+#endif
+};
+
+TemperatureSensor::TemperatureSensor() : config(nullptr), temperature(25.0), offset(0.0),
+                                        rawValue(0), connected(false), historyIndex(0),
                                         historyFilled(false) {
     // Инициализируем историю температур
     for (int i = 0; i < FILTER_SAMPLES_DEFAULT; i++) {
@@ -136,63 +300,62 @@ TemperatureSensor::TemperatureSensor() : pin(-1), temperature(25.0),
     }
 }
 
-void TemperatureSensor::begin(int sensorPin) {
-    pin = sensorPin;
-    pinMode(pin, INPUT);
+void TemperatureSensor::begin(const TemperatureChannelConfig& channelConfig) {
+    config = &channelConfig;
+    if (config->pin >= 0) {
+        pinMode(config->pin, INPUT);
+    }
     
     temperature = 25.0;
-    lastReadTime = 0;
+    rawValue = 0;
+    connected = false;
     historyIndex = 0;
     historyFilled = false;
 }
 
-void TemperatureSensor::update() {
-    unsigned long currentTime = millis();
-    
-    // Обновляем температуру каждые 100мс
-    if (currentTime - lastReadTime >= 100) {
-        float rawTemp = readRawTemperature();
-        temperature = applyFilter(rawTemp);
-        lastReadTime = currentTime;
-    }
-    
-    // Отладочная информация каждые 5 секунд
-    static unsigned long lastDebugTime = 0;
-    if (currentTime - lastDebugTime > 5000) {
-        Serial.println("--- ДАТЧИК ТЕМПЕРАТУРЫ ---");
-        Serial.print("Сырое значение ADC: ");
-        Serial.println(getRawValue());
-        Serial.print("Температура: ");
-        Serial.print(temperature, 1);
-        Serial.println("°C");
-        Serial.println("---------------------------");
-        lastDebugTime = currentTime;
-    }
+void TemperatureSensor::update(int adcValue) {
+    rawValue = adcValue;
+    connected = adcValue >= TEMP_ADC_MIN_VALID && adcValue <= TEMP_ADC_MAX_VALID;
+    temperature = applyFilter(convertToTemperature(adcValue));
 }
 
 float TemperatureSensor::getTemperature() const {
-    return temperature;
+    return temperature + offset;
 }
 
 float TemperatureSensor::getRawValue() const {
-    return analogRead(pin);
+    return rawValue;
 }
 
-float TemperatureSensor::readRawTemperature() {
-    int rawValue = analogRead(pin);
-    
+bool TemperatureSensor::isConnected() const {
+    return connected;
+}
+
+const TemperatureChannelConfig& TemperatureSensor::getConfig() const {
+    return *config;
+}
+
+void TemperatureSensor::setOffset(float offsetC) {
+    offset = offsetC;
+}
+
+float TemperatureSensor::getOffset() const {
+    return offset;
+}
+
+float TemperatureSensor::convertToTemperature(int adcValue) const {
     // Конвертируем ADC значение в напряжение
-    float voltage = rawValue * (3.3 / 4095.0);
+    float voltage = adcValue * (3.3 / 4095.0);
     
     // Рассчитываем сопротивление NTC
-    float resistance = (SERIES_RESISTANCE_DEFAULT * voltage) / (3.3 - voltage);
+    float resistance = (config->seriesResistance * voltage) / (3.3 - voltage);
     
     // Рассчитываем температуру по формуле Стейнхарта-Харта
-    float tempK = 1.0 / (log(resistance / NOMINAL_RESISTANCE_DEFAULT) / BETA_COEFFICIENT_DEFAULT + 1.0 / (NOMINAL_TEMP_DEFAULT + 273.15));
+    float tempK = 1.0 / (log(resistance / config->nominalResistance) / config->betaCoefficient + 1.0 / (NOMINAL_TEMP_DEFAULT + 273.15));
     float tempC = tempK - 273.15;
     
-    // Ограничиваем разумными пределами
-    if (tempC < -10.0) tempC = -10.0;
+    // Ограничиваем разумными пределами (также при обрыве и замыкании)
+    if (!(tempC >= -10.0)) tempC = -10.0;
     if (tempC > 100.0) tempC = 100.0;
     
     return tempC;
@@ -222,35 +385,160 @@ float TemperatureSensor::applyFilter(float newValue) {
 // SENSOR MANAGER IMPLEMENTATION
 // ========================================
 
-SensorManager::SensorManager() : sensorsInitialized(false), lastUpdateTime(0) {
+SensorManager::SensorManager() : deliveredPowerW(0.0), inletEstimate(INLET_TEMP_DEFAULT),
+                                 inletEstimateValid(false), steadySince(0), slopeReferenceTime(0),
+                                 slopeReferenceTemp(0.0), slopeReferencePower(0.0),
+                                 sensorsInitialized(false), lastUpdateTime(0), lastDebugTime(0) {
 }
 
 void SensorManager::begin() {
     flowSensor.begin();
-    tempSensor.begin();
+    for (int ch = 0; ch < TEMP_CHANNEL_COUNT; ch++) {
+        tempSensors[ch].begin(TEMP_CHANNELS[ch]);
+    }
+    
+    // Кривая калибровки датчика потока
+    FlowCalibrationPoint points[FLOW_CURVE_MAX_POINTS];
+    int count = 0;
+    if (ConfigStorage::loadFlowCurve(points, count)) {
+        flowSensor.setCurve(points, count);
+        if (DEBUG_SERIAL) {
+            Serial.printf("Кривая калибровки датчика потока: %d точек\n", count);
+        }
+    }
+    
     sensorsInitialized = true;
-    lastUpdateTime = millis();
+    lastUpdateTime = ControlIO::nowMs();
+    steadySince = lastUpdateTime;
+    slopeReferenceTime = lastUpdateTime;
 }
 
 void SensorManager::update() {
+    PERF_SCOPE(PERF_SENSORS_UPDATE);
+    
     if (!sensorsInitialized) return;
     
-    unsigned long currentTime = millis();
+    unsigned long currentTime = ControlIO::nowMs();
     
     // Обновляем датчики с заданным интервалом
     if (currentTime - lastUpdateTime >= UPDATE_INTERVAL_MS) {
         flowSensor.update();
-        tempSensor.update();
+        sampleTemperatures();
+        updateInletEstimate(currentTime);
         lastUpdateTime = currentTime;
     }
 }
 
+void SensorManager::sampleTemperatures() {
+    // Один проход АЦП по всем каналам: выборки каналов чередуются, чтобы
+    // все каналы усреднялись по одному и тому же интервалу времени
+    uint32_t sums[TEMP_CHANNEL_COUNT] = { 0 };
+    if (!ControlIO::isReplaying()) {
+#if MAINS_SENSING_ENABLED
+        // АЦП1 занят DMA измерения сети: NTC на выходе входит в его шаблон,
+        // отсчет уже усреднен за полупериод
+        sums[TEMP_CHANNEL_OUTLET] = (uint32_t)MainsSensing::getAuxAdc() * TEMP_ADC_OVERSAMPLE;
+#else
+        for (int sample = 0; sample < TEMP_ADC_OVERSAMPLE; sample++) {
+            for (int ch = 0; ch < TEMP_CHANNEL_COUNT; ch++) {
+                if (TEMP_CHANNELS[ch].pin >= 0) {
+                    sums[ch] += analogRead(TEMP_CHANNELS[ch].pin);
+                }
+            }
+        }
+#endif
+    }
+    
+    // Отсчет проходит через ControlIO: запись трассы или значение из нее
+    for (int ch = 0; ch < TEMP_CHANNEL_COUNT; ch++) {
+        if (TEMP_CHANNELS[ch].pin >= 0) {
+            tempSensors[ch].update(ControlIO::adcSample(ch, sums[ch] / TEMP_ADC_OVERSAMPLE));
+        }
+    }
+    
+    // Отладочная информация каждые 5 секунд
+    if (LOG_ENABLED(TEMP, LOG_LEVEL_DEBUG)) {
+        if (ControlIO::nowMs() - lastDebugTime > 5000) {
+            LOG_D(TEMP, "ADC: выход %.0f (%.1f°C), вход %.0f (%.1f°C, %s)",
+                  tempSensors[TEMP_CHANNEL_OUTLET].getRawValue(), getTemperature(),
+                  tempSensors[TEMP_CHANNEL_INLET].getRawValue(), getInletTemperature(),
+                  isInletMeasured() ? "датчик" : "оценка");
+            lastDebugTime = ControlIO::nowMs();
+        }
+    }
+}
+
+void SensorManager::updateInletEstimate(unsigned long currentTime) {
+    // Установившийся режим: есть поток, температура на выходе и мощность
+    // почти не меняются. Проверяем раз в секунду
+    if (currentTime - slopeReferenceTime < 1000) return;
+    
+    float outletTemp = getTemperature();
+    float dt = (currentTime - slopeReferenceTime) / 1000.0;
+    float slope = fabs(outletTemp - slopeReferenceTemp) / dt;
+    float powerChange = fabs(deliveredPowerW - slopeReferencePower);
+    bool powerStable = powerChange <= INLET_ESTIMATE_MAX_POWER_CHANGE * max(slopeReferencePower, 100.0f);
+    
+    slopeReferenceTime = currentTime;
+    slopeReferenceTemp = outletTemp;
+    slopeReferencePower = deliveredPowerW;
+    
+    if (!flowSensor.isWaterFlowing() || slope > INLET_ESTIMATE_MAX_SLOPE || !powerStable) {
+        steadySince = currentTime;
+        return;
+    }
+    if (currentTime - steadySince < INLET_ESTIMATE_SETTLE_MS) return;
+    
+    // Массовый расход: 1 л воды ~ 1 кг
+    float massFlowKgS = flowSensor.getFlowRate() / 60.0;
+    float estimate = outletTemp - deliveredPowerW / (massFlowKgS * WATER_HEAT_CAPACITY);
+    if (estimate < 0.0) estimate = 0.0;
+    
+    if (inletEstimateValid) {
+        inletEstimate += INLET_ESTIMATE_FILTER * (estimate - inletEstimate);
+    } else {
+        inletEstimate = estimate;
+        inletEstimateValid = true;
+    }
+}
+
 float SensorManager::getFlowRate() const {
     return flowSensor.getFlowRate();
 }
 
 float SensorManager::getTemperature() const {
-    return tempSensor.getTemperature();
+    return tempSensors[TEMP_CHANNEL_OUTLET].getTemperature();
+}
+
+float SensorManager::getChannelTemperature(TemperatureChannel channel) const {
+    return tempSensors[channel].getTemperature();
+}
+
+const TemperatureSensor& SensorManager::getTemperatureSensor(TemperatureChannel channel) const {
+    return tempSensors[channel];
+}
+
+void SensorManager::setTemperatureOffset(TemperatureChannel channel, float offsetC) {
+    tempSensors[channel].setOffset(offsetC);
+}
+
+float SensorManager::getInletTemperature() const {
+    if (isInletMeasured()) {
+        return tempSensors[TEMP_CHANNEL_INLET].getTemperature();
+    }
+    return inletEstimate;
+}
+
+bool SensorManager::isInletMeasured() const {
+    return TEMP_CHANNELS[TEMP_CHANNEL_INLET].pin >= 0 && tempSensors[TEMP_CHANNEL_INLET].isConnected();
+}
+
+bool SensorManager::isInletEstimateValid() const {
+    return inletEstimateValid;
+}
+
+void SensorManager::setDeliveredPower(float watts) {
+    deliveredPowerW = watts;
 }
 
 bool SensorManager::isWaterFlowing() const {
@@ -261,30 +549,88 @@ bool SensorManager::isInitialized() const {
     return sensorsInitialized;
 }
 
+unsigned long SensorManager::getLastUpdateTime() const {
+    return lastUpdateTime;
+}
+
 // Методы для калибровки и управления потоком
 void SensorManager::setCalibrationFactor(float factor) {
-    // Передаем коэффициент калибровки в датчик потока
-    // Пока что просто сохраняем в переменную, так как FlowSensor не имеет этого метода
+    flowSensor.setPulsesPerLiter(factor);
     if (DEBUG_SERIAL) {
         Serial.println("Коэффициент калибровки потока установлен: " + String(factor, 2) + " имп/л");
     }
 }
 
-void SensorManager::calibrateFlowSensor() {
-    if (DEBUG_SERIAL) {
-        Serial.println("Запуск калибровки датчика потока...");
-    }
+float SensorManager::getCalibrationFactor() const {
+    // Действующий коэффициент при текущем расходе
+    return flowSensor.getPulsesPerLiter(flowSensor.getPulseFrequency());
+}
+
+void SensorManager::startFlowCalibration() {
+    flowSensor.startCalibration();
+    LOG_I(FLOW, "Калибровка: пролейте известный объем воды и введите его");
+}
+
+void SensorManager::cancelFlowCalibration() {
+    flowSensor.cancelCalibration();
+    LOG_I(FLOW, "Калибровка отменена");
+}
+
+SensorManager::CalibrationResult SensorManager::finishFlowCalibration(float volumeLiters, FlowCalibrationPoint& point) {
+    if (!flowSensor.isCalibrating()) return CAL_NOT_ACTIVE;
+    if (volumeLiters <= 0) return CAL_INVALID_VOLUME;
     
-    // Простая калибровка - устанавливаем стандартное значение
-    // В реальной реализации здесь должна быть логика калибровки
-    if (DEBUG_SERIAL) {
-        Serial.println("Калибровка датчика потока завершена");
+    if (!flowSensor.finishCalibration(volumeLiters, point) ||
+        flowSensor.getCalibrationPulses() < FLOW_CAL_MIN_PULSES) {
+        return CAL_TOO_FEW_PULSES;
     }
+    if (!ConfigRegistry::isInRange(PARAM_FLOW_CALIBRATION, point.pulsesPerLiter)) {
+        return CAL_OUT_OF_RANGE;
+    }
+    
+    // Точка кривой и коэффициент последнего пролива (используется, пока
+    // в кривой меньше двух точек)
+    flowSensor.addCurvePoint(point);
+    flowSensor.setPulsesPerLiter(point.pulsesPerLiter);
+    ConfigRegistry::set(PARAM_FLOW_CALIBRATION, point.pulsesPerLiter);
+    ConfigStorage::saveConfig();
+    
+    FlowCalibrationPoint points[FLOW_CURVE_MAX_POINTS];
+    int count = flowSensor.getCurve(points);
+    ConfigStorage::saveFlowCurve(points, count);
+    
+    LOG_I(FLOW, "Калибровка: %lu имп на %.3f л, %.1f Гц -> %.1f имп/л (точек кривой: %d)",
+          flowSensor.getCalibrationPulses(), volumeLiters, point.frequencyHz, point.pulsesPerLiter, count);
+    return CAL_OK;
 }
 
-float SensorManager::getCalibrationFactor() const {
-    // Возвращаем стандартный коэффициент калибровки
-    return FLOW_CALIBRATION_FACTOR;
+void SensorManager::clearFlowCalibrationCurve() {
+    flowSensor.clearCurve();
+    ConfigStorage::saveFlowCurve(nullptr, 0);
+    LOG_I(FLOW, "Кривая калибровки очищена");
+}
+
+bool SensorManager::isFlowCalibrationActive() const {
+    return flowSensor.isCalibrating();
+}
+
+unsigned long SensorManager::getFlowCalibrationPulses() const {
+    return flowSensor.getCalibrationPulses();
+}
+
+int SensorManager::getFlowCalibrationCurve(FlowCalibrationPoint* points) const {
+    return flowSensor.getCurve(points);
+}
+
+const char* SensorManager::getCalibrationResultText(CalibrationResult result) {
+    switch (result) {
+        case CAL_OK:             return "калибровка выполнена";
+        case CAL_NOT_ACTIVE:     return "калибровка не запущена";
+        case CAL_INVALID_VOLUME: return "объем должен быть больше нуля";
+        case CAL_TOO_FEW_PULSES: return "слишком мало импульсов, пролейте больший объем";
+        case CAL_OUT_OF_RANGE:   return "коэффициент вне допустимого диапазона";
+        default:                 return "ошибка";
+    }
 }
 
 unsigned long SensorManager::getFlowPulseCount() const {
@@ -292,26 +638,35 @@ unsigned long SensorManager::getFlowPulseCount() const {
     return flowSensor.getPulseCount();
 }
 
-void SensorManager::printFlowSensorDiagnostics() const {
-    Serial.println("=== ДИАГНОСТИКА ДАТЧИКА ПОТОКА ===");
-    Serial.print("Пин датчика: ");
-    Serial.println(FLOW_SENSOR_PIN);
-    Serial.print("Состояние пина: ");
-    Serial.println(flowSensor.isPinActive() ? "АКТИВЕН (LOW)" : "НЕАКТИВЕН (HIGH)");
-    Serial.print("Количество импульсов: ");
-    Serial.println(flowSensor.getPulseCount());
-    Serial.print("Время последнего импульса: ");
-    Serial.print(flowSensor.getTimeSinceLastPulse());
-    Serial.println(" мс назад");
-    Serial.print("Скорость потока: ");
-    Serial.print(flowSensor.getFlowRate(), 2);
-    Serial.println(" л/мин");
-    Serial.print("Поток обнаружен: ");
-    Serial.println(flowSensor.isWaterFlowing() ? "ДА" : "НЕТ");
-    Serial.print("Коэффициент калибровки: ");
-    Serial.print(getCalibrationFactor(), 1);
-    Serial.println(" имп/л");
-    Serial.println("=====================================");
+unsigned long SensorManager::getFlowTotalPulses() const {
+    return flowSensor.getTotalPulses();
+}
+
+void SensorManager::printFlowSensorDiagnostics(Print& out) const {
+    out.println("=== ДИАГНОСТИКА ДАТЧИКА ПОТОКА ===");
+    out.print("Пин датчика: ");
+    out.println(FLOW_SENSOR_PIN);
+    out.print("Состояние пина: ");
+    out.println(flowSensor.isPinActive() ? "АКТИВЕН (LOW)" : "НЕАКТИВЕН (HIGH)");
+    out.print("Количество импульсов: ");
+    out.println(flowSensor.getPulseCount());
+    out.print("Время последнего импульса: ");
+    out.print(flowSensor.getTimeSinceLastPulse());
+    out.println(" мс назад");
+    out.print("Скорость потока: ");
+    out.print(flowSensor.getFlowRate(), 2);
+    out.println(" л/мин");
+    out.print("Поток обнаружен: ");
+    out.println(flowSensor.isWaterFlowing() ? "ДА" : "НЕТ");
+    out.print("Коэффициент калибровки: ");
+    out.print(getCalibrationFactor(), 1);
+    out.println(" имп/л");
+    FlowCalibrationPoint points[FLOW_CURVE_MAX_POINTS];
+    int count = flowSensor.getCurve(points);
+    for (int i = 0; i < count; i++) {
+        out.printf("  Точка %d: %.1f Гц -> %.1f имп/л\n", i + 1, points[i].frequencyHz, points[i].pulsesPerLiter);
+    }
+    out.println("=====================================");
 }
 
 bool SensorManager::isFlowSensorWorking() const {
@@ -2,21 +2,42 @@
 #define SENSORS_H
 
 #include <Arduino.h>
+#include <driver/pcnt.h>
 #include "config.h"
 
+// Точка кривой калибровки: коэффициент датчика при данной частоте импульсов.
+// Турбинные датчики нелинейны на малом расходе, поэтому коэффициент
+// интерполируется по частоте между точками
+struct FlowCalibrationPoint {
+    float frequencyHz;          // Средняя частота импульсов за пролив
+    float pulsesPerLiter;       // Измеренный коэффициент (имп/л)
+};
+
 class FlowSensor {
 private:
     int pin;
-    volatile unsigned long pulseCount;
-    volatile unsigned long lastPulseTime;
+    unsigned long pulseCount;           // Импульсы текущего окна измерения
+    unsigned long totalPulses;          // Импульсы с момента запуска
+    int16_t lastCounterValue;           // Последнее показание PCNT
+    unsigned long lastPulseTime;
     unsigned long lastFlowTime;
+    unsigned long lastUpdateTime;
+    unsigned long lastDebugTime;
     float flowRate; // л/мин
+    float pulseFrequency; // Гц
     bool isFlowDetected;
     
+    // Калибровка
+    float pulsesPerLiter;               // Коэффициент из настроек
+    FlowCalibrationPoint curve[FLOW_CURVE_MAX_POINTS]; // По возрастанию частоты
+    int curvePointCount;
+    bool calibrating;
+    unsigned long calibrationPulses;
+    unsigned long calibrationStartMs;   // Опрос перед первым импульсом
+    unsigned long calibrationEndMs;     // Опрос с последним импульсом
+    
     // Настройки датчика
-    static constexpr float PULSES_PER_LITER_DEFAULT = PULSES_PER_LITER; // Импульсов на литр
     static constexpr unsigned long FLOW_TIMEOUT_MS_DEFAULT = FLOW_TIMEOUT_MS; // Таймаут отсутствия потока
-    static constexpr unsigned long MIN_PULSE_INTERVAL_MS_DEFAULT = MIN_PULSE_INTERVAL_MS; // Минимальный интервал между импульсами
     
 public:
     FlowSensor();
@@ -28,28 +49,62 @@ public:
     float getFlowRate() const; // л/мин
     bool isWaterFlowing() const;
     unsigned long getPulseCount() const;
+    unsigned long getTotalPulses() const;
+    float getPulseFrequency() const; // Гц
+    
+    // Коэффициент: при двух и более точках кривой - интерполяция по частоте,
+    // иначе значение из настроек
+    void setPulsesPerLiter(float factor);
+    float getPulsesPerLiter(float frequencyHz) const;
+    
+    // Кривая калибровки
+    void setCurve(const FlowCalibrationPoint* points, int count);
+    int getCurve(FlowCalibrationPoint* points) const;
+    void addCurvePoint(const FlowCalibrationPoint& point);
+    void clearCurve();
+    
+    // Калибровочный пролив: счет импульсов от start до finish
+    void startCalibration();
+    void cancelCalibration();
+    bool finishCalibration(float volumeLiters, FlowCalibrationPoint& point);
+    bool isCalibrating() const;
+    unsigned long getCalibrationPulses() const;
     
     // Диагностические методы
     unsigned long getLastPulseTime() const;
     unsigned long getTimeSinceLastPulse() const;
     bool isPinActive() const;
     
-    // Обработчик прерывания
-    static void IRAM_ATTR pulseISR();
-    static FlowSensor* instance;
+private:
+    unsigned long readPulses();
+};
+
+// Каналы температуры
+enum TemperatureChannel {
+    TEMP_CHANNEL_OUTLET,        // NTC на выходе нагревателя (основной)
+    TEMP_CHANNEL_INLET,         // NTC на входе (необязательный)
+    TEMP_CHANNEL_COUNT
+};
+
+// Параметры NTC канала
+struct TemperatureChannelConfig {
+    const char* name;
+    int pin;                    // -1 - канал не используется
+    float nominalResistance;    // Сопротивление при NOMINAL_TEMP (Ом)
+    float betaCoefficient;
+    float seriesResistance;     // Подтягивающий резистор (Ом)
 };
 
 class TemperatureSensor {
 private:
-    int pin;
+    const TemperatureChannelConfig* config;
     float temperature;
-    unsigned long lastReadTime;
+    float offset;               // Калибровочная поправка (°C)
+    int rawValue;
+    bool connected;
     
     // Параметры NTC датчика
     static constexpr float NOMINAL_TEMP_DEFAULT = NOMINAL_TEMP; // Номинальная температура
-    static constexpr float NOMINAL_RESISTANCE_DEFAULT = NOMINAL_RESISTANCE; // Сопротивление при 25°C
-    static constexpr float BETA_COEFFICIENT_DEFAULT = BETA_COEFFICIENT; // Бета-коэффициент
-    static constexpr float SERIES_RESISTANCE_DEFAULT = SERIES_RESISTANCE; // Подтягивающий резистор
     
     // Фильтрация
     static const int FILTER_SAMPLES_DEFAULT = FILTER_SAMPLES;
@@ -60,28 +115,50 @@ private:
 public:
     TemperatureSensor();
     
-    void begin(int sensorPin = NTC_PIN);
-    void update();
+    void begin(const TemperatureChannelConfig& channelConfig);
+    // Обработка значения АЦП из общего прохода по всем каналам
+    void update(int adcValue);
     
     // Получение данных
     float getTemperature() const; // °C
     float getRawValue() const;
+    bool isConnected() const;     // Показания АЦП в пределах подключенного NTC
+    const TemperatureChannelConfig& getConfig() const;
+    
+    void setOffset(float offsetC);
+    float getOffset() const;
     
 private:
-    float readRawTemperature();
+    friend struct BenchAccess;   // Тесты производительности (bench_suite.cpp)
+    
+    float convertToTemperature(int adcValue) const;
     float applyFilter(float newValue);
 };
 
 class SensorManager {
 private:
     FlowSensor flowSensor;
-    TemperatureSensor tempSensor;
+    TemperatureSensor tempSensors[TEMP_CHANNEL_COUNT];
+    
+    // Оценка температуры на входе по установившемуся режиму:
+    // T_вх = T_вых - P / (m * c)
+    float deliveredPowerW;
+    float inletEstimate;
+    bool inletEstimateValid;
+    unsigned long steadySince;
+    unsigned long slopeReferenceTime;
+    float slopeReferenceTemp;
+    float slopeReferencePower;
     
     // Состояние системы
     bool sensorsInitialized;
     unsigned long lastUpdateTime;
+    unsigned long lastDebugTime;
     static const unsigned long UPDATE_INTERVAL_MS = 100; // Обновление каждые 100мс
     
+    void sampleTemperatures();
+    void updateInletEstimate(unsigned long currentTime);
+    
 public:
     SensorManager();
     
@@ -90,20 +167,51 @@ public:
     
     // Получение данных
     float getFlowRate() const;
-    float getTemperature() const;
+    float getTemperature() const;             // Температура на выходе
     bool isWaterFlowing() const;
     
+    // Каналы температуры
+    float getChannelTemperature(TemperatureChannel channel) const;
+    const TemperatureSensor& getTemperatureSensor(TemperatureChannel channel) const;
+    void setTemperatureOffset(TemperatureChannel channel, float offsetC);
+    
+    // Температура на входе: датчик, если подключен, иначе оценка
+    float getInletTemperature() const;
+    bool isInletMeasured() const;
+    bool isInletEstimateValid() const;
+    // Отдаваемая мощность для оценки температуры на входе (Вт)
+    void setDeliveredPower(float watts);
+    
     // Методы для калибровки и управления потоком
     void setCalibrationFactor(float factor);
-    void calibrateFlowSensor();
     float getCalibrationFactor() const;
     unsigned long getFlowPulseCount() const;
+    unsigned long getFlowTotalPulses() const;   // С момента запуска
+    
+    // Калибровка по известному объему. finish сохраняет точку кривой и
+    // коэффициент в настройки
+    enum CalibrationResult {
+        CAL_OK,
+        CAL_NOT_ACTIVE,
+        CAL_INVALID_VOLUME,
+        CAL_TOO_FEW_PULSES,
+        CAL_OUT_OF_RANGE
+    };
+    void startFlowCalibration();
+    void cancelFlowCalibration();
+    CalibrationResult finishFlowCalibration(float volumeLiters, FlowCalibrationPoint& point);
+    void clearFlowCalibrationCurve();
+    bool isFlowCalibrationActive() const;
+    unsigned long getFlowCalibrationPulses() const;
+    int getFlowCalibrationCurve(FlowCalibrationPoint* points) const;
+    static const char* getCalibrationResultText(CalibrationResult result);
     
     // Проверка состояния
     bool isInitialized() const;
+    unsigned long getLastUpdateTime() const;  // millis() последнего опроса датчиков
     
     // Расширенная диагностика датчика потока
-    void printFlowSensorDiagnostics() const;
+    void printFlowSensorDiagnostics(Print& out) const;
     bool isFlowSensorWorking() const;
     unsigned long getTimeSinceLastPulse() const;
 };
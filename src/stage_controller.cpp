@@ -0,0 +1,229 @@
+#include "stage_controller.h"
+#include "control_io.h"
+#include "config_registry.h"
+#include "safety_supervisor.h"
+#include "logger.h"
+
+static const int RELAY_PINS[RELAY_STAGE_MAX] = RELAY_STAGE_PINS;
+
+volatile int StageController::outputCount = 0;
+
+StageController::StageController() :
+    count(0),
+    simulated(false),
+    stagePowerW(RELAY_STAGE_POWER_W),
+    vernierPowerW(3 * ELEMENT_POWER_W),
+    stageRatio(RELAY_STAGE_POWER_W / (3 * ELEMENT_POWER_W)),
+    minOnMs(RELAY_MIN_ON_SEC * 1000UL),
+    minOffMs(RELAY_MIN_OFF_SEC * 1000UL),
+    switches(0),
+    deliveredPercent(0.0) {
+    memset(stages, 0, sizeof(stages));
+}
+
+void StageController::begin(int stageCount, bool simulation) {
+    count = constrain(stageCount, 0, RELAY_STAGE_MAX);
+    simulated = simulation;
+
+    // relayStageCount действует после перезапуска: супервизор выключает
+    // выходы, которые настроены здесь, а не текущее значение параметра
+    if (!simulated && count > outputCount) {
+        outputCount = count;
+    }
+
+    for (int i = 0; i < count; i++) {
+        stages[i].on = false;
+        stages[i].lastChangeMs = 0;
+        if (!simulated) {
+            pinMode(RELAY_PINS[i], OUTPUT);
+            ControlIO::writeRelay(RELAY_PINS[i], !RELAY_ACTIVE_LEVEL);
+        }
+    }
+}
+
+void StageController::configure(float stageW, float vernierW, unsigned long minOn, unsigned long minOff) {
+    stagePowerW = stageW;
+    vernierPowerW = vernierW;
+    stageRatio = vernierW > 0 ? stageW / vernierW : 0.0;
+    minOnMs = minOn;
+    minOffMs = minOff;
+}
+
+// ========================================
+// РАСПРЕДЕЛЕНИЕ МОЩНОСТИ
+// ========================================
+
+float StageController::update(float demandPercent, unsigned long nowMs) {
+    if (count == 0) {
+        deliveredPercent = demandPercent;
+        return demandPercent;
+    }
+    if (demandPercent <= 0.0) {
+        allOff(nowMs);
+        return 0.0;
+    }
+
+    // Запрос в единицах мощности триаков: 1.0 - все три фазы на 100%
+    float capacity = 1.0 + count * stageRatio;
+    float units = min(demandPercent, 100.0f) / 100.0 * capacity;
+    float residual = units - getActiveCount() * stageRatio;
+
+    // Не больше одного переключения за вызов
+    if (residual > 1.0) {
+        int index = pickStageToEnable(nowMs);
+        if (index >= 0) {
+            setStage(index, true, nowMs);
+            residual -= stageRatio;
+        }
+    } else if (residual < 0.0) {
+        int index = pickStageToDisable(nowMs);
+        if (index >= 0) {
+            setStage(index, false, nowMs);
+            residual += stageRatio;
+        }
+    }
+
+    float vernier = constrain(residual, 0.0f, 1.0f);
+    deliveredPercent = (getActiveCount() * stageRatio + vernier) / capacity * 100.0;
+    return vernier * 100.0;
+}
+
+void StageController::allOff(unsigned long nowMs) {
+    for (int i = 0; i < count; i++) {
+        if (stages[i].on) {
+            setStage(i, false, nowMs);
+        }
+    }
+    deliveredPercent = 0.0;
+}
+
+bool StageController::canSwitch(int index, unsigned long nowMs) const {
+    const Stage& stage = stages[index];
+    // Ни разу не включавшейся паузу выдерживать не нужно (сразу после запуска)
+    if (!stage.on && stage.cycles == 0) return true;
+    return nowMs - stage.lastChangeMs >= (stage.on ? minOnMs : minOffMs);
+}
+
+int StageController::pickStageToEnable(unsigned long nowMs) const {
+    // Меньше всего включений, затем меньше наработка
+    int best = -1;
+    for (int i = 0; i < count; i++) {
+        if (stages[i].on || !canSwitch(i, nowMs)) continue;
+        if (best < 0 || stages[i].cycles < stages[best].cycles ||
+            (stages[i].cycles == stages[best].cycles && stages[i].onTimeMs < stages[best].onTimeMs)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+int StageController::pickStageToDisable(unsigned long nowMs) const {
+    // Дольше всех включенная
+    int best = -1;
+    for (int i = 0; i < count; i++) {
+        if (!stages[i].on || !canSwitch(i, nowMs)) continue;
+        if (best < 0 || nowMs - stages[i].lastChangeMs > nowMs - stages[best].lastChangeMs) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void StageController::setStage(int index, bool on, unsigned long nowMs) {
+    Stage& stage = stages[index];
+    if (on) {
+        stage.cycles++;
+    } else {
+        stage.onTimeMs += nowMs - stage.lastChangeMs;
+    }
+    stage.on = on;
+    stage.lastChangeMs = nowMs;
+    switches++;
+
+    if (!simulated) {
+        ControlIO::writeRelay(RELAY_PINS[index], on ? RELAY_ACTIVE_LEVEL : !RELAY_ACTIVE_LEVEL);
+        LOG_I(SYSTEM, "Ступень %d %s (включений %lu)", index + 1, on ? "включена" : "выключена", stage.cycles);
+    }
+}
+
+int StageController::getActiveCount() const {
+    int active = 0;
+    for (int i = 0; i < count; i++) {
+        if (stages[i].on) active++;
+    }
+    return active;
+}
+
+unsigned long StageController::getOnTimeMs(int index, unsigned long nowMs) const {
+    const Stage& stage = stages[index];
+    return stage.onTimeMs + (stage.on ? nowMs - stage.lastChangeMs : 0);
+}
+
+// ========================================
+// СИМУЛЯЦИЯ
+// ========================================
+
+void StageController::runSimulation(Print& out, int stageCount, unsigned long durationS, SimulationResult& result) {
+    memset(&result, 0, sizeof(result));
+
+    // Параметры ступеней - текущие из ConfigRegistry
+    StageController stages;
+    stages.begin(stageCount, true);
+    stages.configure(ConfigRegistry::get(PARAM_RELAY_STAGE_POWER), 3 * ConfigRegistry::get(PARAM_ELEMENT_POWER),
+                     ConfigRegistry::getUInt(PARAM_RELAY_MIN_ON) * 1000UL,
+                     ConfigRegistry::getUInt(PARAM_RELAY_MIN_OFF) * 1000UL);
+    stageCount = stages.getStageCount();
+
+    float capacity = 1.0 + stageCount * stages.stageRatio;
+    int naiveActive = 0;
+    uint32_t noise = 1;
+
+    // Интервал строк - кратный STAGE_SIM_OUTPUT_S
+    unsigned long outputS = STAGE_SIM_OUTPUT_S;
+    while (durationS / outputS + 1 > STAGE_SIM_MAX_ROWS) {
+        outputS += STAGE_SIM_OUTPUT_S;
+    }
+
+    out.println("time_s,demand_pct,stages,triac_pct,delivered_pct,naive_stages");
+
+    unsigned long durationMs = durationS * 1000UL;
+    for (unsigned long t = 0; t <= durationMs; t += STAGE_SIM_STEP_MS) {
+        // Медленный подъем и спад запроса с колебаниями ПИД (±2% с периодом
+        // 20 с) и шумом ±1%
+        noise = noise * 1103515245UL + 12345UL;
+        float demand = 50.0 - 50.0 * cosf(2.0 * PI * t / durationMs) +
+                       2.0 * sinf(2.0 * PI * t / 20000.0) + ((noise >> 16) % 2001 - 1000) / 1000.0;
+        demand = constrain(demand, 0.0f, 100.0f);
+
+        float triac = stages.update(demand, t);
+        float error = fabsf(stages.getDeliveredPercent() - demand);
+        if (error > result.maxErrorPercent) result.maxErrorPercent = error;
+        if (error > STAGE_SIM_ERROR_PERCENT) result.blockedSteps++;
+
+        // Пороговое включение: столько ступеней, сколько помещается в запрос
+        int naive = stages.stageRatio > 0 ? (int)(demand / 100.0 * capacity / stages.stageRatio) : 0;
+        naive = constrain(naive, 0, stageCount);
+        result.naiveSwitches += abs(naive - naiveActive);
+        naiveActive = naive;
+
+        if (t % (outputS * 1000UL) == 0) {
+            out.printf("%lu,%.2f,%d,%.2f,%.2f,%d\n", t / 1000, demand, stages.getActiveCount(), triac,
+                       stages.getDeliveredPercent(), naive);
+        }
+
+        result.steps++;
+        if ((result.steps & 0x3FF) == 0) {
+            SafetySupervisor::feedWatchdog();
+        }
+    }
+
+    result.switches = stages.getTotalSwitches();
+    for (int i = 0; i < stageCount; i++) {
+        result.cycles[i] = stages.getStage(i).cycles;
+    }
+
+    out.printf("# stagesim: ступеней %d, шагов %lu, переключений %lu (пороговое %lu), "
+               "макс. отклонение %.2f%%, шагов с отклонением > %.1f%%: %lu\n",
+               stageCount, result.steps, result.switches, result.naiveSwitches, result.maxErrorPercent,
+               STAGE_SIM_ERROR_PERCENT, result.blockedSteps);
+}
@@ -0,0 +1,93 @@
+#ifndef STAGE_CONTROLLER_H
+#define STAGE_CONTROLLER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========================================
+// СТУПЕНИ НА РЕЛЕ / КОНТАКТОРАХ
+// ========================================
+//
+// Дополнительные нагреватели, включаемые реле или контакторами, - грубые
+// ступени, триаки PhaseController - точная подстройка (нониус) между ними.
+// Запрос мощности 0-100% относится ко всей установке: триаки (3 фазы по
+// elementPowerW) плюс relayStageCount ступеней по relayStagePowerW.
+// Без ступеней запрос передается триакам без изменений.
+//
+// Ступень добавляется, только когда триаки уже на 100%, и снимается,
+// только когда лишней оказывается мощность при триаках на 0%. Если ступень
+// не мощнее всех триаков, после переключения остаток снова попадает в
+// диапазон триаков: разрешение регулирования то же, что и без ступеней.
+// Реле защищены минимальным временем включения и паузы (relayMinOnSec,
+// relayMinOffSec); пока переключение запрещено, триаки упираются в 0 или
+// 100%. Включается ступень с наименьшим числом включений, выключается
+// дольше всех работающая - износ распределяется поровну.
+//
+// Нулевой запрос (нет потока, остановка) выключает ступени сразу, без
+// ожидания минимального времени включения.
+
+class StageController {
+public:
+    struct Stage {
+        bool on;
+        unsigned long lastChangeMs;
+        unsigned long cycles;       // Включений с запуска
+        unsigned long onTimeMs;     // Наработка с запуска (без текущего включения)
+    };
+
+    // Сравнение с пороговым включением без защиты реле (runSimulation)
+    struct SimulationResult {
+        unsigned long steps;
+        unsigned long switches;             // Переключений реле StageController
+        unsigned long naiveSwitches;        // Пороговое включение без гистерезиса и пауз
+        float maxErrorPercent;              // Наибольшее отклонение отдаваемой мощности от запроса
+        unsigned long blockedSteps;         // Шагов с ошибкой больше STAGE_SIM_ERROR_PERCENT
+        unsigned long cycles[RELAY_STAGE_MAX];
+    };
+
+    StageController();
+
+    // Пины - RELAY_STAGE_PINS; simulated - без выходов (симуляция)
+    void begin(int count, bool simulated = false);
+    void configure(float stagePowerW, float vernierPowerW, unsigned long minOnMs, unsigned long minOffMs);
+
+    // Запрос всей установки 0-100% -> мощность триаков 0-100%
+    float update(float demandPercent, unsigned long nowMs);
+    void allOff(unsigned long nowMs);       // Аварийно: без минимального времени включения
+
+    int getStageCount() const { return count; }
+    static int getOutputCount() { return outputCount; }   // Выходов, настроенных begin (для супервизора)
+    int getActiveCount() const;
+    const Stage& getStage(int index) const { return stages[index]; }
+    unsigned long getOnTimeMs(int index, unsigned long nowMs) const;
+    unsigned long getTotalSwitches() const { return switches; }
+    float getStagePowerW() const { return stagePowerW; }
+    float getActivePowerW() const { return getActiveCount() * stagePowerW; }
+    float getDeliveredPercent() const { return deliveredPercent; }
+
+    // Профиль запроса 0 -> 100 -> 0% с колебаниями ПИД через оба способа
+    // включения, CSV раз в STAGE_SIM_OUTPUT_S (реже, чтобы строк было не
+    // больше STAGE_SIM_MAX_ROWS). Выполняется целиком, без возврата в loop
+    static void runSimulation(Print& out, int stageCount, unsigned long durationS, SimulationResult& result);
+
+private:
+    static volatile int outputCount;
+
+    Stage stages[RELAY_STAGE_MAX];
+    int count;
+    bool simulated;
+    float stagePowerW;
+    float vernierPowerW;
+    float stageRatio;               // Мощность ступени / мощность триаков
+    unsigned long minOnMs;
+    unsigned long minOffMs;
+    unsigned long switches;
+    float deliveredPercent;
+
+    bool canSwitch(int index, unsigned long nowMs) const;
+    int pickStageToEnable(unsigned long nowMs) const;
+    int pickStageToDisable(unsigned long nowMs) const;
+    void setStage(int index, bool on, unsigned long nowMs);
+};
+
+#endif
@@ -1,30 +1,229 @@
 #include "system_controller.h"
+#include "logger.h"
+#include "config_registry.h"
+#include "safety_supervisor.h"
+#include "cpu_frequency.h"
+#include "perf_profiler.h"
+#include "control_io.h"
+#include "config_storage.h"
+
+// ========================================
+// ТАБЛИЦА ПЕРЕХОДОВ
+// ========================================
+
+namespace {
+
+typedef SystemController SC;
+
+// Событие без строки для текущего состояния игнорируется
+constexpr SC::Transition TRANSITIONS[] = {
+    { SC::STATE_IDLE,         SC::EVENT_FLOW_STARTED,     SC::STATE_STARTING,     SC::GUARD_CAN_HEAT },
+    { SC::STATE_IDLE,         SC::EVENT_USER_START,       SC::STATE_STARTING,     SC::GUARD_CAN_HEAT },
+    { SC::STATE_IDLE,         SC::EVENT_OVER_TEMP,        SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_IDLE,         SC::EVENT_SENSOR_FAULT,     SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_IDLE,         SC::EVENT_EMERGENCY_STOP,   SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_IDLE,         SC::EVENT_SAFETY_TRIP,      SC::STATE_ERROR,        SC::GUARD_NONE },
+    
+    { SC::STATE_STARTING,     SC::EVENT_RAMP_DONE,        SC::STATE_HEATING,      SC::GUARD_NONE },
+    { SC::STATE_STARTING,     SC::EVENT_FLOW_STOPPED,     SC::STATE_IDLE,         SC::GUARD_NONE },
+    { SC::STATE_STARTING,     SC::EVENT_USER_STOP,        SC::STATE_IDLE,         SC::GUARD_NONE },
+    { SC::STATE_STARTING,     SC::EVENT_RESET,            SC::STATE_IDLE,         SC::GUARD_NONE },
+    { SC::STATE_STARTING,     SC::EVENT_OVER_TEMP,        SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_STARTING,     SC::EVENT_SENSOR_FAULT,     SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_STARTING,     SC::EVENT_EMERGENCY_STOP,   SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_STARTING,     SC::EVENT_SAFETY_TRIP,      SC::STATE_ERROR,        SC::GUARD_NONE },
+    
+    { SC::STATE_HEATING,      SC::EVENT_NEAR_SETPOINT,    SC::STATE_COOLING_DOWN, SC::GUARD_NONE },
+    { SC::STATE_HEATING,      SC::EVENT_FLOW_STOPPED,     SC::STATE_IDLE,         SC::GUARD_NONE },
+    { SC::STATE_HEATING,      SC::EVENT_USER_STOP,        SC::STATE_IDLE,         SC::GUARD_NONE },
+    { SC::STATE_HEATING,      SC::EVENT_RESET,            SC::STATE_IDLE,         SC::GUARD_NONE },
+    { SC::STATE_HEATING,      SC::EVENT_OVER_TEMP,        SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_HEATING,      SC::EVENT_SENSOR_FAULT,     SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_HEATING,      SC::EVENT_EMERGENCY_STOP,   SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_HEATING,      SC::EVENT_SAFETY_TRIP,      SC::STATE_ERROR,        SC::GUARD_NONE },
+    
+    { SC::STATE_COOLING_DOWN, SC::EVENT_BELOW_SETPOINT,   SC::STATE_HEATING,      SC::GUARD_NONE },
+    { SC::STATE_COOLING_DOWN, SC::EVENT_SETPOINT_CHANGED, SC::STATE_HEATING,      SC::GUARD_NONE },
+    { SC::STATE_COOLING_DOWN, SC::EVENT_FLOW_STOPPED,     SC::STATE_IDLE,         SC::GUARD_NONE },
+    { SC::STATE_COOLING_DOWN, SC::EVENT_USER_STOP,        SC::STATE_IDLE,         SC::GUARD_NONE },
+    { SC::STATE_COOLING_DOWN, SC::EVENT_RESET,            SC::STATE_IDLE,         SC::GUARD_NONE },
+    { SC::STATE_COOLING_DOWN, SC::EVENT_OVER_TEMP,        SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_COOLING_DOWN, SC::EVENT_SENSOR_FAULT,     SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_COOLING_DOWN, SC::EVENT_EMERGENCY_STOP,   SC::STATE_ERROR,        SC::GUARD_NONE },
+    { SC::STATE_COOLING_DOWN, SC::EVENT_SAFETY_TRIP,      SC::STATE_ERROR,        SC::GUARD_NONE },
+    
+    { SC::STATE_ERROR,        SC::EVENT_RESET,            SC::STATE_IDLE,         SC::GUARD_NONE },
+};
+
+constexpr size_t TRANSITION_COUNT = sizeof(TRANSITIONS) / sizeof(TRANSITIONS[0]);
+
+// Проверки таблицы при компиляции
+
+constexpr bool rowsValid(size_t i) {
+    return i >= TRANSITION_COUNT ? true :
+           TRANSITIONS[i].from < SC::STATE_COUNT && TRANSITIONS[i].to < SC::STATE_COUNT &&
+           TRANSITIONS[i].event < SC::EVENT_COUNT && rowsValid(i + 1);
+}
+
+constexpr int countRows(int state, int event, size_t i) {
+    return i >= TRANSITION_COUNT ? 0 :
+           (TRANSITIONS[i].from == state && TRANSITIONS[i].event == event ? 1 : 0) + countRows(state, event, i + 1);
+}
+
+constexpr int targetOf(int state, int event, size_t i) {
+    return i >= TRANSITION_COUNT ? -1 :
+           (TRANSITIONS[i].from == state && TRANSITIONS[i].event == event) ? TRANSITIONS[i].to :
+           targetOf(state, event, i + 1);
+}
+
+// Не более одной строки на пару (состояние, событие)
+constexpr bool isDeterministic(int state, int event) {
+    return state >= SC::STATE_COUNT ? true :
+           event >= SC::EVENT_COUNT ? isDeterministic(state + 1, 0) :
+           countRows(state, event, 0) <= 1 && isDeterministic(state, event + 1);
+}
+
+// Из любого рабочего состояния аварийные события ведут в ошибку
+constexpr bool faultsHandled(int state) {
+    return state >= SC::STATE_ERROR ? true :
+           targetOf(state, SC::EVENT_OVER_TEMP, 0) == SC::STATE_ERROR &&
+           targetOf(state, SC::EVENT_SENSOR_FAULT, 0) == SC::STATE_ERROR &&
+           targetOf(state, SC::EVENT_EMERGENCY_STOP, 0) == SC::STATE_ERROR &&
+           targetOf(state, SC::EVENT_SAFETY_TRIP, 0) == SC::STATE_ERROR &&
+           faultsHandled(state + 1);
+}
+
+// Выход из ошибки - только по сбросу
+constexpr bool errorLatched(size_t i) {
+    return i >= TRANSITION_COUNT ? true :
+           (TRANSITIONS[i].from != SC::STATE_ERROR || TRANSITIONS[i].event == SC::EVENT_RESET) &&
+           errorLatched(i + 1);
+}
+
+static_assert(rowsValid(0), "Таблица переходов: недопустимое состояние или событие");
+static_assert(isDeterministic(0, 0), "Таблица переходов: повтор пары (состояние, событие)");
+static_assert(faultsHandled(0), "Таблица переходов: аварийное событие не ведет в STATE_ERROR");
+static_assert(errorLatched(0), "Таблица переходов: выход из STATE_ERROR не по сбросу");
+
+static_assert(SC::PROFILE_MODE_COUNT == PROFILE_SLOT_COUNT, "PROFILE_SLOT_COUNT не совпадает с ProfileMode");
+
+void addSegment(PowerProfile& profile, unsigned long durationS, float value, ProfileEngine::Shape shape) {
+    ProfileSegment& segment = profile.segments[profile.segmentCount++];
+    segment.durationMs = durationS * 1000UL;
+    segment.value = value;
+    segment.shape = shape;
+}
+
+// Термодезинфекция: уставка с запасом над засчитываемой температурой,
+// длительность - удержание и время на нагрев (настройки disinfection*)
+float disinfectionSetpoint() {
+    return min(ConfigRegistry::get(PARAM_DISINFECTION_TEMP) + DISINFECTION_MARGIN_C, TARGET_TEMP_MAX);
+}
+
+unsigned long disinfectionDurationS() {
+    return ConfigRegistry::getUInt(PARAM_DISINFECTION_HOLD) * 60UL + DISINFECTION_HEATUP_S;
+}
+
+// Профиль термодезинфекции может набрать удержание: температура все время
+// не ниже уставки, проход не короче длительности
+bool isDisinfectionConsistent(const PowerProfile& profile) {
+    if (profile.target != ProfileEngine::TARGET_SETPOINT) return false;
+    
+    float setpoint = disinfectionSetpoint();
+    if (profile.startValue < setpoint) return false;
+    
+    uint32_t totalMs = 0;
+    for (int i = 0; i < profile.segmentCount && i < PROFILE_MAX_SEGMENTS; i++) {
+        if (profile.segments[i].value < setpoint) return false;
+        totalMs += profile.segments[i].durationMs;
+    }
+    return profile.looping || totalMs >= disinfectionDurationS() * 1000UL;
+}
+
+// Встроенные профили режимов (config.h, термодезинфекция - по настройкам)
+void buildDefaultProfile(SC::ProfileMode mode, PowerProfile& profile) {
+    memset(&profile, 0, sizeof(profile));
+    switch (mode) {
+        case SC::PROFILE_MODE_PREHEAT:
+            // Предел мощности плавно растет до 100%
+            profile.target = ProfileEngine::TARGET_POWER_LIMIT;
+            profile.startValue = PREHEAT_START_LIMIT;
+            addSegment(profile, PREHEAT_TIME_S, 100.0, ProfileEngine::SHAPE_SMOOTH);
+            break;
+            
+        case SC::PROFILE_MODE_DISINFECTION:
+            // Подъем температуры ограничен RampEngine, профиль задает удержание
+            profile.target = ProfileEngine::TARGET_SETPOINT;
+            profile.startValue = disinfectionSetpoint();
+            addSegment(profile, disinfectionDurationS(), profile.startValue, ProfileEngine::SHAPE_STEP);
+            break;
+            
+        default:
+            // Обкатка: разгон, 100%, спад, пониженная мощность - по кругу
+            profile.target = ProfileEngine::TARGET_POWER;
+            profile.looping = 1;
+            profile.startValue = BURN_IN_LOW_POWER;
+            addSegment(profile, 60, 100.0, ProfileEngine::SHAPE_LINEAR);
+            addSegment(profile, BURN_IN_HOLD_S, 100.0, ProfileEngine::SHAPE_STEP);
+            addSegment(profile, 60, BURN_IN_LOW_POWER, ProfileEngine::SHAPE_SMOOTH);
+            addSegment(profile, BURN_IN_LOW_S, BURN_IN_LOW_POWER, ProfileEngine::SHAPE_STEP);
+            break;
+    }
+}
+
+}
 
 SystemController::SystemController() : 
+    profileMode(PROFILE_MODE_NONE),
+    disinfectionCustom(false),
     currentState(STATE_IDLE),
     previousState(STATE_IDLE),
     stateStartTime(0),
     lastUpdateTime(0),
+    lastDebugTime(0),
     minFlowRate(MIN_FLOW_RATE_DEFAULT),           // 0.5 л/мин по умолчанию
     targetTemperature(TARGET_TEMP_DEFAULT),
     minTemperature(MIN_TEMP_DEFAULT),       // Минимум 40°C
     maxTemperature(MAX_TEMP_DEFAULT),       // Максимум 65°C
     rampUpTime(RAMP_UP_TIME_MS),           // 2 секунды разгона
     currentTargetPower(0.0),
-    rampStartPower(0.0),
     rampTargetPower(0.0),
     heatingEnabled(true),
     flowDetected(false),
     currentFlowRate(0.0),
     currentTemperature(25.0),
+    flowCandidate(false),
+    flowCandidateSince(0),
     emergencyStopFlag(false),
-    lastFlowCheckTime(0) {
+    eventHead(0),
+    eventCount(0),
+    droppedEvents(0),
+    traceHead(0),
+    traceCount(0) {
 }
 
 void SystemController::begin() {
     // Инициализируем компоненты
     sensors.begin();
     phaseController.begin();
+    stages.begin(ConfigRegistry::getUInt(PARAM_RELAY_STAGE_COUNT));
+    energyMeter.begin();
+    
+    // Профили режимов: встроенные, поверх - сохраненные во flash
+    for (int mode = 0; mode < PROFILE_MODE_COUNT; mode++) {
+        buildDefaultProfile((ProfileMode)mode, profiles[mode]);
+    }
+    PowerProfile builtIn = profiles[PROFILE_MODE_DISINFECTION];
+    ConfigStorage::loadProfiles(profiles, PROFILE_MODE_COUNT);
+    disinfectionCustom = memcmp(&builtIn, &profiles[PROFILE_MODE_DISINFECTION], sizeof(builtIn)) != 0;
+    if (disinfectionCustom && !isDisinfectionConsistent(profiles[PROFILE_MODE_DISINFECTION])) {
+        LOG_W(SYSTEM, "Сохраненный профиль disinfection не набирает удержание, используется встроенный");
+        profiles[PROFILE_MODE_DISINFECTION] = builtIn;
+        disinfectionCustom = false;
+    }
+    if (!ControlIO::isReplaying()) {
+        disinfection.begin();
+    }
     
     // Настраиваем PID контроллер
     pidController.setSetpoint(targetTemperature);
@@ -34,30 +233,40 @@ void SystemController::begin() {
     // Настраиваем контроллер фаз
     phaseController.start();
     
-    // Переходим в режим покоя
-    transitionToState(STATE_IDLE);
+    // Начинаем в режиме покоя
+    currentState = STATE_IDLE;
+    stateStartTime = ControlIO::nowMs();
     
-    lastUpdateTime = millis();
+    lastUpdateTime = ControlIO::nowMs();
 }
 
 void SystemController::update() {
-    unsigned long currentTime = millis();
+    PERF_SCOPE(PERF_SYSTEM_UPDATE);
     
-    // Обновляем датчики
-    updateSensors();
+    unsigned long currentTime = ControlIO::nowMs();
     
-    // Проверяем защитные условия
-    if (!checkSafetyConditions()) {
-        emergencyShutdown();
-        return;
-    }
+    // Датчики и защита только ставят события, переходы - в processEvents
+    updateSensors();
+    detectEvents();
+    processEvents();
     
-    // Обновляем машину состояний
-    updateStateMachine();
+    // Выходы текущего состояния
+    updateProfile();
+    runStateActions();
     
     // Обновляем контроллер фаз
     phaseController.update();
     
+    // Интегрируем отданную энергию
+    energyMeter.setStagePower(stages.getActivePowerW());
+    energyMeter.update(phaseController, currentFlowRate);
+    sensors.setDeliveredPower(energyMeter.getTotalDeliveredPower());
+    
+    // При воспроизведении запуск и остановка режима приходят из трассы
+    if (!ControlIO::isReplaying()) {
+        updateDisinfection();
+    }
+    
     lastUpdateTime = currentTime;
 }
 
@@ -71,82 +280,104 @@ void SystemController::updateSensors() {
     bool newFlowDetected = (currentFlowRate >= minFlowRate);
     
     // Отладочная информация каждые 2 секунды
-    static unsigned long lastDebugTime = 0;
-    if (millis() - lastDebugTime > 2000) {
-        Serial.println("=== СТАТУС СИСТЕМЫ ===");
-        Serial.print("Поток: ");
-        Serial.print(currentFlowRate, 2);
-        Serial.print(" л/мин (мин: ");
-        Serial.print(minFlowRate, 1);
-        Serial.print(" л/мин) - ");
-        Serial.println(newFlowDetected ? "ОБНАРУЖЕН" : "НЕТ");
-        
-        Serial.print("Температура: ");
-        Serial.print(currentTemperature, 1);
-        Serial.print("°C (цель: ");
-        Serial.print(targetTemperature, 1);
-        Serial.println("°C)");
-        
-        Serial.print("Нагрев: ");
-        Serial.print(heatingEnabled ? "ВКЛ" : "ВЫКЛ");
-        Serial.print(", Состояние: ");
-        Serial.print(getState());
-        Serial.print(", Мощность: ");
-        Serial.print(currentTargetPower, 1);
-        Serial.println("%");
-        
-        // Отладочная информация ПИД-регулятора
-        if (pidController.isControllerEnabled()) {
-            float temperatureError = targetTemperature - currentTemperature;
-            Serial.print("ПИД: Ошибка=");
-            Serial.print(temperatureError, 2);
-            Serial.print("°C, ПИД-выход=");
-            Serial.print(pidController.getLastOutput(), 1);
-            Serial.print("%, Логика=");
-            if (temperatureError > 5.0) {
-                Serial.print("100% (далеко)");
-            } else if (temperatureError > 2.0) {
-                Serial.print("80%+ (приближение)");
-            } else {
-                Serial.print("60% (поддержание)");
+    if (LOG_ENABLED(SYSTEM, LOG_LEVEL_DEBUG)) {
+        if (ControlIO::nowMs() - lastDebugTime > 2000) {
+            LOG_D(SYSTEM, "Поток: %.2f л/мин (мин: %.1f) - %s, температура: %.1f°C (цель: %.1f°C)",
+                  currentFlowRate, minFlowRate, newFlowDetected ? "ОБНАРУЖЕН" : "НЕТ",
+                  currentTemperature, getActiveSetpoint());
+            LOG_D(SYSTEM, "Нагрев: %s, состояние: %s, мощность: %.1f%%",
+                  heatingEnabled ? "ВКЛ" : "ВЫКЛ", getStateName(currentState), currentTargetPower);
+            
+            // Отладочная информация ПИД-регулятора
+            if (pidController.isControllerEnabled()) {
+                float temperatureError = getActiveSetpoint() - currentTemperature;
+                const char* logic = temperatureError > 5.0 ? "100% (далеко)" :
+                                    temperatureError > 2.0 ? "80%+ (приближение)" : "60% (поддержание)";
+                LOG_D(SYSTEM, "ПИД: ошибка=%.2f°C, выход=%.1f%%, логика=%s",
+                      temperatureError, pidController.getLastOutput(), logic);
             }
-            Serial.println();
+            lastDebugTime = ControlIO::nowMs();
         }
-        
-        Serial.println("========================");
-        lastDebugTime = millis();
     }
     
-    // Если поток только что появился или исчез
-    if (newFlowDetected != flowDetected) {
-        // Добавляем гистерезис для стабилизации потока
-        static unsigned long lastFlowChangeTime = 0;
-        unsigned long currentTime = millis();
-        
-        // Минимальный интервал между изменениями потока (200мс)
-        if (currentTime - lastFlowChangeTime < 200) {
-            return; // Игнорируем слишком частые изменения
+    // Гистерезис: новое состояние потока должно продержаться FLOW_DEBOUNCE_MS
+    unsigned long currentTime = ControlIO::nowMs();
+    if (newFlowDetected != flowCandidate) {
+        flowCandidate = newFlowDetected;
+        flowCandidateSince = currentTime;
+    }
+    
+    if (flowCandidate != flowDetected && currentTime - flowCandidateSince >= FLOW_DEBOUNCE_MS) {
+        flowDetected = flowCandidate;
+        LOG_I(SYSTEM, "Изменение потока: %s", flowDetected ? "ПОЯВИЛСЯ" : "ИСЧЕЗ");
+        postEvent(flowDetected ? EVENT_FLOW_STARTED : EVENT_FLOW_STOPPED);
+    }
+}
+
+void SystemController::detectEvents() {
+    // Защитные условия
+    if (currentState != STATE_ERROR) {
+        if (ControlIO::isSafetyTripped()) {
+            postEvent(EVENT_SAFETY_TRIP);    // Выходы уже выключены супервизором
+        } else if (currentTemperature > max(maxTemperature, getActiveSetpoint()) + 5.0) {
+            postEvent(EVENT_OVER_TEMP);
+        } else if (currentTemperature < -5.0) {
+            postEvent(EVENT_SENSOR_FAULT); // Некорректные показания датчика
         }
+    }
+    
+    // Зоны температуры относительно целевой
+    float temperatureError = getActiveSetpoint() - currentTemperature;
+    if (currentState == STATE_HEATING && temperatureError <= 2.0) {
+        postEvent(EVENT_NEAR_SETPOINT);
+    } else if (currentState == STATE_COOLING_DOWN && temperatureError > 3.0) {
+        postEvent(EVENT_BELOW_SETPOINT);
+    }
+}
+
+void SystemController::postEvent(ControllerEvent event) {
+    if (eventCount >= EVENT_QUEUE_SIZE) {
+        droppedEvents++;
+        return;
+    }
+    eventQueue[(eventHead + eventCount) % EVENT_QUEUE_SIZE] = event;
+    eventCount++;
+}
+
+void SystemController::processEvents() {
+    // Обрабатываем только события, поставленные до начала обработки:
+    // события, порожденные переходами, ждут следующего цикла
+    int pending = eventCount;
+    while (pending-- > 0) {
+        ControllerEvent event = eventQueue[eventHead];
+        eventHead = (eventHead + 1) % EVENT_QUEUE_SIZE;
+        eventCount--;
+        dispatch(event);
+    }
+}
+
+void SystemController::dispatch(ControllerEvent event) {
+    for (size_t i = 0; i < TRANSITION_COUNT; i++) {
+        const Transition& transition = TRANSITIONS[i];
+        if (transition.from != currentState || transition.event != event) continue;
         
-        lastFlowChangeTime = currentTime;
-        flowDetected = newFlowDetected;
-        
-        Serial.print("Изменение потока: ");
-        Serial.println(flowDetected ? "ПОЯВИЛСЯ" : "ИСЧЕЗ");
-        
-        if (flowDetected && heatingEnabled) {
-            // Поток появился - начинаем нагрев
-            Serial.println("Запуск нагрева...");
-            transitionToState(STATE_STARTING);
-        } else if (!flowDetected) {
-            // Поток исчез - останавливаем нагрев
-            Serial.println("Остановка нагрева...");
-            transitionToState(STATE_IDLE);
+        if (checkGuard(transition.guard)) {
+            transitionToState((SystemState)transition.to, event);
         }
+        return;
+    }
+}
+
+bool SystemController::checkGuard(uint8_t guard) const {
+    switch (guard) {
+        case GUARD_CAN_HEAT:
+            return flowDetected && heatingEnabled && !emergencyStopFlag;
+        default:
+            return true;
     }
 }
 
-void SystemController::updateStateMachine() {
+void SystemController::runStateActions() {
     switch (currentState) {
         case STATE_IDLE:
             handleIdleState();
@@ -169,156 +400,207 @@ void SystemController::updateStateMachine() {
 void SystemController::handleIdleState() {
     // В режиме покоя только мониторим датчики
     // Нагрев отключен
-    phaseController.setTargetPower(0.0);
+    setOutputPower(0.0);
     currentTargetPower = 0.0;
-    
-    // Если поток появился и нагрев включен - переходим к запуску
-    if (flowDetected && heatingEnabled) {
-        transitionToState(STATE_STARTING);
-    }
 }
 
 void SystemController::handleStartingState() {
     // Простой разгон до 100% мощности
     updateRampUp();
     
-    // Если разгон завершен - переходим к активному нагреву
-    if (currentTargetPower >= rampTargetPower) {
-        // Сбрасываем PID перед переходом к активному нагреву
-        pidController.reset();
-        transitionToState(STATE_HEATING);
+    // Разгон завершен (или упирается в предел тока) - переходим к активному нагреву
+    if (ramp.isSettled() || ramp.isCurrentLimited()) {
+        postEvent(EVENT_RAMP_DONE);
     }
 }
 
 void SystemController::handleHeatingState() {
     // Активный нагрев с PID регулированием
-    if (flowDetected && heatingEnabled) {
-        // Рассчитываем мощность через PID
-        float pidOutput = pidController.compute(currentTemperature, targetTemperature);
-        
-        // Простая логика: если температура далека от целевой - работаем на максимум
-        float temperatureError = targetTemperature - currentTemperature;
-        
-        float finalPower;
-        if (temperatureError > 5.0) {
-            // Температура далека от целевой - работаем на 100%
-            finalPower = 100.0;
-        } else if (temperatureError > 2.0) {
-            // Приближаемся к целевой - используем ПИД, но не менее 80%
-            finalPower = max(pidOutput, 80.0f);
-        } else {
-            // Близко к целевой - переходим к поддержанию
-            transitionToState(STATE_COOLING_DOWN);
-            return;
-        }
-        
-        phaseController.setTargetPower(finalPower);
-        currentTargetPower = finalPower;
+    float setpoint = getActiveSetpoint();
+    float pidOutput = pidController.compute(currentTemperature, setpoint);
+    
+    // Простая логика: если температура далека от целевой - работаем на максимум
+    float temperatureError = setpoint - currentTemperature;
+    
+    float finalPower;
+    if (temperatureError > 5.0) {
+        // Температура далека от целевой - работаем на 100%
+        finalPower = 100.0;
+    } else if (temperatureError > 2.0) {
+        // Приближаемся к целевой - используем ПИД, но не менее 80%
+        finalPower = max(pidOutput, 80.0f);
     } else {
-        // Поток исчез или нагрев отключен
-        transitionToState(STATE_IDLE);
+        // Близко к целевой: EVENT_NEAR_SETPOINT переведет в поддержание
+        finalPower = min(pidOutput, 60.0f);
     }
+    
+    finalPower = applyProfilePower(finalPower);
+    setOutputPower(finalPower);
+    currentTargetPower = finalPower;
 }
 
 void SystemController::handleCoolingDownState() {
     // Поддержание температуры с PID регулированием
-    if (flowDetected && heatingEnabled) {
-        // Рассчитываем мощность через PID
-        float pidOutput = pidController.compute(currentTemperature, targetTemperature);
-        
-        // Ограничиваем мощность для поддержания (максимум 60%)
-        float finalPower = min(pidOutput, 60.0f);
-        
-        phaseController.setTargetPower(finalPower);
-        currentTargetPower = finalPower;
-        
-        // Если температура упала значительно - возвращаемся к активному нагреву
-        float temperatureError = targetTemperature - currentTemperature;
-        if (temperatureError > 3.0) {
-            transitionToState(STATE_HEATING);
-        }
-    } else {
-        // Поток исчез или нагрев отключен
-        transitionToState(STATE_IDLE);
-    }
+    float pidOutput = pidController.compute(currentTemperature, getActiveSetpoint());
+    
+    // Ограничиваем мощность для поддержания (максимум 60%)
+    float finalPower = applyProfilePower(min(pidOutput, 60.0f));
+    
+    setOutputPower(finalPower);
+    currentTargetPower = finalPower;
 }
 
 void SystemController::handleErrorState() {
     // В режиме ошибки отключаем все
-    phaseController.setTargetPower(0.0);
+    setOutputPower(0.0);
     phaseController.emergencyStop();
     currentTargetPower = 0.0;
 }
 
-void SystemController::transitionToState(SystemState newState) {
-    if (newState != currentState) {
-        previousState = currentState;
-        currentState = newState;
-        stateStartTime = millis();
-        
-        // Действия при переходе в новое состояние
-        switch (newState) {
-            case STATE_STARTING:
-                // Начинаем плавный разгон
-                startRampUp(100.0); // Разгон до 100% мощности
-                break;
-                
-            case STATE_IDLE:
-                // Сбрасываем PID при остановке
+void SystemController::transitionToState(SystemState newState, ControllerEvent event) {
+    previousState = currentState;
+    currentState = newState;
+    stateStartTime = ControlIO::nowMs();
+    
+    // Журнал переходов
+    TransitionRecord& record = trace[traceHead];
+    record.timeMs = stateStartTime;
+    record.from = previousState;
+    record.to = newState;
+    record.event = event;
+    traceHead = (traceHead + 1) % CONTROLLER_TRACE_SIZE;
+    if (traceCount < CONTROLLER_TRACE_SIZE) traceCount++;
+    
+    LOG_I(SYSTEM, "Переход: %s -> %s (%s)", getStateName(previousState), getStateName(newState), getEventName(event));
+    
+    // Действия при переходе в новое состояние
+    switch (newState) {
+        case STATE_STARTING:
+            // Начинаем плавный разгон
+            startRampUp(100.0); // Разгон до 100% мощности
+            break;
+            
+        case STATE_HEATING:
+            // Сбрасываем PID после разгона
+            if (previousState == STATE_STARTING) {
                 pidController.reset();
-                break;
-                
-            case STATE_ERROR:
-                // Аварийная остановка
-                phaseController.emergencyStop();
-                break;
-                
-            default:
-                break;
-        }
+            }
+            break;
+            
+        case STATE_IDLE:
+            // Сбрасываем PID при остановке
+            pidController.reset();
+            
+            // После сброса ошибки снова разрешаем управление фазами
+            if (previousState == STATE_ERROR) {
+                if (!ControlIO::isReplaying()) {
+                    SafetySupervisor::clearTrip();
+                }
+                emergencyStopFlag = false;
+                phaseController.start();
+            }
+            break;
+            
+        case STATE_ERROR:
+            // Аварийная остановка
+            emergencyStopFlag = true;
+            currentTargetPower = 0.0;
+            phaseController.emergencyStop();
+            stages.allOff(ControlIO::nowMs());
+            ramp.reset();
+            
+            // Режим по профилю не продолжается после ошибки
+            if (profileMode != PROFILE_MODE_NONE) {
+                LOG_W(SYSTEM, "Режим %s прерван ошибкой", getProfileModeName(profileMode));
+                profileEngine.stop();
+                profileMode = PROFILE_MODE_NONE;
+            }
+            break;
+            
+        default:
+            break;
     }
+    
+    // Частота CPU на время нагрева (CPU_FREQ_CONTROL_MHZ)
+    if (!ControlIO::isReplaying()) {
+        CpuFrequency::setHeld(CpuFrequency::LOCK_CONTROL, newState != STATE_IDLE && newState != STATE_ERROR);
+    }
+}
+
+void SystemController::setOutputPower(float power) {
+    // Любое изменение запроса ограничено по скорости RampEngine
+    float ramped = ramp.update(power, ControlIO::nowUs());
+    unsigned long now = ControlIO::nowMs();
+    float triacCommand = stages.update(ramped, now);
+    powerLoop.setStagePower(stages.getActivePowerW());
+    phaseController.setTargetPower(powerLoop.update(triacCommand, now));
 }
 
 void SystemController::startRampUp(float targetPower) {
-    rampStartPower = currentTargetPower;
     rampTargetPower = targetPower;
 }
 
 void SystemController::updateRampUp() {
-    unsigned long elapsed = millis() - stateStartTime;
-    
-    if (elapsed >= rampUpTime) {
-        // Разгон завершен
-        currentTargetPower = rampTargetPower;
-    } else {
-        // Линейный разгон
-        float progress = (float)elapsed / rampUpTime;
-        currentTargetPower = rampStartPower + (rampTargetPower - rampStartPower) * progress;
-    }
-    
-    phaseController.setTargetPower(currentTargetPower);
+    // Скорость разгона - RampEngine (rampUpTimeMs - время 0 -> 100%)
+    setOutputPower(applyProfilePower(rampTargetPower));
+    currentTargetPower = ramp.getOutput();
 }
 
-bool SystemController::checkSafetyConditions() {
-    // Проверяем критические условия
-    if (currentTemperature > maxTemperature + 5.0) {
-        return false; // Перегрев
-    }
+void SystemController::configureRamp() {
+    float upRate = rampUpTime > 0 ? 100000.0 / rampUpTime : RAMP_INSTANT_RATE;
+    ramp.configure((RampEngine::Profile)ConfigRegistry::getUInt(PARAM_RAMP_PROFILE), upRate,
+                   ConfigRegistry::get(PARAM_RAMP_DOWN_RATE), ConfigRegistry::get(PARAM_RAMP_CURRENT_LIMIT));
+}
+
+// ========================================
+// РЕЖИМЫ ПО ПРОФИЛЮ
+// ========================================
+
+void SystemController::updateProfile() {
+    if (profileMode == PROFILE_MODE_NONE) return;
     
-    if (currentTemperature < -5.0) {
-        return false; // Некорректные показания датчика
-    }
+    // Время профиля идет только при нагреве: без потока ТЭНы выключены,
+    // и удержание температуры или мощности не выполняется
+    bool heating = currentState == STATE_STARTING || currentState == STATE_HEATING ||
+                   currentState == STATE_COOLING_DOWN;
+    profileEngine.update(ControlIO::nowMs(), heating);
     
-    if (emergencyStopFlag) {
-        return false; // Аварийная остановка
+    if (profileEngine.isFinished()) {
+        LOG_I(SYSTEM, "Режим %s завершен", getProfileModeName(profileMode));
+        profileMode = PROFILE_MODE_NONE;
+        postEvent(EVENT_SETPOINT_CHANGED);
     }
+}
+
+float SystemController::applyProfilePower(float power) const {
+    if (profileMode == PROFILE_MODE_NONE) return power;
     
-    return true;
+    switch (profileEngine.getTarget()) {
+        case ProfileEngine::TARGET_POWER:
+            return profileEngine.getValue();
+        case ProfileEngine::TARGET_POWER_LIMIT:
+            return min(power, profileEngine.getValue());
+        default:
+            return power;
+    }
 }
 
-void SystemController::emergencyShutdown() {
-    transitionToState(STATE_ERROR);
-    emergencyStopFlag = true;
+void SystemController::updateDisinfection() {
+    bool canHeat = heatingEnabled && !emergencyStopFlag && currentState != STATE_ERROR;
+    DisinfectionScheduler::Action action = disinfection.update(
+        ControlIO::nowMs(), flowDetected, canHeat, currentTemperature,
+        profileMode == PROFILE_MODE_DISINFECTION, energyMeter.getTotalEnergyKWh());
+    
+    switch (action) {
+        case DisinfectionScheduler::ACTION_START:
+            startProfile(PROFILE_MODE_DISINFECTION);
+            break;
+        case DisinfectionScheduler::ACTION_STOP:
+            stopProfile();
+            break;
+        default:
+            break;
+    }
 }
 
 // ========================================
@@ -326,32 +608,88 @@ void SystemController::emergencyShutdown() {
 // ========================================
 
 void SystemController::enableHeating() {
+    ControlIO::command(ControlIO::COMMAND_ENABLE);
     heatingEnabled = true;
+    postEvent(EVENT_USER_START);
 }
 
 void SystemController::disableHeating() {
+    ControlIO::command(ControlIO::COMMAND_DISABLE);
     heatingEnabled = false;
-    transitionToState(STATE_IDLE);
+    postEvent(EVENT_USER_STOP);
 }
 
 void SystemController::emergencyStop() {
-    emergencyStopFlag = true;
-    emergencyShutdown();
+    ControlIO::command(ControlIO::COMMAND_EMERGENCY_STOP);
+    
+    // Отключаем нагрев сразу, не дожидаясь следующего цикла
+    postEvent(EVENT_EMERGENCY_STOP);
+    processEvents();
 }
 
 void SystemController::reset() {
-    emergencyStopFlag = false;
+    ControlIO::command(ControlIO::COMMAND_RESET);
     heatingEnabled = false;
-    transitionToState(STATE_IDLE);
-    pidController.reset();
+    postEvent(EVENT_RESET);
+}
+
+void SystemController::applyConfig() {
+    // Сначала диапазон, затем цель: setTargetTemperature проверяет диапазон
+    setTemperatureRange(ConfigRegistry::get(PARAM_MIN_TEMP), ConfigRegistry::get(PARAM_MAX_TEMP));
+    setTargetTemperature(ConfigRegistry::get(PARAM_TARGET_TEMP));
+    setMinFlowRate(ConfigRegistry::get(PARAM_MIN_FLOW_RATE));
+    setRampUpTime(ConfigRegistry::getUInt(PARAM_RAMP_UP_TIME));
+    
+    sensors.setCalibrationFactor(ConfigRegistry::get(PARAM_FLOW_CALIBRATION));
+    sensors.setTemperatureOffset(TEMP_CHANNEL_OUTLET, ConfigRegistry::get(PARAM_OUTLET_TEMP_OFFSET));
+    sensors.setTemperatureOffset(TEMP_CHANNEL_INLET, ConfigRegistry::get(PARAM_INLET_TEMP_OFFSET));
+    
+    float integralLimit = ConfigRegistry::get(PARAM_PID_INTEGRAL_LIMIT);
+    pidController.setTunings(ConfigRegistry::get(PARAM_PID_KP),
+                             ConfigRegistry::get(PARAM_PID_KI),
+                             ConfigRegistry::get(PARAM_PID_KD));
+    pidController.setIntegralLimits(-integralLimit, integralLimit);
+    pidController.setComputeInterval(ConfigRegistry::getUInt(PARAM_PID_INTERVAL));
+    
+    phaseController.setFireDelayLimits(ConfigRegistry::getUInt(PARAM_MIN_FIRE_DELAY),
+                                       ConfigRegistry::getUInt(PARAM_MAX_FIRE_DELAY));
+    phaseController.setTriacPulse(ConfigRegistry::getUInt(PARAM_TRIAC_PULSE));
+    stages.configure(ConfigRegistry::get(PARAM_RELAY_STAGE_POWER), 3 * ConfigRegistry::get(PARAM_ELEMENT_POWER),
+                     ConfigRegistry::getUInt(PARAM_RELAY_MIN_ON) * 1000UL,
+                     ConfigRegistry::getUInt(PARAM_RELAY_MIN_OFF) * 1000UL);
+    powerLoop.configure(3 * ConfigRegistry::get(PARAM_ELEMENT_POWER));
+    
+    energyMeter.setElementPower(ConfigRegistry::get(PARAM_ELEMENT_POWER));
+    energyMeter.setTariff(ConfigRegistry::get(PARAM_ENERGY_TARIFF));
+    
+    disinfection.configure(ConfigRegistry::getUInt(PARAM_DISINFECTION_INTERVAL),
+                           ConfigRegistry::get(PARAM_DISINFECTION_TEMP),
+                           ConfigRegistry::getUInt(PARAM_DISINFECTION_HOLD));
+    
+    // Встроенный профиль следует за настройками; загруженный, ставший
+    // несовместимым с ними, заменяется встроенным (до перезапуска)
+    if (!disinfectionCustom || !isDisinfectionConsistent(profiles[PROFILE_MODE_DISINFECTION])) {
+        if (disinfectionCustom) {
+            LOG_W(SYSTEM, "Профиль disinfection не набирает удержание при новых настройках, используется встроенный");
+        }
+        buildDefaultProfile(PROFILE_MODE_DISINFECTION, profiles[PROFILE_MODE_DISINFECTION]);
+        disinfectionCustom = false;
+    }
 }
 
 void SystemController::setMinFlowRate(float flowRate) {
+    if (flowRate != minFlowRate) {
+        ControlIO::command(ControlIO::COMMAND_MIN_FLOW, flowRate);
+    }
     minFlowRate = flowRate;
 }
 
 void SystemController::setTargetTemperature(float temperature) {
     if (temperature >= minTemperature && temperature <= maxTemperature) {
+        if (temperature != targetTemperature) {
+            ControlIO::command(ControlIO::COMMAND_TARGET_TEMP, temperature);
+            postEvent(EVENT_SETPOINT_CHANGED);
+        }
         targetTemperature = temperature;
         pidController.setSetpoint(temperature);
     }
@@ -373,6 +711,65 @@ void SystemController::setTemperatureRange(float minTemp, float maxTemp) {
 
 void SystemController::setRampUpTime(unsigned long timeMs) {
     rampUpTime = timeMs;
+    configureRamp();
+}
+
+bool SystemController::startProfile(ProfileMode mode) {
+    if (mode < 0 || mode >= PROFILE_MODE_COUNT) return false;
+    if (!profileEngine.load(profiles[mode])) return false;
+    
+    ControlIO::command(ControlIO::COMMAND_PROFILE, mode);
+    profileEngine.start(ControlIO::nowMs());
+    profileMode = mode;
+    LOG_I(SYSTEM, "Режим %s: %s, сегментов %d, проход %lu с%s", getProfileModeName(mode),
+          ProfileEngine::getTargetName(profileEngine.getTarget()), profileEngine.getSegmentCount(),
+          (unsigned long)(profileEngine.getCycleMs() / 1000), profileEngine.isLooping() ? ", по кругу" : "");
+    
+    // Целевая температура режима может быть выше текущей
+    postEvent(EVENT_SETPOINT_CHANGED);
+    return true;
+}
+
+void SystemController::stopProfile() {
+    if (profileMode == PROFILE_MODE_NONE) return;
+    
+    ControlIO::command(ControlIO::COMMAND_PROFILE, -1);
+    LOG_I(SYSTEM, "Режим %s остановлен", getProfileModeName(profileMode));
+    profileEngine.stop();
+    profileMode = PROFILE_MODE_NONE;
+    postEvent(EVENT_SETPOINT_CHANGED);
+}
+
+bool SystemController::setProfile(ProfileMode mode, const PowerProfile& profile) {
+    if (mode < 0 || mode >= PROFILE_MODE_COUNT || !ProfileEngine::isValid(profile)) return false;
+    if (mode == PROFILE_MODE_DISINFECTION) {
+        if (!isDisinfectionConsistent(profile)) {
+            LOG_W(SYSTEM, "Профиль disinfection отклонен: нужна уставка не ниже %.1f°C на %lu с",
+                  disinfectionSetpoint(), disinfectionDurationS());
+            return false;
+        }
+        disinfectionCustom = true;
+    }
+    
+    profiles[mode] = profile;
+    if (!ControlIO::isReplaying() && !ConfigStorage::saveProfiles(profiles, PROFILE_MODE_COUNT)) {
+        LOG_W(SYSTEM, "Профиль %s не сохранен во flash, действует до перезапуска", getProfileModeName(mode));
+    }
+    
+    // Идущий режим начинается заново с новым профилем
+    if (profileMode == mode) {
+        profileEngine.load(profile);
+        profileEngine.start(ControlIO::nowMs());
+    }
+    return true;
+}
+
+void SystemController::resetProfile(ProfileMode mode) {
+    if (mode < 0 || mode >= PROFILE_MODE_COUNT) return;
+    PowerProfile profile;
+    buildDefaultProfile(mode, profile);
+    setProfile(mode, profile);
+    if (mode == PROFILE_MODE_DISINFECTION) disinfectionCustom = false;
 }
 
 SystemController::SystemState SystemController::getState() const {
@@ -411,6 +808,25 @@ float SystemController::getTargetTemperature() const {
     return targetTemperature;
 }
 
+SystemController::ProfileMode SystemController::getProfileMode() const {
+    return profileMode;
+}
+
+const PowerProfile& SystemController::getProfile(ProfileMode mode) const {
+    return profiles[mode];
+}
+
+const ProfileEngine& SystemController::getProfileEngine() const {
+    return profileEngine;
+}
+
+float SystemController::getActiveSetpoint() const {
+    if (profileMode != PROFILE_MODE_NONE && profileEngine.getTarget() == ProfileEngine::TARGET_SETPOINT) {
+        return profileEngine.getValue();
+    }
+    return targetTemperature;
+}
+
 float SystemController::getMinTemperature() const {
     return minTemperature;
 }
@@ -427,3 +843,98 @@ SensorManager& SystemController::getSensors() {
 const SensorManager& SystemController::getSensors() const {
     return sensors;
 }
+
+const PhaseController& SystemController::getPhaseController() const {
+    return phaseController;
+}
+
+const PIDController& SystemController::getPIDController() const {
+    return pidController;
+}
+
+const StageController& SystemController::getStageController() const {
+    return stages;
+}
+
+const PowerLoop& SystemController::getPowerLoop() const {
+    return powerLoop;
+}
+
+const RampEngine& SystemController::getRampEngine() const {
+    return ramp;
+}
+
+DisinfectionScheduler& SystemController::getDisinfection() {
+    return disinfection;
+}
+
+const DisinfectionScheduler& SystemController::getDisinfection() const {
+    return disinfection;
+}
+
+EnergyMeter& SystemController::getEnergyMeter() {
+    return energyMeter;
+}
+
+const EnergyMeter& SystemController::getEnergyMeter() const {
+    return energyMeter;
+}
+
+int SystemController::getTraceCount() const {
+    return traceCount;
+}
+
+const SystemController::TransitionRecord& SystemController::getTraceEntry(int index) const {
+    int oldest = (traceHead - traceCount + CONTROLLER_TRACE_SIZE) % CONTROLLER_TRACE_SIZE;
+    return trace[(oldest + index) % CONTROLLER_TRACE_SIZE];
+}
+
+unsigned long SystemController::getDroppedEventCount() const {
+    return droppedEvents;
+}
+
+const char* SystemController::getStateName(SystemState state) {
+    switch (state) {
+        case STATE_IDLE:         return "IDLE";
+        case STATE_STARTING:     return "STARTING";
+        case STATE_HEATING:      return "HEATING";
+        case STATE_COOLING_DOWN: return "COOLING_DOWN";
+        case STATE_ERROR:        return "ERROR";
+        default:                 return "UNKNOWN";
+    }
+}
+
+const char* SystemController::getEventName(ControllerEvent event) {
+    switch (event) {
+        case EVENT_FLOW_STARTED:     return "FlowStarted";
+        case EVENT_FLOW_STOPPED:     return "FlowStopped";
+        case EVENT_RAMP_DONE:        return "RampDone";
+        case EVENT_NEAR_SETPOINT:    return "NearSetpoint";
+        case EVENT_BELOW_SETPOINT:   return "BelowSetpoint";
+        case EVENT_SETPOINT_CHANGED: return "SetpointChanged";
+        case EVENT_OVER_TEMP:        return "OverTemp";
+        case EVENT_SENSOR_FAULT:     return "SensorFault";
+        case EVENT_USER_START:       return "UserStart";
+        case EVENT_USER_STOP:        return "UserStop";
+        case EVENT_EMERGENCY_STOP:   return "EmergencyStop";
+        case EVENT_RESET:            return "Reset";
+        case EVENT_SAFETY_TRIP:      return "SafetyTrip";
+        default:                     return "Unknown";
+    }
+}
+
+const char* SystemController::getProfileModeName(ProfileMode mode) {
+    switch (mode) {
+        case PROFILE_MODE_PREHEAT:      return "preheat";
+        case PROFILE_MODE_DISINFECTION: return "disinfection";
+        case PROFILE_MODE_BURN_IN:      return "burnin";
+        default:                        return "none";
+    }
+}
+
+int SystemController::findProfileMode(const char* name) {
+    for (int mode = 0; mode < PROFILE_MODE_COUNT; mode++) {
+        if (strcasecmp(getProfileModeName((ProfileMode)mode), name) == 0) return mode;
+    }
+    return -1;
+}
@@ -5,6 +5,12 @@
 #include "sensors.h"
 #include "phase_controller.h"
 #include "pid_controller.h"
+#include "energy_meter.h"
+#include "stage_controller.h"
+#include "power_loop.h"
+#include "ramp_engine.h"
+#include "profile_engine.h"
+#include "disinfection_scheduler.h"
 #include "config.h"
 
 class SystemController {
@@ -16,18 +22,81 @@ public:
         STATE_COOLING_DOWN,   // Плавное снижение мощности
         STATE_ERROR           // Ошибка системы
     };
+    static const int STATE_COUNT = STATE_ERROR + 1;
+    
+    // События машины состояний. Датчики, защита и команды пользователя
+    // только ставят события в очередь, переходы выполняет таблица
+    enum ControllerEvent {
+        EVENT_FLOW_STARTED,     // Поток выше минимума дольше FLOW_DEBOUNCE_MS
+        EVENT_FLOW_STOPPED,
+        EVENT_RAMP_DONE,        // Разгон завершен
+        EVENT_NEAR_SETPOINT,    // Температура близко к целевой
+        EVENT_BELOW_SETPOINT,   // Температура заметно ниже целевой
+        EVENT_SETPOINT_CHANGED,
+        EVENT_OVER_TEMP,
+        EVENT_SENSOR_FAULT,
+        EVENT_USER_START,
+        EVENT_USER_STOP,
+        EVENT_EMERGENCY_STOP,
+        EVENT_RESET,
+        EVENT_SAFETY_TRIP,      // Сработал супервизор безопасности
+        EVENT_COUNT
+    };
+    
+    // Режимы по профилю времени (ProfileEngine), поверх обычного нагрева
+    enum ProfileMode {
+        PROFILE_MODE_NONE = -1,
+        PROFILE_MODE_PREHEAT,       // Предел мощности нарастает (холодный пуск)
+        PROFILE_MODE_DISINFECTION,  // Температура выше обычной (термодезинфекция)
+        PROFILE_MODE_BURN_IN,       // Циклы мощности (обкатка новой установки)
+        PROFILE_MODE_COUNT
+    };
+    
+    // Условие перехода
+    enum TransitionGuard {
+        GUARD_NONE,
+        GUARD_CAN_HEAT          // Есть поток, нагрев разрешен
+    };
+    
+    // Строка таблицы переходов (system_controller.cpp)
+    struct Transition {
+        uint8_t from;
+        uint8_t event;
+        uint8_t to;
+        uint8_t guard;
+    };
+    
+    // Запись журнала переходов
+    struct TransitionRecord {
+        uint32_t timeMs;
+        uint8_t from;
+        uint8_t to;
+        uint8_t event;
+    };
 
 private:
     // Компоненты системы
     SensorManager sensors;
     PhaseController phaseController;
+    StageController stages;       // Ступени на реле поверх триаков
+    PowerLoop powerLoop;          // Поправка команды триакам по измеренной мощности
+    RampEngine ramp;              // Скорость изменения запроса мощности (%/с)
     PIDController pidController;
+    EnergyMeter energyMeter;
+    
+    // Профили режимов (встроенные или загруженные через /config)
+    PowerProfile profiles[PROFILE_MODE_COUNT];
+    ProfileEngine profileEngine;
+    ProfileMode profileMode;
+    bool disinfectionCustom;              // Профиль термодезинфекции загружен, а не встроенный
+    DisinfectionScheduler disinfection;   // Запуск режима термодезинфекции по расписанию
     
     // Состояние системы
     SystemState currentState;
     SystemState previousState;
     unsigned long stateStartTime;
     unsigned long lastUpdateTime;
+    unsigned long lastDebugTime;
     
     // Настройки системы
     float minFlowRate;        // Минимальный поток для включения (л/мин)
@@ -36,9 +105,8 @@ private:
     float maxTemperature;     // Максимальная температура (°C)
     
     // Плавный запуск
-    unsigned long rampUpTime; // Время разгона до полной мощности (мс)
+    unsigned long rampUpTime; // Время разгона 0 -> 100% (мс), задает скорость роста
     float currentTargetPower; // Текущая целевая мощность
-    float rampStartPower;     // Мощность в начале разгона
     float rampTargetPower;    // Целевая мощность разгона
     
     // Состояние нагрева
@@ -47,27 +115,44 @@ private:
     float currentFlowRate;
     float currentTemperature;
     
+    bool flowCandidate;               // Состояние потока, ожидающее подтверждения
+    unsigned long flowCandidateSince;
+    
     // Защитные функции
     bool emergencyStopFlag;
-    unsigned long lastFlowCheckTime;
-    static const unsigned long FLOW_CHECK_INTERVAL_MS = 500;
+    
+    // Очередь событий (кольцевой буфер)
+    ControllerEvent eventQueue[EVENT_QUEUE_SIZE];
+    int eventHead;
+    int eventCount;
+    unsigned long droppedEvents;
+    
+    // Журнал последних переходов
+    TransitionRecord trace[CONTROLLER_TRACE_SIZE];
+    int traceHead;
+    int traceCount;
     
     // Методы
     void updateSensors();
-    void updateStateMachine();
+    void detectEvents();
+    void processEvents();
+    void dispatch(ControllerEvent event);
+    bool checkGuard(uint8_t guard) const;
+    void runStateActions();
     void handleIdleState();
     void handleStartingState();
     void handleHeatingState();
     void handleCoolingDownState();
     void handleErrorState();
     
-    void transitionToState(SystemState newState);
+    void transitionToState(SystemState newState, ControllerEvent event);
     void startRampUp(float targetPower);
+    void setOutputPower(float power);   // Запрос всей установки: скорость, ступени, триаки
+    void configureRamp();
     void updateRampUp();
-    
-    // Защитные функции
-    bool checkSafetyConditions();
-    void emergencyShutdown();
+    void updateProfile();
+    float applyProfilePower(float power) const;
+    void updateDisinfection();
 
 public:
     SystemController();
@@ -84,12 +169,34 @@ public:
     void emergencyStop();
     void reset();
     
+    // Событие в очередь (обрабатывается в update)
+    void postEvent(ControllerEvent event);
+    
     // Настройки
     void setMinFlowRate(float flowRate);
     void setTargetTemperature(float temperature);
     void setTemperatureRange(float minTemp, float maxTemp);
     void setRampUpTime(unsigned long timeMs);
     
+    // Применение всех параметров ConfigRegistry (без перезапуска)
+    void applyConfig();
+    
+    // Режимы по профилю: время профиля идет, пока есть нагрев (поток)
+    bool startProfile(ProfileMode mode);
+    void stopProfile();
+    bool setProfile(ProfileMode mode, const PowerProfile& profile);  // Проверка и запись во flash
+    void resetProfile(ProfileMode mode);                             // Встроенный профиль
+    ProfileMode getProfileMode() const;
+    const PowerProfile& getProfile(ProfileMode mode) const;
+    const ProfileEngine& getProfileEngine() const;
+    float getActiveSetpoint() const;    // С учетом профиля температуры
+    static const char* getProfileModeName(ProfileMode mode);
+    static int findProfileMode(const char* name);                   // -1, если не найден
+    
+    // Термодезинфекция по расписанию (запрос, отмена, журнал результатов)
+    DisinfectionScheduler& getDisinfection();
+    const DisinfectionScheduler& getDisinfection() const;
+    
     // Получение состояния
     SystemState getState() const;
     float getCurrentFlowRate() const;
@@ -99,6 +206,13 @@ public:
     bool isEmergencyStop() const;
     bool isWaterFlowing() const;
     
+    // Журнал переходов: index 0 - самый старый
+    int getTraceCount() const;
+    const TransitionRecord& getTraceEntry(int index) const;
+    unsigned long getDroppedEventCount() const;
+    static const char* getStateName(SystemState state);
+    static const char* getEventName(ControllerEvent event);
+    
     // Получение настроек
     float getMinFlowRate() const;
     float getTargetTemperature() const;
@@ -108,6 +222,17 @@ public:
     // Методы для работы с датчиками
     SensorManager& getSensors();
     const SensorManager& getSensors() const;
+    
+    // Доступ к регуляторам (для телеметрии и диагностики)
+    const PhaseController& getPhaseController() const;
+    const PIDController& getPIDController() const;
+    const StageController& getStageController() const;
+    const PowerLoop& getPowerLoop() const;
+    const RampEngine& getRampEngine() const;
+    
+    // Учет энергии
+    EnergyMeter& getEnergyMeter();
+    const EnergyMeter& getEnergyMeter() const;
 };
 
 #endif
@@ -2,13 +2,18 @@
 #include "config_storage.h"
 
 bool SystemState::saveConfiguration() {
-    return ConfigStorage::saveConfig(*this);
+    return ConfigStorage::saveConfig();
 }
 
 bool SystemState::loadConfiguration() {
-    return ConfigStorage::loadConfig(*this);
+    bool result = ConfigStorage::loadConfig();
+    targetTemp = ConfigRegistry::get(PARAM_TARGET_TEMP);
+    flowCalibrationFactor = ConfigRegistry::get(PARAM_FLOW_CALIBRATION);
+    return result;
 }
 
 void SystemState::resetConfiguration() {
-    ConfigStorage::resetToDefaults(*this);
+    ConfigStorage::resetToDefaults();
+    targetTemp = ConfigRegistry::get(PARAM_TARGET_TEMP);
+    flowCalibrationFactor = ConfigRegistry::get(PARAM_FLOW_CALIBRATION);
 }
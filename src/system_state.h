@@ -7,6 +7,8 @@
 struct SystemState {
     // Основные параметры
     float currentTemp;              // Текущая температура (°C)
+    float inletTemp;                // Температура на входе (°C)
+    bool isInletMeasured;           // Датчик на входе (иначе оценка)
     float targetTemp;               // Целевая температура (°C)
     float flowRate;                 // Скорость потока (л/мин)
     float flowCalibrationFactor;    // Коэффициент калибровки потока
@@ -23,6 +25,13 @@ struct SystemState {
     float targetPower[3];           // Целевая мощность по фазам (0-100%)
     float currentTargetPower;       // Текущая целевая мощность
     
+    // Учет энергии
+    float deliveredPowerW;          // Отдаваемая мощность (Вт)
+    double energyPhaseKWh[3];       // Энергия по фазам (кВт*ч)
+    double energyTotalKWh;          // Суммарная энергия (кВт*ч)
+    double litresHeated;            // Объем нагретой воды (л)
+    double energyCost;              // Стоимость энергии
+    
     // Режим работы системы
     int systemMode;                 // Режим работы (SYSTEM_MODE_*)
     bool isWiFiEnabled;            // WiFi включен
@@ -36,6 +45,8 @@ struct SystemState {
     // Конструктор с инициализацией по умолчанию
     SystemState() {
         currentTemp = 25.0;
+        inletTemp = INLET_TEMP_DEFAULT;
+        isInletMeasured = false;
         targetTemp = TARGET_TEMP_DEFAULT;
         flowRate = 0.0;
         flowCalibrationFactor = FLOW_CALIBRATION_FACTOR;
@@ -49,9 +60,14 @@ struct SystemState {
         for (int i = 0; i < 3; i++) {
             heatingPower[i] = 0.0;
             targetPower[i] = 0.0;
+            energyPhaseKWh[i] = 0.0;
         }
         
         currentTargetPower = 0.0;
+        deliveredPowerW = 0.0;
+        energyTotalKWh = 0.0;
+        litresHeated = 0.0;
+        energyCost = 0.0;
         
         systemMode = SYSTEM_MODE_ACTIVE;
         isWiFiEnabled = false;
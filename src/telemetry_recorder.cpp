@@ -0,0 +1,383 @@
+#include "telemetry_recorder.h"
+#include "system_controller.h"
+#include "memory_monitor.h"
+
+// Масштабы каналов: значение в единицах измерения = целое * масштаб
+static const float CHANNEL_SCALES[TELEMETRY_CHANNEL_COUNT] = {
+    1.0,    // время, мс
+    0.01,   // температура, °C
+    0.01,   // поток, л/мин
+    0.1,    // мощность L1, %
+    0.1,    // мощность L2, %
+    0.1,    // мощность L3, %
+    0.01,   // ПИД P, %
+    0.01,   // ПИД I, %
+    0.01,   // ПИД D, %
+    0.01,   // частота, Гц
+    1.0     // состояние
+};
+
+static const char* const CHANNEL_NAMES[TELEMETRY_CHANNEL_COUNT] = {
+    "time_ms", "temperature", "flow", "power_l1", "power_l2", "power_l3",
+    "pid_p", "pid_i", "pid_d", "frequency", "state"
+};
+
+// Декодированный блок для экспорта (не на стеке loop)
+static int32_t exportBuffer[TELEMETRY_CHANNEL_COUNT][TELEMETRY_BLOCK_SAMPLES];
+
+TelemetryRecorder::TelemetryRecorder()
+    : buffer(nullptr)
+    , capacity(0)
+    , writeOffset(0)
+    , blocks(nullptr)
+    , maxBlocks(0)
+    , blockHead(0)
+    , blockCount(0)
+    , usedBytes(0)
+    , stagingCount(0)
+    , stagingFirstSample(0)
+    , totalSamples(0)
+    , sampleRateHz(TELEMETRY_SAMPLE_RATE_HZ)
+    , samplePeriodUs(1000000UL / TELEMETRY_SAMPLE_RATE_HZ)
+    , lastSampleTime(0) {
+}
+
+bool TelemetryRecorder::begin(size_t bufferBytes) {
+    if (buffer != nullptr) return true;
+
+    // Размер блока не может быть меньше ~2 байт на колонку
+    maxBlocks = bufferBytes / (TELEMETRY_CHANNEL_COUNT * 2) + 1;
+
+    buffer = (uint8_t*)MemoryMonitor::allocate(MEM_TELEMETRY, bufferBytes, true);
+    blocks = (BlockDescriptor*)MemoryMonitor::allocate(MEM_TELEMETRY, maxBlocks * sizeof(BlockDescriptor));
+
+    if (buffer == nullptr || blocks == nullptr) {
+        MemoryMonitor::release(MEM_TELEMETRY, buffer);
+        MemoryMonitor::release(MEM_TELEMETRY, blocks);
+        buffer = nullptr;
+        blocks = nullptr;
+        capacity = 0;
+        if (DEBUG_SERIAL) {
+            Serial.println("Телеметрия: не удалось выделить буфер");
+        }
+        return false;
+    }
+
+    capacity = bufferBytes;
+    clear();
+    lastSampleTime = micros();
+
+    if (DEBUG_SERIAL) {
+        Serial.printf("Телеметрия: буфер %u байт, %d Гц\n", (unsigned)capacity, sampleRateHz);
+    }
+    return true;
+}
+
+void TelemetryRecorder::update(const SystemController& controller) {
+    if (buffer == nullptr) return;
+
+    unsigned long currentTime = micros();
+    if (currentTime - lastSampleTime < samplePeriodUs) return;
+
+    // Держим сетку отсчетов без накопления ошибки; после долгой паузы начинаем заново
+    lastSampleTime += samplePeriodUs;
+    if (currentTime - lastSampleTime >= samplePeriodUs) {
+        lastSampleTime = currentTime;
+    }
+
+    const PhaseController& phase = controller.getPhaseController();
+    const PIDController& pid = controller.getPIDController();
+
+    int32_t values[TELEMETRY_CHANNEL_COUNT];
+    values[TELEMETRY_TIME_MS] = millis();
+    values[TELEMETRY_TEMPERATURE] = lroundf(controller.getCurrentTemperature() * 100.0);
+    values[TELEMETRY_FLOW] = lroundf(controller.getCurrentFlowRate() * 100.0);
+    // Фактическая мощность каждой фазы (при потере фазы остальные отдают больше)
+    for (int i = 0; i < 3; i++) {
+        values[TELEMETRY_POWER_L1 + i] = lroundf(phase.getDeliveredPowerFraction(i) * 1000.0);
+    }
+    values[TELEMETRY_PID_P] = lroundf(pid.getLastProportional() * 100.0);
+    values[TELEMETRY_PID_I] = lroundf(pid.getLastIntegralTerm() * 100.0);
+    values[TELEMETRY_PID_D] = lroundf(pid.getLastDerivativeTerm() * 100.0);
+    values[TELEMETRY_FREQUENCY] = lroundf(phase.getFrequency() * 100.0);
+    values[TELEMETRY_STATE] = controller.getState();
+
+    record(values);
+}
+
+void TelemetryRecorder::record(const int32_t* values) {
+    if (buffer == nullptr) return;
+
+    if (stagingCount == 0) {
+        stagingFirstSample = totalSamples;
+    }
+
+    for (int ch = 0; ch < TELEMETRY_CHANNEL_COUNT; ch++) {
+        staging[ch][stagingCount] = values[ch];
+    }
+    stagingCount++;
+    totalSamples++;
+
+    if (stagingCount >= TELEMETRY_BLOCK_SAMPLES) {
+        flushBlock();
+    }
+}
+
+bool TelemetryRecorder::setSampleRate(int hz) {
+    if (hz < TELEMETRY_RATE_MIN_HZ || hz > TELEMETRY_RATE_MAX_HZ) {
+        return false;
+    }
+
+    // Смена частоты начинает новую запись, чтобы время в блоках было равномерным
+    sampleRateHz = hz;
+    samplePeriodUs = 1000000UL / hz;
+    clear();
+    return true;
+}
+
+int TelemetryRecorder::getSampleRate() const {
+    return sampleRateHz;
+}
+
+void TelemetryRecorder::clear() {
+    writeOffset = 0;
+    blockHead = 0;
+    blockCount = 0;
+    usedBytes = 0;
+    stagingCount = 0;
+    totalSamples = 0;
+    lastSampleTime = micros();
+}
+
+// ========================================
+// СЖАТИЕ БЛОКОВ
+// ========================================
+
+void TelemetryRecorder::flushBlock() {
+    if (stagingCount == 0) return;
+
+    // Первый проход считает размер, второй пишет прямо в кольцевой буфер
+    size_t size = encodeBlock(nullptr, stagingCount);
+    if (size > capacity) {
+        stagingCount = 0;
+        return;
+    }
+
+    // Не помещается до конца буфера - освобождаем хвост и переходим в начало
+    if (writeOffset + size > capacity) {
+        while (blockCount > 0 && blocks[blockHead].offset >= writeOffset) {
+            evictOldest();
+        }
+        writeOffset = 0;
+    }
+
+    // Освобождаем место, занятое самыми старыми блоками
+    while (blockCount > 0) {
+        const BlockDescriptor& oldest = blocks[blockHead];
+        bool overlaps = oldest.offset < writeOffset + size &&
+                        oldest.offset + oldest.payloadBytes > writeOffset;
+        if (!overlaps && blockCount < maxBlocks) break;
+        evictOldest();
+    }
+
+    encodeBlock(buffer + writeOffset, stagingCount);
+
+    BlockDescriptor& block = blocks[(blockHead + blockCount) % maxBlocks];
+    block.offset = writeOffset;
+    block.firstSample = stagingFirstSample;
+    block.sampleCount = stagingCount;
+    block.payloadBytes = size;
+    blockCount++;
+
+    writeOffset += size;
+    usedBytes += size;
+    stagingCount = 0;
+}
+
+void TelemetryRecorder::evictOldest() {
+    usedBytes -= blocks[blockHead].payloadBytes;
+    blockHead = (blockHead + 1) % maxBlocks;
+    blockCount--;
+}
+
+size_t TelemetryRecorder::encodeBlock(uint8_t* out, int count) const {
+    size_t pos = 0;
+
+    for (int ch = 0; ch < TELEMETRY_CHANNEL_COUNT; ch++) {
+        // Время идет с постоянным шагом - кодируем разности второго порядка
+        bool secondOrder = (ch == TELEMETRY_TIME_MS);
+        int32_t prev = 0;
+        int32_t prevDelta = 0;
+        uint32_t zeroRun = 0;
+
+        for (int i = 0; i < count; i++) {
+            int32_t value = staging[ch][i];
+            int32_t delta = (int32_t)((uint32_t)value - (uint32_t)prev);
+            int32_t residual = secondOrder ? (int32_t)((uint32_t)delta - (uint32_t)prevDelta) : delta;
+            prevDelta = (i > 0) ? delta : 0;
+            prev = value;
+
+            if (residual == 0 && i > 0) {
+                zeroRun++;
+                continue;
+            }
+
+            if (zeroRun > 0) {
+                pos += writeVarint(out ? out + pos : nullptr, ((uint64_t)(zeroRun - 1) << 1) | 1);
+                zeroRun = 0;
+            }
+            pos += writeVarint(out ? out + pos : nullptr, (uint64_t)zigzag(residual) << 1);
+        }
+
+        if (zeroRun > 0) {
+            pos += writeVarint(out ? out + pos : nullptr, ((uint64_t)(zeroRun - 1) << 1) | 1);
+        }
+    }
+
+    return pos;
+}
+
+void TelemetryRecorder::decodeBlock(const uint8_t* data, int count, int32_t out[][TELEMETRY_BLOCK_SAMPLES]) const {
+    for (int ch = 0; ch < TELEMETRY_CHANNEL_COUNT; ch++) {
+        bool secondOrder = (ch == TELEMETRY_TIME_MS);
+        int32_t prev = 0;
+        int32_t prevDelta = 0;
+        int i = 0;
+
+        while (i < count) {
+            uint64_t token = readVarint(data);
+            uint32_t repeat = (token & 1) ? (uint32_t)(token >> 1) + 1 : 1;
+            int32_t residual = (token & 1) ? 0 : unzigzag((uint32_t)(token >> 1));
+
+            for (uint32_t r = 0; r < repeat && i < count; r++, i++) {
+                int32_t delta = secondOrder ? (int32_t)((uint32_t)residual + (uint32_t)prevDelta) : residual;
+                int32_t value = (int32_t)((uint32_t)prev + (uint32_t)delta);
+                prevDelta = (i > 0) ? delta : 0;
+                prev = value;
+                out[ch][i] = value;
+            }
+        }
+    }
+}
+
+size_t TelemetryRecorder::writeVarint(uint8_t* out, uint64_t value) {
+    size_t length = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if (value) byte |= 0x80;
+        if (out) out[length] = byte;
+        length++;
+    } while (value);
+    return length;
+}
+
+uint64_t TelemetryRecorder::readVarint(const uint8_t*& data) {
+    uint64_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = *data++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && shift < 64);
+    return value;
+}
+
+uint32_t TelemetryRecorder::zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+int32_t TelemetryRecorder::unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// ========================================
+// ЭКСПОРТ
+// ========================================
+
+void TelemetryRecorder::forEachSample(SampleCallback callback, void* context) {
+    if (buffer == nullptr) return;
+
+    // Незавершенный блок тоже попадает в выгрузку
+    flushBlock();
+
+    int32_t values[TELEMETRY_CHANNEL_COUNT];
+    for (int b = 0; b < blockCount; b++) {
+        const BlockDescriptor& block = blocks[(blockHead + b) % maxBlocks];
+        decodeBlock(buffer + block.offset, block.sampleCount, exportBuffer);
+
+        for (int i = 0; i < block.sampleCount; i++) {
+            for (int ch = 0; ch < TELEMETRY_CHANNEL_COUNT; ch++) {
+                values[ch] = exportBuffer[ch][i];
+            }
+            callback(values, context);
+        }
+    }
+}
+
+void TelemetryRecorder::exportBinary(ChunkCallback callback, void* context) {
+    if (buffer == nullptr) return;
+
+    flushBlock();
+
+    FileHeader header;
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.channelCount = TELEMETRY_CHANNEL_COUNT;
+    header.sampleRateHz = sampleRateHz;
+    header.blockSamples = TELEMETRY_BLOCK_SAMPLES;
+    header.blockCount = blockCount;
+    for (int ch = 0; ch < TELEMETRY_CHANNEL_COUNT; ch++) {
+        header.scales[ch] = CHANNEL_SCALES[ch];
+    }
+    callback((const uint8_t*)&header, sizeof(header), context);
+
+    for (int b = 0; b < blockCount; b++) {
+        const BlockDescriptor& block = blocks[(blockHead + b) % maxBlocks];
+        BlockHeader blockHeader;
+        blockHeader.firstSample = block.firstSample;
+        blockHeader.sampleCount = block.sampleCount;
+        blockHeader.payloadBytes = block.payloadBytes;
+        callback((const uint8_t*)&blockHeader, sizeof(blockHeader), context);
+        callback(buffer + block.offset, block.payloadBytes, context);
+    }
+}
+
+// ========================================
+// СТАТИСТИКА
+// ========================================
+
+uint32_t TelemetryRecorder::getSampleCount() const {
+    uint32_t count = stagingCount;
+    for (int b = 0; b < blockCount; b++) {
+        count += blocks[(blockHead + b) % maxBlocks].sampleCount;
+    }
+    return count;
+}
+
+uint32_t TelemetryRecorder::getTotalSamples() const {
+    return totalSamples;
+}
+
+size_t TelemetryRecorder::getUsedBytes() const {
+    return usedBytes;
+}
+
+size_t TelemetryRecorder::getCapacity() const {
+    return capacity;
+}
+
+float TelemetryRecorder::getDurationSeconds() const {
+    return (float)getSampleCount() / sampleRateHz;
+}
+
+float TelemetryRecorder::getChannelScale(int channel) {
+    if (channel < 0 || channel >= TELEMETRY_CHANNEL_COUNT) return 1.0;
+    return CHANNEL_SCALES[channel];
+}
+
+const char* TelemetryRecorder::getChannelName(int channel) {
+    if (channel < 0 || channel >= TELEMETRY_CHANNEL_COUNT) return "";
+    return CHANNEL_NAMES[channel];
+}
@@ -0,0 +1,138 @@
+#ifndef TELEMETRY_RECORDER_H
+#define TELEMETRY_RECORDER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Предварительное объявление
+class SystemController;
+
+// ========================================
+// ТЕЛЕМЕТРИЯ ВЫСОКОЙ ЧАСТОТЫ
+// ========================================
+//
+// Отсчеты квантуются в целые числа и накапливаются в блок из
+// TELEMETRY_BLOCK_SAMPLES отсчетов. Заполненный блок сжимается по колонкам:
+// для каждого канала записывается первое значение и разности между
+// соседними отсчетами (для времени - разности второго порядка). Разности
+// кодируются zigzag-varint, серии нулевых разностей - одним байтом.
+//
+// Формат двоичного дампа (/telemetry.bin, little-endian):
+//   FileHeader, затем для каждого блока BlockHeader и payloadBytes байт данных.
+//   Данные блока: TELEMETRY_CHANNEL_COUNT колонок подряд, в каждой
+//   sampleCount значений. Токен колонки - varint v (до 64 бит):
+//     v & 1 == 0 -> одна разность, zigzag(разность) = v >> 1
+//     v & 1 == 1 -> (v >> 1) + 1 нулевых разностей
+//   Первое значение колонки кодируется как разность от нуля. Арифметика
+//   разностей - по модулю 2^32 (время в мс хранится как uint32).
+
+enum TelemetryChannel {
+    TELEMETRY_TIME_MS,        // Время отсчета (мс от запуска)
+    TELEMETRY_TEMPERATURE,    // Температура, 0.01°C
+    TELEMETRY_FLOW,           // Поток, 0.01 л/мин
+    TELEMETRY_POWER_L1,       // Мощность L1, 0.1%
+    TELEMETRY_POWER_L2,       // Мощность L2, 0.1%
+    TELEMETRY_POWER_L3,       // Мощность L3, 0.1%
+    TELEMETRY_PID_P,          // Пропорциональная составляющая, 0.01%
+    TELEMETRY_PID_I,          // Интегральная составляющая, 0.01%
+    TELEMETRY_PID_D,          // Дифференциальная составляющая, 0.01%
+    TELEMETRY_FREQUENCY,      // Частота сети, 0.01 Гц
+    TELEMETRY_STATE,          // Состояние SystemController
+    TELEMETRY_CHANNEL_COUNT
+};
+
+class TelemetryRecorder {
+public:
+    struct FileHeader {
+        uint32_t magic;           // "WHTL"
+        uint16_t version;
+        uint16_t channelCount;
+        uint16_t sampleRateHz;
+        uint16_t blockSamples;
+        uint32_t blockCount;
+        float scales[TELEMETRY_CHANNEL_COUNT]; // Множитель перевода в единицы измерения
+    };
+
+    struct BlockHeader {
+        uint32_t firstSample;     // Порядковый номер первого отсчета
+        uint16_t sampleCount;
+        uint16_t payloadBytes;
+    };
+
+    static const uint32_t FILE_MAGIC = 0x4C544857; // "WHTL"
+    static const uint16_t FILE_VERSION = 1;
+
+    // Обратный вызов экспорта: один декодированный отсчет в целых единицах
+    typedef void (*SampleCallback)(const int32_t* values, void* context);
+    // Обратный вызов экспорта: фрагмент двоичного дампа
+    typedef void (*ChunkCallback)(const uint8_t* data, size_t length, void* context);
+
+    TelemetryRecorder();
+
+    // Выделение буфера (PSRAM при наличии, иначе куча)
+    bool begin(size_t bufferBytes = TELEMETRY_BUFFER_BYTES);
+
+    // Снятие отсчета, если подошло время (вызывать в loop)
+    void update(const SystemController& controller);
+    void record(const int32_t* values);
+
+    // Управление
+    bool setSampleRate(int hz);
+    int getSampleRate() const;
+    void clear();
+
+    // Экспорт (от старых отсчетов к новым)
+    void forEachSample(SampleCallback callback, void* context);
+    void exportBinary(ChunkCallback callback, void* context);
+
+    // Статистика
+    uint32_t getSampleCount() const;     // Отсчетов в буфере
+    uint32_t getTotalSamples() const;    // Отсчетов с момента запуска записи
+    size_t getUsedBytes() const;
+    size_t getCapacity() const;
+    float getDurationSeconds() const;
+
+    static float getChannelScale(int channel);
+    static const char* getChannelName(int channel);
+
+private:
+    struct BlockDescriptor {
+        uint32_t offset;
+        uint32_t firstSample;
+        uint16_t sampleCount;
+        uint16_t payloadBytes;
+    };
+
+    // Кольцевой буфер сжатых блоков
+    uint8_t* buffer;
+    size_t capacity;
+    size_t writeOffset;
+
+    BlockDescriptor* blocks;
+    int maxBlocks;
+    int blockHead;
+    int blockCount;
+    size_t usedBytes;
+
+    // Текущий несжатый блок
+    int32_t staging[TELEMETRY_CHANNEL_COUNT][TELEMETRY_BLOCK_SAMPLES];
+    int stagingCount;
+    uint32_t stagingFirstSample;
+
+    uint32_t totalSamples;
+    int sampleRateHz;
+    unsigned long samplePeriodUs;
+    unsigned long lastSampleTime;
+
+    void flushBlock();
+    size_t encodeBlock(uint8_t* out, int count) const;
+    void decodeBlock(const uint8_t* data, int count, int32_t out[][TELEMETRY_BLOCK_SAMPLES]) const;
+    void evictOldest();
+
+    static size_t writeVarint(uint8_t* out, uint64_t value);
+    static uint64_t readVarint(const uint8_t*& data);
+    static uint32_t zigzag(int32_t value);
+    static int32_t unzigzag(uint32_t value);
+};
+
+#endif
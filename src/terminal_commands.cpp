@@ -1,256 +1,804 @@
 #include "terminal_commands.h"
+#include "command_registry.h"
 #include "system_controller.h"
+#include "system_state.h"
+#include "config_registry.h"
+#include "config_storage.h"
+#include "safety_supervisor.h"
+#include "cpu_frequency.h"
+#include "perf_profiler.h"
+#include "phase_timing.h"
+#include "control_io.h"
+#include "replay_engine.h"
+#include "bench_suite.h"
+#include "memory_monitor.h"
+#include "request_arena.h"
+#include "mains_sensing.h"
 
-TerminalCommands::TerminalCommands() : systemController(nullptr), isInitialized(false) {
+// ========================================
+// ОБРАБОТЧИКИ КОМАНД
+// ========================================
+
+namespace {
+
+const char* getStateName(int state) {
+    switch (state) {
+        case 0: return "ПОКОЙ";
+        case 1: return "ЗАПУСК";
+        case 2: return "НАГРЕВ";
+        case 3: return "ПОДДЕРЖАНИЕ";
+        case 4: return "ОШИБКА";
+        default: return "НЕИЗВЕСТНО";
+    }
 }
 
-void TerminalCommands::begin(SystemController* controller) {
-    systemController = controller;
-    isInitialized = true;
-    inputBuffer = "";
+void printSeparator(Print& out) {
+    out.println("=====================================");
+}
+
+void applyParameter(CommandContext& context, const char* name, const char* value) {
+    int id = ConfigRegistry::findByName(name);
+    if (id < 0) {
+        context.out.printf("Неизвестный параметр: %s\n", name);
+        return;
+    }
     
-    Serial.println("Терминальные команды инициализированы");
+    ConfigRegistry::SetResult result = ConfigRegistry::set((ParamId)id, atof(value));
+    if (result != ConfigRegistry::SET_OK && result != ConfigRegistry::SET_OK_RESTART) {
+        context.out.printf("Ошибка: %s - %s\n", name, ConfigRegistry::getResultText(result));
+        return;
+    }
+    
+    // Применяем без перезапуска и откладываем запись во flash
+    context.controller->applyConfig();
+    if (context.state) {
+        context.state->targetTemp = ConfigRegistry::get(PARAM_TARGET_TEMP);
+        context.state->flowCalibrationFactor = ConfigRegistry::get(PARAM_FLOW_CALIBRATION);
+    }
+    ConfigStorage::saveConfig();
+    
+    char line[96];
+    ConfigRegistry::formatEntry((ParamId)id, line, sizeof(line));
+    context.out.printf("%s (%s)\n", line, ConfigRegistry::getResultText(result));
 }
 
-void TerminalCommands::update() {
-    if (!isInitialized || !systemController) return;
+void cmdHelp(const CommandArgs& args, CommandContext& context) {
+    CommandRegistry::printHelp(context.out);
+    if (CommandRegistry::isJobActive()) {
+        context.out.printf("Выполняется задание %s ('cancel' - отменить)\n", CommandRegistry::getJobName());
+    }
+}
+
+void cmdStatus(const CommandArgs& args, CommandContext& context) {
+    SystemController* controller = context.controller;
+    Print& out = context.out;
     
-    // Читаем данные из Serial
-    while (Serial.available()) {
-        char c = Serial.read();
-        
-        if (c == '\n' || c == '\r') {
-            if (inputBuffer.length() > 0) {
-                processCommand(inputBuffer);
-                inputBuffer = "";
-            }
-        } else if (c >= 32 && c <= 126) { // Печатные символы
-            inputBuffer += c;
+    printSeparator(out);
+    out.println("=== СТАТУС СИСТЕМЫ ===");
+    out.printf("Состояние: %s\n", getStateName(controller->getState()));
+    out.printf("Нагрев: %s\n", controller->isHeatingEnabled() ? "ВКЛ" : "ВЫКЛ");
+    out.printf("Аварийная остановка: %s\n", controller->isEmergencyStop() ? "ДА" : "НЕТ");
+    out.printf("Температура: %.1f°C\n", controller->getCurrentTemperature());
+    out.printf("На входе: %.1f°C (%s)\n", controller->getSensors().getInletTemperature(),
+               controller->getSensors().isInletMeasured() ? "датчик" : "оценка");
+    out.printf("Поток: %.2f л/мин\n", controller->getCurrentFlowRate());
+    out.printf("Мощность: %.1f%%\n", controller->getCurrentPower());
+    out.printf("Целевая температура: %.1f°C\n", controller->getTargetTemperature());
+    out.printf("Мин. поток: %.1f л/мин\n", controller->getMinFlowRate());
+    if (context.state) {
+        out.printf("WiFi: %s\n", context.state->isWiFiEnabled ? "ВКЛ" : "ВЫКЛ");
+    }
+    printSeparator(out);
+}
+
+void cmdTemp(const CommandArgs& args, CommandContext& context) {
+    if (args.count() > 1) {
+        applyParameter(context, "targetTemp", args.get(1));
+        return;
+    }
+    context.out.printf("Температура: %.1f°C (цель: %.1f°C)\n",
+                       context.controller->getCurrentTemperature(), context.controller->getTargetTemperature());
+}
+
+void cmdFlow(const CommandArgs& args, CommandContext& context) {
+    if (args.count() > 1) {
+        applyParameter(context, "minFlowRate", args.get(1));
+        return;
+    }
+    SystemController* controller = context.controller;
+    context.out.printf("Поток: %.2f л/мин (мин: %.1f л/мин) - %s\n", controller->getCurrentFlowRate(),
+                       controller->getMinFlowRate(), controller->isWaterFlowing() ? "ЕСТЬ" : "НЕТ");
+}
+
+void cmdFlowDiagnostics(const CommandArgs& args, CommandContext& context) {
+    const SensorManager& sensors = context.controller->getSensors();
+    Print& out = context.out;
+    
+    printSeparator(out);
+    sensors.printFlowSensorDiagnostics(out);
+    
+    out.println("=== ДОПОЛНИТЕЛЬНАЯ ИНФОРМАЦИЯ ===");
+    out.printf("Датчик работает: %s\n", sensors.isFlowSensorWorking() ? "ДА" : "НЕТ");
+    out.printf("Минимальный порог потока: %.1f л/мин\n", context.controller->getMinFlowRate());
+    out.printf("Поток обнаружен системой: %s\n", context.controller->isWaterFlowing() ? "ДА" : "НЕТ");
+    printSeparator(out);
+}
+
+void cmdEnergy(const CommandArgs& args, CommandContext& context) {
+    EnergyMeter& energy = context.controller->getEnergyMeter();
+    Print& out = context.out;
+    
+    if (args.is(1, "reset")) {
+        energy.reset();
+        out.println("Счетчики энергии сброшены");
+        return;
+    }
+    if (args.count() > 1) {
+        out.println("Использование: energy [reset]");
+        return;
+    }
+    
+    printSeparator(out);
+    out.println("=== УЧЕТ ЭНЕРГИИ ===");
+    for (int i = 0; i < 3; i++) {
+        out.printf("L%d: %.0f Вт, %.3f кВт*ч\n", i + 1,
+                   energy.getDeliveredPower(i), energy.getPhaseEnergyKWh(i));
+    }
+    out.printf("Мощность: %.0f Вт\n", energy.getTotalDeliveredPower());
+    out.printf("Всего: %.3f кВт*ч\n", energy.getTotalEnergyKWh());
+    out.printf("Нагрето воды: %.1f л\n", energy.getLitresHeated());
+    out.printf("Стоимость: %.2f\n", energy.getCost());
+    printSeparator(out);
+}
+
+void cmdTrace(const CommandArgs& args, CommandContext& context) {
+    SystemController* controller = context.controller;
+    context.out.printf("Состояние: %s\n", SystemController::getStateName(controller->getState()));
+    for (int i = 0; i < controller->getTraceCount(); i++) {
+        const SystemController::TransitionRecord& record = controller->getTraceEntry(i);
+        context.out.printf("%lu мс: %s -> %s (%s)\n", (unsigned long)record.timeMs,
+                           SystemController::getStateName((SystemController::SystemState)record.from),
+                           SystemController::getStateName((SystemController::SystemState)record.to),
+                           SystemController::getEventName((SystemController::ControllerEvent)record.event));
+    }
+}
+
+void cmdGet(const CommandArgs& args, CommandContext& context) {
+    char line[96];
+    if (args.count() > 1) {
+        int id = ConfigRegistry::findByName(args.get(1));
+        if (id < 0) {
+            context.out.printf("Неизвестный параметр: %s\n", args.get(1));
+            return;
         }
+        ConfigRegistry::formatEntry((ParamId)id, line, sizeof(line));
+        context.out.println(line);
+        return;
+    }
+    
+    context.out.println("Параметры:");
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        ConfigRegistry::formatEntry((ParamId)i, line, sizeof(line));
+        context.out.println(line);
     }
 }
 
-void TerminalCommands::processCommand(const String& command) {
-    String cmd = command;
-    cmd.toLowerCase();
-    cmd.trim();
-    
-    Serial.println("> " + command);
-    
-    if (cmd == "help" || cmd == "h" || cmd == "?") {
-        showHelp();
-    } else if (cmd == "status" || cmd == "s") {
-        showStatus();
-    } else if (cmd == "temp" || cmd == "t") {
-        showTemperature();
-    } else if (cmd == "flow" || cmd == "f") {
-        showFlow();
-    } else if (cmd == "enable" || cmd == "on") {
-        enableHeating();
-    } else if (cmd == "disable" || cmd == "off") {
-        disableHeating();
-    } else if (cmd == "stop" || cmd == "emergency") {
-        emergencyStop();
-    } else if (cmd.startsWith("temp ")) {
-        setTemperature(cmd.substring(5));
-    } else if (cmd.startsWith("flow ")) {
-        setFlowRate(cmd.substring(5));
-    } else if (cmd == "flowdiag" || cmd == "fd") {
-        showFlowDiagnostics();
-    } else if (cmd == "testflow") {
-        // Тест датчика потока
-        Serial.println("=== ТЕСТ ДАТЧИКА ПОТОКА ===");
-        Serial.println("Крутите турбинку датчика потока...");
-        Serial.println("Ожидаем импульсы на пине 35...");
-        Serial.println("Команда 'stop' для выхода из теста");
-        
-        unsigned long testStartTime = millis();
-        float lastFlowRate = 0.0;
-        
-        while (millis() - testStartTime < 30000) { // 30 секунд теста
-            if (Serial.available()) {
-                String testCmd = Serial.readString();
-                testCmd.trim();
-                if (testCmd == "stop") break;
-            }
-            
-            systemController->update();
-            
-            float currentFlowRate = systemController->getCurrentFlowRate();
-            if (abs(currentFlowRate - lastFlowRate) > 0.01) {
-                Serial.print("Поток: ");
-                Serial.print(currentFlowRate, 2);
-                Serial.println(" л/мин");
-                lastFlowRate = currentFlowRate;
-            }
-            
-            delay(100);
+void cmdSet(const CommandArgs& args, CommandContext& context) {
+    applyParameter(context, args.get(1), args.get(2));
+}
+
+void cmdCalibrate(const CommandArgs& args, CommandContext& context) {
+    SensorManager& sensors = context.controller->getSensors();
+    Print& out = context.out;
+    
+    if (args.count() == 1 || args.is(1, "start")) {
+        sensors.startFlowCalibration();
+        out.println("Калибровка запущена: пролейте известный объем (лучше 1-5 л) и введите 'calibrate finish <литры>'");
+    } else if (args.is(1, "finish")) {
+        FlowCalibrationPoint point;
+        SensorManager::CalibrationResult result = sensors.finishFlowCalibration(args.getFloat(2), point);
+        if (result != SensorManager::CAL_OK) {
+            out.printf("Калибровка: %s\n", SensorManager::getCalibrationResultText(result));
+            return;
+        }
+        if (context.state) {
+            context.state->flowCalibrationFactor = ConfigRegistry::get(PARAM_FLOW_CALIBRATION);
+        }
+        out.printf("Калибровка выполнена: %.1f имп/л при %.1f Гц\n", point.pulsesPerLiter, point.frequencyHz);
+    } else if (args.is(1, "cancel")) {
+        sensors.cancelFlowCalibration();
+        out.println("Калибровка отменена");
+    } else if (args.is(1, "clear")) {
+        sensors.clearFlowCalibrationCurve();
+        out.println("Кривая калибровки очищена");
+    } else if (args.is(1, "status")) {
+        out.printf("Калибровка: %s, импульсов: %lu\n", sensors.isFlowCalibrationActive() ? "ИДЕТ" : "НЕТ",
+                   sensors.getFlowCalibrationPulses());
+        out.printf("Коэффициент: %.1f имп/л\n", sensors.getCalibrationFactor());
+        FlowCalibrationPoint points[FLOW_CURVE_MAX_POINTS];
+        int count = sensors.getFlowCalibrationCurve(points);
+        for (int i = 0; i < count; i++) {
+            out.printf("  %.1f Гц -> %.1f имп/л\n", points[i].frequencyHz, points[i].pulsesPerLiter);
         }
-        Serial.println("Тест завершен");
-    } else if (cmd == "reset") {
-        systemController->reset();
-        Serial.println("Система сброшена");
     } else {
-        Serial.println("Неизвестная команда. Введите 'help' для справки.");
+        out.println("Использование: calibrate [start|finish <л>|cancel|clear|status]");
     }
 }
 
-void TerminalCommands::showHelp() {
-    printSeparator();
-    Serial.println("=== КОМАНДЫ УПРАВЛЕНИЯ ===");
-    Serial.println("help, h, ?     - Показать эту справку");
-    Serial.println("status, s      - Статус системы");
-    Serial.println("temp, t        - Текущая температура");
-    Serial.println("flow, f        - Текущий поток");
-    Serial.println("flowdiag, fd   - Диагностика датчика потока");
-    Serial.println("enable, on     - Включить нагрев");
-    Serial.println("disable, off   - Выключить нагрев");
-    Serial.println("stop           - Аварийная остановка");
-    Serial.println("reset          - Сброс системы");
-    Serial.println("temp <значение> - Установить температуру (40-65°C)");
-    Serial.println("flow <значение> - Установить мин. поток (л/мин)");
-    Serial.println("testflow       - Тест датчика потока (30 сек)");
-    printSeparator();
+void cmdSafety(const CommandArgs& args, CommandContext& context) {
+    Print& out = context.out;
+    
+    if (args.is(1, "inject")) {
+        SafetySupervisor::Fault fault = SafetySupervisor::findFault(args.get(2));
+        if (fault == SafetySupervisor::FAULT_NONE) {
+            out.println("Использование: safety inject overtemp|dryfire|stale|zerocross");
+            return;
+        }
+        if (!SafetySupervisor::injectFault(fault)) {
+            out.println("Проверка невозможна: защита уже сработала (сбросьте ошибку)");
+            return;
+        }
+        out.printf("Имитация %s, ожидаемое время до выключения <= %lu мс. Результат: safety\n",
+                   SafetySupervisor::getFaultName(fault), SafetySupervisor::getLatencyBoundMs(fault));
+        return;
+    }
+    if (args.count() > 1) {
+        out.println("Использование: safety [inject overtemp|dryfire|stale|zerocross]");
+        return;
+    }
+    
+    out.printf("Супервизор: %s", SafetySupervisor::isTripped() ? "СРАБОТАЛ" : "НОРМА");
+    if (SafetySupervisor::isTripped()) {
+        out.printf(" (%s, %lu мс)", SafetySupervisor::getFaultName(SafetySupervisor::getTripFault()),
+                   SafetySupervisor::getTripTime());
+    }
+    out.printf("\nСрабатываний: %lu\n", SafetySupervisor::getTripCount());
+    if (SafetySupervisor::isTestPending()) {
+        out.println("Проверка выполняется...");
+    } else if (SafetySupervisor::getLastTestLatencyUs() >= 0) {
+        SafetySupervisor::Fault fault = SafetySupervisor::getLastTestFault();
+        out.printf("Последняя проверка: %s, %.1f мс (граница %lu мс)\n", SafetySupervisor::getFaultName(fault),
+                   SafetySupervisor::getLastTestLatencyUs() / 1000.0, SafetySupervisor::getLatencyBoundMs(fault));
+    }
 }
 
-void TerminalCommands::showStatus() {
-    printSeparator();
-    Serial.println("=== СТАТУС СИСТЕМЫ ===");
+void cmdCpu(const CommandArgs& args, CommandContext& context) {
+    Print& out = context.out;
     
-    String stateName = getStateName(systemController->getState());
-    Serial.println("Состояние: " + stateName);
-    
-    Serial.print("Нагрев: ");
-    Serial.println(systemController->isHeatingEnabled() ? "ВКЛ" : "ВЫКЛ");
+    if (args.is(1, "reset")) {
+        CpuFrequency::resetStats();
+        out.println("Статистика частоты CPU сброшена");
+        return;
+    }
+    if (args.count() > 1) {
+        out.println("Использование: cpu [reset]");
+        return;
+    }
     
-    Serial.print("Аварийная остановка: ");
-    Serial.println(systemController->isEmergencyStop() ? "ДА" : "НЕТ");
+    printSeparator(out);
+    out.printf("Частота CPU: %lu МГц, переключений: %lu\n",
+               (unsigned long)CpuFrequency::getCurrentMhz(), CpuFrequency::getSwitchCount());
+    out.print("Блокировки:");
+    for (int i = 0; i < CpuFrequency::LOCK_COUNT; i++) {
+        CpuFrequency::Lock lock = (CpuFrequency::Lock)i;
+        if (CpuFrequency::isHeld(lock)) {
+            out.printf(" %s(%lu)", CpuFrequency::getLockName(lock), (unsigned long)CpuFrequency::getLockMhz(lock));
+        }
+    }
+    out.println();
+    for (int i = 0; i < CpuFrequency::LEVEL_COUNT; i++) {
+        out.printf("%3lu МГц: %.1f с, включений триаков %lu, запаздывание ср. %.0f / макс. %lu мкс\n",
+                   (unsigned long)CpuFrequency::getLevelMhz(i), CpuFrequency::getTimeAtLevelUs(i) / 1000000.0,
+                   CpuFrequency::getFireCount(i), CpuFrequency::getAverageFireLatencyUs(i),
+                   CpuFrequency::getMaxFireLatencyUs(i));
+    }
+    printSeparator(out);
+}
+
+void cmdPerf(const CommandArgs& args, CommandContext& context) {
+    Print& out = context.out;
     
-    Serial.print("Температура: ");
-    Serial.print(systemController->getCurrentTemperature(), 1);
-    Serial.println("°C");
+    if (args.is(1, "reset")) {
+        PerfProfiler::reset();
+        out.println("Статистика профилирования сброшена");
+        return;
+    }
+    if (args.is(1, "phase")) {
+        if (args.is(2, "start")) {
+            PhaseTiming::start();
+        } else if (args.is(2, "stop")) {
+            PhaseTiming::stop();
+        } else if (args.is(2, "reset")) {
+            PhaseTiming::reset();
+        } else if (args.count() > 2) {
+            out.println("Использование: perf phase [start|stop|reset]");
+            return;
+        }
+        printSeparator(out);
+        PhaseTiming::printReport(out);
+        printSeparator(out);
+        return;
+    }
+    if (args.count() > 1) {
+        out.println("Использование: perf [reset|phase [start|stop|reset]]");
+        return;
+    }
     
-    Serial.print("Поток: ");
-    Serial.print(systemController->getCurrentFlowRate(), 2);
-    Serial.println(" л/мин");
+    printSeparator(out);
+    PerfProfiler::printReport(out);
+    printSeparator(out);
+}
+
+void cmdReplay(const CommandArgs& args, CommandContext& context) {
+    Print& out = context.out;
     
-    Serial.print("Мощность: ");
-    Serial.print(systemController->getCurrentPower(), 1);
-    Serial.println("%");
+    if (args.is(1, "record")) {
+        if (!ReplayEngine::startRecording(*context.controller)) {
+            out.println("Не удалось начать запись (идет загрузка или нет памяти)");
+            return;
+        }
+        out.printf("Запись трассы входов запущена (до %d записей)\n", ControlIO::getCapacity());
+        return;
+    }
+    if (args.is(1, "stop")) {
+        ControlIO::stopRecording();
+    } else if (args.is(1, "clear")) {
+        ControlIO::clear();
+    } else if (args.is(1, "run")) {
+        const char* notReady = ReplayEngine::checkReady(*context.controller);
+        if (notReady) {
+            out.printf("Воспроизведение невозможно: %s\n", notReady);
+            return;
+        }
+        // В терминал - только переходы, полный CSV - GET /replay.csv
+        ReplayEngine::Summary summary;
+        ReplayEngine::run(*context.controller, out, false, summary);
+        return;
+    } else if (args.count() > 1) {
+        out.println("Использование: replay [record|stop|clear|run]");
+        return;
+    }
     
-    Serial.print("Целевая температура: ");
-    Serial.print(systemController->getTargetTemperature(), 1);
-    Serial.println("°C");
+    out.printf("Трасса: %s, записей %d из %d, %.1f с\n",
+               ControlIO::isRecording() ? "ЗАПИСЬ" : "остановлена", ControlIO::getRecordCount(),
+               ControlIO::getCapacity(), ControlIO::getDurationUs() / 1000000.0);
+}
+
+void cmdStages(const CommandArgs& args, CommandContext& context) {
+    Print& out = context.out;
+    const StageController& stages = context.controller->getStageController();
     
-    Serial.print("Мин. поток: ");
-    Serial.print(systemController->getMinFlowRate(), 1);
-    Serial.println(" л/мин");
+    if (args.is(1, "sim")) {
+        // Без настроенных ступеней - две, чтобы было что сравнить
+        unsigned long durationS = args.count() > 2 ? (unsigned long)args.getFloat(2) : 3600;
+        int count = args.count() > 3 ? (int)args.getFloat(3) :
+                    stages.getStageCount() > 0 ? stages.getStageCount() : 2;
+        if (durationS < 60 || durationS > 86400 || count < 1 || count > RELAY_STAGE_MAX) {
+            out.printf("Использование: stages sim [60..86400 с] [1..%d ступеней]\n", RELAY_STAGE_MAX);
+            return;
+        }
+        // Симуляция занимает loop на секунды: датчики и детектор нуля не
+        // опрашиваются, поэтому только без нагрева (как replay run)
+        if (context.controller->getState() != SystemController::STATE_IDLE) {
+            out.println("Симуляция невозможна: система не в покое");
+            return;
+        }
+        StageController::SimulationResult result;
+        StageController::runSimulation(out, count, durationS, result);
+        for (int i = 0; i < count; i++) {
+            out.printf("# ступень %d: включений %lu\n", i + 1, result.cycles[i]);
+        }
+        return;
+    } else if (args.count() > 1) {
+        out.println("Использование: stages [sim [с] [ступеней]]");
+        return;
+    }
     
-    printSeparator();
+    if (stages.getStageCount() == 0) {
+        out.println("Ступени на реле не настроены (relayStageCount = 0)");
+        return;
+    }
+    unsigned long now = millis();
+    out.printf("Ступеней %d по %.0f Вт, включено %d, переключений %lu, отдается %.1f%%\n",
+               stages.getStageCount(), stages.getStagePowerW(), stages.getActiveCount(),
+               stages.getTotalSwitches(), stages.getDeliveredPercent());
+    for (int i = 0; i < stages.getStageCount(); i++) {
+        const StageController::Stage& stage = stages.getStage(i);
+        out.printf("  %d: %-4s включений %lu, наработка %.2f ч, в состоянии %lu с\n", i + 1,
+                   stage.on ? "ВКЛ" : "выкл", stage.cycles, stages.getOnTimeMs(i, now) / 3600000.0,
+                   (now - stage.lastChangeMs) / 1000);
+    }
 }
 
-void TerminalCommands::showTemperature() {
-    float temp = systemController->getCurrentTemperature();
-    float target = systemController->getTargetTemperature();
+void cmdMains(const CommandArgs& args, CommandContext& context) {
+    Print& out = context.out;
+    if (!MainsSensing::isEnabled()) {
+        out.println("Измерение сети не собрано (MAINS_SENSING_ENABLED 0)");
+        return;
+    }
+    
+    MainsSensing::Measurement measurement;
+    MainsSensing::getMeasurement(measurement);
+    out.printf("Измерение: %s, полупериодов %lu, отброшено %lu, отсчетов на полупериод %.1f\n",
+               MainsSensing::isValid() ? "действует" : "НЕТ", (unsigned long)measurement.sequence,
+               MainsSensing::getRejectedCount(), measurement.samplesPerHalfCycle);
+    out.printf("Напряжение L1: %.1f В\n", measurement.voltageRms);
+    for (int phase = 0; phase < 3; phase++) {
+        out.printf("  L%d: %.2f А, %.0f Вт\n", phase + 1, measurement.currentRms[phase], measurement.realPowerW[phase]);
+    }
     
-    Serial.print("Температура: ");
-    Serial.print(temp, 1);
-    Serial.print("°C (цель: ");
-    Serial.print(target, 1);
-    Serial.println("°C)");
+    const PowerLoop& powerLoop = context.controller->getPowerLoop();
+    out.printf("Контур мощности: %s, задано %.0f Вт, измерено %.0f Вт, поправка %+.1f%%\n",
+               powerLoop.isActive() ? "работает" : "не активен", powerLoop.getTargetPowerW(),
+               powerLoop.getMeasuredPowerW(), powerLoop.getTrimPercent());
 }
 
-void TerminalCommands::showFlow() {
-    float flow = systemController->getCurrentFlowRate();
-    float minFlow = systemController->getMinFlowRate();
-    bool flowing = systemController->isWaterFlowing();
+void cmdPhases(const CommandArgs& args, CommandContext& context) {
+    Print& out = context.out;
+    const PhaseController& phaseController = context.controller->getPhaseController();
+    const PhaseMonitor& monitor = phaseController.getPhaseMonitor();
+    float halfPeriodUs = phaseController.getHalfPeriodUs();
     
-    Serial.print("Поток: ");
-    Serial.print(flow, 2);
-    Serial.print(" л/мин (мин: ");
-    Serial.print(minFlow, 1);
-    Serial.print(" л/мин) - ");
-    Serial.println(flowing ? "ЕСТЬ" : "НЕТ");
+    out.printf("Источник: %s, порядок фаз: %s, полупериод %.0f мкс\n",
+               PhaseMonitor::getSourceName(monitor.getSource()),
+               PhaseMonitor::getSequenceName(monitor.getSequence()), halfPeriodUs);
+    for (int phase = 0; phase < 3; phase++) {
+        out.printf("  L%d: %-7s смещение %5.0f мкс (%s, номинал %5.0f), мощность %5.1f%%, обрывов %lu\n",
+                   phase + 1, PhaseMonitor::getHealthName(monitor.getHealth(phase)),
+                   monitor.getOffsetUs(phase, halfPeriodUs),
+                   monitor.hasMeasuredOffset(phase) ? "измерено" : "номинал",
+                   monitor.getNominalOffsetUs(phase, halfPeriodUs), phaseController.getPhasePower(phase),
+                   monitor.getLossCount(phase));
+    }
 }
 
-void TerminalCommands::enableHeating() {
-    systemController->enableHeating();
-    Serial.println("Нагрев ВКЛЮЧЕН");
+void printProfile(Print& out, SystemController::ProfileMode mode, const PowerProfile& profile) {
+    unsigned long totalMs = 0;
+    for (int i = 0; i < profile.segmentCount; i++) {
+        totalMs += profile.segments[i].durationMs;
+    }
+    out.printf("  %s: %s, от %.1f, %lu с%s\n", SystemController::getProfileModeName(mode),
+               ProfileEngine::getTargetName((ProfileEngine::Target)profile.target), profile.startValue,
+               totalMs / 1000, profile.looping ? ", по кругу" : "");
+    for (int i = 0; i < profile.segmentCount; i++) {
+        const ProfileSegment& segment = profile.segments[i];
+        out.printf("    %d: %-6s -> %.1f за %.0f с\n", i + 1,
+                   ProfileEngine::getShapeName((ProfileEngine::Shape)segment.shape), segment.value,
+                   segment.durationMs / 1000.0);
+    }
 }
 
-void TerminalCommands::disableHeating() {
-    systemController->disableHeating();
-    Serial.println("Нагрев ВЫКЛЮЧЕН");
+void cmdProfile(const CommandArgs& args, CommandContext& context) {
+    Print& out = context.out;
+    SystemController* controller = context.controller;
+    
+    if (args.is(1, "stop")) {
+        controller->stopProfile();
+        out.println("Режим по профилю остановлен");
+        return;
+    } else if (args.is(1, "default")) {
+        int mode = SystemController::findProfileMode(args.get(2));
+        if (mode < 0) {
+            out.println("Использование: profile default <preheat|disinfection|burnin>");
+            return;
+        }
+        controller->resetProfile((SystemController::ProfileMode)mode);
+        out.printf("Профиль %s: встроенный\n", args.get(2));
+        return;
+    } else if (args.count() > 1) {
+        int mode = SystemController::findProfileMode(args.get(1));
+        if (mode < 0 || args.count() > 2) {
+            out.println("Использование: profile [preheat|disinfection|burnin|stop|default <режим>]");
+            return;
+        }
+        if (!controller->startProfile((SystemController::ProfileMode)mode)) {
+            out.printf("Профиль %s недопустим\n", args.get(1));
+            return;
+        }
+        out.printf("Режим %s запущен (время профиля идет при нагреве)\n", args.get(1));
+        return;
+    }
+    
+    const ProfileEngine& engine = controller->getProfileEngine();
+    SystemController::ProfileMode active = controller->getProfileMode();
+    if (active == SystemController::PROFILE_MODE_NONE) {
+        out.println("Режим по профилю: нет");
+    } else {
+        out.printf("Режим %s: %s = %.1f, сегмент %d из %d, %lu с, проходов %lu, уставка %.1f°C\n",
+                   SystemController::getProfileModeName(active),
+                   ProfileEngine::getTargetName(engine.getTarget()), engine.getValue(),
+                   engine.getSegment() + 1, engine.getSegmentCount(),
+                   (unsigned long)(engine.getElapsedMs() / 1000), (unsigned long)engine.getCycles(),
+                   controller->getActiveSetpoint());
+    }
+    for (int i = 0; i < SystemController::PROFILE_MODE_COUNT; i++) {
+        SystemController::ProfileMode mode = (SystemController::ProfileMode)i;
+        printProfile(out, mode, controller->getProfile(mode));
+    }
 }
 
-void TerminalCommands::emergencyStop() {
-    systemController->emergencyStop();
-    Serial.println("АВАРИЙНАЯ ОСТАНОВКА!");
+void cmdDisinfection(const CommandArgs& args, CommandContext& context) {
+    Print& out = context.out;
+    DisinfectionScheduler& disinfection = context.controller->getDisinfection();
+    
+    if (args.is(1, "start")) {
+        disinfection.requestCycle();
+        out.println("Термодезинфекция начнется с ближайшим водоразбором");
+        return;
+    } else if (args.is(1, "stop")) {
+        disinfection.cancel();
+        out.println("Термодезинфекция отменена");
+        return;
+    } else if (args.count() > 1) {
+        out.println("Использование: disinfection [start|stop]");
+        return;
+    }
+    
+    const DisinfectionHistory& history = disinfection.getHistory();
+    out.printf("Термодезинфекция: %s, интервал %lu ч, не ниже %.1f°C %lu мин\n",
+               DisinfectionScheduler::getStateName(disinfection.getState()),
+               disinfection.getIntervalS() / 3600, disinfection.getMinTemp(), disinfection.getHoldS() / 60);
+    out.printf("С последнего выполнения %.1f ч работы, до срока %.1f ч, текущее удержание %lu с, попыток %d из %d\n",
+               history.sinceLastS / 3600.0, disinfection.getDueInS() / 3600.0, disinfection.getExposureS(),
+               disinfection.getAttempts(), DISINFECTION_MAX_ATTEMPTS);
+    out.printf("Выполнено %lu, в обычной работе %lu, прервано %lu, пропущено %lu%s\n",
+               (unsigned long)history.passed, (unsigned long)history.inUse,
+               (unsigned long)history.aborted, (unsigned long)history.missed,
+               disinfection.isPersistent() ? "" : " (не сохраняется во flash)");
+    for (int i = 0; i < history.count; i++) {
+        const DisinfectionResult& entry = disinfection.getResult(i);
+        out.printf("  %.1f ч назад: %-8s %u с, мин %.1f°C, ср %.1f°C, %.0f Вт*ч%s\n",
+                   (history.operatingS - entry.operatingS) / 3600.0,
+                   DisinfectionScheduler::getResultName((DisinfectionScheduler::Result)entry.result),
+                   entry.holdS, entry.minTemp, entry.avgTemp, entry.energyWh,
+                   entry.scheduled ? "" : " (обычная работа)");
+    }
 }
 
-void TerminalCommands::setTemperature(const String& args) {
-    float temp = args.toFloat();
+void cmdBench(const CommandArgs& args, CommandContext& context) {
+    if (args.count() > 1 && !args.is(1, "baseline")) {
+        context.out.println("Использование: bench [baseline]");
+        return;
+    }
+    if (context.controller->getState() != SystemController::STATE_IDLE) {
+        context.out.println("Тесты невозможны: система не в покое");
+        return;
+    }
     
-    if (temp >= 40.0 && temp <= 65.0) {
-        systemController->setTargetTemperature(temp);
-        Serial.print("Целевая температура установлена: ");
-        Serial.print(temp, 1);
-        Serial.println("°C");
-  } else {
-        Serial.println("Ошибка: температура должна быть от 40 до 65°C");
+    BenchSuite::Result results[BenchSuite::CASE_COUNT];
+    BenchSuite::Summary summary;
+    BenchSuite::run(results, summary);
+    
+    if (args.is(1, "baseline")) {
+        BenchSuite::printBaseline(context.out, results, summary);
+    } else {
+        BenchSuite::printCsv(context.out, results, summary);
     }
 }
 
-void TerminalCommands::setFlowRate(const String& args) {
-    float flow = args.toFloat();
+void printAllocationWatch(Print& out) {
+    const MemoryMonitor::AllocationWatch& watch = MemoryMonitor::getAllocationWatch();
+    if (!watch.active && !watch.finished) return;
     
-    if (flow >= 0.1 && flow <= 10.0) {
-        systemController->setMinFlowRate(flow);
-        Serial.print("Минимальный поток установлен: ");
-        Serial.print(flow, 1);
-        Serial.println(" л/мин");
-  } else {
-        Serial.println("Ошибка: поток должен быть от 0.1 до 10.0 л/мин");
+    out.printf("Проверка выделений (%lu с): %s; управление %lu (%lu Б), HTTP %lu (%lu Б), другие задачи %lu\n",
+               watch.durationMs / 1000,
+               watch.active ? "идет" : MemoryMonitor::isAllocationWatchPassed() ? "ПРОЙДЕНА" : "НЕ ПРОЙДЕНА",
+               (unsigned long)watch.controlAllocations, (unsigned long)watch.controlBytes,
+               (unsigned long)watch.httpAllocations, (unsigned long)watch.httpBytes,
+               (unsigned long)watch.otherAllocations);
+    for (int i = 0; i < watch.sampleCount; i++) {
+        out.printf("  %s %lu Б из 0x%08lx\n", watch.sampleHttp[i] ? "http      " : "управление",
+                   (unsigned long)watch.sampleSize[i], (unsigned long)watch.sampleCaller[i]);
     }
 }
 
-void TerminalCommands::showFlowDiagnostics() {
-    printSeparator();
-    Serial.println("=== ДИАГНОСТИКА ДАТЧИКА ПОТОКА ===");
+void cmdMemory(const CommandArgs& args, CommandContext& context) {
+    Print& out = context.out;
     
-    // Получаем доступ к датчикам через системный контроллер
-    const SensorManager& sensors = systemController->getSensors();
+    if (args.is(1, "watch")) {
+        if (!MemoryMonitor::isAllocationWatchSupported()) {
+            out.println("Проверка выделений доступна в сборке env:esp32dev-allocwatch");
+        } else if (!MemoryMonitor::startAllocationWatch(args.count() > 2 ? (unsigned long)args.getFloat(2) : 60)) {
+            out.printf("Проверка уже идет или длительность вне 1..%d с\n", ALLOC_WATCH_MAX_SECONDS);
+        } else {
+            out.println("Проверка выделений начата, результат - команда 'mem'");
+        }
+        return;
+    }
     
-    // Выводим диагностическую информацию
-    sensors.printFlowSensorDiagnostics();
+    const MemoryMonitor::HeapInfo& heap = MemoryMonitor::getHeapInfo();
     
-    // Дополнительная информация
-    Serial.println("=== ДОПОЛНИТЕЛЬНАЯ ИНФОРМАЦИЯ ===");
-    Serial.print("Датчик работает: ");
-    Serial.println(sensors.isFlowSensorWorking() ? "ДА" : "НЕТ");
-    Serial.print("Минимальный порог потока: ");
-    Serial.print(systemController->getMinFlowRate(), 1);
-    Serial.println(" л/мин");
-    Serial.print("Поток обнаружен системой: ");
-    Serial.println(systemController->isWaterFlowing() ? "ДА" : "НЕТ");
-    Serial.println("=====================================");
+    printSeparator(out);
+    out.printf("Куча: свободно %lu Б, самый большой блок %lu Б, фрагментация %d%%, минимум %lu Б\n",
+               (unsigned long)ESP.getFreeHeap(), (unsigned long)heap.largestFreeBlock,
+               heap.fragmentationPercent, (unsigned long)heap.minFreeEver);
+    out.printf("Блоков: занято %lu, свободно %lu; предупреждений %lu%s\n",
+               (unsigned long)heap.allocatedBlocks, (unsigned long)heap.freeBlocks, MemoryMonitor::getAlertCount(),
+               MemoryMonitor::isFragmentationAlert() || MemoryMonitor::isLowHeapAlert() ? " (АКТИВНО)" : "");
+    out.println("подсистема   выделений  освобождений     сейчас       пик");
+    for (int t = 0; t < MEM_TAG_COUNT; t++) {
+        const MemoryMonitor::TagStats& s = MemoryMonitor::getTagStats((MemoryTag)t);
+        out.printf("%-10s %11lu %13lu %10ld %9ld\n", MemoryMonitor::getTagName((MemoryTag)t),
+                   (unsigned long)s.allocations, (unsigned long)s.frees, (long)s.currentBytes, (long)s.peakBytes);
+    }
+    for (int i = 0; i < MemoryMonitor::getTaskCount(); i++) {
+        out.printf("Стек %s: минимальный запас %lu Б\n", MemoryMonitor::getTaskName(i),
+                   (unsigned long)MemoryMonitor::getTaskStackFree(i));
+    }
+    out.printf("Буфер HTTP запроса: пик %u из %u Б, выделений из кучи при переполнении %lu\n",
+               (unsigned)RequestArena::getHighWater(), (unsigned)RequestArena::getCapacity(),
+               RequestArena::getFallbackCount());
+    printAllocationWatch(out);
+    printSeparator(out);
 }
 
-String TerminalCommands::getStateName(int state) {
-    switch (state) {
-        case 0: return "ПОКОЙ";
-        case 1: return "ЗАПУСК";
-        case 2: return "НАГРЕВ";
-        case 3: return "ПОДДЕРЖАНИЕ";
-        case 4: return "ОШИБКА";
-        default: return "НЕИЗВЕСТНО";
+void cmdEnable(const CommandArgs& args, CommandContext& context) {
+    context.controller->enableHeating();
+    context.out.println("Нагрев ВКЛЮЧЕН");
+}
+
+void cmdDisable(const CommandArgs& args, CommandContext& context) {
+    context.controller->disableHeating();
+    context.out.println("Нагрев ВЫКЛЮЧЕН");
+}
+
+void cmdEmergencyStop(const CommandArgs& args, CommandContext& context) {
+    context.controller->emergencyStop();
+    context.out.println("АВАРИЙНАЯ ОСТАНОВКА!");
+}
+
+void cmdReset(const CommandArgs& args, CommandContext& context) {
+    context.controller->reset();
+    context.out.println("Система сброшена");
+}
+
+void cmdDefaults(const CommandArgs& args, CommandContext& context) {
+    if (context.state) {
+        context.state->resetConfiguration();
+    } else {
+        ConfigStorage::resetToDefaults();
+    }
+    context.controller->applyConfig();
+    context.out.println("Конфигурация сброшена к настройкам по умолчанию");
+}
+
+// Тест датчика потока: печатает поток при изменении. Датчики опрашивает
+// loop, шаг только читает результат
+bool testFlowStep(CommandJob& job) {
+    float flowRate = job.controller->getCurrentFlowRate();
+    if (fabs(flowRate - job.lastValue) > 0.01) {
+        job.out->printf("Поток: %.2f л/мин\n", flowRate);
+        job.lastValue = flowRate;
+    }
+    return true;
+}
+
+void cmdTestFlow(const CommandArgs& args, CommandContext& context) {
+    unsigned long seconds = args.count() > 1 ? (unsigned long)args.getFloat(1) : CMD_TESTFLOW_DURATION_S;
+    if (seconds == 0) {
+        context.out.println("Использование: testflow [секунды]");
+        return;
+    }
+    
+    CommandJob job = {};
+    job.name = "testflow";
+    job.step = testFlowStep;
+    job.intervalMs = 100;
+    job.durationMs = seconds * 1000UL;
+    job.lastValue = -1.0;
+    job.controller = context.controller;
+    job.out = context.jobOut;
+    
+    if (!CommandRegistry::startJob(job)) {
+        context.out.printf("Уже выполняется задание %s ('cancel' - отменить)\n", CommandRegistry::getJobName());
+        return;
+    }
+    
+    context.out.println("=== ТЕСТ ДАТЧИКА ПОТОКА ===");
+    context.out.printf("Крутите турбинку датчика потока (пин %d), %lu с\n", FLOW_SENSOR_PIN, seconds);
+    context.out.println("Команда 'cancel' для выхода из теста");
+}
+
+void cmdCancel(const CommandArgs& args, CommandContext& context) {
+    if (!CommandRegistry::isJobActive()) {
+        context.out.println("Нет активного задания");
+        return;
     }
+    CommandRegistry::cancelJob();
+}
+
+// Таблица команд: имя, псевдонимы, число аргументов, справка
+const CommandDescriptor COMMANDS[] = {
+    { "help",      "h|?",         0, 0, "",                     "показать справку",                         cmdHelp },
+    { "status",    "s",           0, 0, "",                     "состояние системы",                        cmdStatus },
+    { "temp",      "t",           0, 1, "[°C]",                 "текущая / установить целевую температуру", cmdTemp },
+    { "flow",      "f",           0, 1, "[л/мин]",              "текущий / установить мин. поток",          cmdFlow },
+    { "flowdiag",  "fd",          0, 0, "",                     "диагностика датчика потока",               cmdFlowDiagnostics },
+    { "energy",    "e",           0, 1, "[reset]",              "учет энергии / сброс счетчиков",           cmdEnergy },
+    { "trace",     nullptr,       0, 0, "",                     "последние переходы машины состояний",      cmdTrace },
+    { "get",       nullptr,       0, 1, "[имя]",                "показать параметры (* - после перезапуска)", cmdGet },
+    { "set",       nullptr,       2, 2, "<имя> <значение>",     "изменить параметр",                        cmdSet },
+    { "calibrate", nullptr,       0, 2, "[start|finish <л>|cancel|clear|status]", "калибровка датчика потока", cmdCalibrate },
+    { "safety",    nullptr,       0, 2, "[inject <неисправность>]", "супервизор безопасности",              cmdSafety },
+    { "cpu",       nullptr,       0, 1, "[reset]",              "частота CPU и точность включения триаков", cmdCpu },
+    { "perf",      nullptr,       0, 2, "[reset|phase [start|stop|reset]]", "время участков loop / точность включения триаков", cmdPerf },
+    { "replay",    nullptr,       0, 1, "[record|stop|clear|run]", "запись и воспроизведение трассы входов", cmdReplay },
+    { "mem",       "memory",      0, 2, "[watch <с>]",          "куча, память подсистем, проверка выделений", cmdMemory },
+    { "stages",    nullptr,       0, 3, "[sim [с] [ступеней]]", "ступени на реле / симуляция переключений", cmdStages },
+    { "phases",    nullptr,       0, 0, "",                     "состояние, смещения и порядок фаз",        cmdPhases },
+    { "mains",     nullptr,       0, 0, "",                     "напряжение, ток и мощность по фазам",      cmdMains },
+    { "profile",   nullptr,       0, 2, "[режим|stop|default <режим>]", "режимы по профилю: прогрев, дезинфекция, обкатка", cmdProfile },
+    { "disinfection", nullptr,    0, 1, "[start|stop]",         "термодезинфекция по расписанию и журнал", cmdDisinfection },
+    { "bench",     nullptr,       0, 1, "[baseline]",           "тесты производительности (CSV, регрессии)", cmdBench },
+    { "enable",    "on",          0, 0, "",                     "включить нагрев",                          cmdEnable },
+    { "disable",   "off",         0, 0, "",                     "выключить нагрев",                         cmdDisable },
+    { "stop",      "emergency",   0, 0, "",                     "аварийная остановка",                      cmdEmergencyStop },
+    { "reset",     nullptr,       0, 0, "",                     "сброс системы (выход из ошибки)",          cmdReset },
+    { "defaults",  nullptr,       0, 0, "",                     "сбросить конфигурацию",                    cmdDefaults },
+    { "testflow",  nullptr,       0, 1, "[секунды]",            "тест датчика потока (фоновое задание)",    cmdTestFlow },
+    { "cancel",    nullptr,       0, 0, "",                     "отменить фоновое задание",                 cmdCancel },
+};
+
 }
 
-void TerminalCommands::printSeparator() {
-    Serial.println("=====================================");
+// ========================================
+// ТЕРМИНАЛ SERIAL
+// ========================================
+
+TerminalCommands::TerminalCommands()
+    : systemController(nullptr), inputLength(0), inputOverflow(false), isInitialized(false) {
+}
+
+void TerminalCommands::registerCommands() {
+    CommandRegistry::begin(COMMANDS, sizeof(COMMANDS) / sizeof(COMMANDS[0]));
+}
+
+void TerminalCommands::begin(SystemController* controller) {
+    systemController = controller;
+    isInitialized = true;
+    inputLength = 0;
+    registerCommands();
+    
+    Serial.println("Терминальные команды инициализированы");
+}
+
+void TerminalCommands::update() {
+    if (!isInitialized || !systemController) return;
+    
+    // Читаем только доступные символы, не ожидая конца строки
+    while (Serial.available()) {
+        char c = Serial.read();
+        
+        if (c == '\n' || c == '\r') {
+            if (inputOverflow) {
+                Serial.println("Слишком длинная команда");
+            } else if (inputLength > 0) {
+                inputBuffer[inputLength] = '\0';
+                processLine();
+            }
+            inputLength = 0;
+            inputOverflow = false;
+        } else if (c >= 32 && c <= 126) { // Печатные символы
+            if (inputLength < CMD_LINE_MAX - 1) {
+                inputBuffer[inputLength++] = c;
+            } else {
+                inputOverflow = true;
+            }
+        }
+    }
+    
+    // Шаги длительных команд (Serial и веб)
+    CommandRegistry::update();
+}
+
+void TerminalCommands::processLine() {
+    Serial.print("> ");
+    Serial.println(inputBuffer);
+    
+    CommandContext context = { systemController, nullptr, Serial, &Serial };
+    CommandRegistry::execute(inputBuffer, context);
 }
 
 SystemController* TerminalCommands::getSystemController() const {
     return systemController;
-}
\ No newline at end of file
+}
@@ -2,41 +2,38 @@
 #define TERMINAL_COMMANDS_H
 
 #include <Arduino.h>
+#include "config.h"
 
 // Предварительное объявление класса SystemController
 class SystemController;
 
+// Терминал Serial: построчное чтение без выделения памяти и выполнение
+// команд общей таблицы (см. command_registry.h). Та же таблица
+// обслуживает веб-терминал через TerminalManager
 class TerminalCommands {
 private:
     SystemController* systemController;
-    String inputBuffer;
+    char inputBuffer[CMD_LINE_MAX];
+    int inputLength;
+    bool inputOverflow;
     bool isInitialized;
     
-    // Методы обработки команд
-    void processCommand(const String& command);
-    void showHelp();
-    void showStatus();
-    void showTemperature();
-    void showFlow();
-    void enableHeating();
-    void disableHeating();
-    void emergencyStop();
-    void setTemperature(const String& args);
-    void setFlowRate(const String& args);
-    void showFlowDiagnostics();
-    
-    // Вспомогательные методы
-    String getStateName(int state);
-    void printSeparator();
+    void processLine();
 
 public:
     TerminalCommands();
     
+    // Регистрация таблицы команд и чтение Serial
     void begin(SystemController* controller);
+    
+    // Чтение Serial и шаги длительных команд (вызывать в loop)
     void update();
     
+    // Таблица команд в CommandRegistry (нужна и веб-терминалу)
+    static void registerCommands();
+    
     // Методы для получения данных
     SystemController* getSystemController() const;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,8 +1,19 @@
 #include "terminal_manager.h"
+#include "terminal_commands.h"
+#include "command_registry.h"
+#include "system_controller.h"
+#include "memory_monitor.h"
 
 String TerminalManager::logBuffer = "";
+SystemController* TerminalManager::systemController = nullptr;
+
+void TerminalManager::setSystemController(SystemController* controller) {
+    systemController = controller;
+}
 
 void TerminalManager::addLog(const String& message) {
+    MEMORY_SCOPE(MEM_TERMINAL);
+    
     // Добавляем сообщение в буфер логов
     logBuffer += String(millis() / 1000) + "s: " + message + "\n";
     
@@ -24,57 +35,59 @@ String TerminalManager::getLogs() {
     return logBuffer;
 }
 
-String TerminalManager::processCommand(const String& command, SystemState* state) {
-    String result = "";
+// Вывод команды в строку ответа
+class StringPrint : public Print {
+public:
+    String text;
     
-    if (command == "help") {
-        result = "Доступные команды:\n";
-        result += "help - показать справку\n";
-        result += "status - показать состояние системы\n";
-        result += "temp <value> - установить целевую температуру\n";
-        result += "calibrate - калибровать датчик потока\n";
-        result += "reset - сбросить конфигурацию\n";
+    size_t write(uint8_t c) override {
+        text += (char)c;
+        return 1;
     }
-    else if (command == "status") {
-        if (state) {
-            result = "Состояние системы:\n";
-            result += "Температура: " + String(state->currentTemp, 1) + "°C\n";
-            result += "Целевая температура: " + String(state->targetTemp, 1) + "°C\n";
-            result += "Поток: " + String(state->flowRate, 2) + " л/мин\n";
-            result += "Нагрев: " + String(state->isHeating ? "ВКЛ" : "ВЫКЛ") + "\n";
-            result += "WiFi: " + String(state->isWiFiEnabled ? "ВКЛ" : "ВЫКЛ") + "\n";
-        } else {
-            result = "Состояние системы недоступно";
-        }
-    }
-    else if (command.startsWith("temp ")) {
-        if (state) {
-            float temp = command.substring(5).toFloat();
-            if (temp >= TARGET_TEMP_MIN && temp <= TARGET_TEMP_MAX) {
-                state->targetTemp = temp;
-                state->saveConfiguration();
-                result = "Целевая температура установлена: " + String(temp, 1) + "°C";
-            } else {
-                result = "Неверная температура. Диапазон: " + String(TARGET_TEMP_MIN) + "-" + String(TARGET_TEMP_MAX) + "°C";
-            }
-        } else {
-            result = "Система не инициализирована";
+};
+
+// Вывод фоновых заданий веб-терминала: построчно в журнал терминала
+class TerminalLogPrint : public Print {
+public:
+    TerminalLogPrint() : length(0) {}
+    
+    size_t write(uint8_t c) override {
+        if (c == '\n') {
+            line[length] = '\0';
+            TerminalManager::addLog(line);
+            length = 0;
+        } else if (length < sizeof(line) - 1) {
+            line[length++] = c;
         }
+        return 1;
     }
-    else if (command == "calibrate") {
-        result = "Калибровка датчика потока запущена";
+    
+private:
+    char line[128];
+    size_t length;
+};
+
+static TerminalLogPrint logOutput;
+
+String TerminalManager::processCommand(const String& command, SystemState* state) {
+    if (!systemController) {
+        return "Система не инициализирована";
     }
-    else if (command == "reset") {
-        if (state) {
-            state->resetConfiguration();
-            result = "Конфигурация сброшена к настройкам по умолчанию";
-        } else {
-            result = "Система не инициализирована";
-        }
+    if (CommandRegistry::getCount() == 0) {
+        TerminalCommands::registerCommands();
     }
-    else {
-        result = "Неизвестная команда: " + command + "\nВведите 'help' для справки";
+    if (command.length() >= CMD_LINE_MAX) {
+        return "Слишком длинная команда";
     }
     
-    return result;
+    char line[CMD_LINE_MAX];
+    command.toCharArray(line, sizeof(line));
+    
+    StringPrint output;
+    CommandContext context = { systemController, state, output, &logOutput };
+    CommandRegistry::execute(line, context);
+    
+    // Ответ без завершающего перевода строки
+    output.text.trim();
+    return output.text;
 }
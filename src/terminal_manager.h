@@ -4,15 +4,25 @@
 #include <Arduino.h>
 #include "system_state.h"
 
+// Предварительное объявление класса SystemController
+class SystemController;
+
 class TerminalManager {
 public:
     // Статические методы для логирования
     static void addLog(const String& message);
     static String getLogs();
+    // Выполнение команды веб-терминала (общая таблица команд, см.
+    // terminal_commands.cpp). Вывод фоновых заданий попадает в журнал
     static String processCommand(const String& command, SystemState* state);
+    static void setSystemController(SystemController* controller);
     
 private:
+    friend struct BenchAccess;   // Тесты производительности (bench_suite.cpp)
+    
     static String logBuffer;
+    static SystemController* systemController;
+    
     static const int MAX_LOG_SIZE = 2048;
 };
 
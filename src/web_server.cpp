@@ -4,6 +4,20 @@
 #include "terminal_manager.h"
 #include "config_storage.h"
 #include "system_controller.h"
+#include "telemetry_recorder.h"
+#include "history_store.h"
+#include "safety_supervisor.h"
+#include "power_manager.h"
+#include "cpu_frequency.h"
+#include "perf_profiler.h"
+#include "phase_timing.h"
+#include "control_io.h"
+#include "replay_engine.h"
+#include "bench_suite.h"
+#include "memory_monitor.h"
+#include "request_arena.h"
+#include "mains_sensing.h"
+#include "logger.h"
 #include <Arduino.h>
 #include <HardwareSerial.h>
 #include <SPIFFS.h>
@@ -34,36 +48,32 @@ void WebServerManager::begin() {
 }
 
 void WebServerManager::handleClient() {
+  PERF_SCOPE(PERF_WEB_CLIENT);
+  MEMORY_SCOPE(MEM_WEB);
+  
   // Обрабатываем клиентов только если WiFi сессия активна
   if (wifiSessionActive) {
+    RequestArena::setInRequest(true);
     server.handleClient();
+    RequestArena::setInRequest(false);
+    // Ответ отправлен - документы и тела ответов запроса больше не нужны
+    RequestArena::reset();
     
     // Периодическая диагностика датчика протока во время WiFi сессии (каждые 30 секунд)
     static unsigned long lastDiagnosticTime = 0;
     if (millis() - lastDiagnosticTime > 30000) {
-      if (systemController && DEBUG_SERIAL) {
-        Serial.println("--- ПЕРИОДИЧЕСКАЯ ДИАГНОСТИКА ДАТЧИКА ПОТОКА (WiFi активен) ---");
-        Serial.print("Пин датчика потока (GPIO35): ");
-        Serial.println(digitalRead(FLOW_SENSOR_PIN) ? "HIGH" : "LOW");
-        Serial.print("Состояние датчика: ");
-        Serial.println(systemController->getSensors().isFlowSensorWorking() ? "РАБОТАЕТ" : "НЕ РАБОТАЕТ");
-        Serial.print("Количество импульсов: ");
-        Serial.println(systemController->getSensors().getFlowPulseCount());
-        Serial.print("Время последнего импульса: ");
-        Serial.print(systemController->getSensors().getTimeSinceLastPulse());
-        Serial.println(" мс назад");
-        Serial.print("Текущая скорость потока: ");
-        Serial.print(systemController->getCurrentFlowRate(), 2);
-        Serial.println(" л/мин");
-        Serial.print("Поток обнаружен: ");
-        Serial.println(systemController->isWaterFlowing() ? "ДА" : "НЕТ");
-        Serial.println("--------------------------------------------------------");
+      if (systemController) {
+        const SensorManager& sensors = systemController->getSensors();
+        LOG_D(FLOW, "Диагностика (WiFi): пин %s, датчик %s, импульсов %lu, последний %lu мс назад, %.2f л/мин, поток %s",
+              digitalRead(FLOW_SENSOR_PIN) ? "HIGH" : "LOW", sensors.isFlowSensorWorking() ? "работает" : "не работает",
+              (unsigned long)sensors.getFlowPulseCount(), (unsigned long)sensors.getTimeSinceLastPulse(),
+              systemController->getCurrentFlowRate(), systemController->isWaterFlowing() ? "да" : "нет");
       }
       lastDiagnosticTime = millis();
     }
     
     // Проверяем таймаут сессии
-    if ((millis() - sessionStartTime) > WIFI_SESSION_TIMEOUT_MS) {
+    if ((millis() - sessionStartTime) > sessionTimeoutMs) {
       if (DEBUG_SERIAL) {
         Serial.println("WiFi сессия истекла, отключаем WiFi");
       }
@@ -80,6 +90,9 @@ void WebServerManager::startWiFiSession() {
     return;
   }
   
+  // WiFi стеку и веб-серверу нужна частота выше базовой
+  CpuFrequency::setHeld(CpuFrequency::LOCK_WIFI, true);
+  
   // Запуск WiFi в режиме точки доступа
   startWiFiAP();
   
@@ -141,6 +154,7 @@ void WebServerManager::stopWiFiSession() {
   // Отключаем WiFi
   WiFi.softAPdisconnect(true);
   WiFi.mode(WIFI_OFF);
+  CpuFrequency::setHeld(CpuFrequency::LOCK_WIFI, false);
   
   // Обновляем состояние
   wifiSessionActive = false;
@@ -190,11 +204,11 @@ unsigned long WebServerManager::getSessionTimeLeft() const {
   }
   
   unsigned long elapsed = millis() - sessionStartTime;
-  if (elapsed >= WIFI_SESSION_TIMEOUT_MS) {
+  if (elapsed >= sessionTimeoutMs) {
     return 0;
   }
   
-  return WIFI_SESSION_TIMEOUT_MS - elapsed;
+  return sessionTimeoutMs - elapsed;
 }
 
 void WebServerManager::updateStatus(SystemState& state) {
@@ -203,27 +217,102 @@ void WebServerManager::updateStatus(SystemState& state) {
 
 void WebServerManager::setSystemController(SystemController* controller) {
   systemController = controller;
+  TerminalManager::setSystemController(controller);
+}
+
+void WebServerManager::setSessionTimeout(unsigned long timeoutMs) {
+  sessionTimeoutMs = timeoutMs;
+}
+
+void WebServerManager::setTelemetryRecorder(TelemetryRecorder* recorder) {
+  telemetry = recorder;
 }
 
+void WebServerManager::setHistoryStore(HistoryStore* store) {
+  history = store;
+}
+
+void WebServerManager::setPowerManager(PowerManager* manager) {
+  power = manager;
+}
+
+// Буферизованная отправка ответа частями (chunked), без сборки всего ответа в String
+struct ChunkedResponse {
+  WebServer& server;
+  char buffer[512];
+  size_t length;
+  
+  ChunkedResponse(WebServer& srv) : server(srv), length(0) {}
+  
+  void write(const uint8_t* data, size_t size) {
+    while (size > 0) {
+      size_t part = min(size, sizeof(buffer) - length);
+      memcpy(buffer + length, data, part);
+      length += part;
+      data += part;
+      size -= part;
+      if (length == sizeof(buffer)) flush();
+    }
+  }
+  
+  void print(const char* text) {
+    write((const uint8_t*)text, strlen(text));
+  }
+  
+  void flush() {
+    if (length > 0) {
+      server.sendContent_P(buffer, length);
+      length = 0;
+    }
+  }
+  
+  void finish() {
+    flush();
+    server.sendContent("");
+  }
+};
+
+// ChunkedResponse как Print (вывод ReplayEngine)
+class ChunkedPrint : public Print {
+public:
+  ChunkedPrint(ChunkedResponse& response) : response(response) {}
+  
+  size_t write(uint8_t c) override {
+    response.write(&c, 1);
+    return 1;
+  }
+  
+  size_t write(const uint8_t* data, size_t size) override {
+    response.write(data, size);
+    return size;
+  }
+  
+private:
+  ChunkedResponse& response;
+};
+
 void WebServerManager::setupRoutes() {
+  // Страницы, телеметрия и история формируются на повышенной частоте CPU
   server.on("/", HTTP_GET, [this]() { 
+    CpuFrequencyLock lock(CpuFrequency::LOCK_HTTP);
     server.send(200, "text/html", getMainPage()); 
   });
   
   server.on("/web_interface.html", HTTP_GET, [this]() { 
+    CpuFrequencyLock lock(CpuFrequency::LOCK_HTTP);
     server.send(200, "text/html", getWebInterface()); 
   });
   
   server.on("/status", HTTP_GET, [this]() { 
-    server.send(200, "application/json", getStatusJSON()); 
+    sendJson(200, getStatusJSON()); 
   });
   
   server.on("/config", HTTP_GET, [this]() { 
-    server.send(200, "application/json", getConfigJSON()); 
+    sendJson(200, getConfigJSON()); 
   });
   
   server.on("/sensors", HTTP_GET, [this]() { 
-    server.send(200, "application/json", getSensorsInfoJSON()); 
+    sendJson(200, getSensorsInfoJSON()); 
   });
   
   server.on("/config", HTTP_POST, [this]() { 
@@ -234,15 +323,141 @@ void WebServerManager::setupRoutes() {
     handleCalibrate(); 
   });
   
+  server.on("/trace", HTTP_GET, [this]() {
+    sendJson(200, getTraceJSON());
+  });
+  
+  server.on("/safety", HTTP_GET, [this]() {
+    sendJson(200, getSafetyJSON());
+  });
+  
+  server.on("/safety", HTTP_POST, [this]() {
+    handleSafety();
+  });
+  
+  // Термодезинфекция: журнал результатов, POST /disinfection?action=start|stop
+  server.on("/disinfection", HTTP_GET, [this]() {
+    sendJson(200, getDisinfectionJSON());
+  });
+  
+  server.on("/disinfection", HTTP_POST, [this]() {
+    handleDisinfection();
+  });
+  
+  server.on("/power", HTTP_GET, [this]() {
+    sendJson(200, getPowerJSON());
+  });
+  
+  // Профиль горячих участков loop, POST /perf?reset=1 - сброс
+  server.on("/perf", HTTP_GET, [this]() {
+    sendJson(200, getPerfJSON());
+  });
+  
+  // Точность включения триаков: POST /perf/phase?action=start|stop|reset
+  server.on("/perf/phase", HTTP_GET, [this]() {
+    sendJson(200, getPhaseTimingJSON());
+  });
+  
+  server.on("/perf/phase", HTTP_POST, [this]() {
+    handlePhaseTiming();
+  });
+  
+  server.on("/perf", HTTP_POST, [this]() {
+    if (server.arg("reset") == "1") {
+      PerfProfiler::reset();
+      TerminalManager::addLog("⏱ Статистика профилирования сброшена");
+    }
+    sendJson(200, getPerfJSON());
+  });
+  
+  // Трасса входов контура: POST /replay?action=record|stop|clear,
+  // скачивание/загрузка трассы и прогон через контур (CSV решений)
+  server.on("/replay", HTTP_GET, [this]() {
+    sendJson(200, getReplayJSON());
+  });
+  
+  server.on("/replay", HTTP_POST, [this]() {
+    handleReplayControl();
+  });
+  
+  server.on("/replay/trace.bin", HTTP_GET, [this]() {
+    handleReplayTraceDownload();
+  });
+  
+  server.on("/replay/trace", HTTP_POST, [this]() {
+    if (ControlIO::isRecording() || ControlIO::getRecordCount() == 0) {
+      server.send(400, "application/json", "{\"status\":\"error\",\"message\":\"Неверный файл трассы\"}");
+      return;
+    }
+    sendJson(200, getReplayJSON());
+  }, [this]() {
+    handleReplayTraceUpload();
+  });
+  
+  server.on("/replay.csv", HTTP_GET, [this]() {
+    CpuFrequencyLock lock(CpuFrequency::LOCK_HTTP);
+    handleReplayRun();
+  });
+  
+  server.on("/memory", HTTP_GET, [this]() {
+    sendJson(200, getMemoryJSON());
+  });
+  
+  // Проверка выделений: POST /memory?watch=<с> (сборка env:esp32dev-allocwatch)
+  server.on("/memory", HTTP_POST, [this]() {
+    if (!MemoryMonitor::isAllocationWatchSupported()) {
+      server.send(501, "application/json", "{\"error\":\"Build with env:esp32dev-allocwatch\"}");
+      return;
+    }
+    if (!server.hasArg("watch") || !MemoryMonitor::startAllocationWatch(server.arg("watch").toInt())) {
+      server.send(409, "application/json", "{\"error\":\"Watch already running or invalid duration\"}");
+      return;
+    }
+    sendJson(200, getMemoryJSON());
+  });
+  
+  // Тесты производительности: 409 при регрессии или без базовых значений bench_baseline.h
+  server.on("/bench", HTTP_GET, [this]() {
+    handleBenchmark();
+  });
+  
   server.on("/emergency", HTTP_POST, [this]() { 
     handleEmergencyStop(); 
   });
   
+  // API телеметрии высокой частоты
+  server.on("/telemetry", HTTP_GET, [this]() {
+    sendJson(200, getTelemetryInfoJSON());
+  });
+  
+  server.on("/telemetry", HTTP_POST, [this]() {
+    handleTelemetryControl();
+  });
+  
+  server.on("/telemetry.csv", HTTP_GET, [this]() {
+    CpuFrequencyLock lock(CpuFrequency::LOCK_HTTP);
+    handleTelemetryCSV();
+  });
+  
+  server.on("/telemetry.bin", HTTP_GET, [this]() {
+    CpuFrequencyLock lock(CpuFrequency::LOCK_HTTP);
+    handleTelemetryBinary();
+  });
+  
+  // История для графиков: /history?res=1|60|900&from=<секунды от запуска>
+  server.on("/history", HTTP_GET, [this]() {
+    CpuFrequencyLock lock(CpuFrequency::LOCK_HTTP);
+    handleHistory();
+  });
+  
   // API для сброса конфигурации
   server.on("/reset-config", HTTP_POST, [this]() {
     if (currentState) {
       TerminalManager::addLog("🔄 Сброс конфигурации через веб-интерфейс");
       currentState->resetConfiguration();
+      if (systemController) {
+        systemController->applyConfig();
+      }
       server.send(200, "application/json", "{\"status\":\"success\",\"message\":\"Конфигурация сброшена\"}");
       TerminalManager::addLog("✅ Конфигурация сброшена через веб-интерфейс");
     } else {
@@ -255,7 +470,7 @@ void WebServerManager::setupRoutes() {
   server.on("/save-config", HTTP_POST, [this]() {
     if (currentState) {
       TerminalManager::addLog("💾 Принудительное сохранение конфигурации через веб-интерфейс");
-      if (currentState->saveConfiguration()) {
+      if (currentState->saveConfiguration() && ConfigStorage::flush()) {
         server.send(200, "application/json", "{\"status\":\"success\",\"message\":\"Конфигурация сохранена\"}");
         TerminalManager::addLog("✅ Конфигурация принудительно сохранена через веб-интерфейс");
       } else {
@@ -304,61 +519,84 @@ void WebServerManager::setupRoutes() {
 
 void WebServerManager::handleSaveConfig() {
   if (server.hasArg("plain")) {
-    String body = server.arg("plain");
-    DynamicJsonDocument doc(CONFIG_JSON_SIZE);
-    DeserializationError error = deserializeJson(doc, body);
+    ArenaJsonDocument doc(CONFIG_JSON_SIZE);
+    DeserializationError error = deserializeJson(doc, server.arg("plain"));
     
     if (!error) {
       bool configChanged = false;
+      String rejected = "";
       
-      if (doc.containsKey("targetTemp")) {
-        float newTemp = doc["targetTemp"];
-        if (newTemp >= TARGET_TEMP_MIN && newTemp <= TARGET_TEMP_MAX) {
-          currentState->targetTemp = newTemp;
-          // Передаем новое значение в SystemController
-          if (systemController) {
-            systemController->setTargetTemperature(newTemp);
+      // Все параметры реестра, присутствующие в запросе. Связанные параметры
+      // (например, minTemp и targetTemp) могут конфликтовать при изменении
+      // по одному, поэтому конфликтующие пробуем еще раз после остальных
+      bool retry[PARAM_COUNT] = { false };
+      for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < PARAM_COUNT; i++) {
+          ParamId id = (ParamId)i;
+          const ParamDescriptor& param = ConfigRegistry::getDescriptor(id);
+          if (!doc.containsKey(param.name) || (pass == 1 && !retry[i])) continue;
+          
+          float value = doc[param.name];
+          ConfigRegistry::SetResult result = ConfigRegistry::set(id, value);
+          if (result == ConfigRegistry::SET_CONFLICT && pass == 0) {
+            retry[i] = true;
+            continue;
+          }
+          
+          if (result == ConfigRegistry::SET_OK || result == ConfigRegistry::SET_OK_RESTART) {
+            configChanged = true;
+            char text[24];
+            ConfigRegistry::formatValue(id, text, sizeof(text));
             if (DEBUG_SERIAL) {
-              Serial.println("SystemController target temperature updated to: " + String(newTemp) + "°C");
+              Serial.println(String(param.name) + " updated to: " + text);
             }
+            TerminalManager::addLog(String("Параметр ") + param.name + " = " + text + " " + param.unit +
+                                    " через веб-интерфейс (" + ConfigRegistry::getResultText(result) + ")");
+          } else {
+            if (rejected.length() > 0) rejected += ",";
+            rejected += String("\"") + param.name + "\"";
+            TerminalManager::addLog(String("❌ Параметр ") + param.name + ": " + ConfigRegistry::getResultText(result));
           }
-          configChanged = true;
-          if (DEBUG_SERIAL) {
-            Serial.println("Target temperature updated to: " + String(newTemp) + "°C");
-          }
-          TerminalManager::addLog("Целевая температура установлена через веб-интерфейс: " + String(newTemp, 1) + "°C");
         }
       }
       
-      if (doc.containsKey("flowCalibrationFactor")) {
-        float newFactor = doc["flowCalibrationFactor"];
-        if (newFactor >= FLOW_CALIBRATION_MIN && newFactor <= FLOW_CALIBRATION_MAX) {
-          currentState->flowCalibrationFactor = newFactor;
-          // Обновляем коэффициент в датчике
-          systemController->getSensors().setCalibrationFactor(newFactor);
-          configChanged = true;
-          if (DEBUG_SERIAL) {
-            Serial.println("Flow calibration factor updated to: " + String(newFactor) + " imp/L");
-          }
-          TerminalManager::addLog("Калибровка протока установлена через веб-интерфейс: " + String(newFactor, 2) + " имп/л");
+      // Профили режимов и выбор режима (не параметры реестра)
+      bool profileChanged = systemController && applyProfileConfig(doc, rejected);
+      
+      // Применяем новые значения к регуляторам без перезапуска
+      if (configChanged) {
+        if (systemController) {
+          systemController->applyConfig();
         }
+        currentState->targetTemp = ConfigRegistry::get(PARAM_TARGET_TEMP);
+        currentState->flowCalibrationFactor = ConfigRegistry::get(PARAM_FLOW_CALIBRATION);
+      }
+      
+      if (rejected.length() > 0) {
+        server.send(400, "application/json", "{\"error\":\"Invalid parameters\",\"rejected\":[" + rejected + "]}");
+        if (configChanged) {
+          currentState->saveConfiguration();
+        }
+        return;
       }
       
       if (configChanged) {
-        // Сохраняем конфигурацию в EEPROM
+        // Сохраняем конфигурацию (запись во flash отложена)
         if (currentState->saveConfiguration()) {
           server.send(200, "application/json", "{\"status\":\"ok\"}");
           if (DEBUG_SERIAL) {
-            Serial.println("Configuration updated and saved to EEPROM");
+            Serial.println("Configuration updated and saved");
           }
-          TerminalManager::addLog("✅ Настройки успешно сохранены в EEPROM через веб-интерфейс");
+          TerminalManager::addLog("✅ Настройки успешно сохранены через веб-интерфейс");
         } else {
-          server.send(500, "application/json", "{\"error\":\"Failed to save to EEPROM\"}");
+          server.send(500, "application/json", "{\"error\":\"Failed to save configuration\"}");
           if (DEBUG_SERIAL) {
-            Serial.println("Failed to save configuration to EEPROM");
+            Serial.println("Failed to save configuration");
           }
-          TerminalManager::addLog("❌ Ошибка сохранения настроек в EEPROM через веб-интерфейс");
+          TerminalManager::addLog("❌ Ошибка сохранения настроек через веб-интерфейс");
         }
+      } else if (profileChanged) {
+        server.send(200, "application/json", "{\"status\":\"ok\"}");
       } else {
         server.send(400, "application/json", "{\"error\":\"Invalid parameters\"}");
         TerminalManager::addLog("❌ Неверные параметры при сохранении настроек через веб-интерфейс");
@@ -373,20 +611,132 @@ void WebServerManager::handleSaveConfig() {
   }
 }
 
-void WebServerManager::handleCalibrate() {
-  if (currentState) {
-    // Запуск калибровки датчика протока
-    TerminalManager::addLog("🔧 Запуск калибровки датчика протока через веб-интерфейс");
-    systemController->getSensors().calibrateFlowSensor();
-    currentState->flowCalibrationFactor = systemController->getSensors().getCalibrationFactor();
+bool WebServerManager::applyProfileConfig(JsonDocument& doc, String& rejected) {
+  bool changed = false;
+  
+  // "profiles": { "<режим>": { профиль } | "default" }
+  JsonObject profiles = doc["profiles"];
+  for (int i = 0; i < SystemController::PROFILE_MODE_COUNT && !profiles.isNull(); i++) {
+    SystemController::ProfileMode mode = (SystemController::ProfileMode)i;
+    const char* name = SystemController::getProfileModeName(mode);
+    if (!profiles.containsKey(name)) continue;
     
-    server.send(200, "application/json", "{\"status\":\"calibration_completed\", \"factor\":" + String(currentState->flowCalibrationFactor) + "}");
+    const char* text = profiles[name].as<const char*>();
+    PowerProfile profile;
+    if (text && strcmp(text, "default") == 0) {
+      systemController->resetProfile(mode);
+    } else if (!parseProfile(profiles[name].as<JsonObjectConst>(), profile) || !systemController->setProfile(mode, profile)) {
+      if (rejected.length() > 0) rejected += ",";
+      rejected += String("\"profiles.") + name + "\"";
+      TerminalManager::addLog(String("❌ Профиль ") + name + ": недопустимые сегменты или значения");
+      continue;
+    }
+    changed = true;
+    TerminalManager::addLog(String("Профиль ") + name + " обновлен через веб-интерфейс");
+  }
+  
+  // "profileMode": "<режим>" | "none"
+  if (doc.containsKey("profileMode")) {
+    const char* name = doc["profileMode"] | "";
+    int mode = SystemController::findProfileMode(name);
+    if (strcasecmp(name, "none") == 0) {
+      systemController->stopProfile();
+      changed = true;
+    } else if (mode >= 0 && systemController->startProfile((SystemController::ProfileMode)mode)) {
+      changed = true;
+      TerminalManager::addLog(String("Режим ") + name + " запущен через веб-интерфейс");
+    } else {
+      if (rejected.length() > 0) rejected += ",";
+      rejected += "\"profileMode\"";
+    }
+  }
+  
+  return changed;
+}
+
+bool WebServerManager::parseProfile(JsonObjectConst item, PowerProfile& profile) {
+  memset(&profile, 0, sizeof(profile));
+  
+  int target = ProfileEngine::findTarget(item["target"] | "");
+  JsonArrayConst segments = item["segments"].as<JsonArrayConst>();
+  if (target < 0 || segments.isNull() || segments.size() == 0 || segments.size() > PROFILE_MAX_SEGMENTS) {
+    return false;
+  }
+  profile.target = target;
+  profile.looping = (item["loop"] | false) ? 1 : 0;
+  
+  for (JsonObjectConst segment : segments) {
+    int shape = ProfileEngine::findShape(segment["shape"] | "linear");
+    float durationS = segment["durationS"] | 0.0f;
+    if (shape < 0 || durationS <= 0.0 || durationS > PROFILE_MAX_SEGMENT_S || !segment.containsKey("value")) {
+      return false;
+    }
+    ProfileSegment& entry = profile.segments[profile.segmentCount++];
+    entry.durationMs = (uint32_t)lroundf(durationS * 1000.0);
+    entry.value = segment["value"];
+    entry.shape = shape;
+  }
+  
+  // Без начального значения профиль начинается со значения первого сегмента
+  profile.startValue = item["start"] | profile.segments[0].value;
+  return ProfileEngine::isValid(profile);
+}
+
+void WebServerManager::fillProfile(JsonObject item, const PowerProfile& profile) {
+  item["target"] = ProfileEngine::getTargetName((ProfileEngine::Target)profile.target);
+  item["loop"] = profile.looping != 0;
+  item["start"] = profile.startValue;
+  JsonArray segments = item.createNestedArray("segments");
+  for (int i = 0; i < profile.segmentCount; i++) {
+    const ProfileSegment& segment = profile.segments[i];
+    JsonObject entry = segments.createNestedObject();
+    entry["durationS"] = segment.durationMs / 1000.0;
+    entry["value"] = segment.value;
+    entry["shape"] = ProfileEngine::getShapeName((ProfileEngine::Shape)segment.shape);
+  }
+}
+
+void WebServerManager::handleCalibrate() {
+  if (!currentState || !systemController) {
+    server.send(500, "application/json", "{\"error\":\"System not ready\"}");
+    return;
+  }
+  
+  // Калибровка по известному объему: start -> пролив -> finish&volume=<л>
+  SensorManager& sensors = systemController->getSensors();
+  String action = server.hasArg("action") ? server.arg("action") : "start";
+  
+  if (action == "start") {
+    sensors.startFlowCalibration();
+    TerminalManager::addLog("🔧 Калибровка датчика протока запущена через веб-интерфейс: пролейте известный объем");
+  } else if (action == "finish") {
+    float volume = server.hasArg("volume") ? server.arg("volume").toFloat() : 0.0;
+    FlowCalibrationPoint point;
+    SensorManager::CalibrationResult result = sensors.finishFlowCalibration(volume, point);
+    if (result != SensorManager::CAL_OK) {
+      server.send(400, "application/json", String("{\"error\":\"") + SensorManager::getCalibrationResultText(result) + "\"}");
+      TerminalManager::addLog(String("❌ Калибровка датчика протока: ") + SensorManager::getCalibrationResultText(result));
+      return;
+    }
+    currentState->flowCalibrationFactor = ConfigRegistry::get(PARAM_FLOW_CALIBRATION);
     
     if (DEBUG_SERIAL) {
       Serial.println("Flow sensor calibration completed");
     }
-    TerminalManager::addLog("✅ Калибровка датчика протока завершена через веб-интерфейс. Коэффициент: " + String(currentState->flowCalibrationFactor, 2) + " имп/л");
+    TerminalManager::addLog("✅ Калибровка датчика протока завершена через веб-интерфейс. Коэффициент: " +
+                            String(point.pulsesPerLiter, 2) + " имп/л при " + String(point.frequencyHz, 1) + " Гц");
+  } else if (action == "cancel") {
+    sensors.cancelFlowCalibration();
+    TerminalManager::addLog("Калибровка датчика протока отменена через веб-интерфейс");
+  } else if (action == "clear") {
+    sensors.clearFlowCalibrationCurve();
+    TerminalManager::addLog("Кривая калибровки датчика протока очищена через веб-интерфейс");
+  } else {
+    server.send(400, "application/json", "{\"error\":\"Unknown action\"}");
+    return;
   }
+  
+  sendJson(200, getFlowCalibrationJSON());
 }
 
 void WebServerManager::handleEmergencyStop() {
@@ -403,6 +753,186 @@ void WebServerManager::handleEmergencyStop() {
   }
 }
 
+const char* WebServerManager::getTelemetryInfoJSON() {
+  if (!telemetry) {
+    return "{\"error\":\"Telemetry not available\"}";
+  }
+  
+  ArenaJsonDocument doc(512);
+  doc["sampleRate"] = telemetry->getSampleRate();
+  doc["samples"] = telemetry->getSampleCount();
+  doc["totalSamples"] = telemetry->getTotalSamples();
+  doc["durationSec"] = telemetry->getDurationSeconds();
+  doc["usedBytes"] = telemetry->getUsedBytes();
+  doc["capacityBytes"] = telemetry->getCapacity();
+  doc["bytesPerSample"] = telemetry->getSampleCount() > 0 ?
+    (float)telemetry->getUsedBytes() / telemetry->getSampleCount() : 0.0;
+  
+  JsonArray channels = doc.createNestedArray("channels");
+  for (int ch = 0; ch < TELEMETRY_CHANNEL_COUNT; ch++) {
+    channels.add(TelemetryRecorder::getChannelName(ch));
+  }
+  
+  return RequestArena::serialize(doc);
+}
+
+void WebServerManager::handleTelemetryControl() {
+  if (!telemetry) {
+    server.send(500, "application/json", "{\"error\":\"Telemetry not available\"}");
+    return;
+  }
+  
+  if (server.hasArg("rate")) {
+    int rate = server.arg("rate").toInt();
+    if (!telemetry->setSampleRate(rate)) {
+      server.send(400, "application/json", "{\"error\":\"Invalid rate\"}");
+      return;
+    }
+    TerminalManager::addLog("Частота телеметрии установлена: " + String(rate) + " Гц");
+  }
+  
+  if (server.hasArg("clear")) {
+    telemetry->clear();
+    TerminalManager::addLog("Буфер телеметрии очищен");
+  }
+  
+  sendJson(200, getTelemetryInfoJSON());
+}
+
+void WebServerManager::handleTelemetryCSV() {
+  if (!telemetry) {
+    server.send(500, "text/plain", "Telemetry not available");
+    return;
+  }
+  
+  ChunkedResponse response(server);
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Content-Disposition", "attachment; filename=telemetry.csv");
+  server.send(200, "text/csv", "");
+  
+  // Заголовок CSV
+  char line[160];
+  size_t length = 0;
+  for (int ch = 0; ch < TELEMETRY_CHANNEL_COUNT; ch++) {
+    length += snprintf(line + length, sizeof(line) - length, ch ? ",%s" : "%s", TelemetryRecorder::getChannelName(ch));
+  }
+  line[length++] = '\n';
+  response.write((const uint8_t*)line, length);
+  
+  telemetry->forEachSample([](const int32_t* values, void* context) {
+    ChunkedResponse* out = static_cast<ChunkedResponse*>(context);
+    char row[160];
+    size_t len = snprintf(row, sizeof(row), "%lu", (unsigned long)(uint32_t)values[TELEMETRY_TIME_MS]);
+    for (int ch = 1; ch < TELEMETRY_CHANNEL_COUNT && len < sizeof(row); ch++) {
+      float scale = TelemetryRecorder::getChannelScale(ch);
+      if (scale == 1.0) {
+        len += snprintf(row + len, sizeof(row) - len, ",%ld", (long)values[ch]);
+      } else {
+        len += snprintf(row + len, sizeof(row) - len, scale < 0.1 ? ",%.2f" : ",%.1f", values[ch] * scale);
+      }
+    }
+    if (len < sizeof(row)) row[len++] = '\n';
+    out->write((const uint8_t*)row, len);
+  }, &response);
+  
+  response.finish();
+}
+
+void WebServerManager::handleTelemetryBinary() {
+  if (!telemetry) {
+    server.send(500, "text/plain", "Telemetry not available");
+    return;
+  }
+  
+  ChunkedResponse response(server);
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Content-Disposition", "attachment; filename=telemetry.bin");
+  server.send(200, "application/octet-stream", "");
+  
+  telemetry->exportBinary([](const uint8_t* data, size_t length, void* context) {
+    static_cast<ChunkedResponse*>(context)->write(data, length);
+  }, &response);
+  
+  response.finish();
+}
+
+void WebServerManager::handleHistory() {
+  if (!history) {
+    server.send(500, "application/json", "{\"error\":\"History not available\"}");
+    return;
+  }
+  
+  unsigned long resolution = server.hasArg("res") ? server.arg("res").toInt() : 60;
+  unsigned long from = server.hasArg("from") ? server.arg("from").toInt() : 0;
+  int tier = HistoryStore::findTier(resolution);
+  if (tier < 0) {
+    server.send(400, "application/json", "{\"error\":\"Invalid resolution, use 1, 60 or 900\"}");
+    return;
+  }
+  
+  // Первая ячейка, начинающаяся не раньше from
+  int count = history->getBucketCount(tier);
+  int first = 0;
+  while (first < count && history->getBucketStartTime(tier, first) < from) {
+    first++;
+  }
+  
+  ChunkedResponse response(server);
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  
+  // Колоночный формат: целые значения с масштабом, null для интервалов без данных
+  char text[96];
+  snprintf(text, sizeof(text), "{\"res\":%lu,\"now\":%lu,\"t0\":%lu,\"n\":%d,\"metrics\":{",
+           resolution, millis() / 1000,
+           first < count ? history->getBucketStartTime(tier, first) : millis() / 1000, count - first);
+  response.print(text);
+  
+  for (int m = 0; m < HISTORY_METRIC_COUNT; m++) {
+    snprintf(text, sizeof(text), "%s\"%s\":{\"scale\":%g", m ? "," : "",
+             HistoryStore::getMetricName(m), HistoryStore::getMetricScale(m));
+    response.print(text);
+    
+    static const char* const FIELDS[] = { "min", "avg", "max" };
+    for (int f = 0; f < 3; f++) {
+      snprintf(text, sizeof(text), ",\"%s\":[", FIELDS[f]);
+      response.print(text);
+      for (int i = first; i < count; i++) {
+        const HistoryStore::Bucket& bucket = history->getBucket(tier, i);
+        int16_t value = f == 0 ? bucket.minValue[m] : f == 1 ? bucket.avgValue[m] : bucket.maxValue[m];
+        const char* separator = (i > first) ? "," : "";
+        if (value == HistoryStore::EMPTY_VALUE) {
+          snprintf(text, sizeof(text), "%snull", separator);
+        } else {
+          snprintf(text, sizeof(text), "%s%d", separator, value);
+        }
+        response.print(text);
+      }
+      response.print("]");
+    }
+    response.print("}");
+  }
+  response.print("}");
+  
+  // Энергия по ячейкам (Вт*ч), из средней отдаваемой мощности
+  response.print(",\"energyWh\":[");
+  for (int i = first; i < count; i++) {
+    const HistoryStore::Bucket& bucket = history->getBucket(tier, i);
+    int16_t value = bucket.avgValue[HISTORY_DELIVERED_POWER];
+    const char* separator = (i > first) ? "," : "";
+    if (value == HistoryStore::EMPTY_VALUE) {
+      snprintf(text, sizeof(text), "%snull", separator);
+    } else {
+      float energyWh = value * HistoryStore::getMetricScale(HISTORY_DELIVERED_POWER) * resolution / 3600.0;
+      snprintf(text, sizeof(text), "%s%.2f", separator, energyWh);
+    }
+    response.print(text);
+  }
+  
+  response.print("]}");
+  response.finish();
+}
+
 String WebServerManager::getMainPage() {
   return readFileFromSPIFFS("/index.html");
 }
@@ -411,13 +941,15 @@ String WebServerManager::getWebInterface() {
   return readFileFromSPIFFS("/web_interface.html");
 }
 
-String WebServerManager::getStatusJSON() {
+const char* WebServerManager::getStatusJSON() {
   if (!currentState) {
     return "{\"error\":\"No state data\"}";
   }
   
-  DynamicJsonDocument doc(1024);
+  ArenaJsonDocument doc(2048);
   doc["temperature"] = currentState->currentTemp;
+  doc["inletTemp"] = currentState->inletTemp;
+  doc["inletSource"] = currentState->isInletMeasured ? "sensor" : "estimate";
   doc["targetTemp"] = currentState->targetTemp;
   doc["flowRate"] = currentState->flowRate;
   doc["flowCalibrationFactor"] = currentState->flowCalibrationFactor;
@@ -427,19 +959,68 @@ String WebServerManager::getStatusJSON() {
   doc["isThermalFuseOK"] = currentState->isThermalFuseOK;
   doc["isSystemEnabled"] = currentState->isSystemEnabled;
   doc["isPowerRamping"] = currentState->isPowerRamping;
+  doc["rampProfile"] = RampEngine::getProfileName(systemController->getRampEngine().getProfile());
+  doc["rampOutput"] = systemController->getRampEngine().getOutput();
+  doc["rampCurrentLimited"] = systemController->getRampEngine().isCurrentLimited();
+  
+  const ProfileEngine& profile = systemController->getProfileEngine();
+  doc["profileMode"] = SystemController::getProfileModeName(systemController->getProfileMode());
+  doc["profileValue"] = profile.getValue();
+  doc["profileSegment"] = profile.getSegment();
+  doc["profileElapsedS"] = (unsigned long)(profile.getElapsedMs() / 1000);
+  doc["activeSetpoint"] = systemController->getActiveSetpoint();
+  doc["disinfectionState"] = DisinfectionScheduler::getStateName(systemController->getDisinfection().getState());
   doc["powerL1"] = currentState->heatingPower[0];
   doc["powerL2"] = currentState->heatingPower[1];
   doc["powerL3"] = currentState->heatingPower[2];
   doc["targetPowerL1"] = currentState->targetPower[0];
   doc["targetPowerL2"] = currentState->targetPower[1];
   doc["targetPowerL3"] = currentState->targetPower[2];
+  doc["deliveredPowerW"] = currentState->deliveredPowerW;
+  doc["energyKWh"] = currentState->energyTotalKWh;
+  doc["energyL1KWh"] = currentState->energyPhaseKWh[0];
+  doc["energyL2KWh"] = currentState->energyPhaseKWh[1];
+  doc["energyL3KWh"] = currentState->energyPhaseKWh[2];
+  doc["litresHeated"] = currentState->litresHeated;
+  doc["energyCost"] = currentState->energyCost;
   doc["uptime"] = millis() / 1000;
   
+  // Ступени на реле (только если настроены)
+  const StageController& stages = systemController->getStageController();
+  if (stages.getStageCount() > 0) {
+    doc["relayStages"] = stages.getStageCount();
+    doc["relayStagesOn"] = stages.getActiveCount();
+    doc["relayStagePowerW"] = stages.getActivePowerW();
+    doc["relaySwitches"] = stages.getTotalSwitches();
+  }
+  
+  // Измерение сети и контур мощности (только если трансформаторы подключены)
+  if (MainsSensing::isEnabled()) {
+    MainsSensing::Measurement measurement;
+    MainsSensing::getMeasurement(measurement);
+    const PowerLoop& powerLoop = systemController->getPowerLoop();
+    JsonObject mains = doc.createNestedObject("mains");
+    mains["valid"] = MainsSensing::isValid();
+    mains["voltageRms"] = measurement.voltageRms;
+    JsonArray current = mains.createNestedArray("currentRms");
+    JsonArray real = mains.createNestedArray("realPowerW");
+    for (int phase = 0; phase < 3; phase++) {
+      current.add(measurement.currentRms[phase]);
+      real.add(measurement.realPowerW[phase]);
+    }
+    mains["samplesPerHalfCycle"] = measurement.samplesPerHalfCycle;
+    mains["halfCycles"] = measurement.sequence;
+    mains["rejected"] = MainsSensing::getRejectedCount();
+    mains["powerLoopActive"] = powerLoop.isActive();
+    mains["powerLoopTargetW"] = powerLoop.getTargetPowerW();
+    mains["powerLoopTrim"] = powerLoop.getTrimPercent();
+  }
+  
   // Информация о режиме работы системы
   String modeText = "";
   switch(currentState->systemMode) {
     case SYSTEM_MODE_SLEEP:
-      modeText = "Глубокий сон";
+      modeText = "Сон (light sleep)";
       break;
     case SYSTEM_MODE_ACTIVE:
       modeText = "Активная работа";
@@ -455,56 +1036,54 @@ String WebServerManager::getStatusJSON() {
   doc["systemMode"] = currentState->systemMode;
   doc["systemModeText"] = modeText;
   doc["isWiFiEnabled"] = currentState->isWiFiEnabled;
-  doc["wifiSessionTimeLeft"] = currentState->isWiFiEnabled ? 
-    (WIFI_SESSION_TIMEOUT_MS - (millis() - currentState->wifiSessionStartTime)) / 1000 : 0;
+  doc["wifiSessionTimeLeft"] = getSessionTimeLeft() / 1000;
   doc["updateFrequency"] = 1000; // 1с обновление в WiFi сессии
   
-  String response;
-  serializeJson(doc, response);
-  return response;
+  return RequestArena::serialize(doc);
 }
 
-String WebServerManager::getConfigJSON() {
-  DynamicJsonDocument doc(512);
+const char* WebServerManager::getConfigJSON() {
+  ArenaJsonDocument doc(CONFIG_JSON_SIZE);
   
-  // Читаем данные напрямую из EEPROM при каждом запросе
-  float targetTemp = TARGET_TEMP_DEFAULT;
-  float flowCalibrationFactor = FLOW_CALIBRATION_FACTOR;
+  // Текущие значения всех параметров (включая еще не записанные во flash)
+  for (int i = 0; i < PARAM_COUNT; i++) {
+    ParamId id = (ParamId)i;
+    doc[ConfigRegistry::getDescriptor(id).name] = ConfigRegistry::get(id);
+  }
   
-  // Проверяем, есть ли валидная конфигурация в EEPROM
-  if (ConfigStorage::isValidConfig()) {
-    // Читаем данные из EEPROM
-    uint32_t magic;
-    EEPROM.get(0, magic); // MAGIC_NUMBER_ADDR = 0
-    
-    if (magic == 0x57415445) { // MAGIC_NUMBER
-      // Читаем структуру конфигурации
-      struct {
-        float targetTemp;
-        float flowCalibrationFactor;
-        uint32_t magic;
-      } config;
-      
-      EEPROM.get(4, config); // CONFIG_START_ADDR = 4
-      
-      // Проверяем валидность данных
-      if (config.targetTemp >= TARGET_TEMP_MIN && config.targetTemp <= TARGET_TEMP_MAX &&
-          config.flowCalibrationFactor >= FLOW_CALIBRATION_MIN && config.flowCalibrationFactor <= FLOW_CALIBRATION_MAX) {
-        targetTemp = config.targetTemp;
-        flowCalibrationFactor = config.flowCalibrationFactor;
-        
-        if (DEBUG_SERIAL) {
-          Serial.println("WebServer: Загружена конфигурация из EEPROM:");
-          Serial.println("Целевая температура: " + String(targetTemp, 1) + "°C");
-          Serial.println("Коэффициент калибровки: " + String(flowCalibrationFactor, 2) + " имп/л");
-        }
-      }
-    }
+  // Описание параметров для веб-интерфейса
+  JsonArray params = doc.createNestedArray("params");
+  for (int i = 0; i < PARAM_COUNT; i++) {
+    const ParamDescriptor& param = ConfigRegistry::getDescriptor((ParamId)i);
+    JsonObject item = params.createNestedObject();
+    item["name"] = param.name;
+    item["type"] = param.type == PARAM_TYPE_UINT ? "uint" : "float";
+    item["min"] = param.minValue;
+    item["max"] = param.maxValue;
+    item["default"] = param.defaultValue;
+    item["live"] = param.live;
+    item["unit"] = param.unit;
   }
   
-  // Устанавливаем значения в JSON
-  doc["targetTemp"] = targetTemp;
-  doc["flowCalibrationFactor"] = flowCalibrationFactor;
+  // Состояние хранилища
+  const RecordLog& recordLog = ConfigStorage::getLog();
+  doc["storageLog"] = ConfigStorage::isUsingLog();
+  doc["storagePending"] = ConfigStorage::hasPendingChanges();
+  doc["storageWrites"] = ConfigStorage::getFlashWriteCount();
+  doc["storageSectors"] = recordLog.getSectorCount();
+  doc["storageSequence"] = recordLog.getSequence();
+  doc["storageFreeBytes"] = recordLog.getFreeBytes();
+  
+  // Профили режимов (загружаются через POST /config)
+  if (systemController) {
+    doc["profileMode"] = SystemController::getProfileModeName(systemController->getProfileMode());
+    JsonObject profiles = doc.createNestedObject("profiles");
+    for (int i = 0; i < SystemController::PROFILE_MODE_COUNT; i++) {
+      SystemController::ProfileMode mode = (SystemController::ProfileMode)i;
+      fillProfile(profiles.createNestedObject(SystemController::getProfileModeName(mode)),
+                  systemController->getProfile(mode));
+    }
+  }
   
   // Добавляем константы конфигурации
   doc["flowThresholdMin"] = FLOW_THRESHOLD_MIN;
@@ -516,9 +1095,7 @@ String WebServerManager::getConfigJSON() {
   doc["targetTempMin"] = TARGET_TEMP_MIN;
   doc["targetTempMax"] = TARGET_TEMP_MAX;
   
-  String response;
-  serializeJson(doc, response);
-  return response;
+  return RequestArena::serialize(doc);
 }
 
 void WebServerManager::startWiFiAP() {
@@ -549,20 +1126,36 @@ void WebServerManager::startWiFiAP() {
 }
 
 String WebServerManager::readFileFromSPIFFS(String path) {
+  MEMORY_SCOPE(MEM_SPIFFS);
+  
   File file = SPIFFS.open(path, "r");
   if (!file) {
     return "Error: File not found";
   }
   
-  String content = "";
+  // Один блок нужного размера вместо роста строки по символу: при
+  // посимвольном += куча дробится копиями промежуточных строк
+  String content;
+  content.reserve(file.size());
+  char chunk[257];
   while (file.available()) {
-    content += char(file.read());
+    size_t length = file.read((uint8_t*)chunk, sizeof(chunk) - 1);
+    if (length == 0) break;
+    chunk[length] = '\0';
+    content += chunk;
   }
   file.close();
   
   return content;
 }
 
+void WebServerManager::sendJson(int code, const char* json) {
+  // send(code, type, String) копирует тело в String на каждый ответ
+  server.send_P(code, "application/json", json, strlen(json));
+  // Из буфера не освобождается; выделенное из кучи при переполнении - здесь
+  RequestArena::releaseText(json);
+}
+
 String WebServerManager::getSystemLogs() {
   // Получаем логи из основного лога страницы
   String logs = "";
@@ -571,6 +1164,9 @@ String WebServerManager::getSystemLogs() {
   logs += "=== СИСТЕМНЫЕ ЛОГИ ===\n";
   logs += "Время работы: " + String(millis() / 1000) + " сек\n";
   logs += "Свободная память: " + String(ESP.getFreeHeap()) + " байт\n";
+  logs += "Самый большой блок: " + String(MemoryMonitor::getHeapInfo().largestFreeBlock) + " байт (фрагментация " +
+          String(MemoryMonitor::getHeapInfo().fragmentationPercent) + "%)\n";
+  logs += "Минимум свободной памяти: " + String(MemoryMonitor::getHeapInfo().minFreeEver) + " байт\n";
   logs += "Размер стека: " + String(uxTaskGetStackHighWaterMark(NULL)) + " байт\n";
   logs += "Температура чипа: " + String(temperatureRead(), 1) + "°C\n";
   
@@ -594,14 +1190,545 @@ String WebServerManager::getSystemLogs() {
   return logs;
 }
 
-String WebServerManager::getSensorsInfoJSON() {
-  DynamicJsonDocument doc(1024);
+const char* WebServerManager::getTraceJSON() {
+  if (!systemController) {
+    return "{\"error\":\"System not ready\"}";
+  }
+  
+  ArenaJsonDocument doc(4096);
+  doc["state"] = SystemController::getStateName(systemController->getState());
+  doc["uptimeMs"] = millis();
+  doc["droppedEvents"] = systemController->getDroppedEventCount();
+  
+  // Последние переходы, от старых к новым
+  JsonArray transitions = doc.createNestedArray("transitions");
+  for (int i = 0; i < systemController->getTraceCount(); i++) {
+    const SystemController::TransitionRecord& record = systemController->getTraceEntry(i);
+    JsonObject entry = transitions.createNestedObject();
+    entry["timeMs"] = record.timeMs;
+    entry["from"] = SystemController::getStateName((SystemController::SystemState)record.from);
+    entry["to"] = SystemController::getStateName((SystemController::SystemState)record.to);
+    entry["event"] = SystemController::getEventName((SystemController::ControllerEvent)record.event);
+  }
+  
+  return RequestArena::serialize(doc);
+}
+
+const char* WebServerManager::getSafetyJSON() {
+  ArenaJsonDocument doc(512);
+  bool tripped = SafetySupervisor::isTripped();
+  doc["tripped"] = tripped;
+  doc["fault"] = SafetySupervisor::getFaultName(SafetySupervisor::getTripFault());
+  if (tripped) {
+    doc["tripTimeMs"] = SafetySupervisor::getTripTime();
+  }
+  doc["tripCount"] = SafetySupervisor::getTripCount();
+  doc["periodMs"] = SUPERVISOR_PERIOD_MS;
+  doc["watchdogTimeoutSec"] = SUPERVISOR_WDT_TIMEOUT_S;
+  
+  // Результат последней проверки с имитацией неисправности
+  JsonObject test = doc.createNestedObject("test");
+  test["pending"] = SafetySupervisor::isTestPending();
+  if (SafetySupervisor::getLastTestLatencyUs() >= 0) {
+    SafetySupervisor::Fault fault = SafetySupervisor::getLastTestFault();
+    test["fault"] = SafetySupervisor::getFaultName(fault);
+    test["latencyUs"] = SafetySupervisor::getLastTestLatencyUs();
+    test["boundMs"] = SafetySupervisor::getLatencyBoundMs(fault);
+    test["withinBound"] = SafetySupervisor::getLastTestLatencyUs() <= (long)SafetySupervisor::getLatencyBoundMs(fault) * 1000L;
+  }
+  
+  return RequestArena::serialize(doc);
+}
+
+const char* WebServerManager::getDisinfectionJSON() {
+  ArenaJsonDocument doc(2560);
+  if (!systemController) {
+    doc["error"] = "System not ready";
+    return RequestArena::serialize(doc);
+  }
+  
+  const DisinfectionScheduler& disinfection = systemController->getDisinfection();
+  const DisinfectionHistory& history = disinfection.getHistory();
+  doc["state"] = DisinfectionScheduler::getStateName(disinfection.getState());
+  doc["requested"] = disinfection.isRequested();
+  doc["intervalH"] = disinfection.getIntervalS() / 3600;
+  doc["minTempC"] = disinfection.getMinTemp();
+  doc["holdS"] = disinfection.getHoldS();
+  doc["exposureS"] = disinfection.getExposureS();
+  doc["attempts"] = disinfection.getAttempts();
+  doc["maxAttempts"] = DISINFECTION_MAX_ATTEMPTS;
+  doc["cycleEnergyWh"] = disinfection.getCycleEnergyWh(systemController->getEnergyMeter().getTotalEnergyKWh());
+  
+  // Время - по работе устройства (часов реального времени нет)
+  doc["operatingH"] = history.operatingS / 3600.0;
+  doc["sinceLastH"] = history.sinceLastS / 3600.0;
+  doc["dueInH"] = disinfection.getDueInS() / 3600.0;
+  doc["persistent"] = disinfection.isPersistent();
+  
+  JsonObject counts = doc.createNestedObject("counts");
+  counts["passed"] = history.passed;
+  counts["inUse"] = history.inUse;
+  counts["aborted"] = history.aborted;
+  counts["missed"] = history.missed;
+  
+  // Доказательства выполнения: удержание и температура, новые в конце
+  JsonArray results = doc.createNestedArray("results");
+  for (int i = 0; i < history.count; i++) {
+    const DisinfectionResult& entry = disinfection.getResult(i);
+    JsonObject item = results.createNestedObject();
+    item["result"] = DisinfectionScheduler::getResultName((DisinfectionScheduler::Result)entry.result);
+    item["scheduled"] = entry.scheduled != 0;
+    item["agoH"] = (history.operatingS - entry.operatingS) / 3600.0;
+    item["holdS"] = entry.holdS;
+    item["minTempC"] = entry.minTemp;
+    item["avgTempC"] = entry.avgTemp;
+    item["energyWh"] = entry.energyWh;
+  }
+  
+  return RequestArena::serialize(doc);
+}
+
+const char* WebServerManager::getPowerJSON() {
+  ArenaJsonDocument doc(1536);
+  if (!power) {
+    doc["error"] = "Энергосбережение не подключено";
+    return RequestArena::serialize(doc);
+  }
+  
+  doc["enabled"] = IDLE_SLEEP_ENABLED;
+  doc["sleepCount"] = power->getSleepCount();
+  doc["sleepSharePercent"] = power->getSleepShare() * 100.0;
+  doc["estimatedCurrentMa"] = power->getEstimatedCurrentMa();
+  
+  // Время в режимах (с)
+  JsonObject modes = doc.createNestedObject("timeSec");
+  for (int i = 0; i < PowerManager::POWER_MODE_COUNT; i++) {
+    PowerManager::PowerMode mode = (PowerManager::PowerMode)i;
+    modes[PowerManager::getModeName(mode)] = power->getModeTimeUs(mode) / 1000000.0;
+  }
+  
+  JsonObject wakes = doc.createNestedObject("wakeups");
+  for (int i = 0; i < PowerManager::WAKE_SOURCE_COUNT; i++) {
+    PowerManager::WakeSource source = (PowerManager::WakeSource)i;
+    wakes[PowerManager::getWakeSourceName(source)] = power->getWakeCount(source);
+  }
+  
+  // Задержка пробуждения по таймеру сверх заданного интервала сна
+  JsonObject latency = doc.createNestedObject("wakeLatencyUs");
+  latency["last"] = power->getLastWakeLatencyUs();
+  latency["avg"] = power->getAverageWakeLatencyUs();
+  latency["max"] = power->getMaxWakeLatencyUs();
+  
+  // Частота CPU: удерживаемые блокировки, время на каждой частоте и
+  // запаздывание включения триаков на ней
+  JsonObject cpu = doc.createNestedObject("cpu");
+  cpu["freqMhz"] = CpuFrequency::getCurrentMhz();
+  cpu["switchCount"] = CpuFrequency::getSwitchCount();
+  JsonArray locks = cpu.createNestedArray("locks");
+  for (int i = 0; i < CpuFrequency::LOCK_COUNT; i++) {
+    CpuFrequency::Lock lock = (CpuFrequency::Lock)i;
+    if (CpuFrequency::isHeld(lock)) {
+      locks.add(CpuFrequency::getLockName(lock));
+    }
+  }
+  JsonArray levels = cpu.createNestedArray("levels");
+  for (int i = 0; i < CpuFrequency::LEVEL_COUNT; i++) {
+    JsonObject level = levels.createNestedObject();
+    level["mhz"] = CpuFrequency::getLevelMhz(i);
+    level["timeSec"] = CpuFrequency::getTimeAtLevelUs(i) / 1000000.0;
+    level["fires"] = CpuFrequency::getFireCount(i);
+    level["fireLatencyAvgUs"] = CpuFrequency::getAverageFireLatencyUs(i);
+    level["fireLatencyMaxUs"] = CpuFrequency::getMaxFireLatencyUs(i);
+  }
+  
+  return RequestArena::serialize(doc);
+}
+
+const char* WebServerManager::getPerfJSON() {
+  ArenaJsonDocument doc(4096);
+  doc["enabled"] = PERF_PROFILING_ENABLED;
+  doc["cpuFreqMhz"] = getCpuFrequencyMhz();
+  
+  JsonArray probes = doc.createNestedArray("probes");
+  for (int p = 0; p < PERF_PROBE_COUNT; p++) {
+    PerfProbe probe = (PerfProbe)p;
+    const PerfProfiler::Stats& stats = PerfProfiler::getStats(probe);
+    JsonObject item = probes.createNestedObject();
+    item["name"] = PerfProfiler::getProbeName(probe);
+    item["count"] = stats.count;
+    item["minCycles"] = stats.minCycles;
+    item["meanCycles"] = PerfProfiler::getMeanCycles(probe);
+    item["p99Cycles"] = PerfProfiler::getP99Cycles(probe);
+    item["maxCycles"] = stats.maxCycles;
+    
+    // Гистограмма log2: элемент i - замеры [2^i, 2^(i+1)) тактов,
+    // хвост из нулей отбрасывается
+    int last = PERF_HISTOGRAM_BUCKETS - 1;
+    while (last >= 0 && stats.histogram[last] == 0) last--;
+    JsonArray histogram = item.createNestedArray("histogram");
+    for (int i = 0; i <= last; i++) {
+      histogram.add(stats.histogram[i]);
+    }
+  }
+  
+  return RequestArena::serialize(doc);
+}
+
+const char* WebServerManager::getPhaseTimingJSON() {
+  ArenaJsonDocument doc(2048);
+  doc["active"] = PhaseTiming::isActive();
+  doc["zeroCrossCount"] = PhaseTiming::getZeroCrossCount();
+  doc["checkedHalfPeriods"] = PhaseTiming::getCheckedHalfPeriods();
+  
+  JsonArray phases = doc.createNestedArray("phases");
+  for (int phase = 0; phase < 3; phase++) {
+    const PhaseTiming::PhaseStats& stats = PhaseTiming::getStats(phase);
+    JsonObject item = phases.createNestedObject();
+    item["phase"] = phase + 1;
+    item["fires"] = stats.fires;
+    item["meanErrorUs"] = PhaseTiming::getMeanErrorUs(phase);
+    item["jitterUs"] = PhaseTiming::getJitterUs(phase);
+    item["minErrorUs"] = stats.minErrorUs;
+    item["maxErrorUs"] = stats.maxErrorUs;
+    item["early"] = stats.early;
+    item["missed"] = stats.missed;
+    
+    // Гистограмма |ошибки|: элемент i - [2^i - 1, 2^(i+1) - 1) мкс
+    int last = PHASE_TIMING_HISTOGRAM_BUCKETS - 1;
+    while (last >= 0 && stats.histogram[last] == 0) last--;
+    JsonArray histogram = item.createNestedArray("histogram");
+    for (int i = 0; i <= last; i++) {
+      histogram.add(stats.histogram[i]);
+    }
+  }
+  
+  return RequestArena::serialize(doc);
+}
+
+void WebServerManager::handlePhaseTiming() {
+  String action = server.arg("action");
+  if (action == "start") {
+    PhaseTiming::start();
+    TerminalManager::addLog("⏱ Измерение точности включения триаков запущено");
+  } else if (action == "stop") {
+    PhaseTiming::stop();
+    TerminalManager::addLog("⏱ Измерение точности включения триаков остановлено");
+  } else if (action == "reset") {
+    PhaseTiming::reset();
+  } else {
+    server.send(400, "application/json", "{\"status\":\"error\",\"message\":\"action: start|stop|reset\"}");
+    return;
+  }
+  sendJson(200, getPhaseTimingJSON());
+}
+
+const char* WebServerManager::getReplayJSON() {
+  ArenaJsonDocument doc(512);
+  doc["recording"] = ControlIO::isRecording();
+  doc["records"] = ControlIO::getRecordCount();
+  doc["capacity"] = ControlIO::getCapacity();
+  doc["full"] = ControlIO::isFull();
+  doc["durationMs"] = ControlIO::getDurationUs() / 1000;
+  doc["stepUs"] = REPLAY_STEP_US;
+  const char* notReady = systemController ? ReplayEngine::checkReady(*systemController) : "система не готова";
+  doc["ready"] = notReady == nullptr;
+  if (notReady) {
+    doc["reason"] = notReady;
+  }
+  
+  return RequestArena::serialize(doc);
+}
+
+void WebServerManager::handleReplayControl() {
+  String action = server.arg("action");
+  if (action == "record") {
+    if (!systemController || !ReplayEngine::startRecording(*systemController)) {
+      server.send(500, "application/json", "{\"status\":\"error\",\"message\":\"Не удалось начать запись\"}");
+      return;
+    }
+    TerminalManager::addLog("⏺ Запись трассы входов запущена");
+  } else if (action == "stop") {
+    ControlIO::stopRecording();
+    TerminalManager::addLog("⏹ Запись трассы входов остановлена");
+  } else if (action == "clear") {
+    ControlIO::clear();
+  } else {
+    server.send(400, "application/json", "{\"status\":\"error\",\"message\":\"action: record|stop|clear\"}");
+    return;
+  }
+  sendJson(200, getReplayJSON());
+}
+
+void WebServerManager::handleReplayTraceDownload() {
+  if (ControlIO::isRecording() || ControlIO::getRecordCount() == 0) {
+    server.send(409, "application/json", "{\"error\":\"No trace (or recording in progress)\"}");
+    return;
+  }
+  
+  ChunkedResponse response(server);
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Content-Disposition", "attachment; filename=trace.bin");
+  server.send(200, "application/octet-stream", "");
+  
+  ControlIO::TraceHeader header;
+  ControlIO::fillHeader(header);
+  response.write((const uint8_t*)&header, sizeof(header));
+  for (int i = 0; i < ControlIO::getRecordCount(); i++) {
+    response.write((const uint8_t*)&ControlIO::getRecord(i), sizeof(ControlIO::TraceRecord));
+  }
+  response.finish();
+}
+
+void WebServerManager::handleReplayTraceUpload() {
+  HTTPUpload& upload = server.upload();
+  if (upload.status == UPLOAD_FILE_START) {
+    if (!ControlIO::beginLoad()) {
+      TerminalManager::addLog("❌ Загрузка трассы отклонена: идет запись или нет памяти");
+    }
+  } else if (upload.status == UPLOAD_FILE_WRITE) {
+    ControlIO::loadBytes(upload.buf, upload.currentSize);
+  } else if (upload.status == UPLOAD_FILE_END) {
+    if (ControlIO::endLoad()) {
+      TerminalManager::addLog("📥 Загружена трасса: " + String(ControlIO::getRecordCount()) + " записей");
+    } else {
+      TerminalManager::addLog("❌ Неверный файл трассы");
+    }
+  } else if (upload.status == UPLOAD_FILE_ABORTED) {
+    ControlIO::endLoad();
+  }
+}
+
+void WebServerManager::handleReplayRun() {
+  const char* notReady = systemController ? ReplayEngine::checkReady(*systemController) : "система не готова";
+  if (notReady) {
+    server.send(409, "text/plain", notReady);
+    return;
+  }
+  
+  ChunkedResponse response(server);
+  ChunkedPrint out(response);
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Content-Disposition", "attachment; filename=replay.csv");
+  server.send(200, "text/csv", "");
+  
+  // Все строки решений; только переходы - ?transitions=1
+  ReplayEngine::Summary summary;
+  ReplayEngine::run(*systemController, out, server.arg("transitions") != "1", summary);
+  response.finish();
+  
+  TerminalManager::addLog("▶ Воспроизведение трассы: " + String(summary.transitions) + " переходов, " +
+                          String(summary.durationMs) + " мс за " + String(summary.wallMs) + " мс");
+}
+
+const char* WebServerManager::getMemoryJSON() {
+  const MemoryMonitor::HeapInfo& info = MemoryMonitor::getHeapInfo();
+  ArenaJsonDocument doc(2560);
+  
+  JsonObject heap = doc.createNestedObject("heap");
+  heap["free"] = ESP.getFreeHeap();
+  heap["largestBlock"] = info.largestFreeBlock;
+  heap["minFreeEver"] = info.minFreeEver;
+  heap["fragmentationPercent"] = info.fragmentationPercent;
+  heap["allocatedBlocks"] = info.allocatedBlocks;
+  heap["freeBlocks"] = info.freeBlocks;
+  if (psramFound()) {
+    heap["psramFree"] = ESP.getFreePsram();
+  }
+  
+  JsonObject alerts = doc.createNestedObject("alerts");
+  alerts["fragmentation"] = MemoryMonitor::isFragmentationAlert();
+  alerts["lowBlock"] = MemoryMonitor::isLowHeapAlert();
+  alerts["count"] = MemoryMonitor::getAlertCount();
+  alerts["fragmentationThreshold"] = MEMORY_FRAGMENTATION_ALERT_PERCENT;
+  
+  JsonArray tags = doc.createNestedArray("tags");
+  for (int t = 0; t < MEM_TAG_COUNT; t++) {
+    const MemoryMonitor::TagStats& stats = MemoryMonitor::getTagStats((MemoryTag)t);
+    JsonObject item = tags.createNestedObject();
+    item["name"] = MemoryMonitor::getTagName((MemoryTag)t);
+    item["allocations"] = stats.allocations;
+    item["frees"] = stats.frees;
+    item["currentBytes"] = stats.currentBytes;
+    item["peakBytes"] = stats.peakBytes;
+  }
+  
+  // Минимальный запас стека за время работы (байт)
+  JsonArray tasks = doc.createNestedArray("tasks");
+  for (int i = 0; i < MemoryMonitor::getTaskCount(); i++) {
+    JsonObject item = tasks.createNestedObject();
+    item["name"] = MemoryMonitor::getTaskName(i);
+    item["stackFreeMin"] = MemoryMonitor::getTaskStackFree(i);
+  }
+  
+  JsonObject arena = doc.createNestedObject("requestArena");
+  arena["capacity"] = RequestArena::getCapacity();
+  arena["highWater"] = RequestArena::getHighWater();
+  arena["fallbacks"] = RequestArena::getFallbackCount();
+  arena["resets"] = RequestArena::getResetCount();
+  
+  const MemoryMonitor::AllocationWatch& watch = MemoryMonitor::getAllocationWatch();
+  JsonObject watchJson = doc.createNestedObject("allocationWatch");
+  watchJson["supported"] = MemoryMonitor::isAllocationWatchSupported();
+  watchJson["active"] = watch.active;
+  if (watch.active || watch.finished) {
+    watchJson["durationS"] = watch.durationMs / 1000;
+    if (watch.finished) {
+      watchJson["passed"] = MemoryMonitor::isAllocationWatchPassed();
+    }
+    watchJson["controlAllocations"] = watch.controlAllocations;
+    watchJson["controlBytes"] = watch.controlBytes;
+    watchJson["httpAllocations"] = watch.httpAllocations;
+    watchJson["httpBytes"] = watch.httpBytes;
+    watchJson["otherAllocations"] = watch.otherAllocations;
+    JsonArray samples = watchJson.createNestedArray("samples");
+    for (int i = 0; i < watch.sampleCount; i++) {
+      JsonObject item = samples.createNestedObject();
+      item["size"] = watch.sampleSize[i];
+      item["caller"] = watch.sampleCaller[i];
+      item["http"] = watch.sampleHttp[i];
+    }
+  }
+  
+  return RequestArena::serialize(doc);
+}
+
+void WebServerManager::handleBenchmark() {
+  // Прогон занимает loop: датчики и детектор нуля не опрашиваются
+  if (!systemController || systemController->getState() != SystemController::STATE_IDLE) {
+    server.send(409, "application/json", "{\"error\":\"System not idle\"}");
+    return;
+  }
+  
+  BenchSuite::Result results[BenchSuite::CASE_COUNT];
+  BenchSuite::Summary summary;
+  BenchSuite::run(results, summary);
+  
+  ArenaJsonDocument doc(3072);
+  doc["passed"] = BenchSuite::isPassed(summary);
+  doc["regressions"] = summary.regressions;
+  doc["missingBaselines"] = summary.missingBaselines;
+  doc["skipped"] = summary.skipped;
+  doc["thresholdPercent"] = BENCH_REGRESSION_PERCENT;
+  doc["cpuMhz"] = getCpuFrequencyMhz();
+  doc["wallMs"] = summary.wallMs;
+  
+  JsonObject heap = doc.createNestedObject("heap");
+  heap["freeStart"] = summary.heapFreeStart;
+  heap["peakBytes"] = summary.heapPeakBytes;
+  heap["minFreeEver"] = summary.heapMinFreeEver;
+  
+  JsonArray cases = doc.createNestedArray("cases");
+  for (int c = 0; c < summary.count; c++) {
+    const BenchSuite::Result& r = results[c];
+    JsonObject item = cases.createNestedObject();
+    item["name"] = r.name;
+    if (r.skipped) {
+      item["status"] = "skip";
+      continue;
+    }
+    item["iterations"] = r.iterations;
+    item["cyclesPerOp"] = r.meanCycles;
+    item["minCycles"] = r.minCycles;
+    item["bytesPerOp"] = r.bytesPerOp;
+    item["baselineCycles"] = r.baselineCycles;
+    item["baselineBytes"] = r.baselineBytes;
+    item["status"] = r.regressed ? "fail" : r.missingBaseline ? "nobase" : "ok";
+  }
+  
+  sendJson(BenchSuite::isPassed(summary) ? 200 : 409, RequestArena::serialize(doc));
+  
+  if (summary.regressions > 0) {
+    TerminalManager::addLog("⚠ Тесты производительности: регрессий " + String(summary.regressions));
+  }
+}
+
+void WebServerManager::handleSafety() {
+  if (!systemController) {
+    server.send(500, "application/json", "{\"error\":\"System not ready\"}");
+    return;
+  }
+  
+  if (server.hasArg("inject")) {
+    SafetySupervisor::Fault fault = SafetySupervisor::findFault(server.arg("inject").c_str());
+    if (fault == SafetySupervisor::FAULT_NONE) {
+      server.send(400, "application/json", "{\"error\":\"Unknown fault\"}");
+      return;
+    }
+    if (!SafetySupervisor::injectFault(fault)) {
+      server.send(409, "application/json", "{\"error\":\"Supervisor already tripped\"}");
+      return;
+    }
+    TerminalManager::addLog(String("🧪 Проверка супервизора безопасности: имитация ") + SafetySupervisor::getFaultName(fault));
+  } else if (server.hasArg("clear")) {
+    // Защита снимается вместе с выходом контроллера из ошибки
+    systemController->reset();
+    TerminalManager::addLog("🔄 Сброс ошибки через веб-интерфейс");
+  } else {
+    server.send(400, "application/json", "{\"error\":\"Missing inject or clear\"}");
+    return;
+  }
+  
+  sendJson(200, getSafetyJSON());
+}
+
+void WebServerManager::handleDisinfection() {
+  if (!systemController) {
+    server.send(500, "application/json", "{\"error\":\"System not ready\"}");
+    return;
+  }
+  
+  String action = server.arg("action");
+  DisinfectionScheduler& disinfection = systemController->getDisinfection();
+  if (action == "start") {
+    // Цикл начнется с ближайшим водоразбором
+    disinfection.requestCycle();
+    TerminalManager::addLog("🌡 Термодезинфекция запрошена через веб-интерфейс");
+  } else if (action == "stop") {
+    disinfection.cancel();
+    TerminalManager::addLog("🌡 Термодезинфекция отменена через веб-интерфейс");
+  } else {
+    server.send(400, "application/json", "{\"error\":\"action: start|stop\"}");
+    return;
+  }
+  
+  sendJson(200, getDisinfectionJSON());
+}
+
+const char* WebServerManager::getFlowCalibrationJSON() {
+  ArenaJsonDocument doc(1024);
+  fillFlowCalibration(doc.to<JsonObject>());
+  
+  return RequestArena::serialize(doc);
+}
+
+void WebServerManager::fillFlowCalibration(JsonObject calibration) {
+  const SensorManager& sensors = systemController->getSensors();
+  calibration["counter"] = "pcnt";
+  calibration["factor"] = ConfigRegistry::get(PARAM_FLOW_CALIBRATION);
+  calibration["activeFactor"] = sensors.getCalibrationFactor();
+  calibration["active"] = sensors.isFlowCalibrationActive();
+  calibration["pulses"] = sensors.getFlowCalibrationPulses();
+  calibration["minPulses"] = FLOW_CAL_MIN_PULSES;
+  
+  FlowCalibrationPoint points[FLOW_CURVE_MAX_POINTS];
+  int count = sensors.getFlowCalibrationCurve(points);
+  JsonArray curve = calibration.createNestedArray("curve");
+  for (int i = 0; i < count; i++) {
+    JsonObject point = curve.createNestedObject();
+    point["frequencyHz"] = points[i].frequencyHz;
+    point["pulsesPerLiter"] = points[i].pulsesPerLiter;
+  }
+}
+
+const char* WebServerManager::getSensorsInfoJSON() {
+  ArenaJsonDocument doc(2560);
   
   // Функция для получения D-названия пина
   auto getDPinName = [](int gpio) -> String {
     switch (gpio) {
       case 34: return "D34";
       case 35: return "D35";
+      case 36: return "VP";
       case 32: return "D32";
       case 33: return "D33";
       case 25: return "D25";
@@ -629,16 +1756,24 @@ String WebServerManager::getSensorsInfoJSON() {
   
   // Информация о пинах с D-названиями
   doc["pins"]["ntc"] = "GPIO" + String(NTC_PIN) + " (" + getDPinName(NTC_PIN) + ")";
+#if INLET_NTC_ENABLED
+  doc["pins"]["inletNtc"] = "GPIO" + String(INLET_NTC_PIN) + " (" + getDPinName(INLET_NTC_PIN) + ")";
+#endif
   doc["pins"]["flowSensor"] = "GPIO" + String(FLOW_SENSOR_PIN) + " (" + getDPinName(FLOW_SENSOR_PIN) + ")";
   doc["pins"]["triacL1"] = "GPIO" + String(TRIAC_L1_PIN) + " (" + getDPinName(TRIAC_L1_PIN) + ")";
   doc["pins"]["triacL2"] = "GPIO" + String(TRIAC_L2_PIN) + " (" + getDPinName(TRIAC_L2_PIN) + ")";
   doc["pins"]["triacL3"] = "GPIO" + String(TRIAC_L3_PIN) + " (" + getDPinName(TRIAC_L3_PIN) + ")";
+#if PHASE_ZERO_CROSS_INPUTS
+  doc["pins"]["zeroCrossL2"] = "GPIO" + String(ZERO_CROSS_L2_PIN) + " (" + getDPinName(ZERO_CROSS_L2_PIN) + ")";
+  doc["pins"]["zeroCrossL3"] = "GPIO" + String(ZERO_CROSS_L3_PIN) + " (" + getDPinName(ZERO_CROSS_L3_PIN) + ")";
+#endif
   doc["pins"]["relayPower"] = "GPIO" + String(MOSFET_EN_PIN) + " (" + getDPinName(MOSFET_EN_PIN) + ")";
   
-  // Проверка подключения датчиков
-  // NTC датчик - проверяем, что значение не равно 0 (что означает отсутствие подключения)
-  int ntcValue = analogRead(NTC_PIN);
-  doc["sensors"]["ntcConnected"] = ntcValue > 100; // Пороговое значение для определения подключения
+  // Проверка подключения датчиков по последнему проходу АЦП
+  const TemperatureSensor& outlet = systemController->getSensors().getTemperatureSensor(TEMP_CHANNEL_OUTLET);
+  int ntcValue = outlet.getRawValue();
+  doc["sensors"]["ntcConnected"] = outlet.isConnected();
+  doc["sensors"]["inletNtcConnected"] = systemController->getSensors().isInletMeasured();
   
   // Датчик протока - проверяем, что пин настроен как вход и может читаться
   pinMode(FLOW_SENSOR_PIN, INPUT_PULLUP);
@@ -658,11 +1793,50 @@ String WebServerManager::getSensorsInfoJSON() {
     doc["values"]["flowPulseCount"] = systemController->getSensors().getFlowPulseCount();
   }
   
+  if (systemController) {
+    fillFlowCalibration(doc.createNestedObject("flowCalibration"));
+    
+    // Каналы температуры
+    const SensorManager& sensors = systemController->getSensors();
+    JsonArray channels = doc.createNestedArray("temperatures");
+    for (int ch = 0; ch < TEMP_CHANNEL_COUNT; ch++) {
+      const TemperatureSensor& sensor = sensors.getTemperatureSensor((TemperatureChannel)ch);
+      JsonObject channel = channels.createNestedObject();
+      channel["name"] = sensor.getConfig().name;
+      channel["pin"] = sensor.getConfig().pin;
+      channel["raw"] = sensor.getRawValue();
+      channel["temperature"] = sensor.getTemperature();
+      channel["offset"] = sensor.getOffset();
+      channel["connected"] = sensor.isConnected();
+    }
+    doc["values"]["inletTemperature"] = sensors.getInletTemperature();
+    doc["values"]["inletSource"] = sensors.isInletMeasured() ? "sensor" :
+                                   (sensors.isInletEstimateValid() ? "estimate" : "default");
+    
+    // Фазы питания: состояние, смещение перехода через ноль после L1
+    const PhaseController& phaseController = systemController->getPhaseController();
+    const PhaseMonitor& monitor = phaseController.getPhaseMonitor();
+    float halfPeriodUs = phaseController.getHalfPeriodUs();
+    JsonObject supply = doc.createNestedObject("phases");
+    supply["source"] = PhaseMonitor::getSourceName(monitor.getSource());
+    supply["sequence"] = PhaseMonitor::getSequenceName(monitor.getSequence());
+    supply["livePhases"] = monitor.getLiveCount();
+    JsonArray phases = supply.createNestedArray("phases");
+    for (int phase = 0; phase < 3; phase++) {
+      JsonObject item = phases.createNestedObject();
+      item["name"] = phase == 0 ? "L1" : (phase == 1 ? "L2" : "L3");
+      item["health"] = PhaseMonitor::getHealthName(monitor.getHealth(phase));
+      item["offsetUs"] = monitor.getOffsetUs(phase, halfPeriodUs);
+      item["nominalOffsetUs"] = monitor.getNominalOffsetUs(phase, halfPeriodUs);
+      item["measured"] = monitor.hasMeasuredOffset(phase);
+      item["powerPercent"] = phaseController.getPhasePower(phase);
+      item["losses"] = monitor.getLossCount(phase);
+    }
+  }
+  
   // Системная информация
   doc["system"]["uptime"] = millis() / 1000;
   doc["system"]["chipTemp"] = temperatureRead(); // Температура чипа ESP32 в Цельсиях
   
-  String response;
-  serializeJson(doc, response);
-  return response;
+  return RequestArena::serialize(doc);
 }
@@ -6,9 +6,13 @@
 #include <ArduinoJson.h>
 #include "config.h"
 #include "system_state.h"
+#include "profile_engine.h"
 
 // Предварительное объявление
 class SystemController;
+class TelemetryRecorder;
+class HistoryStore;
+class PowerManager;
 
 class WebServerManager {
 public:
@@ -16,6 +20,10 @@ public:
   void handleClient();
   void updateStatus(SystemState& state);
   void setSystemController(SystemController* controller);
+  void setTelemetryRecorder(TelemetryRecorder* recorder);
+  void setHistoryStore(HistoryStore* store);
+  void setPowerManager(PowerManager* manager);
+  void setSessionTimeout(unsigned long timeoutMs);
   
   // Управление WiFi сессией
   void startWiFiSession();
@@ -24,30 +32,63 @@ public:
   unsigned long getSessionTimeLeft() const;
   
 private:
+  friend struct BenchAccess;   // Тесты производительности (bench_suite.cpp)
+  
   WebServer server;
   SystemState* currentState = nullptr;
   SystemController* systemController = nullptr;
+  TelemetryRecorder* telemetry = nullptr;
+  HistoryStore* history = nullptr;
+  PowerManager* power = nullptr;
   
   // Состояние WiFi сессии
   bool wifiSessionActive;
   unsigned long sessionStartTime;
+  unsigned long sessionTimeoutMs = WIFI_SESSION_TIMEOUT_MS;
   
   // Обработчики веб-запросов
   void handleSaveConfig();
   void handleCalibrate();
+  void handleSafety();
+  void handleDisinfection();
   void handleEmergencyStop();
+  void handleTelemetryCSV();
+  void handleTelemetryBinary();
+  void handleTelemetryControl();
+  void handleHistory();
   
   // HTML страницы
   String getMainPage();
   String getWebInterface();
-  String getStatusJSON();
-  String getConfigJSON();
-  String getSensorsInfoJSON();
+  const char* getStatusJSON();
+  const char* getConfigJSON();
+  const char* getSensorsInfoJSON();
+  const char* getTelemetryInfoJSON();
+  const char* getFlowCalibrationJSON();
+  const char* getTraceJSON();
+  const char* getSafetyJSON();
+  const char* getDisinfectionJSON();
+  const char* getPowerJSON();
+  const char* getPerfJSON();
+  const char* getPhaseTimingJSON();
+  void handlePhaseTiming();
+  const char* getReplayJSON();
+  void handleReplayControl();
+  void handleReplayTraceDownload();
+  void handleReplayTraceUpload();
+  void handleReplayRun();
+  void handleBenchmark();
+  const char* getMemoryJSON();
+  void fillFlowCalibration(JsonObject calibration);
+  void fillProfile(JsonObject item, const PowerProfile& profile);
+  static bool parseProfile(JsonObjectConst item, PowerProfile& profile);
+  bool applyProfileConfig(JsonDocument& doc, String& rejected);
   
   // Вспомогательные функции
   void startWiFiAP();
   void setupRoutes();
   String readFileFromSPIFFS(String path);
+  void sendJson(int code, const char* json);   // JSON из RequestArena без копии в String
   String getSystemLogs();
 };
 